@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <functional>
+#include <stdint.h>
 
 namespace signalr
 {
@@ -17,8 +18,15 @@ namespace signalr
         /**
          * Register a callback to run when this token is canceled or destructed.
          * If the token is already canceled, the callback will run immediately.
+         * Returns the registration to pass to `unregister_callback`, 0 if the callback already ran.
          */
-        void register_callback(std::function<void()> callback);
+        uint64_t register_callback(std::function<void()> callback);
+
+        /**
+         * Remove a callback that hasn't run yet, e.g. once the operation it would cancel completed.
+         * Does nothing if the callback already ran or is running.
+         */
+        void unregister_callback(uint64_t registration);
 
         /**
          * Check if the token has been canceled already.
@@ -0,0 +1,44 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#include "_exports.h"
+#include <cstddef>
+
+namespace signalr
+{
+    // Which received invocations of a target `hub_connection::on` may drop when its handler falls behind. An invocation that
+    // hasn't been dispatched yet is replaced in place by a newer one with the same key, so the queued handler work is bounded by
+    // the number of distinct keys rather than by the number of messages. Only takes effect when handlers don't run on the
+    // receive thread, see `signalr_client_config::set_handler_dispatch_mode`.
+    class conflation_policy
+    {
+    public:
+        // every invocation is dispatched
+        SIGNALRCLIENT_API static conflation_policy none() noexcept;
+        // only the newest undispatched invocation of the target is kept
+        SIGNALRCLIENT_API static conflation_policy latest() noexcept;
+        // the newest undispatched invocation is kept per distinct value of the argument at `argument_index`, invocations with
+        // fewer arguments are never conflated
+        SIGNALRCLIENT_API static conflation_policy by_argument(size_t argument_index) noexcept;
+
+        SIGNALRCLIENT_API bool is_conflating() const noexcept;
+        SIGNALRCLIENT_API bool is_keyed() const noexcept;
+        SIGNALRCLIENT_API size_t get_argument_index() const noexcept;
+
+    private:
+        enum class mode
+        {
+            none,
+            latest,
+            by_argument
+        };
+
+        conflation_policy(mode mode, size_t argument_index) noexcept;
+
+        mode m_mode;
+        size_t m_argument_index;
+    };
+}
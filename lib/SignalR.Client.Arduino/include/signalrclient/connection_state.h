@@ -11,6 +11,8 @@ namespace signalr
         connecting,
         connected,
         disconnecting,
-        disconnected
+        disconnected,
+        // the connection was lost and is being reestablished, see `reconnect_policy`
+        reconnecting
     };
 }
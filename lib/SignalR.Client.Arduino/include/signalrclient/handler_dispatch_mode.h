@@ -0,0 +1,19 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+namespace signalr
+{
+    // where handlers registered with `hub_connection::on` run
+    enum class handler_dispatch_mode
+    {
+        // on the thread receiving messages, the next message isn't read until the handler returned
+        receive_thread,
+        // on the scheduler, one handler at a time in the order the messages arrived
+        connection_strand,
+        // on the scheduler, handlers for the same target run one at a time in order while different targets run in parallel
+        target_strand
+    };
+}
@@ -16,7 +16,9 @@ namespace signalr
     enum class http_method
     {
         GET,
-        POST
+        POST,
+        // not DELETE, which winnt.h defines as a macro
+        DEL
     };
 
     class http_request
@@ -29,7 +31,12 @@ namespace signalr
         http_method method;
         std::map<std::string, std::string> headers;
         std::string content;
+        // a zero timeout never expires, e.g. for a response that streams until the request is canceled
         std::chrono::seconds timeout;
+        // Optional, clients that support it hand the body of a 2xx response to this callback as it's received instead of
+        // collecting it in `http_response::content`. It's first called with no data once the response headers arrived. Clients
+        // that don't support it ignore it and return the body with the response.
+        std::function<void(const char* data, size_t size)> on_content;
     };
 
     class http_response
@@ -0,0 +1,43 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#include "_exports.h"
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+#include "signalr_value.h"
+
+namespace signalr
+{
+    class hub_connection_impl;
+
+    // Collects hub calls that `hub_connection::send_batch` writes back to back into a single transport send (i.e. one websocket
+    // frame). Results of the `invoke` calls are still delivered to each call's own callback.
+    class hub_batch
+    {
+    public:
+        SIGNALRCLIENT_API hub_batch& send(const std::string& method_name, const std::vector<signalr::value>& arguments = std::vector<signalr::value>());
+
+        SIGNALRCLIENT_API hub_batch& invoke(const std::string& method_name, const std::vector<signalr::value>& arguments = std::vector<signalr::value>(),
+            std::function<void(signalr::value&&, std::exception_ptr)> callback = [](const signalr::value&, std::exception_ptr) {});
+
+        SIGNALRCLIENT_API size_t size() const noexcept;
+
+    private:
+        friend class hub_connection_impl;
+
+        struct call
+        {
+            std::string method_name;
+            std::vector<signalr::value> arguments;
+            // empty for `send` calls which don't wait for a result
+            std::function<void(signalr::value&&, std::exception_ptr)> callback;
+        };
+
+        std::vector<call> m_calls;
+    };
+}
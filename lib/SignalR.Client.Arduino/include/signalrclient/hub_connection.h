@@ -7,11 +7,16 @@
 #include "_exports.h"
 #include <memory>
 #include <functional>
+#include <chrono>
 #include "connection_state.h"
 #include "trace_level.h"
 #include "log_writer.h"
 #include "signalr_client_config.h"
 #include "signalr_value.h"
+#include "cancellation_token.h"
+#include "stream_reader.h"
+#include "hub_batch.h"
+#include "conflation_policy.h"
 
 namespace signalr
 {
@@ -44,14 +49,57 @@ namespace signalr
 
         SIGNALRCLIENT_API void __cdecl set_disconnected(const std::function<void __cdecl(std::exception_ptr)>& disconnected_callback);
 
+        // called with the error that closed the connection when it starts reconnecting and once it is connected again, see
+        // `signalr_client_config::set_reconnect_policy`; `disconnected` is only called once the connection gives up. Invocations
+        // still waiting for a result have already failed when `reconnecting` is called.
+        SIGNALRCLIENT_API void __cdecl set_reconnecting(const std::function<void __cdecl(std::exception_ptr)>& reconnecting_callback);
+        SIGNALRCLIENT_API void __cdecl set_reconnected(const std::function<void __cdecl()>& reconnected_callback);
+
+        // called once the outbound data drained below the low watermarks after a high watermark was reached, see
+        // `signalr_client_config::set_outbound_buffer_bytes`
+        SIGNALRCLIENT_API void __cdecl set_writable(const std::function<void __cdecl()>& writable_callback);
+
         SIGNALRCLIENT_API void __cdecl set_client_config(const signalr_client_config& config);
 
-        SIGNALRCLIENT_API void __cdecl on(const std::string& event_name, const method_invoked_handler& handler);
+        SIGNALRCLIENT_API void __cdecl on(const std::string& event_name, const method_invoked_handler& handler,
+            const conflation_policy& conflation = conflation_policy::none());
+
+        // the result is handed to the callback as an rvalue, callbacks taking `signalr::value&&` (or `signalr::value`) take ownership
+        // of it without a copy while callbacks taking `const signalr::value&` keep working unchanged
+        SIGNALRCLIENT_API void invoke(const std::string& method_name, const std::vector<signalr::value>& arguments = std::vector<signalr::value>(), std::function<void(signalr::value&&, std::exception_ptr)> callback = [](const signalr::value&, std::exception_ptr) {}) noexcept;
+
+        // the invocation is completed with a `signalr_exception` if no result arrived within `timeout` (checked on the keep alive tick,
+        // so with about one second granularity) or with a `canceled_exception` once `cancellation_token` is canceled, a result
+        // arriving afterwards is ignored; only errors returned by the server are reported as `hub_exception`. A token may be shared
+        // by many invocations, each one removes what it registered with the token once it completed
+        SIGNALRCLIENT_API void invoke(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<void(signalr::value&&, std::exception_ptr)> callback, std::chrono::milliseconds timeout) noexcept;
+        SIGNALRCLIENT_API void invoke(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<void(signalr::value&&, std::exception_ptr)> callback, cancellation_token cancellation_token,
+            std::chrono::milliseconds timeout = std::chrono::milliseconds::zero()) noexcept;
 
-        SIGNALRCLIENT_API void invoke(const std::string& method_name, const std::vector<signalr::value>& arguments = std::vector<signalr::value>(), std::function<void(const signalr::value&, std::exception_ptr)> callback = [](const signalr::value&, std::exception_ptr) {}) noexcept;
+        // starts a server-to-client stream, at most `buffer_size` items that haven't been read with `stream_reader::next` are buffered
+        SIGNALRCLIENT_API stream_reader stream(const std::string& method_name, const std::vector<signalr::value>& arguments = std::vector<signalr::value>(), size_t buffer_size = 16) noexcept;
+
+        // invokes a hub method whose last parameter is a stream of byte arrays (e.g. `ChannelReader<byte[]>`), `producer` is called on the
+        // scheduler to fill up to `chunk_size` bytes at a time and returns how many it wrote, 0 ends the stream and throwing ends it with an error.
+        // At most `max_chunks_in_flight` chunks are waiting to be sent at any time so memory use doesn't depend on the size of the upload.
+        SIGNALRCLIENT_API void upload(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<size_t(uint8_t* buffer, size_t buffer_size)> producer,
+            std::function<void(signalr::value&&, std::exception_ptr)> callback = [](const signalr::value&, std::exception_ptr) {}, size_t chunk_size = 4096, size_t max_chunks_in_flight = 4) noexcept;
 
         SIGNALRCLIENT_API void send(const std::string& method_name, const std::vector<signalr::value>& arguments = std::vector<signalr::value>(), std::function<void(std::exception_ptr)> callback = [](std::exception_ptr) {}) noexcept;
 
+        // like `send` but returns false without sending anything (and without calling `callback`) while the outbound buffer is above its
+        // high watermark, wait for the writable callback before trying again. Always returns false on a moved-from instance
+        SIGNALRCLIENT_API bool try_send(const std::string& method_name, const std::vector<signalr::value>& arguments = std::vector<signalr::value>(), std::function<void(std::exception_ptr)> callback = [](std::exception_ptr) {}) noexcept;
+
+        // like `send` but a message sent with the same method name and key that is still queued (i.e. not handed to the websocket yet) is
+        // replaced by this one, so only the newest value per key goes out when the connection can't keep up. Callbacks of replaced
+        // messages run once the message replacing them was sent
+        SIGNALRCLIENT_API void send_latest(const std::string& method_name, const std::string& key, const std::vector<signalr::value>& arguments = std::vector<signalr::value>(), std::function<void(std::exception_ptr)> callback = [](std::exception_ptr) {}) noexcept;
+
+        // sends every call in the batch with a single transport send, `callback` runs once that send completed and a failed send
+        // also fails the batch's pending invocations
+        SIGNALRCLIENT_API void send_batch(hub_batch&& batch, std::function<void(std::exception_ptr)> callback = [](std::exception_ptr) {}) noexcept;
+
     private:
         friend class hub_connection_builder;
 
@@ -0,0 +1,31 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#include <chrono>
+#include <stddef.h>
+
+namespace signalr
+{
+    // Reconnecting after an established connection was lost, i.e. not after `hub_connection::stop` or a failed start. Attempt n
+    // waits min(initial_delay * 2^(n - 1), max_delay), shortened by a random fraction of up to `jitter` of it so clients that lost
+    // their connections at the same moment, e.g. to a server restart, don't all come back at once. Invocations and streams that
+    // were waiting for the server when the connection was lost fail with a `hub_exception` before reconnecting starts since the
+    // server won't complete them on the new connection, the ones started while reconnecting are sent once it is back.
+    struct reconnect_policy
+    {
+        bool enabled = false;
+        // attempts before giving up and reporting the disconnect, 0 keeps trying
+        size_t max_attempts = 10;
+        std::chrono::milliseconds initial_delay = std::chrono::milliseconds(500);
+        std::chrono::milliseconds max_delay = std::chrono::seconds(30);
+        // 0 - no jitter, 1 - anything between no delay and the full delay
+        double jitter = 1.0;
+        // messages sent while reconnecting are queued and sent once the connection is back, sends beyond this many fail
+        size_t max_queued_messages = 256;
+        // reconnect straight to the hub url over websockets, for servers that accept connections without negotiating
+        bool skip_negotiation = false;
+    };
+}
@@ -16,6 +16,9 @@
 #include <map>
 #include <string>
 #include "scheduler.h"
+#include "handler_dispatch_mode.h"
+#include "websocket_compression.h"
+#include "reconnect_policy.h"
 #include <memory>
 
 namespace signalr
@@ -51,6 +54,41 @@ namespace signalr
         SIGNALRCLIENT_API std::chrono::milliseconds get_server_timeout() const noexcept;
         SIGNALRCLIENT_API void set_keepalive_interval(std::chrono::milliseconds);
         SIGNALRCLIENT_API std::chrono::milliseconds get_keepalive_interval() const noexcept;
+        // messages queued while a send is in progress are concatenated into one websocket frame of at most this many bytes
+        SIGNALRCLIENT_API void set_max_send_batch_size(size_t max_bytes);
+        SIGNALRCLIENT_API size_t get_max_send_batch_size() const noexcept;
+        // how long a partially filled batch may wait for more messages when flushing on idle is disabled
+        SIGNALRCLIENT_API void set_max_send_delay(std::chrono::microseconds);
+        SIGNALRCLIENT_API std::chrono::microseconds get_max_send_delay() const noexcept;
+        SIGNALRCLIENT_API void set_flush_on_idle(bool flush_on_idle);
+        SIGNALRCLIENT_API bool get_flush_on_idle() const noexcept;
+        // limits on data handed to the connection but not sent yet, `hub_connection::try_send` fails once either high watermark is
+        // reached and the writable callback runs after both dropped below their low watermark again
+        SIGNALRCLIENT_API void set_outbound_buffer_bytes(size_t high_watermark, size_t low_watermark);
+        SIGNALRCLIENT_API size_t get_outbound_buffer_high_watermark_bytes() const noexcept;
+        SIGNALRCLIENT_API size_t get_outbound_buffer_low_watermark_bytes() const noexcept;
+        SIGNALRCLIENT_API void set_outbound_buffer_messages(size_t high_watermark, size_t low_watermark);
+        SIGNALRCLIENT_API size_t get_outbound_buffer_high_watermark_messages() const noexcept;
+        SIGNALRCLIENT_API size_t get_outbound_buffer_low_watermark_messages() const noexcept;
+        SIGNALRCLIENT_API void set_handler_dispatch_mode(handler_dispatch_mode mode) noexcept;
+        SIGNALRCLIENT_API handler_dispatch_mode get_handler_dispatch_mode() const noexcept;
+        // limits on received invocations waiting for their handler when handlers don't run on the receive thread, the connection
+        // stops reading from the transport once either high watermark is reached and resumes after both dropped below their low
+        // watermark again
+        SIGNALRCLIENT_API void set_inbound_backlog_bytes(size_t high_watermark, size_t low_watermark);
+        SIGNALRCLIENT_API size_t get_inbound_backlog_high_watermark_bytes() const noexcept;
+        SIGNALRCLIENT_API size_t get_inbound_backlog_low_watermark_bytes() const noexcept;
+        SIGNALRCLIENT_API void set_inbound_backlog_messages(size_t high_watermark, size_t low_watermark);
+        SIGNALRCLIENT_API size_t get_inbound_backlog_high_watermark_messages() const noexcept;
+        SIGNALRCLIENT_API size_t get_inbound_backlog_low_watermark_messages() const noexcept;
+        SIGNALRCLIENT_API void set_websocket_compression(const websocket_compression& compression);
+        SIGNALRCLIENT_API const websocket_compression& get_websocket_compression() const noexcept;
+        // a message from the server larger than this, before or after decompressing it, fails the connection instead of being
+        // buffered, enforced by the native websocket client
+        SIGNALRCLIENT_API void set_max_receive_message_size(size_t max_bytes);
+        SIGNALRCLIENT_API size_t get_max_receive_message_size() const noexcept;
+        SIGNALRCLIENT_API void set_reconnect_policy(const reconnect_policy& policy);
+        SIGNALRCLIENT_API const reconnect_policy& get_reconnect_policy() const noexcept;
 
     private:
 #ifdef USE_CPPRESTSDK
@@ -62,5 +100,20 @@ namespace signalr
         std::chrono::milliseconds m_handshake_timeout;
         std::chrono::milliseconds m_server_timeout;
         std::chrono::milliseconds m_keepalive_interval;
+        size_t m_max_send_batch_size;
+        std::chrono::microseconds m_max_send_delay;
+        bool m_flush_on_idle;
+        size_t m_outbound_high_watermark_bytes;
+        size_t m_outbound_low_watermark_bytes;
+        size_t m_outbound_high_watermark_messages;
+        size_t m_outbound_low_watermark_messages;
+        handler_dispatch_mode m_handler_dispatch_mode;
+        size_t m_inbound_high_watermark_bytes;
+        size_t m_inbound_low_watermark_bytes;
+        size_t m_inbound_high_watermark_messages;
+        size_t m_inbound_low_watermark_messages;
+        websocket_compression m_websocket_compression;
+        size_t m_max_receive_message_size;
+        reconnect_policy m_reconnect_policy;
     };
 }
@@ -0,0 +1,47 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#include "_exports.h"
+#include <memory>
+#include <functional>
+#include "signalr_value.h"
+
+namespace signalr
+{
+    class stream_reader_impl;
+    class hub_connection;
+
+    // Reads the items of a server-to-client stream started with `hub_connection::stream`. Items are pulled one at a time with `next`,
+    // the connection buffers a bounded number of items and stops reading from the server while that buffer is full.
+    // Destroying the reader before the stream completed cancels the stream on the server.
+    class stream_reader
+    {
+    public:
+        SIGNALRCLIENT_API ~stream_reader();
+
+        stream_reader(const stream_reader&) = delete;
+
+        stream_reader& operator=(const stream_reader&) = delete;
+
+        SIGNALRCLIENT_API stream_reader(stream_reader&&) noexcept;
+
+        SIGNALRCLIENT_API stream_reader& operator=(stream_reader&&) noexcept;
+
+        // the callback receives the next item, or `completed` set to true once the stream ended (with `exception` set if it failed),
+        // only one call to `next` can be outstanding at a time
+        SIGNALRCLIENT_API void next(std::function<void(signalr::value&& item, bool completed, std::exception_ptr exception)> callback) noexcept;
+
+        // asks the server to stop the stream, buffered items are dropped and pending and later `next` calls report completion
+        SIGNALRCLIENT_API void cancel() noexcept;
+
+    private:
+        friend class hub_connection;
+
+        explicit stream_reader(std::shared_ptr<stream_reader_impl> impl);
+
+        std::shared_ptr<stream_reader_impl> m_pImpl;
+    };
+}
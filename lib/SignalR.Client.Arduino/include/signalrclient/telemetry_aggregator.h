@@ -0,0 +1,49 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#include "_exports.h"
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include "scheduler.h"
+#include "signalr_value.h"
+
+namespace signalr
+{
+    class hub_connection;
+
+    // Buffers samples per target and sends them with a single `hub_connection::send` once `max_samples` samples were added or
+    // `window` passed since the first buffered sample, whichever comes first, so each sample doesn't pay for the framing of a
+    // whole hub message. The hub method receives one argument: numeric samples are packed into a byte array of little-endian
+    // doubles, other samples are sent as an array.
+    // The connection must outlive the aggregator, destroying the aggregator flushes what is still buffered.
+    class telemetry_aggregator
+    {
+    public:
+        SIGNALRCLIENT_API telemetry_aggregator(hub_connection& connection, std::shared_ptr<scheduler> scheduler, std::chrono::milliseconds window,
+            size_t max_samples = 64, std::function<void(std::exception_ptr)> sent_callback = [](std::exception_ptr) {});
+
+        SIGNALRCLIENT_API ~telemetry_aggregator();
+
+        telemetry_aggregator(const telemetry_aggregator&) = delete;
+
+        telemetry_aggregator& operator=(const telemetry_aggregator&) = delete;
+
+        // adding a sample of the other kind than the ones buffered for the target flushes them first
+        SIGNALRCLIENT_API void add(const std::string& target, double sample);
+        SIGNALRCLIENT_API void add(const std::string& target, const signalr::value& sample);
+
+        // sends everything that is buffered now
+        SIGNALRCLIENT_API void flush();
+
+    private:
+        struct state;
+
+        std::shared_ptr<state> m_state;
+    };
+}
@@ -9,6 +9,7 @@ namespace signalr
     enum class transport_type
     {
         long_polling,
-        websockets
+        websockets,
+        server_sent_events
     };
 }
@@ -6,9 +6,21 @@
 
 #include "transfer_format.h"
 #include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 namespace signalr
 {
+    class persistent_websocket_client;
+
+    // a contiguous part of a payload sent with the scatter-gather `websocket_client::send`
+    struct const_buffer
+    {
+        const char* data;
+        size_t size;
+    };
+
     class websocket_client
     {
     public:
@@ -20,6 +32,74 @@ namespace signalr
 
         virtual void send(const std::string& payload, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback) = 0;
 
+        // Sends the concatenation of `buffers` as one message. The memory the buffers point to stays valid until `callback` is
+        // called, the caller releases it afterwards so clients can write the buffers to the socket without copying them. The
+        // default implementation copies them into one string for the `send` above.
+        virtual void send(const std::vector<const_buffer>& buffers, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback)
+        {
+            size_t size = 0;
+            for (const auto& buffer : buffers)
+            {
+                size += buffer.size;
+            }
+
+            std::string payload;
+            payload.reserve(size);
+            for (const auto& buffer : buffers)
+            {
+                payload.append(buffer.data, buffer.size);
+            }
+
+            send(payload, transfer_format, callback);
+        }
+
         virtual void receive(std::function<void(const std::string&, std::exception_ptr)> callback) = 0;
+
+        // non-null if the client implements `persistent_websocket_client`, in which case `receive` is never called
+        virtual persistent_websocket_client* as_persistent() noexcept { return nullptr; }
+    };
+
+    // Alternative to the one-shot `receive`: the client delivers every received message to a handler that is registered once
+    // before `start`, so nothing needs to be allocated or re-armed per message. Clients only implementing `receive` are adapted
+    // to this internally.
+    class persistent_websocket_client : public websocket_client
+    {
+    public:
+        // Called with each received message until the client is stopped. A call with an exception ends receiving, no more
+        // messages are delivered afterwards. Once the `stop` callback ran the handler is not called anymore and no call is in progress.
+        // Clients overriding `on_owned_message` don't need to implement this one.
+        virtual void on_message(std::function<void(const std::string&, std::exception_ptr)> handler)
+        {
+            (void)handler;
+            throw std::logic_error("persistent websocket clients must override on_message or on_owned_message");
+        }
+
+        // Same as `on_message` but the handler takes ownership of the message, clients that don't reuse their frame buffer can
+        // move it in so it reaches the hub protocol without being copied. This is the handler the transport registers, the
+        // default forwards to `on_message` and copies every message.
+        virtual void on_owned_message(std::function<void(std::string&&, std::exception_ptr)> handler)
+        {
+            on_message([handler](const std::string& message, std::exception_ptr exception)
+                {
+                    handler(std::string(message), exception);
+                });
+        }
+
+        // Optional, clients that read several frames at once (e.g. everything available on the socket) can deliver them with one
+        // call to this handler instead of one `on_message` call per frame so the bookkeeping above happens once per batch. The
+        // handler takes ownership of the messages, errors are still reported through the `on_message` handler.
+        virtual void on_message_batch(std::function<void(std::vector<std::string>&&)> handler) { (void)handler; }
+
+        // Flow control, while paused the client stops reading from the socket after the message that is being delivered.
+        virtual void pause_receive() = 0;
+        virtual void resume_receive() = 0;
+
+        persistent_websocket_client* as_persistent() noexcept override { return this; }
+
+    private:
+        void receive(std::function<void(const std::string&, std::exception_ptr)> callback) override
+        {
+            callback(std::string(), std::make_exception_ptr(std::logic_error("receive is not used with persistent websocket clients")));
+        }
     };
 }
@@ -0,0 +1,30 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#include <stddef.h>
+
+namespace signalr
+{
+    // permessage-deflate (RFC 7692) settings, used by websocket clients that support the extension (the native client
+    // built with USE_ZLIB). The server may decline the extension or tighten the parameters.
+    struct websocket_compression
+    {
+        bool enabled = false;
+        // zlib compression level of sent messages, 0-9 or -1 for zlib's default
+        int level = -1;
+        // LZ77 window of sent messages (9-15), smaller windows use less memory and compress less
+        int client_max_window_bits = 15;
+        // LZ77 window the server is asked to use for the messages it sends (8-15)
+        int server_max_window_bits = 15;
+        // reset the compression state after every sent message, keeping it compresses repetitive messages far better but
+        // holds the window in memory for the lifetime of the connection
+        bool client_no_context_takeover = false;
+        // ask the server to reset its compression state after every message
+        bool server_no_context_takeover = false;
+        // smaller messages are sent uncompressed, compressing them costs more CPU than the bytes it saves
+        size_t min_message_size = 128;
+    };
+}
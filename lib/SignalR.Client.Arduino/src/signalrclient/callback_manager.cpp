@@ -4,90 +4,399 @@
 
 #include "stdafx.h"
 #include "callback_manager.h"
-#include <sstream>
+#include "signalrclient/signalr_exception.h"
+#include <algorithm>
 
 namespace signalr
 {
-    // dtor_clear_arguments will be passed when closing any pending callbacks when the `callback_manager` is
+    namespace
+    {
+        static const char digit_pairs[] =
+            "00010203040506070809"
+            "10111213141516171819"
+            "20212223242526272829"
+            "30313233343536373839"
+            "40414243444546474849"
+            "50515253545556575859"
+            "60616263646566676869"
+            "70717273747576777879"
+            "80818283848586878889"
+            "90919293949596979899";
+
+        static const size_t initial_shard_size = 16;
+        static const size_t min_compact_deadlines_at = 64;
+
+        typedef std::pair<std::chrono::steady_clock::time_point, uint64_t> deadline_entry;
+    }
+
+    // pending callbacks are completed with a `signalr_exception` carrying dtor_clear_arguments when the `callback_manager` is
     // destroyed (i.e. in the dtor)
     callback_manager::callback_manager(const char* dtor_clear_arguments)
-        : m_dtor_clear_arguments(dtor_clear_arguments)
+        : m_compact_deadlines_at(min_compact_deadlines_at), m_dtor_clear_arguments(dtor_clear_arguments)
     { }
 
     callback_manager::~callback_manager()
     {
-        clear(m_dtor_clear_arguments.data());
+        clear(std::make_exception_ptr(signalr_exception(m_dtor_clear_arguments)));
     }
 
     // note: callback must not throw except for the `on_progress` callback which will never be invoked from the dtor
-    std::string callback_manager::register_callback(const std::function<void(const char*, const signalr::value&)>& callback)
+    std::string callback_manager::register_callback(const std::function<void(std::exception_ptr, signalr::value&&)>& callback)
     {
-        auto callback_id = get_callback_id();
+        const auto callback_id = m_id++;
+
+        {
+            auto& shard = get_shard(callback_id);
+            std::lock_guard<std::mutex> lock(shard.lock);
+
+            insert_slot(shard, callback_id + 1, callback_type(callback));
+        }
+
+        return format_callback_id(callback_id);
+    }
+
+    std::string callback_manager::register_callback(const std::function<void(std::exception_ptr, signalr::value&&)>& callback, std::chrono::steady_clock::time_point deadline)
+    {
+        const auto callback_id = m_id++;
+
+        {
+            auto& shard = get_shard(callback_id);
+            std::lock_guard<std::mutex> lock(shard.lock);
+
+            insert_slot(shard, callback_id + 1, callback_type(callback));
+        }
 
         {
-            std::lock_guard<std::mutex> lock(m_map_lock);
+            std::lock_guard<std::mutex> lock(m_deadlines_lock);
 
-            m_callbacks.insert(std::make_pair(callback_id, callback));
+            m_deadlines.push_back(std::make_pair(deadline, callback_id));
+            std::push_heap(m_deadlines.begin(), m_deadlines.end(), std::greater<deadline_entry>());
+
+            if (m_deadlines.size() >= m_compact_deadlines_at)
+            {
+                compact_deadlines();
+            }
         }
 
-        return callback_id;
+        return format_callback_id(callback_id);
     }
 
+    bool callback_manager::invoke_callback(const std::string& callback_id, std::exception_ptr exception, signalr::value&& arguments, bool remove_callback)
+    {
+        uint64_t id;
+        if (!try_parse_callback_id(callback_id, id))
+        {
+            return false;
+        }
+
+        return invoke_callback(id, exception, std::move(arguments), remove_callback);
+    }
 
     // invokes a callback and stops tracking it if remove callback set to true
-    bool callback_manager::invoke_callback(const std::string& callback_id, const char* error, const signalr::value& arguments, bool remove_callback)
+    bool callback_manager::invoke_callback(uint64_t callback_id, std::exception_ptr exception, signalr::value&& arguments, bool remove_callback)
     {
-        std::function<void(const char*, const signalr::value& arguments)> callback;
+        callback_type callback;
 
         {
-            std::lock_guard<std::mutex> lock(m_map_lock);
+            auto& shard = get_shard(callback_id);
+            std::lock_guard<std::mutex> lock(shard.lock);
 
-            auto iter = m_callbacks.find(callback_id);
-            if (iter == m_callbacks.end())
+            auto index = find_slot(shard, callback_id + 1);
+            if (index == SIZE_MAX)
             {
                 return false;
             }
 
-            callback = iter->second;
-
             if (remove_callback)
             {
-                m_callbacks.erase(callback_id);
+                // the entry is going away so the callback can be moved out instead of copied
+                callback = std::move(shard.slots[index].callback);
+                erase_slot(shard, index);
+            }
+            else
+            {
+                callback = shard.slots[index].callback;
             }
         }
 
-        callback(error, arguments);
+        callback(exception, std::move(arguments));
         return true;
     }
 
     bool callback_manager::remove_callback(const std::string& callback_id)
     {
+        uint64_t id;
+        if (!try_parse_callback_id(callback_id, id))
         {
-            std::lock_guard<std::mutex> lock(m_map_lock);
+            return false;
+        }
 
-            return m_callbacks.erase(callback_id) != 0;
+        return remove_callback(id);
+    }
+
+    bool callback_manager::remove_callback(uint64_t callback_id)
+    {
+        callback_type callback;
+
+        {
+            auto& shard = get_shard(callback_id);
+            std::lock_guard<std::mutex> lock(shard.lock);
+
+            auto index = find_slot(shard, callback_id + 1);
+            if (index == SIZE_MAX)
+            {
+                return false;
+            }
+
+            // destruct the callback outside of the lock, it may own objects whose destructors call back into us
+            callback = std::move(shard.slots[index].callback);
+            erase_slot(shard, index);
         }
+
+        return true;
     }
 
-    void callback_manager::clear(const char* error)
+    void callback_manager::clear(std::exception_ptr exception)
     {
+        std::vector<callback_type> callbacks;
+
+        for (auto& shard : m_shards)
         {
-            std::lock_guard<std::mutex> lock(m_map_lock);
+            std::lock_guard<std::mutex> lock(shard.lock);
 
-            for (auto& kvp : m_callbacks)
+            for (auto& slot : shard.slots)
             {
-                kvp.second(error, signalr::value());
+                if (slot.key != 0)
+                {
+                    callbacks.push_back(std::move(slot.callback));
+                    slot.key = 0;
+                    slot.callback = nullptr;
+                }
             }
 
-            m_callbacks.clear();
+            shard.count = 0;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_deadlines_lock);
+            m_deadlines.clear();
+            m_compact_deadlines_at = min_compact_deadlines_at;
+        }
+
+        for (auto& callback : callbacks)
+        {
+            callback(exception, signalr::value());
         }
     }
 
-    std::string callback_manager::get_callback_id()
+    // completes every callback whose deadline is at or before `now` with the given exception, returns how many were completed
+    size_t callback_manager::expire_callbacks(std::chrono::steady_clock::time_point now, std::exception_ptr exception)
     {
-        const auto callback_id = m_id++;
-        std::stringstream ss;
-        ss << callback_id;
-        return ss.str();
+        std::vector<uint64_t> expired;
+
+        {
+            std::lock_guard<std::mutex> lock(m_deadlines_lock);
+
+            while (!m_deadlines.empty() && m_deadlines.front().first <= now)
+            {
+                expired.push_back(m_deadlines.front().second);
+                std::pop_heap(m_deadlines.begin(), m_deadlines.end(), std::greater<deadline_entry>());
+                m_deadlines.pop_back();
+            }
+        }
+
+        size_t expired_count = 0;
+        for (auto callback_id : expired)
+        {
+            // callbacks that already completed are no longer in the table and are skipped here
+            if (invoke_callback(callback_id, exception, signalr::value(), true))
+            {
+                expired_count++;
+            }
+        }
+
+        return expired_count;
+    }
+
+    size_t callback_manager::pending_deadlines()
+    {
+        std::lock_guard<std::mutex> lock(m_deadlines_lock);
+        return m_deadlines.size();
+    }
+
+    // Drops the entries of callbacks that completed and lets the heap grow to twice the live entries before the next
+    // compaction, so compacting stays amortized O(1) per registration.
+    void callback_manager::compact_deadlines()
+    {
+        m_deadlines.erase(std::remove_if(m_deadlines.begin(), m_deadlines.end(),
+            [this](const deadline_entry& entry) { return !is_registered(entry.second); }), m_deadlines.end());
+        std::make_heap(m_deadlines.begin(), m_deadlines.end(), std::greater<deadline_entry>());
+
+        m_compact_deadlines_at = std::max(m_deadlines.size() * 2, min_compact_deadlines_at);
+    }
+
+    bool callback_manager::is_registered(uint64_t callback_id)
+    {
+        auto& shard = get_shard(callback_id);
+        std::lock_guard<std::mutex> lock(shard.lock);
+        return find_slot(shard, callback_id + 1) != SIZE_MAX;
+    }
+
+    std::string callback_manager::format_callback_id(uint64_t callback_id)
+    {
+        // 20 digits is enough for UINT64_MAX, ids are written back to front two digits at a time
+        char buffer[20];
+        auto end = buffer + sizeof(buffer);
+        auto pos = end;
+
+        while (callback_id >= 100)
+        {
+            const auto pair = static_cast<size_t>(callback_id % 100) * 2;
+            callback_id /= 100;
+            *--pos = digit_pairs[pair + 1];
+            *--pos = digit_pairs[pair];
+        }
+
+        if (callback_id >= 10)
+        {
+            const auto pair = static_cast<size_t>(callback_id) * 2;
+            *--pos = digit_pairs[pair + 1];
+            *--pos = digit_pairs[pair];
+        }
+        else
+        {
+            *--pos = static_cast<char>('0' + callback_id);
+        }
+
+        return std::string(pos, static_cast<size_t>(end - pos));
+    }
+
+    bool callback_manager::try_parse_callback_id(const std::string& callback_id, uint64_t& parsed_id)
+    {
+        const auto length = callback_id.length();
+
+        // ids are never formatted with leading zeros so "01" can't be one of ours
+        if (length == 0 || length > 20 || (length > 1 && callback_id[0] == '0'))
+        {
+            return false;
+        }
+
+        uint64_t id = 0;
+        for (size_t i = 0; i < length; ++i)
+        {
+            const auto digit = static_cast<unsigned>(callback_id[i] - '0');
+            if (digit > 9)
+            {
+                return false;
+            }
+
+            if (id > (UINT64_MAX - digit) / 10)
+            {
+                return false;
+            }
+
+            id = id * 10 + digit;
+        }
+
+        parsed_id = id;
+        return true;
+    }
+
+    callback_manager::shard& callback_manager::get_shard(uint64_t callback_id)
+    {
+        return m_shards[callback_id % shard_count];
+    }
+
+    size_t callback_manager::find_slot(const shard& shard, uint64_t key)
+    {
+        const auto size = shard.slots.size();
+        if (size == 0)
+        {
+            return SIZE_MAX;
+        }
+
+        const auto mask = size - 1;
+        auto index = static_cast<size_t>((key - 1) / shard_count) & mask;
+        while (shard.slots[index].key != 0)
+        {
+            if (shard.slots[index].key == key)
+            {
+                return index;
+            }
+
+            index = (index + 1) & mask;
+        }
+
+        return SIZE_MAX;
+    }
+
+    void callback_manager::insert_slot(shard& shard, uint64_t key, callback_type&& callback)
+    {
+        // keep the load factor at or below 1/2 so probe sequences stay short
+        if ((shard.count + 1) * 2 > shard.slots.size())
+        {
+            grow(shard);
+        }
+
+        const auto mask = shard.slots.size() - 1;
+        auto index = static_cast<size_t>((key - 1) / shard_count) & mask;
+        while (shard.slots[index].key != 0)
+        {
+            index = (index + 1) & mask;
+        }
+
+        shard.slots[index].key = key;
+        shard.slots[index].callback = std::move(callback);
+        shard.count++;
+    }
+
+    // backward shift deletion, keeps every remaining entry reachable from its home slot without tombstones
+    void callback_manager::erase_slot(shard& shard, size_t index)
+    {
+        const auto mask = shard.slots.size() - 1;
+
+        shard.slots[index].key = 0;
+        shard.slots[index].callback = nullptr;
+        shard.count--;
+
+        auto hole = index;
+        auto next = (hole + 1) & mask;
+        while (shard.slots[next].key != 0)
+        {
+            const auto home = static_cast<size_t>((shard.slots[next].key - 1) / shard_count) & mask;
+
+            // the entry can only move into the hole if its home slot is not cyclically inside (hole, next]
+            const bool home_in_range = hole <= next
+                ? (hole < home && home <= next)
+                : (hole < home || home <= next);
+
+            if (!home_in_range)
+            {
+                shard.slots[hole].key = shard.slots[next].key;
+                shard.slots[hole].callback = std::move(shard.slots[next].callback);
+                shard.slots[next].key = 0;
+                shard.slots[next].callback = nullptr;
+                hole = next;
+            }
+
+            next = (next + 1) & mask;
+        }
+    }
+
+    void callback_manager::grow(shard& shard)
+    {
+        std::vector<slot> old_slots;
+        old_slots.swap(shard.slots);
+
+        shard.slots.resize(old_slots.empty() ? initial_shard_size : old_slots.size() * 2);
+        shard.count = 0;
+
+        for (auto& slot : old_slots)
+        {
+            if (slot.key != 0)
+            {
+                insert_slot(shard, slot.key, std::move(slot.callback));
+            }
+        }
     }
 }
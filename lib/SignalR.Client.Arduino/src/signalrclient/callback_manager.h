@@ -5,9 +5,12 @@
 #pragma once
 
 #include <atomic>
-#include <unordered_map>
+#include <vector>
 #include <functional>
 #include <mutex>
+#include <chrono>
+#include <stdint.h>
+#include <exception>
 #include "signalrclient/signalr_value.h"
 
 namespace signalr
@@ -21,17 +24,64 @@ namespace signalr
         callback_manager(const callback_manager&) = delete;
         callback_manager& operator=(const callback_manager&) = delete;
 
-        std::string register_callback(const std::function<void(const char*, const signalr::value&)>& callback);
-        bool invoke_callback(const std::string& callback_id, const char* error, const signalr::value& arguments, bool remove_callback);
+        // callbacks receive the result as an rvalue so they can take ownership of it instead of copying, or the exception the
+        // invocation failed with, which lets the caller tell e.g. an error returned by the server from a local timeout
+        std::string register_callback(const std::function<void(std::exception_ptr, signalr::value&&)>& callback);
+        // the callback is completed with `expire_callbacks`' exception if it is still registered once the deadline has passed
+        std::string register_callback(const std::function<void(std::exception_ptr, signalr::value&&)>& callback, std::chrono::steady_clock::time_point deadline);
+        bool invoke_callback(const std::string& callback_id, std::exception_ptr exception, signalr::value&& arguments, bool remove_callback);
+        bool invoke_callback(uint64_t callback_id, std::exception_ptr exception, signalr::value&& arguments, bool remove_callback);
         bool remove_callback(const std::string& callback_id);
-        void clear(const char* error);
+        bool remove_callback(uint64_t callback_id);
+        void clear(std::exception_ptr exception);
+        size_t expire_callbacks(std::chrono::steady_clock::time_point now, std::exception_ptr exception);
+        // deadlines still held, including those of callbacks that completed and weren't compacted away yet
+        size_t pending_deadlines();
+
+        // callback ids are sent as decimal strings, these convert between the wire format and the table key
+        static std::string format_callback_id(uint64_t callback_id);
+        static bool try_parse_callback_id(const std::string& callback_id, uint64_t& parsed_id);
 
     private:
-        std::atomic<int> m_id { 0 };
-        std::unordered_map<std::string, std::function<void(const char*, const signalr::value&)>> m_callbacks;
-        std::mutex m_map_lock;
+        typedef std::function<void(std::exception_ptr, signalr::value&&)> callback_type;
+
+        // open-addressing table with linear probing, `key` is the callback id + 1 so that 0 marks an empty slot
+        struct slot
+        {
+            uint64_t key = 0;
+            callback_type callback;
+        };
+
+        // ids are handed out sequentially and sharded by their low bits so concurrent invocations rarely contend
+        // on the same lock and consecutive ids within a shard land in consecutive slots
+        struct shard
+        {
+            std::mutex lock;
+            std::vector<slot> slots;
+            size_t count = 0;
+        };
+
+        static const size_t shard_count = 8;
+
+        std::atomic<uint64_t> m_id { 0 };
+        shard m_shards[shard_count];
+
+        // min-heap of deadlines shared by all callbacks, entries of callbacks that completed before their deadline are
+        // dropped lazily when they reach the top so completing a callback never has to touch the heap. Registering compacts
+        // the heap once it reached `m_compact_deadlines_at` entries so completed calls with long timeouts can't pile up.
+        std::vector<std::pair<std::chrono::steady_clock::time_point, uint64_t>> m_deadlines;
+        size_t m_compact_deadlines_at;
+        std::mutex m_deadlines_lock;
+
         std::string m_dtor_clear_arguments;
 
-        std::string get_callback_id();
+        shard& get_shard(uint64_t callback_id);
+        bool is_registered(uint64_t callback_id);
+        // must be called with `m_deadlines_lock` held
+        void compact_deadlines();
+        static size_t find_slot(const shard& shard, uint64_t key);
+        static void insert_slot(shard& shard, uint64_t key, callback_type&& callback);
+        static void erase_slot(shard& shard, size_t index);
+        static void grow(shard& shard);
     };
 }
@@ -8,16 +8,26 @@
 
 namespace signalr
 {
-    void cancellation_token::register_callback(std::function<void()> callback)
+    uint64_t cancellation_token::register_callback(std::function<void()> callback)
     {
         auto obj = mParent.lock();
         if (obj)
         {
-            obj->register_callback(callback);
+            return obj->register_callback(callback);
         }
         else
         {
             callback();
+            return 0;
+        }
+    }
+
+    void cancellation_token::unregister_callback(uint64_t registration)
+    {
+        auto obj = mParent.lock();
+        if (obj)
+        {
+            obj->unregister_callback(registration);
         }
     }
 
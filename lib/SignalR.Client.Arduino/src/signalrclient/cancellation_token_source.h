@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <assert.h>
 #include <condition_variable>
 #include <mutex>
@@ -46,7 +47,7 @@ namespace signalr
         static const unsigned int timeout_infinite;
 
         cancellation_token_source() noexcept
-            : m_signaled(false)
+            : m_signaled(false), m_next_registration(0)
         {
         }
 
@@ -57,14 +58,14 @@ namespace signalr
         bool cancel()
         {
             bool signal = false;
-            std::vector<std::function<void()>> callbacks;
+            std::vector<std::pair<uint64_t, std::function<void()>>> callbacks;
             {
                 std::lock_guard<std::mutex> lock(m_lock);
                 signal = !m_signaled;
                 m_signaled = true;
                 m_condition.notify_all();
                 callbacks = std::move(m_callbacks);
-                m_callbacks = std::vector<std::function<void()>>();
+                m_callbacks = std::vector<std::pair<uint64_t, std::function<void()>>>();
             } // unlock
 
             if (!callbacks.empty())
@@ -74,7 +75,7 @@ namespace signalr
                 {
                     try
                     {
-                        func();
+                        func.second();
                     }
                     catch (const std::exception& ex)
                     {
@@ -135,32 +136,51 @@ namespace signalr
             }
         }
 
-        void register_callback(std::function<void()> callback)
+        // returns the registration for `unregister_callback`, 0 if the source was already canceled and the callback ran
+        uint64_t register_callback(std::function<void()> callback)
         {
-            bool run_callback = false;
+            uint64_t registration = 0;
             {
                 std::lock_guard<std::mutex> lock(m_lock);
-                if (m_signaled)
+                if (!m_signaled)
                 {
-                    run_callback = m_signaled;
-                }
-                else
-                {
-                    m_callbacks.push_back(callback);
+                    registration = ++m_next_registration;
+                    m_callbacks.push_back(std::make_pair(registration, callback));
                 }
             } // unlock
 
-            if (run_callback)
+            if (registration == 0)
             {
                 callback();
             }
+
+            return registration;
+        }
+
+        void unregister_callback(uint64_t registration)
+        {
+            std::function<void()> callback;
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                auto found = std::find_if(m_callbacks.begin(), m_callbacks.end(),
+                    [registration](const std::pair<uint64_t, std::function<void()>>& entry) { return entry.first == registration; });
+                if (found == m_callbacks.end())
+                {
+                    return;
+                }
+
+                // destructed outside of the lock, it may own objects whose destructors register or unregister callbacks
+                callback = std::move(found->second);
+                m_callbacks.erase(found);
+            } // unlock
         }
 
     private:
         std::mutex m_lock;
         std::condition_variable m_condition;
         bool m_signaled;
-        std::vector<std::function<void()>> m_callbacks;
+        uint64_t m_next_registration;
+        std::vector<std::pair<uint64_t, std::function<void()>>> m_callbacks;
     };
 
     cancellation_token get_cancellation_token(std::weak_ptr<cancellation_token_source> s);
@@ -0,0 +1,43 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+#include "signalrclient/conflation_policy.h"
+
+namespace signalr
+{
+    conflation_policy::conflation_policy(mode mode, size_t argument_index) noexcept
+        : m_mode(mode), m_argument_index(argument_index)
+    { }
+
+    conflation_policy conflation_policy::none() noexcept
+    {
+        return conflation_policy(mode::none, 0);
+    }
+
+    conflation_policy conflation_policy::latest() noexcept
+    {
+        return conflation_policy(mode::latest, 0);
+    }
+
+    conflation_policy conflation_policy::by_argument(size_t argument_index) noexcept
+    {
+        return conflation_policy(mode::by_argument, argument_index);
+    }
+
+    bool conflation_policy::is_conflating() const noexcept
+    {
+        return m_mode != mode::none;
+    }
+
+    bool conflation_policy::is_keyed() const noexcept
+    {
+        return m_mode == mode::by_argument;
+    }
+
+    size_t conflation_policy::get_argument_index() const noexcept
+    {
+        return m_argument_index;
+    }
+}
@@ -8,18 +8,64 @@
 #include "connection_impl.h"
 #include "negotiate.h"
 #include "url_builder.h"
+#include "cpprest/base_uri.h"
 #include "trace_log_writer.h"
 #include "signalrclient/signalr_exception.h"
 #include "default_http_client.h"
+#include "native_http_client.h"
 #include "case_insensitive_comparison_utils.h"
 #include "completion_event.h"
 #include <assert.h>
 #include "signalrclient/websocket_client.h"
 #include "default_websocket_client.h"
+#include "native_websocket_client.h"
 #include "signalr_default_scheduler.h"
 
 namespace signalr
 {
+    namespace
+    {
+        // Maps a transport negotiate offered to the transport implementing it, returns false if this client doesn't implement
+        // it or it doesn't support `transfer_format`.
+        bool find_transport(const available_transport& available_transport, transfer_format transfer_format, transport_type& transport)
+        {
+            case_insensitive_equals comparer;
+            if (comparer(available_transport.transport, "WebSockets"))
+            {
+                transport = transport_type::websockets;
+            }
+            else if (comparer(available_transport.transport, "ServerSentEvents"))
+            {
+                transport = transport_type::server_sent_events;
+            }
+            else if (comparer(available_transport.transport, "LongPolling"))
+            {
+                transport = transport_type::long_polling;
+            }
+            else
+            {
+                return false;
+            }
+
+            auto format = transfer_format == transfer_format::binary ? "Binary" : "Text";
+            return std::any_of(available_transport.transfer_formats.begin(), available_transport.transfer_formats.end(),
+                [&comparer, format](const std::string& available_format) { return comparer(available_format, format); });
+        }
+
+        const char* translate_transport_type(transport_type transport)
+        {
+            switch (transport)
+            {
+            case transport_type::websockets:
+                return "WebSockets";
+            case transport_type::server_sent_events:
+                return "ServerSentEvents";
+            default:
+                return "LongPolling";
+            }
+        }
+    }
+
     std::shared_ptr<connection_impl> connection_impl::create(const std::string& url, trace_level trace_level, const std::shared_ptr<log_writer>& log_writer,
         std::function<std::shared_ptr<http_client>(const signalr_client_config&)> http_client_factory, std::function<std::shared_ptr<websocket_client>(const signalr_client_config&)> websocket_factory, const bool skip_negotiation)
     {
@@ -30,8 +76,17 @@ namespace signalr
     connection_impl::connection_impl(const std::string& url, trace_level trace_level, const std::shared_ptr<log_writer>& log_writer,
         std::function<std::shared_ptr<http_client>(const signalr_client_config&)> http_client_factory, std::function<std::shared_ptr<websocket_client>(const signalr_client_config&)> websocket_factory, const bool skip_negotiation)
         : m_base_url(url), m_connection_state(connection_state::disconnected), m_logger(log_writer, trace_level), m_transport(nullptr), m_skip_negotiation(skip_negotiation),
-        m_message_received([](const std::string&) noexcept {}), m_disconnected([](std::exception_ptr) noexcept {}), m_disconnect_cts(std::make_shared<cancellation_token_source>())
+        m_transfer_format(transfer_format::text),
+        m_message_received([](const std::string&) noexcept {}), m_disconnected([](std::exception_ptr) noexcept {}), m_writable([]() noexcept {}),
+        m_outbound_bytes(0), m_outbound_messages(0), m_outbound_full(false), m_disconnect_cts(std::make_shared<cancellation_token_source>())
     {
+#if !defined(USE_CPPRESTSDK) && defined(USE_NATIVE_SOCKETS)
+        // the default clients share keep-alive connections, negotiate and its redirects reuse one and the websocket is
+        // upgraded on it
+        auto connection_pool = std::make_shared<native_sockets::connection_pool>();
+        const auto custom_http_client = http_client_factory != nullptr;
+#endif
+
         if (http_client_factory != nullptr)
         {
             m_http_client_factory = std::move(http_client_factory);
@@ -40,6 +95,8 @@ namespace signalr
         {
 #ifdef USE_CPPRESTSDK
             m_http_client_factory = [](const signalr_client_config& signalr_client_config) { return std::unique_ptr<class http_client>(new default_http_client(signalr_client_config)); };
+#elif defined(USE_NATIVE_SOCKETS)
+            m_http_client_factory = [connection_pool](const signalr_client_config& signalr_client_config) { return std::make_shared<native_http_client>(signalr_client_config, connection_pool); };
 #endif
         }
 
@@ -47,6 +104,14 @@ namespace signalr
         {
 #ifdef USE_CPPRESTSDK
             websocket_factory = [](const signalr_client_config& signalr_client_config) { return std::make_shared<default_websocket_client>(signalr_client_config); };
+#elif defined(USE_NATIVE_SOCKETS)
+            websocket_factory = [connection_pool](const signalr_client_config& signalr_client_config) { return std::make_shared<native_websocket_client>(signalr_client_config, connection_pool); };
+
+            if (custom_http_client)
+            {
+                // negotiate can't leave a connection to upgrade, the websocket connects while negotiate is in flight instead
+                m_connect_ahead_pool = connection_pool;
+            }
 #endif
         }
 
@@ -130,7 +195,7 @@ namespace signalr
         std::function<void()> mFunc;
     };
 
-    void connection_impl::start(std::function<void(std::exception_ptr)> callback) noexcept
+    void connection_impl::start(std::function<void(std::exception_ptr)> callback, bool skip_negotiation) noexcept
     {
         {
             std::lock_guard<std::mutex> lock(m_stop_lock);
@@ -153,6 +218,10 @@ namespace signalr
             m_disconnect_cts->reset();
             m_start_completed_event.reset();
             m_connection_id = "";
+            m_failed_transports.clear();
+#if !defined(USE_CPPRESTSDK) && defined(USE_NATIVE_SOCKETS)
+            m_connect_ahead_to.clear();
+#endif
         }
 
         m_scheduler = m_signalr_client_config.get_scheduler();
@@ -162,10 +231,10 @@ namespace signalr
             m_signalr_client_config.set_scheduler(m_scheduler);
         }
 
-        start_negotiate(m_base_url, callback);
+        start_negotiate(m_base_url, callback, skip_negotiation || m_skip_negotiation);
     }
 
-    void connection_impl::start_negotiate(const std::string& url, std::function<void(std::exception_ptr)> callback)
+    void connection_impl::start_negotiate(const std::string& url, std::function<void(std::exception_ptr)> callback, bool skip_negotiation)
     {
         std::weak_ptr<connection_impl> weak_connection = shared_from_this();
         const auto token = m_disconnect_cts;
@@ -205,6 +274,14 @@ namespace signalr
                 return;
             }
 
+#if !defined(USE_CPPRESTSDK) && defined(USE_NATIVE_SOCKETS)
+            if (connection->m_connect_ahead_pool != nullptr)
+            {
+                // the websocket took its connection by now, one left over e.g. after falling back to another transport is unused
+                connection->m_connect_ahead_pool->close_idle();
+            }
+#endif
+
             try
             {
                 if (exception != nullptr)
@@ -296,11 +373,11 @@ namespace signalr
                 transport_started(nullptr, nullptr);
             });
 
-        if (m_skip_negotiation)
+        if (skip_negotiation)
         {
             // TODO: check that the websockets transport is explicitly selected
 
-            return start_transport(url, transport_started);
+            return start_transport(url, transport_type::websockets, transport_started);
         }
 
         start_negotiate_internal(url, 0, transport_started);
@@ -322,6 +399,28 @@ namespace signalr
         std::weak_ptr<connection_impl> weak_connection = shared_from_this();
         const auto token = m_disconnect_cts;
 
+#if !defined(USE_CPPRESTSDK) && defined(USE_NATIVE_SOCKETS)
+        if (m_connect_ahead_pool != nullptr)
+        {
+            try
+            {
+                web::uri uri(url);
+                const auto port = std::to_string(uri.port() > 0 ? uri.port() : 80);
+                if (uri.scheme() == "http" && m_connect_ahead_to != uri.host() + ":" + port)
+                {
+                    // the connection to the host negotiate was redirected away from won't be used
+                    m_connect_ahead_pool->close_idle();
+                    m_connect_ahead_to = uri.host() + ":" + port;
+                    m_connect_ahead_pool->connect_ahead(uri.host(), port);
+                }
+            }
+            catch (...)
+            {
+                // negotiate reports the invalid url
+            }
+        }
+#endif
+
         auto http_client = m_http_client_factory(m_signalr_client_config);
         negotiate::negotiate(http_client, url, m_signalr_client_config,
             [transport_started, weak_connection, redirect_count, token, url](negotiation_response&& response, std::exception_ptr exception)
@@ -372,38 +471,79 @@ namespace signalr
                 connection->m_connection_id = std::move(response.connectionId);
                 connection->m_connection_token = std::move(response.connectionToken);
 
-                // TODO: fallback logic
-
-                bool foundWebsockets = false;
+                // in the server's order of preference, without the ones that already failed to start
+                std::vector<transport_type> transports;
                 for (auto& availableTransport : response.availableTransports)
                 {
-                    case_insensitive_equals comparer;
-                    if (comparer(availableTransport.transport, "WebSockets"))
+                    transport_type transport;
+                    if (find_transport(availableTransport, connection->m_transfer_format, transport)
+                        && std::find(connection->m_failed_transports.begin(), connection->m_failed_transports.end(), transport) == connection->m_failed_transports.end())
                     {
-                        foundWebsockets = true;
-                        break;
+                        transports.push_back(transport);
                     }
                 }
 
-                if (!foundWebsockets)
+                if (transports.empty())
                 {
-                    transport_started(nullptr, std::make_exception_ptr(signalr_exception("The server does not support WebSockets which is currently the only transport supported by this client.")));
+                    transport_started(nullptr, std::make_exception_ptr(signalr_exception("The server does not support any of the transports supported by this client.")));
                     return;
                 }
 
-                // TODO: use transfer format
-
                 if (token->is_canceled())
                 {
                     transport_started(nullptr, std::make_exception_ptr(canceled_exception()));
                     return;
                 }
 
-                connection->start_transport(url, transport_started);
+                // e.g. websockets are often stripped by proxies, the next transport is tried if this one fails to start
+                auto transport = transports.front();
+                auto can_fall_back = transports.size() > 1;
+                // 0 - the attempt hasn't completed, 1 - its result was passed on, 2 - it failed and the next transport is tried
+                auto attempt_state = std::make_shared<std::atomic<int>>(0);
+                connection->start_transport(url, transport, [transport_started, weak_connection, redirect_count, token, url, transport, can_fall_back, attempt_state]
+                    (std::shared_ptr<signalr::transport> started_transport, std::exception_ptr exception)
+                    {
+                        auto fall_back = exception != nullptr && can_fall_back && !token->is_canceled();
+                        auto state = 0;
+                        if (!attempt_state->compare_exchange_strong(state, fall_back ? 2 : 1))
+                        {
+                            if (state == 1)
+                            {
+                                // e.g. an error after the transport started
+                                transport_started(started_transport, exception);
+                            }
+                            else if (started_transport)
+                            {
+                                started_transport->stop([started_transport](std::exception_ptr) {});
+                            }
+                            return;
+                        }
+
+                        if (!fall_back)
+                        {
+                            transport_started(started_transport, exception);
+                            return;
+                        }
+
+                        auto connection = weak_connection.lock();
+                        if (!connection)
+                        {
+                            transport_started(nullptr, exception);
+                            return;
+                        }
+
+                        connection->m_logger.log(trace_level::warning, std::string("the ")
+                            .append(translate_transport_type(transport)).append(" transport failed to start, falling back to the next transport"));
+
+                        // the connection token can only be used once, negotiate again for the next transport
+                        connection->m_failed_transports.push_back(transport);
+                        connection->start_negotiate_internal(url, redirect_count, transport_started);
+                    });
             }, get_cancellation_token(m_disconnect_cts));
     }
 
-    void connection_impl::start_transport(const std::string& url, std::function<void(std::shared_ptr<transport>, std::exception_ptr)> transport_started)
+    void connection_impl::start_transport(const std::string& url, transport_type transport_type,
+        std::function<void(std::shared_ptr<transport>, std::exception_ptr)> transport_started)
     {
         auto connection = shared_from_this();
 
@@ -412,7 +552,7 @@ namespace signalr
         const auto& logger = m_logger;
 
         auto transport = connection->m_transport_factory->create_transport(
-            transport_type::websockets, connection->m_logger, connection->m_signalr_client_config);
+            transport_type, connection->m_logger, connection->m_signalr_client_config);
 
         transport->on_close([weak_connection](std::exception_ptr exception)
             {
@@ -480,6 +620,26 @@ namespace signalr
                 }
             });
 
+        transport->on_receive_batch([disconnect_cts, logger, weak_connection](std::vector<std::string>&& messages)
+            {
+                if (disconnect_cts->is_canceled())
+                {
+                    if (logger.is_enabled(trace_level::info))
+                    {
+                        logger.log(trace_level::info,
+                            std::string{ "ignoring " }.append(std::to_string(messages.size()))
+                            .append(" stray messages received after connection was restarted"));
+                    }
+                    return;
+                }
+
+                auto connection = weak_connection.lock();
+                if (connection)
+                {
+                    connection->process_response_batch(std::move(messages));
+                }
+            });
+
         connection->send_connect_request(transport, url, [transport_started, transport](std::exception_ptr exception)
             {
                 if (exception == nullptr)
@@ -536,6 +696,51 @@ namespace signalr
         invoke_message_received(std::move(response));
     }
 
+    void connection_impl::process_response_batch(std::vector<std::string>&& responses)
+    {
+        if (m_logger.is_enabled(trace_level::debug))
+        {
+            for (const auto& response : responses)
+            {
+                m_logger.log(trace_level::debug,
+                    std::string("processing message: ").append(response));
+            }
+        }
+
+        if (!m_messages_received)
+        {
+            for (auto& response : responses)
+            {
+                invoke_message_received(std::move(response));
+            }
+            return;
+        }
+
+        invoke_messages_received(std::move(responses));
+    }
+
+    void connection_impl::invoke_messages_received(std::vector<std::string>&& messages)
+    {
+        try
+        {
+            m_messages_received(std::move(messages));
+        }
+        catch (const std::exception &e)
+        {
+            if (m_logger.is_enabled(trace_level::error))
+            {
+                m_logger.log(
+                    trace_level::error,
+                    std::string("message_received callback threw an exception: ")
+                    .append(e.what()));
+            }
+        }
+        catch (...)
+        {
+            m_logger.log(trace_level::error, "message_received callback threw an unknown exception");
+        }
+    }
+
     void connection_impl::invoke_message_received(std::string&& message)
     {
         try
@@ -558,7 +763,8 @@ namespace signalr
         }
     }
 
-    void connection_impl::send(const std::string& data, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback) noexcept
+    void connection_impl::send(const std::string& data, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback,
+        send_priority priority, const std::string& conflation_key) noexcept
     {
         // To prevent an (unlikely) condition where the transport is nulled out after we checked the connection_state
         // and before sending data we store the pointer in the local variable. In this case `send()` will throw but
@@ -581,8 +787,25 @@ namespace signalr
             logger.log(trace_level::info, std::string("sending data: ").append(data));
         }
 
-        transport->send(data, transfer_format, [logger, callback](std::exception_ptr exception)
+        const auto size = data.size();
+        auto outbound_bytes = (m_outbound_bytes += size);
+        auto outbound_messages = ++m_outbound_messages;
+        if (outbound_bytes >= m_signalr_client_config.get_outbound_buffer_high_watermark_bytes()
+            || outbound_messages >= m_signalr_client_config.get_outbound_buffer_high_watermark_messages())
+        {
+            m_outbound_full.store(true);
+        }
+
+        // weak_ptr prevents a circular dependency leading to memory leak and other problems
+        std::weak_ptr<connection_impl> weak_connection = shared_from_this();
+        transport->send(data, transfer_format, [logger, callback, weak_connection, size](std::exception_ptr exception)
             mutable {
+                auto connection = weak_connection.lock();
+                if (connection)
+                {
+                    connection->outbound_send_completed(size);
+                }
+
                 try
                 {
                     if (exception != nullptr)
@@ -603,7 +826,7 @@ namespace signalr
 
                     callback(exception);
                 }
-            });
+            }, priority, conflation_key);
     }
 
     void connection_impl::stop(std::function<void(std::exception_ptr)> callback, std::exception_ptr exception) noexcept
@@ -696,6 +919,10 @@ namespace signalr
     // do not use `shared_from_this` as it can be called via the destructor
     void connection_impl::stop_connection(std::exception_ptr error)
     {
+        // released after the disconnected callback ran, so messages still queued in the transport fail after pending
+        // invocations were completed with the stop error and not before
+        std::shared_ptr<transport> stopped_transport;
+        bool was_connected;
         {
             // the lock prevents a race where the user calls `stop` on a disconnected connection and calls `start`
             // on a different thread at the same time. In this case we must not null out the transport if we are
@@ -721,10 +948,30 @@ namespace signalr
                 m_stop_error = nullptr;
             }
 
+            was_connected = m_connection_state == connection_state::connected;
             change_state(connection_state::disconnected);
+            stopped_transport = std::move(m_transport);
             m_transport = nullptr;
         }
 
+        if (was_connected)
+        {
+            // the connection was lost rather than stopped, the callbacks the start registered do nothing anymore but have to
+            // go before the connection can be started again
+            try
+            {
+                m_disconnect_cts->cancel();
+            }
+            catch (const std::exception& ex)
+            {
+                if (m_logger.is_enabled(trace_level::warning))
+                {
+                    m_logger.log(trace_level::warning, std::string("disconnect event threw an exception when the connection was lost: ")
+                        .append(ex.what()));
+                }
+            }
+        }
+
         if (error)
         {
             try
@@ -787,6 +1034,18 @@ namespace signalr
         m_message_received = message_received;
     }
 
+    void connection_impl::set_messages_received(const std::function<void(std::vector<std::string>&&)>& messages_received)
+    {
+        ensure_disconnected("cannot set the callback when the connection is not in the disconnected state. ");
+        m_messages_received = messages_received;
+    }
+
+    void connection_impl::set_transfer_format(transfer_format transfer_format)
+    {
+        ensure_disconnected("cannot set the transfer format when the connection is not in the disconnected state. ");
+        m_transfer_format = transfer_format;
+    }
+
     void connection_impl::set_client_config(const signalr_client_config& config)
     {
         ensure_disconnected("cannot set client config when the connection is not in the disconnected state. ");
@@ -799,6 +1058,70 @@ namespace signalr
         m_disconnected = disconnected;
     }
 
+    void connection_impl::set_writable(const std::function<void()>& writable)
+    {
+        ensure_disconnected("cannot set the writable callback when the connection is not in the disconnected state. ");
+        m_writable = writable;
+    }
+
+    bool connection_impl::is_outbound_buffer_full() noexcept
+    {
+        if (m_outbound_bytes.load() >= m_signalr_client_config.get_outbound_buffer_high_watermark_bytes()
+            || m_outbound_messages.load() >= m_signalr_client_config.get_outbound_buffer_high_watermark_messages())
+        {
+            m_outbound_full.store(true);
+            return true;
+        }
+
+        return false;
+    }
+
+    void connection_impl::pause_receive() noexcept
+    {
+        // the transport is replaced on restart, a pause doesn't outlive the transport it was applied to
+        auto transport = m_transport;
+        if (transport)
+        {
+            transport->pause_receive();
+        }
+    }
+
+    void connection_impl::resume_receive() noexcept
+    {
+        auto transport = m_transport;
+        if (transport)
+        {
+            transport->resume_receive();
+        }
+    }
+
+    void connection_impl::outbound_send_completed(size_t size)
+    {
+        auto outbound_bytes = (m_outbound_bytes -= size);
+        auto outbound_messages = --m_outbound_messages;
+
+        if (outbound_bytes < m_signalr_client_config.get_outbound_buffer_low_watermark_bytes()
+            && outbound_messages < m_signalr_client_config.get_outbound_buffer_low_watermark_messages()
+            && m_outbound_full.exchange(false))
+        {
+            try
+            {
+                m_writable();
+            }
+            catch (const std::exception& e)
+            {
+                if (m_logger.is_enabled(trace_level::error))
+                {
+                    m_logger.log(trace_level::error, std::string("writable callback threw an exception: ").append(e.what()));
+                }
+            }
+            catch (...)
+            {
+                m_logger.log(trace_level::error, "writable callback threw an unknown exception");
+            }
+        }
+    }
+
     void connection_impl::ensure_disconnected(const std::string& error_message) const
     {
         const auto state = get_connection_state();
@@ -860,6 +1183,8 @@ namespace signalr
             return "disconnecting";
         case connection_state::disconnected:
             return "disconnected";
+        case connection_state::reconnecting:
+            return "reconnecting";
         default:
             assert(false);
             return "(unknown)";
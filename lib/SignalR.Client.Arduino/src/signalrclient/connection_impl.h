@@ -14,6 +14,7 @@
 #include "logger.h"
 #include "negotiation_response.h"
 #include "cancellation_token_source.h"
+#include "native_sockets.h"
 
 namespace signalr
 {
@@ -36,16 +37,30 @@ namespace signalr
 
         ~connection_impl();
 
-        void start(std::function<void(std::exception_ptr)> callback) noexcept;
-        void send(const std::string &data, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback) noexcept;
+        // `skip_negotiation` connects over websockets without negotiating, like the connection was created with it
+        void start(std::function<void(std::exception_ptr)> callback, bool skip_negotiation = false) noexcept;
+        void send(const std::string &data, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback,
+            send_priority priority = send_priority::data, const std::string& conflation_key = std::string()) noexcept;
         void stop(std::function<void(std::exception_ptr)> callback, std::exception_ptr exception) noexcept;
 
         connection_state get_connection_state() const noexcept;
         std::string get_connection_id() const noexcept;
 
         void set_message_received(const std::function<void(std::string&&)>& message_received);
+        // optional, receives the messages the transport received together in one call, see `transport::on_receive_batch`
+        void set_messages_received(const std::function<void(std::vector<std::string>&&)>& messages_received);
         void set_disconnected(const std::function<void(std::exception_ptr)>& disconnected);
+        void set_writable(const std::function<void()>& writable);
         void set_client_config(const signalr_client_config& config);
+        // the format of the messages that will be sent, transports that don't support it aren't used. Text by default.
+        void set_transfer_format(transfer_format transfer_format);
+
+        // true if the data that was sent but hasn't completed yet reached one of the outbound high watermarks
+        bool is_outbound_buffer_full() noexcept;
+
+        // stop/resume handing received messages to the message received callback, e.g. while they can't be processed fast enough
+        void pause_receive() noexcept;
+        void resume_receive() noexcept;
 
     private:
         std::shared_ptr<scheduler> m_scheduler;
@@ -55,29 +70,46 @@ namespace signalr
         std::shared_ptr<transport> m_transport;
         std::unique_ptr<transport_factory> m_transport_factory;
         bool m_skip_negotiation;
+        transfer_format m_transfer_format;
+        // transports that failed to start during the current start, skipped when negotiating again
+        std::vector<transport_type> m_failed_transports;
         std::exception_ptr m_stop_error;
 
         std::function<void(std::string&&)> m_message_received;
+        std::function<void(std::vector<std::string>&&)> m_messages_received;
         std::function<void(std::exception_ptr)> m_disconnected;
+        std::function<void()> m_writable;
         signalr_client_config m_signalr_client_config;
 
+        std::atomic<size_t> m_outbound_bytes;
+        std::atomic<size_t> m_outbound_messages;
+        // set once a high watermark was reached, cleared (and the writable callback invoked) when draining below the low watermarks
+        std::atomic<bool> m_outbound_full;
+
         std::shared_ptr<cancellation_token_source> m_disconnect_cts;
         std::mutex m_stop_lock;
         cancellation_token_source m_start_completed_event;
         std::string m_connection_id;
         std::string m_connection_token;
         std::function<std::shared_ptr<http_client>(const signalr_client_config&)> m_http_client_factory;
+#if !defined(USE_CPPRESTSDK) && defined(USE_NATIVE_SOCKETS)
+        // set when the default websocket client is paired with a custom http client
+        std::shared_ptr<native_sockets::connection_pool> m_connect_ahead_pool;
+        // host:port connected ahead during the current start, a start connects ahead to one negotiate host at a time
+        std::string m_connect_ahead_to;
+#endif
 
         connection_impl(const std::string& url, trace_level trace_level, const std::shared_ptr<log_writer>& log_writer,
             std::function<std::shared_ptr<http_client>(const signalr_client_config&)> http_client_factory, std::function<std::shared_ptr<websocket_client>(const signalr_client_config&)> websocket_factory, bool skip_negotiation);
 
-        void start_transport(const std::string& url, std::function<void(std::shared_ptr<transport>, std::exception_ptr)> callback);
+        void start_transport(const std::string& url, transport_type transport_type, std::function<void(std::shared_ptr<transport>, std::exception_ptr)> callback);
         void send_connect_request(const std::shared_ptr<transport>& transport,
             const std::string& url, std::function<void(std::exception_ptr)> callback);
-        void start_negotiate(const std::string& url, std::function<void(std::exception_ptr)> callback);
+        void start_negotiate(const std::string& url, std::function<void(std::exception_ptr)> callback, bool skip_negotiation);
         void start_negotiate_internal(const std::string& url, int redirect_count, std::function<void(std::shared_ptr<transport> transport, std::exception_ptr)> callback);
 
         void process_response(std::string&& response);
+        void process_response_batch(std::vector<std::string>&& responses);
 
         void shutdown(std::function<void(std::exception_ptr)> callback, bool is_dtor = false);
         void stop_connection(std::exception_ptr);
@@ -86,6 +118,8 @@ namespace signalr
         connection_state change_state(connection_state new_state);
         void handle_connection_state_change(connection_state old_state, connection_state new_state);
         void invoke_message_received(std::string&& message);
+        void invoke_messages_received(std::vector<std::string>&& messages);
+        void outbound_send_completed(size_t size);
 
         static std::string translate_connection_state(connection_state state);
         void ensure_disconnected(const std::string& error_message) const;
@@ -30,6 +30,10 @@ namespace signalr
         {
             method = U("POST");
         }
+        else if (request.method == http_method::DEL)
+        {
+            method = U("DELETE");
+        }
         else
         {
             callback(http_response(), std::make_exception_ptr(std::runtime_error("unknown http method")));
@@ -92,6 +92,41 @@ namespace signalr
             });
     }
 
+    void default_websocket_client::send(const std::vector<const_buffer>& buffers, signalr::transfer_format transfer_format, std::function<void(std::exception_ptr)> callback)
+    {
+        if (transfer_format != signalr::transfer_format::binary)
+        {
+            // utf8 messages are taken as a string
+            websocket_client::send(buffers, transfer_format, callback);
+            return;
+        }
+
+        // the buffers stay valid until the callback is called so the stream can reference them instead of a concatenated copy
+        web::websockets::client::websocket_outgoing_message msg;
+        concurrency::streams::producer_consumer_buffer<uint8_t> b;
+        size_t size = 0;
+        for (const auto& buffer : buffers)
+        {
+            b.putn_nocopy(reinterpret_cast<const uint8_t*>(buffer.data), buffer.size);
+            size += buffer.size;
+        }
+        msg.set_binary_message(b.create_istream(), size);
+
+        m_underlying_client.send(msg)
+            .then([callback](pplx::task<void> task)
+            {
+                try
+                {
+                    task.get();
+                    callback(nullptr);
+                }
+                catch (...)
+                {
+                    callback(std::current_exception());
+                }
+            });
+    }
+
     void default_websocket_client::receive(std::function<void(const std::string&, std::exception_ptr)> callback)
     {
         m_underlying_client.receive()
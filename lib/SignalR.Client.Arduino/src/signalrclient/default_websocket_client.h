@@ -23,6 +23,7 @@ namespace signalr
         void start(const std::string& url, std::function<void(std::exception_ptr)> callback);
         void stop(std::function<void(std::exception_ptr)> callback);
         void send(const std::string& payload, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback);
+        void send(const std::vector<const_buffer>& buffers, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback);
         void receive(std::function<void(const std::string&, std::exception_ptr)> callback);
     private:
         web::websockets::client::websocket_client m_underlying_client;
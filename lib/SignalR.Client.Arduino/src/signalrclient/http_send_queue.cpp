@@ -0,0 +1,167 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+#include "http_send_queue.h"
+#include "signalrclient/signalr_exception.h"
+#include <atomic>
+#include <vector>
+
+namespace signalr
+{
+    http_send_queue::http_send_queue(const signalr_client_config& signalr_client_config)
+        : m_signalr_client_config(signalr_client_config), m_open(false), m_sending(false)
+    { }
+
+    void http_send_queue::open(const std::shared_ptr<http_client>& http_client, const std::string& url,
+        const std::shared_ptr<cancellation_token_source>& cts)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_http_client = http_client;
+        m_url = url;
+        m_cts = cts;
+        m_open = true;
+    }
+
+    void http_send_queue::close(const std::string& reason)
+    {
+        std::vector<outbound_message> failed;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_open = false;
+            for (auto& queue : m_queues)
+            {
+                for (auto& message : queue)
+                {
+                    failed.push_back(std::move(message));
+                }
+                queue.clear();
+            }
+        }
+
+        for (auto& message : failed)
+        {
+            message.callback(std::make_exception_ptr(signalr_exception(reason)));
+        }
+    }
+
+    void http_send_queue::send(const std::string& payload, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback,
+        send_priority priority, const std::string& conflation_key)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            if (!m_open)
+            {
+                lock.unlock();
+                callback(std::make_exception_ptr(signalr_exception("transport is not connected")));
+                return;
+            }
+
+            auto& queue = m_queues[static_cast<size_t>(priority)];
+            if (!conflation_key.empty())
+            {
+                for (auto& queued : queue)
+                {
+                    if (queued.conflation_key == conflation_key)
+                    {
+                        queued.payload = payload;
+                        auto replaced_callback = std::move(queued.callback);
+                        queued.callback = [replaced_callback, callback](std::exception_ptr exception)
+                        {
+                            replaced_callback(exception);
+                            callback(exception);
+                        };
+                        return;
+                    }
+                }
+            }
+
+            queue.push_back(outbound_message{ payload, transfer_format, callback, conflation_key });
+            if (m_sending)
+            {
+                return;
+            }
+            m_sending = true;
+        }
+
+        send_pending();
+    }
+
+    // Must only be called by the thread that set `m_sending`, posts everything queued until the queues are empty and releases
+    // the sender role.
+    void http_send_queue::send_pending()
+    {
+        while (true)
+        {
+            http_request request;
+            std::vector<std::function<void(std::exception_ptr)>> callbacks;
+            const char* content_type;
+            std::shared_ptr<http_client> http_client;
+            std::string url;
+            std::shared_ptr<cancellation_token_source> cts;
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                // a message of the other transfer format (which connections don't mix) starts the next batch
+                auto format = transfer_format::text;
+                for (auto& queue : m_queues)
+                {
+                    while (!queue.empty() && (callbacks.empty() || queue.front().format == format))
+                    {
+                        format = queue.front().format;
+                        request.content.append(queue.front().payload);
+                        callbacks.push_back(std::move(queue.front().callback));
+                        queue.pop_front();
+                    }
+                }
+
+                if (callbacks.empty())
+                {
+                    m_sending = false;
+                    return;
+                }
+
+                content_type = format == transfer_format::binary ? "application/octet-stream" : "text/plain;charset=UTF-8";
+                http_client = m_http_client;
+                url = m_url;
+                cts = m_cts;
+            }
+
+            request.method = http_method::POST;
+            request.headers = m_signalr_client_config.get_http_headers();
+            request.headers["Content-Type"] = content_type;
+
+            // 0 - request in flight, 1 - request completed, 2 - `send` returned; whoever comes second continues sending so an
+            // http client completing requests synchronously doesn't make this recurse
+            auto send_state = std::make_shared<std::atomic<int>>(0);
+            auto weak_queue = std::weak_ptr<http_send_queue>(shared_from_this());
+            http_client->send(url, request, [weak_queue, callbacks, send_state](const http_response& response, std::exception_ptr exception)
+                {
+                    if (exception == nullptr && response.status_code / 100 != 2)
+                    {
+                        exception = std::make_exception_ptr(signalr_exception("sending the message failed with status code "
+                            + std::to_string(response.status_code)));
+                    }
+
+                    for (auto& callback : callbacks)
+                    {
+                        callback(exception);
+                    }
+
+                    if (send_state->exchange(1) == 2)
+                    {
+                        auto queue = weak_queue.lock();
+                        if (queue)
+                        {
+                            queue->send_pending();
+                        }
+                    }
+                }, get_cancellation_token(cts));
+
+            if (send_state->exchange(2) == 0)
+            {
+                return;
+            }
+        }
+    }
+}
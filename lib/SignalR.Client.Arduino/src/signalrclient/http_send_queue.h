@@ -0,0 +1,61 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#include "transport.h"
+#include "signalrclient/http_client.h"
+#include "signalrclient/signalr_client_config.h"
+#include "cancellation_token_source.h"
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace signalr
+{
+    // Sends the messages of the http based transports, one POST at a time so the server receives them in order. Messages
+    // queued while a POST is in flight go out together in the next one, the hub protocols delimit their messages so they are
+    // simply concatenated.
+    class http_send_queue : public std::enable_shared_from_this<http_send_queue>
+    {
+    public:
+        explicit http_send_queue(const signalr_client_config& signalr_client_config);
+
+        http_send_queue(const http_send_queue&) = delete;
+
+        http_send_queue& operator=(const http_send_queue&) = delete;
+
+        // messages are posted to `url` until `close` is called, canceling `cts` cancels the POST in flight
+        void open(const std::shared_ptr<http_client>& http_client, const std::string& url,
+            const std::shared_ptr<cancellation_token_source>& cts);
+        // fails the queued messages with `reason` and the ones sent until the queue is opened again
+        void close(const std::string& reason);
+
+        // see `transport::send`
+        void send(const std::string& payload, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback,
+            send_priority priority, const std::string& conflation_key);
+
+    private:
+        signalr_client_config m_signalr_client_config;
+
+        struct outbound_message
+        {
+            std::string payload;
+            transfer_format format;
+            std::function<void(std::exception_ptr)> callback;
+            std::string conflation_key;
+        };
+
+        std::mutex m_lock;
+        std::shared_ptr<http_client> m_http_client;
+        std::string m_url;
+        std::shared_ptr<cancellation_token_source> m_cts;
+        bool m_open;
+        // one queue per `send_priority`, lower ones are sent first
+        std::deque<outbound_message> m_queues[2];
+        bool m_sending;
+
+        void send_pending();
+    };
+}
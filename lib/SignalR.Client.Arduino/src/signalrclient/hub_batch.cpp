@@ -0,0 +1,32 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+#include "signalrclient/hub_batch.h"
+
+namespace signalr
+{
+    hub_batch& hub_batch::send(const std::string& method_name, const std::vector<signalr::value>& arguments)
+    {
+        m_calls.push_back(call{ method_name, arguments, nullptr });
+        return *this;
+    }
+
+    hub_batch& hub_batch::invoke(const std::string& method_name, const std::vector<signalr::value>& arguments,
+        std::function<void(signalr::value&&, std::exception_ptr)> callback)
+    {
+        if (!callback)
+        {
+            callback = [](const signalr::value&, std::exception_ptr) {};
+        }
+
+        m_calls.push_back(call{ method_name, arguments, std::move(callback) });
+        return *this;
+    }
+
+    size_t hub_batch::size() const noexcept
+    {
+        return m_calls.size();
+    }
+}
@@ -64,17 +64,17 @@ namespace signalr
         m_pImpl->stop(callback);
     }
 
-    void hub_connection::on(const std::string& event_name, const method_invoked_handler& handler)
+    void hub_connection::on(const std::string& event_name, const method_invoked_handler& handler, const conflation_policy& conflation)
     {
         if (!m_pImpl)
         {
             throw signalr_exception("on() cannot be called on destructed hub_connection instance");
         }
 
-        return m_pImpl->on(event_name, handler);
+        return m_pImpl->on(event_name, handler, conflation);
     }
 
-    void hub_connection::invoke(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<void(const signalr::value&, std::exception_ptr)> callback) noexcept
+    void hub_connection::invoke(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<void(signalr::value&&, std::exception_ptr)> callback) noexcept
     {
         if (!m_pImpl)
         {
@@ -85,6 +85,87 @@ namespace signalr
         return m_pImpl->invoke(method_name, arguments, callback);
     }
 
+    void hub_connection::invoke(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<void(signalr::value&&, std::exception_ptr)> callback, std::chrono::milliseconds timeout) noexcept
+    {
+        if (!m_pImpl)
+        {
+            callback(signalr::value(), std::make_exception_ptr(signalr_exception("invoke() cannot be called on destructed hub_connection instance")));
+            return;
+        }
+
+        return m_pImpl->invoke(method_name, arguments, callback, timeout, nullptr);
+    }
+
+    void hub_connection::invoke(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<void(signalr::value&&, std::exception_ptr)> callback, cancellation_token cancellation_token,
+        std::chrono::milliseconds timeout) noexcept
+    {
+        if (!m_pImpl)
+        {
+            callback(signalr::value(), std::make_exception_ptr(signalr_exception("invoke() cannot be called on destructed hub_connection instance")));
+            return;
+        }
+
+        return m_pImpl->invoke(method_name, arguments, callback, timeout, &cancellation_token);
+    }
+
+    stream_reader hub_connection::stream(const std::string& method_name, const std::vector<signalr::value>& arguments, size_t buffer_size) noexcept
+    {
+        if (!m_pImpl)
+        {
+            auto stream = std::make_shared<stream_reader_impl>(buffer_size);
+            stream->complete(std::make_exception_ptr(signalr_exception("stream() cannot be called on destructed hub_connection instance")));
+            return stream_reader(stream);
+        }
+
+        return stream_reader(m_pImpl->stream(method_name, arguments, buffer_size));
+    }
+
+    bool hub_connection::try_send(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<void(std::exception_ptr)> callback) noexcept
+    {
+        if (!m_pImpl)
+        {
+            // nothing is sent, a destructed instance never becomes writable again
+            return false;
+        }
+
+        return m_pImpl->try_send(method_name, arguments, callback);
+    }
+
+    void hub_connection::send_latest(const std::string& method_name, const std::string& key, const std::vector<signalr::value>& arguments,
+        std::function<void(std::exception_ptr)> callback) noexcept
+    {
+        if (!m_pImpl)
+        {
+            callback(std::make_exception_ptr(signalr_exception("send_latest() cannot be called on destructed hub_connection instance")));
+            return;
+        }
+
+        m_pImpl->send_latest(method_name, key, arguments, callback);
+    }
+
+    void hub_connection::send_batch(hub_batch&& batch, std::function<void(std::exception_ptr)> callback) noexcept
+    {
+        if (!m_pImpl)
+        {
+            callback(std::make_exception_ptr(signalr_exception("send_batch() cannot be called on destructed hub_connection instance")));
+            return;
+        }
+
+        m_pImpl->send_batch(std::move(batch), callback);
+    }
+
+    void hub_connection::upload(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<size_t(uint8_t*, size_t)> producer,
+        std::function<void(signalr::value&&, std::exception_ptr)> callback, size_t chunk_size, size_t max_chunks_in_flight) noexcept
+    {
+        if (!m_pImpl)
+        {
+            callback(signalr::value(), std::make_exception_ptr(signalr_exception("upload() cannot be called on destructed hub_connection instance")));
+            return;
+        }
+
+        m_pImpl->upload(method_name, arguments, producer, callback, chunk_size, max_chunks_in_flight);
+    }
+
     void hub_connection::send(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<void(std::exception_ptr)> callback) noexcept
     {
         if (!m_pImpl)
@@ -126,6 +207,36 @@ namespace signalr
         m_pImpl->set_disconnected(disconnected_callback);
     }
 
+    void hub_connection::set_reconnecting(const std::function<void(std::exception_ptr)>& reconnecting_callback)
+    {
+        if (!m_pImpl)
+        {
+            throw signalr_exception("set_reconnecting() cannot be called on destructed hub_connection instance");
+        }
+
+        m_pImpl->set_reconnecting(reconnecting_callback);
+    }
+
+    void hub_connection::set_reconnected(const std::function<void()>& reconnected_callback)
+    {
+        if (!m_pImpl)
+        {
+            throw signalr_exception("set_reconnected() cannot be called on destructed hub_connection instance");
+        }
+
+        m_pImpl->set_reconnected(reconnected_callback);
+    }
+
+    void hub_connection::set_writable(const std::function<void()>& writable_callback)
+    {
+        if (!m_pImpl)
+        {
+            throw signalr_exception("set_writable() cannot be called on destructed hub_connection instance");
+        }
+
+        m_pImpl->set_writable(writable_callback);
+    }
+
     void hub_connection::set_client_config(const signalr_client_config& config)
     {
         if (!m_pImpl)
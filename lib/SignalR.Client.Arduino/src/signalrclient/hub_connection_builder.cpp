@@ -7,6 +7,7 @@
 #include <stdexcept>
 #include "json_hub_protocol.h"
 #include "messagepack_hub_protocol.h"
+#include "native_sockets.h"
 
 namespace signalr
 {
@@ -90,7 +91,7 @@ namespace signalr
 
     hub_connection hub_connection_builder::build()
     {
-#ifndef USE_CPPRESTSDK
+#if !defined(USE_CPPRESTSDK) && !defined(USE_NATIVE_SOCKETS)
         if (m_http_client_factory == nullptr)
         {
             throw std::runtime_error("An http client must be provided using 'with_http_client_factory' on the builder.");
@@ -18,9 +18,12 @@ namespace signalr
     // unnamed namespace makes it invisble outside this translation unit
     namespace
     {
-        static std::function<void(const char*, const signalr::value&)> create_hub_invocation_callback(const logger& logger,
-            const std::function<void(const signalr::value&)>& set_result,
+        static std::function<void(std::exception_ptr, signalr::value&&)> create_hub_invocation_callback(const logger& logger,
+            const std::function<void(signalr::value&&)>& set_result,
             const std::function<void(const std::exception_ptr e)>& set_exception);
+
+        static size_t decoded_size(const signalr::value& value);
+        static void append_conflation_key(std::string& key, const signalr::value& value);
     }
 
     std::shared_ptr<hub_connection_impl> hub_connection_impl::create(const std::string& url, std::unique_ptr<hub_protocol>&& hub_protocol,
@@ -41,10 +44,15 @@ namespace signalr
         : m_connection(connection_impl::create(url, trace_level, log_writer, http_client_factory, websocket_factory, skip_negotiation))
             , m_logger(log_writer, trace_level),
         m_callback_manager("connection went out of scope before invocation result was received"),
-        m_handshakeReceived(false), m_disconnected([](std::exception_ptr) noexcept {}), m_protocol(std::move(hub_protocol))
+        m_handshakeReceived(false), m_disconnected([](std::exception_ptr) noexcept {}), m_protocol(std::move(hub_protocol)), m_keepalive_generation(0),
+        m_inbound_backlog_bytes(0), m_inbound_backlog_messages(0), m_full_streams(0), m_receive_paused(false), m_next_upload_stream_id(0),
+        m_reconnecting_callback([](std::exception_ptr) noexcept {}), m_reconnected_callback([]() noexcept {}),
+        m_reconnecting(false), m_reconnect_attempt(false), m_reconnect_generation(0), m_reconnect_attempts(0),
+        m_reconnect_stopped(false), m_reconnect_random(std::random_device()())
     {
         hub_message ping_msg(signalr::message_type::ping);
         m_cached_ping = m_protocol->write_message(&ping_msg);
+        m_connection->set_transfer_format(m_protocol->transfer_format());
     }
 
     void hub_connection_impl::initialize()
@@ -61,6 +69,15 @@ namespace signalr
             }
         });
 
+        m_connection->set_messages_received([weak_hub_connection](std::vector<std::string>&& messages)
+        {
+            auto connection = weak_hub_connection.lock();
+            if (connection)
+            {
+                connection->process_messages(std::move(messages));
+            }
+        });
+
         m_connection->set_disconnected([weak_hub_connection](std::exception_ptr exception)
         {
             auto connection = weak_hub_connection.lock();
@@ -81,14 +98,48 @@ namespace signalr
                     }
                 }
 
-                connection->m_callback_manager.clear("connection was stopped before invocation result was received");
+                {
+                    // the attempt fails and decides whether to try again, the invocations queued meanwhile are still waiting
+                    std::lock_guard<std::mutex> lock(connection->m_reconnect_lock);
+                    if (connection->m_reconnect_attempt)
+                    {
+                        return;
+                    }
+
+                    // reported here rather than by the stop
+                    connection->m_reconnect_stopped = false;
+                }
+
+                // this also happens before reconnecting, the server doesn't complete invocations made on a previous connection
+                connection->m_callback_manager.clear(std::make_exception_ptr(
+                    hub_exception("connection was stopped before invocation result was received")));
+
+                {
+                    // the streams were completed with an error by clearing their callbacks above
+                    std::lock_guard<std::mutex> lock(connection->m_streams_lock);
+                    connection->m_streams.clear();
+                }
+
+                bool stopping;
+                {
+                    std::lock_guard<std::mutex> lock(connection->m_stop_callback_lock);
+                    stopping = !connection->m_stop_callbacks.empty();
+                }
+
+                // only a connection that was established is reconnected, not one that failed to start or was stopped
+                if (connection->m_handshakeReceived && !stopping && connection->m_signalr_client_config.get_reconnect_policy().enabled)
+                {
+                    connection->begin_reconnect(exception);
+                    return;
+                }
 
                 connection->m_disconnected(exception);
             }
         });
     }
 
-    void hub_connection_impl::on(const std::string& event_name, const std::function<void(const std::vector<signalr::value>&)>& handler)
+    void hub_connection_impl::on(const std::string& event_name, const std::function<void(const std::vector<signalr::value>&)>& handler,
+        const conflation_policy& conflation)
     {
         if (event_name.length() == 0)
         {
@@ -109,21 +160,41 @@ namespace signalr
         }
 
         m_subscriptions.insert({event_name, handler});
+
+        if (conflation.is_conflating())
+        {
+            m_conflation.insert({ event_name, std::make_shared<conflation_state>(conflation) });
+        }
     }
 
     void hub_connection_impl::start(std::function<void(std::exception_ptr)> callback) noexcept
     {
-        if (m_connection->get_connection_state() != connection_state::disconnected)
+        if (get_connection_state() != connection_state::disconnected)
         {
             callback(std::make_exception_ptr(signalr_exception(
                 "the connection can only be started if it is in the disconnected state")));
             return;
         }
 
+        start_internal(callback, false);
+    }
+
+    void hub_connection_impl::start_internal(std::function<void(std::exception_ptr)> callback, bool skip_negotiation) noexcept
+    {
         m_connection->set_client_config(m_signalr_client_config);
         m_handshakeTask = std::make_shared<completion_event>();
         m_disconnect_cts = std::make_shared<cancellation_token_source>();
         m_handshakeReceived = false;
+        {
+            std::lock_guard<std::mutex> lock(m_handler_strands_lock);
+            m_handler_strands.clear();
+        }
+        {
+            // the new transport starts out receiving, the backlog counters are left alone since handlers posted before the
+            // restart still remove themselves from it once they ran
+            std::lock_guard<std::mutex> lock(m_inbound_backlog_lock);
+            m_receive_paused = false;
+        }
         std::weak_ptr<hub_connection_impl> weak_connection = shared_from_this();
         m_connection->start([weak_connection, callback](std::exception_ptr start_exception)
             {
@@ -137,7 +208,7 @@ namespace signalr
 
                 if (start_exception)
                 {
-                    assert(connection->get_connection_state() == connection_state::disconnected);
+                    assert(connection->m_connection->get_connection_state() == connection_state::disconnected);
                     // connection didn't start, don't call stop
                     callback(start_exception);
                     return;
@@ -259,8 +330,8 @@ namespace signalr
                     }
 
                     handle_handshake(exception, true);
-                });
-            });
+                }, send_priority::control);
+            }, skip_negotiation);
     }
 
     void hub_connection_impl::stop(std::function<void(std::exception_ptr)> callback, bool is_dtor) noexcept
@@ -277,6 +348,17 @@ namespace signalr
         }
         else
         {
+            {
+                std::lock_guard<std::mutex> lock(m_reconnect_lock);
+                if (m_reconnecting.exchange(false))
+                {
+                    // the attempt in flight or the delay before the next one, if any, is stale now
+                    ++m_reconnect_generation;
+                    m_reconnect_stopped = true;
+                }
+            }
+            fail_reconnect_queue("connection was stopped before the message was sent");
+
             {
                 std::lock_guard<std::mutex> lock(m_stop_callback_lock);
                 m_stop_callbacks.push_back(callback);
@@ -310,6 +392,19 @@ namespace signalr
                         connection->m_stop_callbacks.clear();
                     }
 
+                    bool reconnect_stopped;
+                    {
+                        std::lock_guard<std::mutex> lock(connection->m_reconnect_lock);
+                        reconnect_stopped = connection->m_reconnect_stopped;
+                        connection->m_reconnect_stopped = false;
+                    }
+
+                    // there was no connection to close between reconnect attempts, so nothing reported it yet
+                    if (reconnect_stopped)
+                    {
+                        connection->m_disconnected(nullptr);
+                    }
+
                     for (auto& callback : callbacks)
                     {
                         callback(exception);
@@ -318,7 +413,21 @@ namespace signalr
         }
     }
 
-    void hub_connection_impl::process_message(std::string&& response)
+    void hub_connection_impl::process_messages(std::vector<std::string>&& messages)
+    {
+        for (auto& message : messages)
+        {
+            process_message(std::move(message), false);
+        }
+
+        // the server timeout only needs to move once for the whole batch
+        if (m_handshakeReceived)
+        {
+            reset_server_timeout();
+        }
+    }
+
+    void hub_connection_impl::process_message(std::string&& response, bool reset_timeout)
     {
         try
         {
@@ -359,7 +468,10 @@ namespace signalr
                 }
             }
 
-            reset_server_timeout();
+            if (reset_timeout)
+            {
+                reset_server_timeout();
+            }
             auto messages = m_protocol->parse_messages(response);
 
             for (const auto& val : messages)
@@ -375,28 +487,42 @@ namespace signalr
                 case message_type::invocation:
                 {
                     auto invocation = static_cast<invocation_message*>(val.get());
-                    auto event = m_subscriptions.find(invocation->target);
-                    if (event != m_subscriptions.end())
-                    {
-                        const auto& args = invocation->arguments;
-                        event->second(args);
-                    }
-                    else
-                    {
-                        m_logger.log(trace_level::info, "handler not found");
-                    }
+                    dispatch_invocation(std::move(*invocation));
                     break;
                 }
                 case message_type::stream_invocation:
                     // Sent to server only, should not be received by client
                     throw std::runtime_error("Received unexpected message type 'StreamInvocation'");
                 case message_type::stream_item:
-                    // TODO
+                {
+                    auto stream_item = static_cast<stream_item_message*>(val.get());
+
+                    std::shared_ptr<stream_reader_impl> stream;
+                    {
+                        std::lock_guard<std::mutex> lock(m_streams_lock);
+                        auto found = m_streams.find(stream_item->invocation_id);
+                        if (found != m_streams.end())
+                        {
+                            stream = found->second;
+                        }
+                    }
+
+                    if (stream)
+                    {
+                        // a full buffer pauses the transport through the reader's full callback
+                        stream->push_item(std::move(stream_item->item));
+                    }
+                    else if (m_logger.is_enabled(trace_level::info))
+                    {
+                        m_logger.log(trace_level::info, std::string("no stream found for id: ").append(stream_item->invocation_id));
+                    }
                     break;
+                }
                 case message_type::completion:
                 {
                     auto completion = static_cast<completion_message*>(val.get());
                     invoke_callback(completion);
+                    remove_stream(completion->invocation_id);
                     break;
                 }
                 case message_type::cancel_invocation:
@@ -432,17 +558,194 @@ namespace signalr
         }
     }
 
+    void hub_connection_impl::dispatch_invocation(invocation_message&& invocation)
+    {
+        auto event = m_subscriptions.find(invocation.target);
+        if (event == m_subscriptions.end())
+        {
+            m_logger.log(trace_level::info, "handler not found");
+            return;
+        }
+
+        const auto dispatch_mode = m_signalr_client_config.get_handler_dispatch_mode();
+        if (dispatch_mode == handler_dispatch_mode::receive_thread)
+        {
+            // a throwing handler stops the connection, see `process_message`
+            event->second(invocation.arguments);
+            return;
+        }
+
+        std::shared_ptr<strand> handler_strand;
+        {
+            const auto& key = dispatch_mode == handler_dispatch_mode::target_strand ? invocation.target : std::string();
+
+            std::lock_guard<std::mutex> lock(m_handler_strands_lock);
+            auto& found = m_handler_strands[key];
+            if (!found)
+            {
+                found = std::make_shared<strand>(m_signalr_client_config.get_scheduler());
+            }
+            handler_strand = found;
+        }
+
+        // handlers are never removed and references to unordered_map elements survive rehashing, so the reference stays valid
+        // for as long as this connection lives
+        auto& handler = event->second;
+
+        size_t size = 0;
+        for (const auto& argument : invocation.arguments)
+        {
+            size += decoded_size(argument);
+        }
+
+        std::shared_ptr<conflation_state> conflation;
+        std::string conflation_key;
+        auto found_conflation = m_conflation.find(invocation.target);
+        if (found_conflation != m_conflation.end())
+        {
+            const auto& policy = found_conflation->second->policy;
+            if (!policy.is_keyed())
+            {
+                conflation = found_conflation->second;
+            }
+            else if (policy.get_argument_index() < invocation.arguments.size())
+            {
+                conflation = found_conflation->second;
+                append_conflation_key(conflation_key, invocation.arguments[policy.get_argument_index()]);
+            }
+        }
+
+        std::shared_ptr<pending_invocation> pending;
+        if (conflation)
+        {
+            std::lock_guard<std::mutex> lock(conflation->lock);
+            auto& queued = conflation->pending[conflation_key];
+            if (queued)
+            {
+                // the posted task hasn't taken the arguments yet, it will dispatch these instead
+                m_inbound_backlog_bytes += size;
+                m_inbound_backlog_bytes -= queued->size;
+                queued->arguments = std::move(invocation.arguments);
+                queued->size = size;
+            }
+            else
+            {
+                queued = std::make_shared<pending_invocation>();
+                queued->arguments = std::move(invocation.arguments);
+                queued->size = size;
+                pending = queued;
+            }
+        }
+        else
+        {
+            pending = std::make_shared<pending_invocation>();
+            pending->arguments = std::move(invocation.arguments);
+            pending->size = size;
+        }
+
+        if (!pending)
+        {
+            update_receive_paused();
+            return;
+        }
+
+        m_inbound_backlog_bytes += size;
+        ++m_inbound_backlog_messages;
+        update_receive_paused();
+
+        // weak_ptr prevents a circular dependency leading to memory leak and other problems
+        std::weak_ptr<hub_connection_impl> weak_hub_connection = shared_from_this();
+        handler_strand->post([weak_hub_connection, &handler, pending, conflation, conflation_key]()
+            {
+                auto hub_connection = weak_hub_connection.lock();
+                if (!hub_connection)
+                {
+                    return;
+                }
+
+                if (conflation)
+                {
+                    // from here on newer invocations are posted separately and `pending` is no longer modified
+                    std::lock_guard<std::mutex> lock(conflation->lock);
+                    conflation->pending.erase(conflation_key);
+                }
+
+                try
+                {
+                    handler(pending->arguments);
+                }
+                catch (const std::exception& e)
+                {
+                    // same as when the handler runs on the receive thread
+                    if (hub_connection->m_logger.is_enabled(trace_level::error))
+                    {
+                        hub_connection->m_logger.log(trace_level::error, std::string("handler threw an exception: ").append(e.what()));
+                    }
+                    hub_connection->m_connection->stop([](std::exception_ptr) {}, std::current_exception());
+                }
+                catch (...)
+                {
+                    hub_connection->m_logger.log(trace_level::error, "handler threw an unknown exception");
+                    hub_connection->m_connection->stop([](std::exception_ptr) {},
+                        std::make_exception_ptr(signalr_exception("handler threw an unknown exception")));
+                }
+
+                hub_connection->m_inbound_backlog_bytes -= pending->size;
+                --hub_connection->m_inbound_backlog_messages;
+                hub_connection->update_receive_paused();
+            });
+    }
+
+    // Pauses the transport when the inbound backlog reached one of its high watermarks or a stream reader's buffer is full and resumes
+    // it once the backlog dropped below both low watermarks and no stream buffer is full. Paused, the transport finishes the message in
+    // progress and then stops receiving so a slow handler or reader pushes back on the server instead of letting messages pile up in
+    // memory.
+    void hub_connection_impl::update_receive_paused()
+    {
+        const auto backlog_bytes = m_inbound_backlog_bytes.load();
+        const auto backlog_messages = m_inbound_backlog_messages.load();
+        const auto full_streams = m_full_streams.load();
+
+        std::lock_guard<std::mutex> lock(m_inbound_backlog_lock);
+        if (!m_receive_paused)
+        {
+            if (backlog_bytes >= m_signalr_client_config.get_inbound_backlog_high_watermark_bytes()
+                || backlog_messages >= m_signalr_client_config.get_inbound_backlog_high_watermark_messages()
+                || full_streams > 0)
+            {
+                if (m_logger.is_enabled(trace_level::debug))
+                {
+                    m_logger.log(trace_level::debug, std::string("pausing receive, inbound backlog: ")
+                        .append(std::to_string(backlog_messages)).append(" message(s), ")
+                        .append(std::to_string(backlog_bytes)).append(" byte(s), ")
+                        .append(std::to_string(full_streams)).append(" full stream buffer(s)"));
+                }
+                m_receive_paused = true;
+                m_connection->pause_receive();
+            }
+        }
+        else if (backlog_bytes < m_signalr_client_config.get_inbound_backlog_low_watermark_bytes()
+            && backlog_messages < m_signalr_client_config.get_inbound_backlog_low_watermark_messages()
+            && full_streams == 0)
+        {
+            m_logger.log(trace_level::debug, "resuming receive, inbound backlog drained");
+            m_receive_paused = false;
+            m_connection->resume_receive();
+        }
+    }
+
     bool hub_connection_impl::invoke_callback(completion_message* completion)
     {
-        const char* error = nullptr;
+        // only errors returned by the server are reported as `hub_exception`
+        std::exception_ptr error;
         if (!completion->error.empty())
         {
-            error = completion->error.data();
+            error = std::make_exception_ptr(hub_exception(completion->error));
         }
 
-        // TODO: consider transferring ownership of 'result' so that if we run user callbacks on a different thread we don't need to
-        // worry about object lifetime
-        if (!m_callback_manager.invoke_callback(completion->invocation_id, error, completion->result, true))
+        // ownership of 'result' is transferred to the callback so large results reach user code without being copied and
+        // we don't need to worry about object lifetime if user callbacks run on a different thread
+        if (!m_callback_manager.invoke_callback(completion->invocation_id, error, std::move(completion->result), true))
         {
             if (m_logger.is_enabled(trace_level::info))
             {
@@ -453,122 +756,920 @@ namespace signalr
         return true;
     }
 
-    void hub_connection_impl::invoke(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<void(const signalr::value&, std::exception_ptr)> callback) noexcept
-    {
-        const auto& callback_id = m_callback_manager.register_callback(
-            create_hub_invocation_callback(m_logger, [callback](const signalr::value& result) { callback(result, nullptr); },
-                [callback](const std::exception_ptr e) { callback(signalr::value(), e); }));
-
-        invoke_hub_method(method_name, arguments, callback_id, nullptr,
-            [callback](const std::exception_ptr e){ callback(signalr::value(), e); });
-    }
-
-    void hub_connection_impl::send(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<void(std::exception_ptr)> callback) noexcept
+    void hub_connection_impl::invoke(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<void(signalr::value&&, std::exception_ptr)> callback) noexcept
     {
-        invoke_hub_method(method_name, arguments, "",
-            [callback]() { callback(nullptr); },
-            [callback](const std::exception_ptr e){ callback(e); });
+        invoke(method_name, arguments, callback, std::chrono::milliseconds::zero(), nullptr);
     }
 
-    void hub_connection_impl::invoke_hub_method(const std::string& method_name, const std::vector<signalr::value>& arguments,
-        const std::string& callback_id, std::function<void()> set_completion, std::function<void(const std::exception_ptr)> set_exception) noexcept
+    void hub_connection_impl::invoke(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<void(signalr::value&&, std::exception_ptr)> callback,
+        std::chrono::milliseconds timeout, cancellation_token* cancellation_token) noexcept
     {
-        try
+        // the closure registered with `cancellation_token` is removed once the invocation completed so a token shared by many
+        // invocations doesn't keep one per call; `registration` is 0 until it was registered and `completed` covers the
+        // invocation completing before that
+        struct cancel_registration
         {
-            invocation_message invocation(callback_id, method_name, arguments);
-            auto message = m_protocol->write_message(&invocation);
+            std::mutex lock;
+            bool completed = false;
+            uint64_t registration = 0;
+        };
+        std::shared_ptr<cancel_registration> cancel_state;
+        if (cancellation_token != nullptr)
+        {
+            cancel_state = std::make_shared<cancel_registration>();
+            auto token = *cancellation_token;
+            auto user_callback = callback;
+            callback = [cancel_state, token, user_callback](signalr::value&& result, std::exception_ptr exception) mutable
+            {
+                uint64_t registration;
+                {
+                    std::lock_guard<std::mutex> lock(cancel_state->lock);
+                    cancel_state->completed = true;
+                    registration = cancel_state->registration;
+                }
 
-            // weak_ptr prevents a circular dependency leading to memory leak and other problems
-            auto weak_hub_connection = std::weak_ptr<hub_connection_impl>(shared_from_this());
+                if (registration != 0)
+                {
+                    token.unregister_callback(registration);
+                }
+
+                user_callback(std::move(result), exception);
+            };
+        }
+
+        auto invocation_callback = create_hub_invocation_callback(m_logger, [callback](signalr::value&& result) { callback(std::move(result), nullptr); },
+            [callback](const std::exception_ptr e) { callback(signalr::value(), e); });
+
+        // deadlines go into the callback manager's shared heap which is drained by the keep alive timer, so a call with a
+        // timeout costs one heap entry rather than a timer of its own
+        const auto& callback_id = timeout > std::chrono::milliseconds::zero()
+            ? m_callback_manager.register_callback(invocation_callback, std::chrono::steady_clock::now() + timeout)
+            : m_callback_manager.register_callback(invocation_callback);
 
-            m_connection->send(message, m_protocol->transfer_format(), [set_completion, set_exception, weak_hub_connection, callback_id](std::exception_ptr exception)
+        if (cancellation_token != nullptr)
+        {
+            std::weak_ptr<hub_connection_impl> weak_hub_connection = shared_from_this();
+            auto registration = cancellation_token->register_callback([weak_hub_connection, callback_id]()
                 {
-                    if (exception)
-                    {
-                        auto hub_connection = weak_hub_connection.lock();
-                        if (hub_connection)
-                        {
-                            hub_connection->m_callback_manager.remove_callback(callback_id);
-                        }
-                        set_exception(exception);
-                    }
-                    else
+                    auto hub_connection = weak_hub_connection.lock();
+                    if (hub_connection)
                     {
-                        if (callback_id.empty())
-                        {
-                            // complete nonBlocking call
-                            set_completion();
-                        }
+                        // no-op if the invocation already completed
+                        hub_connection->m_callback_manager.invoke_callback(callback_id, std::make_exception_ptr(canceled_exception()),
+                            signalr::value(), true);
                     }
                 });
 
-            reset_send_ping();
-        }
-        catch (const std::exception& e)
-        {
-            m_callback_manager.remove_callback(callback_id);
-            if (m_logger.is_enabled(trace_level::warning))
+            bool completed;
             {
-                m_logger.log(trace_level::warning, std::string("failed to send invocation: ").append(e.what()));
+                std::lock_guard<std::mutex> lock(cancel_state->lock);
+                completed = cancel_state->completed;
+                cancel_state->registration = registration;
+            }
+
+            if (completed && registration != 0)
+            {
+                cancellation_token->unregister_callback(registration);
+            }
+
+            if (cancellation_token->is_canceled())
+            {
+                return;
             }
-            set_exception(std::current_exception());
         }
-    }
 
-    connection_state hub_connection_impl::get_connection_state() const noexcept
-    {
-        return m_connection->get_connection_state();
+        invoke_hub_method(invocation_message(callback_id, method_name, arguments), nullptr,
+            [callback](const std::exception_ptr e){ callback(signalr::value(), e); });
     }
 
-    std::string hub_connection_impl::get_connection_id() const
+    void hub_connection_impl::send(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<void(std::exception_ptr)> callback) noexcept
     {
-        return m_connection->get_connection_id();
+        invoke_hub_method(invocation_message("", method_name, arguments),
+            [callback]() { callback(nullptr); },
+            [callback](const std::exception_ptr e){ callback(e); });
     }
 
-    void hub_connection_impl::set_client_config(const signalr_client_config& config)
+    bool hub_connection_impl::try_send(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<void(std::exception_ptr)> callback) noexcept
     {
-        m_signalr_client_config = config;
-        m_connection->set_client_config(config);
-    }
+        // the watermarks are soft limits, concurrent senders can overshoot the high watermark by one message each
+        if (m_connection->is_outbound_buffer_full())
+        {
+            return false;
+        }
 
-    void hub_connection_impl::set_disconnected(const std::function<void(std::exception_ptr)>& disconnected)
-    {
-        m_disconnected = disconnected;
+        send(method_name, arguments, callback);
+        return true;
     }
 
-    void hub_connection_impl::reset_send_ping()
+    void hub_connection_impl::send_latest(const std::string& method_name, const std::string& key, const std::vector<signalr::value>& arguments,
+        std::function<void(std::exception_ptr)> callback) noexcept
     {
-        auto timeMs = (std::chrono::steady_clock::now() + m_signalr_client_config.get_keepalive_interval()).time_since_epoch();
-        m_nextActivationSendPing.store(std::chrono::duration_cast<std::chrono::milliseconds>(timeMs).count());
-    }
+        // the method name is length prefixed so different (method, key) pairs can't end up with the same transport key
+        auto conflation_key = std::to_string(method_name.size()).append(":").append(method_name).append(key);
 
-    void hub_connection_impl::reset_server_timeout()
-    {
-        auto timeMs = (std::chrono::steady_clock::now() + m_signalr_client_config.get_server_timeout()).time_since_epoch();
-        m_nextActivationServerTimeout.store(std::chrono::duration_cast<std::chrono::milliseconds>(timeMs).count());
+        invoke_hub_method(invocation_message("", method_name, arguments),
+            [callback]() { callback(nullptr); },
+            [callback](const std::exception_ptr e) { callback(e); },
+            conflation_key);
     }
 
-    void hub_connection_impl::start_keepalive()
+    void hub_connection_impl::send_batch(hub_batch&& batch, std::function<void(std::exception_ptr)> callback) noexcept
     {
-        if (m_logger.is_enabled(trace_level::debug))
+        if (batch.m_calls.empty())
         {
-            m_logger.log(trace_level::debug, "starting keep alive timer.");
+            callback(nullptr);
+            return;
         }
 
-        auto send_ping = [](std::shared_ptr<hub_connection_impl> connection)
+        // both protocols frame each message on its own (record separator / length prefix) so the messages can simply be
+        // appended and the server parses them one by one, just like we do in `process_message`
+        std::string payload;
+        std::vector<std::pair<std::string, std::function<void(signalr::value&&, std::exception_ptr)>>> invocations;
+
+        try
         {
-            if (!connection)
+            for (auto& call : batch.m_calls)
             {
-                return;
-            }
+                std::string callback_id;
+                if (call.callback)
+                {
+                    auto invocation_callback = call.callback;
+                    callback_id = m_callback_manager.register_callback(
+                        create_hub_invocation_callback(m_logger, [invocation_callback](signalr::value&& result) { invocation_callback(std::move(result), nullptr); },
+                            [invocation_callback](const std::exception_ptr e) { invocation_callback(signalr::value(), e); }));
+                    invocations.push_back(std::make_pair(callback_id, invocation_callback));
+                }
 
-            if (connection->get_connection_state() != connection_state::connected)
-            {
-                return;
+                invocation_message invocation(std::move(callback_id), std::move(call.method_name), std::move(call.arguments));
+                payload.append(m_protocol->write_message(&invocation));
             }
-
-            try
-            {
+        }
+        catch (const std::exception& e)
+        {
+            if (m_logger.is_enabled(trace_level::warning))
+            {
+                m_logger.log(trace_level::warning, std::string("failed to send batch: ").append(e.what()));
+            }
+
+            auto exception = std::current_exception();
+            for (auto& invocation : invocations)
+            {
+                if (m_callback_manager.remove_callback(invocation.first))
+                {
+                    invocation.second(signalr::value(), exception);
+                }
+            }
+            callback(exception);
+            return;
+        }
+
+        // weak_ptr prevents a circular dependency leading to memory leak and other problems
+        std::weak_ptr<hub_connection_impl> weak_hub_connection = shared_from_this();
+        send_message(payload, [weak_hub_connection, invocations, callback](std::exception_ptr exception)
+            {
+                auto hub_connection = weak_hub_connection.lock();
+                if (exception && hub_connection)
+                {
+                    // an id that is gone was already completed (e.g. by the callback manager being cleared on disconnect or
+                    // destroyed with the hub connection), completing it again would report the invocation twice
+                    for (auto& invocation : invocations)
+                    {
+                        if (hub_connection->m_callback_manager.remove_callback(invocation.first))
+                        {
+                            invocation.second(signalr::value(), exception);
+                        }
+                    }
+                }
+                callback(exception);
+            });
+
+        reset_send_ping();
+    }
+
+    std::shared_ptr<stream_reader_impl> hub_connection_impl::stream(const std::string& method_name, const std::vector<signalr::value>& arguments, size_t buffer_size) noexcept
+    {
+        auto stream = std::make_shared<stream_reader_impl>(buffer_size);
+
+        // the completion message ends the stream, clearing the callbacks on disconnect fails it
+        const auto callback_id = m_callback_manager.register_callback(
+            create_hub_invocation_callback(m_logger, [stream](signalr::value&&) { stream->complete(nullptr); },
+                [stream](const std::exception_ptr e) { stream->complete(e); }));
+
+        {
+            std::lock_guard<std::mutex> lock(m_streams_lock);
+            m_streams.insert({ callback_id, stream });
+        }
+
+        // weak_ptr prevents a circular dependency leading to memory leak and other problems
+        std::weak_ptr<hub_connection_impl> weak_hub_connection = shared_from_this();
+        stream->set_cancel_callback([weak_hub_connection, callback_id]()
+            {
+                auto hub_connection = weak_hub_connection.lock();
+                if (hub_connection)
+                {
+                    hub_connection->cancel_stream(callback_id);
+                }
+            });
+
+        // the reader reports the buffer emptying from `next` (or the stream ending) after reporting it full, so the count can't drop
+        // below the number of full buffers
+        stream->set_full_callback([weak_hub_connection](bool full)
+            {
+                auto hub_connection = weak_hub_connection.lock();
+                if (hub_connection)
+                {
+                    if (full)
+                    {
+                        ++hub_connection->m_full_streams;
+                    }
+                    else
+                    {
+                        --hub_connection->m_full_streams;
+                    }
+                    hub_connection->update_receive_paused();
+                }
+            });
+
+        invoke_hub_method(stream_invocation_message(callback_id, method_name, arguments), nullptr,
+            [weak_hub_connection, callback_id, stream](const std::exception_ptr e)
+            {
+                auto hub_connection = weak_hub_connection.lock();
+                if (hub_connection)
+                {
+                    hub_connection->remove_stream(callback_id);
+                }
+                stream->complete(e);
+            });
+
+        return stream;
+    }
+
+    // state of a client-to-server stream, chunks are produced on the scheduler and at most `max_chunks_in_flight` chunks
+    // are handed to the connection at any time so memory use doesn't grow with the size of the upload
+    struct hub_connection_impl::upload_state
+    {
+        std::string callback_id;
+        std::string stream_id;
+        std::function<size_t(uint8_t*, size_t)> producer;
+        std::function<void(signalr::value&&, std::exception_ptr)> callback;
+        size_t chunk_size;
+        size_t max_chunks_in_flight;
+
+        std::mutex lock;
+        size_t chunks_in_flight = 0;
+        // the producer is only ever run by one thread at a time
+        bool pumping = false;
+        // set when the producer reached the end or failed, or when sending failed
+        bool finished = false;
+        bool completion_sent = false;
+        std::string error;
+    };
+
+    void hub_connection_impl::upload(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<size_t(uint8_t*, size_t)> producer,
+        std::function<void(signalr::value&&, std::exception_ptr)> callback, size_t chunk_size, size_t max_chunks_in_flight) noexcept
+    {
+        auto upload = std::make_shared<upload_state>();
+        upload->stream_id = callback_manager::format_callback_id(m_next_upload_stream_id++);
+        upload->producer = std::move(producer);
+        upload->callback = callback;
+        upload->chunk_size = chunk_size == 0 ? 1 : chunk_size;
+        upload->max_chunks_in_flight = max_chunks_in_flight == 0 ? 1 : max_chunks_in_flight;
+
+        upload->callback_id = m_callback_manager.register_callback(
+            create_hub_invocation_callback(m_logger, [callback](signalr::value&& result) { callback(std::move(result), nullptr); },
+                [callback](const std::exception_ptr e) { callback(signalr::value(), e); }));
+
+        auto failed = std::make_shared<std::atomic<bool>>(false);
+        invoke_hub_method(invocation_message(upload->callback_id, method_name, arguments, std::vector<std::string> { upload->stream_id }), nullptr,
+            [callback, upload, failed](const std::exception_ptr e)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(upload->lock);
+                    upload->finished = true;
+                    upload->completion_sent = true;
+                }
+                *failed = true;
+                callback(signalr::value(), e);
+            });
+
+        if (*failed)
+        {
+            return;
+        }
+
+        std::weak_ptr<hub_connection_impl> weak_hub_connection = shared_from_this();
+        m_signalr_client_config.get_scheduler()->schedule([weak_hub_connection, upload]()
+            {
+                auto hub_connection = weak_hub_connection.lock();
+                if (hub_connection)
+                {
+                    hub_connection->pump_upload(upload);
+                }
+            });
+    }
+
+    void hub_connection_impl::pump_upload(const std::shared_ptr<upload_state>& upload)
+    {
+        std::unique_lock<std::mutex> lock(upload->lock);
+
+        if (upload->pumping)
+        {
+            return;
+        }
+        upload->pumping = true;
+
+        while (!upload->finished && upload->chunks_in_flight < upload->max_chunks_in_flight)
+        {
+            lock.unlock();
+
+            std::vector<uint8_t> chunk(upload->chunk_size);
+            size_t produced = 0;
+            std::string error;
+            try
+            {
+                produced = upload->producer(chunk.data(), chunk.size());
+                if (produced > chunk.size())
+                {
+                    throw signalr_exception("upload producer returned more bytes than the chunk size");
+                }
+            }
+            catch (const std::exception& e)
+            {
+                error = std::string("upload producer failed: ").append(e.what());
+            }
+            catch (...)
+            {
+                error = "upload producer failed";
+            }
+
+            lock.lock();
+
+            if (upload->finished)
+            {
+                break;
+            }
+
+            if (!error.empty() || produced == 0)
+            {
+                upload->finished = true;
+                upload->error = std::move(error);
+                break;
+            }
+
+            upload->chunks_in_flight++;
+            lock.unlock();
+
+            chunk.resize(produced);
+            std::string message;
+            std::exception_ptr exception;
+            try
+            {
+                stream_item_message stream_item(upload->stream_id, signalr::value(std::move(chunk)));
+                message = m_protocol->write_message(&stream_item);
+            }
+            catch (...)
+            {
+                exception = std::current_exception();
+            }
+
+            if (exception)
+            {
+                upload_chunk_sent(upload, exception);
+            }
+            else
+            {
+                std::weak_ptr<hub_connection_impl> weak_hub_connection = shared_from_this();
+                send_message(message, [weak_hub_connection, upload](std::exception_ptr exception)
+                    {
+                        auto hub_connection = weak_hub_connection.lock();
+                        if (hub_connection)
+                        {
+                            hub_connection->upload_chunk_sent(upload, exception);
+                        }
+                    });
+                reset_send_ping();
+            }
+
+            lock.lock();
+        }
+
+        upload->pumping = false;
+        lock.unlock();
+
+        complete_upload(upload);
+    }
+
+    void hub_connection_impl::upload_chunk_sent(const std::shared_ptr<upload_state>& upload, std::exception_ptr exception)
+    {
+        bool pump = false;
+
+        {
+            std::lock_guard<std::mutex> lock(upload->lock);
+
+            upload->chunks_in_flight--;
+
+            if (exception)
+            {
+                if (upload->completion_sent)
+                {
+                    return;
+                }
+
+                // the server can't make sense of a stream with a missing chunk, fail the invocation instead of completing the stream
+                upload->finished = true;
+                upload->completion_sent = true;
+            }
+            else
+            {
+                // a running pump picks up the free slot itself
+                pump = !upload->finished && !upload->pumping;
+            }
+        }
+
+        if (exception)
+        {
+            if (m_logger.is_enabled(trace_level::warning))
+            {
+                m_logger.log(trace_level::warning, std::string("failed to send upload chunk for stream id: ").append(upload->stream_id));
+            }
+
+            if (m_callback_manager.remove_callback(upload->callback_id))
+            {
+                upload->callback(signalr::value(), exception);
+            }
+            return;
+        }
+
+        if (pump)
+        {
+            // the producer may block so it never runs on the thread completing the send
+            std::weak_ptr<hub_connection_impl> weak_hub_connection = shared_from_this();
+            m_signalr_client_config.get_scheduler()->schedule([weak_hub_connection, upload]()
+                {
+                    auto hub_connection = weak_hub_connection.lock();
+                    if (hub_connection)
+                    {
+                        hub_connection->pump_upload(upload);
+                    }
+                });
+        }
+        else
+        {
+            complete_upload(upload);
+        }
+    }
+
+    // sends the completion for the stream once the producer is done and every chunk has been handed to the transport
+    void hub_connection_impl::complete_upload(const std::shared_ptr<upload_state>& upload)
+    {
+        std::string error;
+
+        {
+            std::lock_guard<std::mutex> lock(upload->lock);
+
+            if (!upload->finished || upload->pumping || upload->chunks_in_flight != 0 || upload->completion_sent)
+            {
+                return;
+            }
+
+            upload->completion_sent = true;
+            error = upload->error;
+        }
+
+        try
+        {
+            completion_message completion(upload->stream_id, error, signalr::value(), false);
+            auto message = m_protocol->write_message(&completion);
+
+            std::weak_ptr<hub_connection_impl> weak_hub_connection = shared_from_this();
+            send_message(message, [weak_hub_connection, upload](std::exception_ptr exception)
+                {
+                    auto hub_connection = weak_hub_connection.lock();
+                    if (exception && hub_connection && hub_connection->m_callback_manager.remove_callback(upload->callback_id))
+                    {
+                        upload->callback(signalr::value(), exception);
+                    }
+                });
+        }
+        catch (const std::exception& e)
+        {
+            if (m_logger.is_enabled(trace_level::warning))
+            {
+                m_logger.log(trace_level::warning, std::string("failed to complete upload: ").append(e.what()));
+            }
+
+            if (m_callback_manager.remove_callback(upload->callback_id))
+            {
+                upload->callback(signalr::value(), std::current_exception());
+            }
+        }
+    }
+
+    std::shared_ptr<stream_reader_impl> hub_connection_impl::remove_stream(const std::string& invocation_id)
+    {
+        std::lock_guard<std::mutex> lock(m_streams_lock);
+
+        auto found = m_streams.find(invocation_id);
+        if (found == m_streams.end())
+        {
+            return nullptr;
+        }
+
+        auto stream = std::move(found->second);
+        m_streams.erase(found);
+        return stream;
+    }
+
+    void hub_connection_impl::cancel_stream(const std::string& invocation_id)
+    {
+        remove_stream(invocation_id);
+
+        // only tell the server if the stream was still running, i.e. its completion hadn't arrived yet
+        if (!m_callback_manager.remove_callback(invocation_id))
+        {
+            return;
+        }
+
+        if (get_connection_state() != connection_state::connected)
+        {
+            return;
+        }
+
+        try
+        {
+            cancel_invocation_message cancel_invocation(invocation_id);
+            auto message = m_protocol->write_message(&cancel_invocation);
+
+            std::weak_ptr<hub_connection_impl> weak_hub_connection = shared_from_this();
+            m_connection->send(message, m_protocol->transfer_format(), [weak_hub_connection](std::exception_ptr exception)
+                {
+                    auto hub_connection = weak_hub_connection.lock();
+                    if (exception && hub_connection && hub_connection->m_logger.is_enabled(trace_level::warning))
+                    {
+                        hub_connection->m_logger.log(trace_level::warning, "failed to send stream cancellation");
+                    }
+                });
+        }
+        catch (const std::exception& e)
+        {
+            if (m_logger.is_enabled(trace_level::warning))
+            {
+                m_logger.log(trace_level::warning, std::string("failed to send stream cancellation: ").append(e.what()));
+            }
+        }
+    }
+
+    void hub_connection_impl::invoke_hub_method(const invocation_message& invocation, std::function<void()> set_completion,
+        std::function<void(const std::exception_ptr)> set_exception, const std::string& conflation_key) noexcept
+    {
+        const auto& callback_id = invocation.invocation_id;
+
+        try
+        {
+            auto message = m_protocol->write_message(&invocation);
+
+            // weak_ptr prevents a circular dependency leading to memory leak and other problems
+            auto weak_hub_connection = std::weak_ptr<hub_connection_impl>(shared_from_this());
+
+            send_message(message, [set_completion, set_exception, weak_hub_connection, callback_id](std::exception_ptr exception)
+                {
+                    if (exception)
+                    {
+                        // the send can fail after the invocation was already completed, e.g. by its result arriving while the
+                        // message was still queued in the transport or by the connection stopping, don't complete it twice
+                        auto hub_connection = weak_hub_connection.lock();
+                        if (callback_id.empty() || (hub_connection && hub_connection->m_callback_manager.remove_callback(callback_id)))
+                        {
+                            set_exception(exception);
+                        }
+                    }
+                    else
+                    {
+                        if (callback_id.empty())
+                        {
+                            // complete nonBlocking call
+                            set_completion();
+                        }
+                    }
+                }, send_priority::data, conflation_key);
+
+            reset_send_ping();
+        }
+        catch (const std::exception& e)
+        {
+            m_callback_manager.remove_callback(callback_id);
+            if (m_logger.is_enabled(trace_level::warning))
+            {
+                m_logger.log(trace_level::warning, std::string("failed to send invocation: ").append(e.what()));
+            }
+            set_exception(std::current_exception());
+        }
+    }
+
+    connection_state hub_connection_impl::get_connection_state() const noexcept
+    {
+        return m_reconnecting ? connection_state::reconnecting : m_connection->get_connection_state();
+    }
+
+    std::string hub_connection_impl::get_connection_id() const
+    {
+        return m_connection->get_connection_id();
+    }
+
+    void hub_connection_impl::set_client_config(const signalr_client_config& config)
+    {
+        m_signalr_client_config = config;
+        m_connection->set_client_config(config);
+    }
+
+    void hub_connection_impl::set_disconnected(const std::function<void(std::exception_ptr)>& disconnected)
+    {
+        m_disconnected = disconnected;
+    }
+
+    void hub_connection_impl::set_writable(const std::function<void()>& writable)
+    {
+        m_connection->set_writable(writable);
+    }
+
+    void hub_connection_impl::set_reconnecting(const std::function<void(std::exception_ptr)>& reconnecting)
+    {
+        m_reconnecting_callback = reconnecting;
+    }
+
+    void hub_connection_impl::set_reconnected(const std::function<void()>& reconnected)
+    {
+        m_reconnected_callback = reconnected;
+    }
+
+    std::chrono::milliseconds hub_connection_impl::get_reconnect_delay(const reconnect_policy& policy, size_t attempt, double random)
+    {
+        // stops doubling at the max delay, so the delay can't overflow however many attempts were made
+        auto delay = policy.initial_delay;
+        for (size_t i = 1; i < attempt && delay.count() > 0 && delay < policy.max_delay; ++i)
+        {
+            delay *= 2;
+        }
+        delay = std::min(delay, policy.max_delay);
+
+        return std::chrono::milliseconds(static_cast<std::chrono::milliseconds::rep>(delay.count() * (1 - policy.jitter * random)));
+    }
+
+    void hub_connection_impl::begin_reconnect(std::exception_ptr exception)
+    {
+        uint64_t generation;
+        {
+            std::lock_guard<std::mutex> lock(m_reconnect_lock);
+            m_reconnecting = true;
+            m_reconnect_attempts = 0;
+            generation = ++m_reconnect_generation;
+        }
+
+        if (m_logger.is_enabled(trace_level::info))
+        {
+            m_logger.log(trace_level::info, "connection lost, reconnecting");
+        }
+
+        m_reconnecting_callback(exception);
+        schedule_reconnect(generation);
+    }
+
+    void hub_connection_impl::schedule_reconnect(uint64_t generation)
+    {
+        const auto& policy = m_signalr_client_config.get_reconnect_policy();
+        size_t attempt;
+        double random;
+        {
+            std::lock_guard<std::mutex> lock(m_reconnect_lock);
+            if (generation != m_reconnect_generation)
+            {
+                return;
+            }
+
+            attempt = ++m_reconnect_attempts;
+            random = std::uniform_real_distribution<double>(0, 1)(m_reconnect_random);
+        }
+
+        auto delay = get_reconnect_delay(policy, attempt, random);
+        if (m_logger.is_enabled(trace_level::debug))
+        {
+            m_logger.log(trace_level::debug, std::string("reconnect attempt ").append(std::to_string(attempt))
+                .append(" in ").append(std::to_string(delay.count())).append(" ms"));
+        }
+
+        std::weak_ptr<hub_connection_impl> weak_connection = shared_from_this();
+        m_signalr_client_config.get_scheduler()->schedule([weak_connection, generation]()
+            {
+                auto connection = weak_connection.lock();
+                if (connection)
+                {
+                    connection->attempt_reconnect(generation);
+                }
+            }, delay);
+    }
+
+    void hub_connection_impl::attempt_reconnect(uint64_t generation)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_reconnect_lock);
+            if (generation != m_reconnect_generation)
+            {
+                return;
+            }
+            m_reconnect_attempt = true;
+        }
+
+        std::weak_ptr<hub_connection_impl> weak_connection = shared_from_this();
+        start_internal([weak_connection, generation](std::exception_ptr exception)
+            {
+                auto connection = weak_connection.lock();
+                if (connection)
+                {
+                    connection->complete_reconnect(generation, exception);
+                }
+            }, m_signalr_client_config.get_reconnect_policy().skip_negotiation);
+    }
+
+    void hub_connection_impl::complete_reconnect(uint64_t generation, std::exception_ptr exception)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_reconnect_lock);
+            m_reconnect_attempt = false;
+            if (generation != m_reconnect_generation)
+            {
+                return;
+            }
+        }
+
+        if (exception)
+        {
+            try
+            {
+                std::rethrow_exception(exception);
+            }
+            catch (const std::exception& e)
+            {
+                if (m_logger.is_enabled(trace_level::warning))
+                {
+                    m_logger.log(trace_level::warning, std::string("reconnect attempt failed: ").append(e.what()));
+                }
+            }
+
+            const auto max_attempts = m_signalr_client_config.get_reconnect_policy().max_attempts;
+            {
+                std::lock_guard<std::mutex> lock(m_reconnect_lock);
+                if (max_attempts == 0 || m_reconnect_attempts < max_attempts)
+                {
+                    generation = m_reconnect_generation;
+                    exception = nullptr;
+                }
+                else
+                {
+                    m_reconnecting = false;
+                    ++m_reconnect_generation;
+                }
+            }
+
+            if (exception == nullptr)
+            {
+                schedule_reconnect(generation);
+                return;
+            }
+
+            if (m_logger.is_enabled(trace_level::error))
+            {
+                m_logger.log(trace_level::error, "giving up reconnecting");
+            }
+            fail_reconnect_queue("connection could not be reestablished before the message was sent");
+            m_disconnected(exception);
+            return;
+        }
+
+        // in the order they were sent, the connection is only reported as connected once they are all in the transport
+        while (true)
+        {
+            queued_message message;
+            {
+                std::lock_guard<std::mutex> lock(m_reconnect_lock);
+                if (generation != m_reconnect_generation)
+                {
+                    // lost again or stopped, the messages left wait for the next reconnect or were failed by the stop
+                    return;
+                }
+
+                if (m_reconnect_queue.empty())
+                {
+                    m_reconnecting = false;
+                    break;
+                }
+
+                message = std::move(m_reconnect_queue.front());
+                m_reconnect_queue.pop_front();
+            }
+
+            m_connection->send(message.payload, m_protocol->transfer_format(), message.callback, message.priority, message.conflation_key);
+        }
+
+        if (m_logger.is_enabled(trace_level::info))
+        {
+            m_logger.log(trace_level::info, "reconnected");
+        }
+        m_reconnected_callback();
+    }
+
+    void hub_connection_impl::fail_reconnect_queue(const std::string& reason)
+    {
+        std::deque<queued_message> queue;
+        {
+            std::lock_guard<std::mutex> lock(m_reconnect_lock);
+            queue.swap(m_reconnect_queue);
+        }
+
+        if (queue.empty())
+        {
+            return;
+        }
+
+        auto exception = std::make_exception_ptr(signalr_exception(reason));
+        for (auto& message : queue)
+        {
+            message.callback(exception);
+        }
+    }
+
+    void hub_connection_impl::send_message(const std::string& message, std::function<void(std::exception_ptr)> callback,
+        send_priority priority, const std::string& conflation_key)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_reconnect_lock);
+            if (m_reconnecting)
+            {
+                if (!conflation_key.empty())
+                {
+                    for (auto& queued : m_reconnect_queue)
+                    {
+                        if (queued.conflation_key == conflation_key)
+                        {
+                            queued.payload = message;
+                            auto replaced_callback = std::move(queued.callback);
+                            queued.callback = [replaced_callback, callback](std::exception_ptr exception)
+                            {
+                                replaced_callback(exception);
+                                callback(exception);
+                            };
+                            return;
+                        }
+                    }
+                }
+
+                if (m_reconnect_queue.size() >= m_signalr_client_config.get_reconnect_policy().max_queued_messages)
+                {
+                    lock.unlock();
+                    callback(std::make_exception_ptr(signalr_exception("the connection is reconnecting and too many messages are queued")));
+                    return;
+                }
+
+                m_reconnect_queue.push_back(queued_message{ message, callback, priority, conflation_key });
+                return;
+            }
+        }
+
+        m_connection->send(message, m_protocol->transfer_format(), callback, priority, conflation_key);
+    }
+
+    void hub_connection_impl::reset_send_ping()
+    {
+        auto timeMs = (std::chrono::steady_clock::now() + m_signalr_client_config.get_keepalive_interval()).time_since_epoch();
+        m_nextActivationSendPing.store(std::chrono::duration_cast<std::chrono::milliseconds>(timeMs).count());
+    }
+
+    void hub_connection_impl::reset_server_timeout()
+    {
+        auto timeMs = (std::chrono::steady_clock::now() + m_signalr_client_config.get_server_timeout()).time_since_epoch();
+        m_nextActivationServerTimeout.store(std::chrono::duration_cast<std::chrono::milliseconds>(timeMs).count());
+    }
+
+    void hub_connection_impl::start_keepalive()
+    {
+        if (m_logger.is_enabled(trace_level::debug))
+        {
+            m_logger.log(trace_level::debug, "starting keep alive timer.");
+        }
+
+        auto send_ping = [](std::shared_ptr<hub_connection_impl> connection)
+        {
+            if (!connection)
+            {
+                return;
+            }
+
+            if (connection->get_connection_state() != connection_state::connected)
+            {
+                return;
+            }
+
+            try
+            {
                 std::weak_ptr<hub_connection_impl> weak_connection = connection;
                 connection->m_connection->send(
                     connection->m_cached_ping,
@@ -589,7 +1690,7 @@ namespace signalr
                                 connection->reset_send_ping();
                             }
                         }
-                    });
+                    }, send_priority::control);
             }
             catch (const std::exception& e)
             {
@@ -603,18 +1704,28 @@ namespace signalr
         send_ping(shared_from_this());
         reset_server_timeout();
 
+        const auto generation = ++m_keepalive_generation;
         std::weak_ptr<hub_connection_impl> weak_connection = shared_from_this();
         timer(m_signalr_client_config.get_scheduler(),
-            [send_ping, weak_connection](std::chrono::milliseconds)
+            [send_ping, weak_connection, generation](std::chrono::milliseconds)
             {
                 auto connection = weak_connection.lock();
 
-                if (!connection)
+                if (!connection || connection->m_keepalive_generation.load() != generation)
                 {
                     return true;
                 }
 
-                if (connection->get_connection_state() != connection_state::connected)
+                const auto state = connection->get_connection_state();
+                if (state == connection_state::reconnecting)
+                {
+                    // invocations made while reconnecting wait in the queue, their timeouts still have to fire
+                    connection->m_callback_manager.expire_callbacks(std::chrono::steady_clock::now(),
+                        std::make_exception_ptr(signalr_exception("invocation timed out before a result was received")));
+                    return false;
+                }
+
+                if (state != connection_state::connected)
                 {
                     return true;
                 }
@@ -640,6 +1751,9 @@ namespace signalr
                     }
                 }
 
+                connection->m_callback_manager.expire_callbacks(std::chrono::steady_clock::now(),
+                    std::make_exception_ptr(signalr_exception("invocation timed out before a result was received")));
+
                 if (timeNowmSeconds > connection->m_nextActivationSendPing.load())
                 {
                     if (connection->m_logger.is_enabled(trace_level::debug))
@@ -656,23 +1770,106 @@ namespace signalr
     // unnamed namespace makes it invisble outside this translation unit
     namespace
     {
-        static std::function<void(const char* error, const signalr::value&)> create_hub_invocation_callback(const logger& logger,
-            const std::function<void(const signalr::value&)>& set_result,
+        static std::function<void(std::exception_ptr, signalr::value&&)> create_hub_invocation_callback(const logger& logger,
+            const std::function<void(signalr::value&&)>& set_result,
             const std::function<void(const std::exception_ptr)>& set_exception)
         {
-            return [logger, set_result, set_exception](const char* error, const signalr::value& message)
+            return [logger, set_result, set_exception](std::exception_ptr exception, signalr::value&& message)
             {
-                if (error != nullptr)
+                if (exception != nullptr)
                 {
-                    set_exception(
-                        std::make_exception_ptr(
-                            hub_exception(error)));
+                    set_exception(exception);
                 }
                 else
                 {
-                    set_result(message);
+                    set_result(std::move(message));
                 }
             };
         }
+
+        // approximate memory held by a received value, only used to account for the inbound backlog
+        static size_t decoded_size(const signalr::value& value)
+        {
+            switch (value.type())
+            {
+            case value_type::string:
+                return value.as_string().size();
+            case value_type::binary:
+                return value.as_binary().size();
+            case value_type::array:
+            {
+                size_t size = 0;
+                for (const auto& item : value.as_array())
+                {
+                    size += decoded_size(item);
+                }
+                return size;
+            }
+            case value_type::map:
+            {
+                size_t size = 0;
+                for (const auto& entry : value.as_map())
+                {
+                    size += entry.first.size() + decoded_size(entry.second);
+                }
+                return size;
+            }
+            default:
+                return sizeof(double);
+            }
+        }
+
+        // appends an encoding of `value` that differs for values that aren't equal, lengths are included so that e.g. ["a", "b"]
+        // and ["ab"] don't collide
+        static void append_conflation_key(std::string& key, const signalr::value& value)
+        {
+            switch (value.type())
+            {
+            case value_type::null:
+                key.push_back('n');
+                break;
+            case value_type::boolean:
+                key.push_back(value.as_bool() ? 't' : 'f');
+                break;
+            case value_type::float64:
+            {
+                auto number = value.as_double();
+                key.push_back('d');
+                key.append(reinterpret_cast<const char*>(&number), sizeof(number));
+                break;
+            }
+            case value_type::string:
+                key.push_back('s');
+                key.append(std::to_string(value.as_string().size())).push_back(':');
+                key.append(value.as_string());
+                break;
+            case value_type::binary:
+            {
+                const auto& binary = value.as_binary();
+                key.push_back('b');
+                key.append(std::to_string(binary.size())).push_back(':');
+                key.append(binary.begin(), binary.end());
+                break;
+            }
+            case value_type::array:
+                key.push_back('a');
+                key.append(std::to_string(value.as_array().size())).push_back(':');
+                for (const auto& item : value.as_array())
+                {
+                    append_conflation_key(key, item);
+                }
+                break;
+            case value_type::map:
+                key.push_back('m');
+                key.append(std::to_string(value.as_map().size())).push_back(':');
+                for (const auto& entry : value.as_map())
+                {
+                    key.append(std::to_string(entry.first.size())).push_back(':');
+                    key.append(entry.first);
+                    append_conflation_key(key, entry.second);
+                }
+                break;
+            }
+        }
     }
 }
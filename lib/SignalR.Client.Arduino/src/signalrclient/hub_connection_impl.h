@@ -5,6 +5,8 @@
 #pragma once
 
 #include <unordered_map>
+#include <deque>
+#include <random>
 #include "callback_manager.h"
 #include "case_insensitive_comparison_utils.h"
 #include "completion_event.h"
@@ -13,6 +15,10 @@
 #include "logger.h"
 #include "cancellation_token_source.h"
 #include "connection_impl.h"
+#include "stream_reader_impl.h"
+#include "strand.h"
+#include "signalrclient/hub_batch.h"
+#include "signalrclient/conflation_policy.h"
 
 namespace signalr
 {
@@ -33,10 +39,21 @@ namespace signalr
         hub_connection_impl(const hub_connection_impl&) = delete;
         hub_connection_impl& operator=(const hub_connection_impl&) = delete;
 
-        void on(const std::string& event_name, const std::function<void(const std::vector<signalr::value>&)>& handler);
+        void on(const std::string& event_name, const std::function<void(const std::vector<signalr::value>&)>& handler,
+            const conflation_policy& conflation = conflation_policy::none());
 
-        void invoke(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<void(const signalr::value&, std::exception_ptr)> callback) noexcept;
+        void invoke(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<void(signalr::value&&, std::exception_ptr)> callback) noexcept;
+        // a zero timeout means no timeout, `cancellation_token` may be null
+        void invoke(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<void(signalr::value&&, std::exception_ptr)> callback,
+            std::chrono::milliseconds timeout, cancellation_token* cancellation_token) noexcept;
         void send(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<void(std::exception_ptr)> callback) noexcept;
+        void send_batch(hub_batch&& batch, std::function<void(std::exception_ptr)> callback) noexcept;
+        bool try_send(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<void(std::exception_ptr)> callback) noexcept;
+        void send_latest(const std::string& method_name, const std::string& key, const std::vector<signalr::value>& arguments,
+            std::function<void(std::exception_ptr)> callback) noexcept;
+        std::shared_ptr<stream_reader_impl> stream(const std::string& method_name, const std::vector<signalr::value>& arguments, size_t buffer_size) noexcept;
+        void upload(const std::string& method_name, const std::vector<signalr::value>& arguments, std::function<size_t(uint8_t*, size_t)> producer,
+            std::function<void(signalr::value&&, std::exception_ptr)> callback, size_t chunk_size, size_t max_chunks_in_flight) noexcept;
 
         void start(std::function<void(std::exception_ptr)> callback) noexcept;
         void stop(std::function<void(std::exception_ptr)> callback, bool is_dtor = false) noexcept;
@@ -46,6 +63,12 @@ namespace signalr
 
         void set_client_config(const signalr_client_config& config);
         void set_disconnected(const std::function<void(std::exception_ptr)>& disconnected);
+        void set_writable(const std::function<void()>& writable);
+        void set_reconnecting(const std::function<void(std::exception_ptr)>& reconnecting);
+        void set_reconnected(const std::function<void()>& reconnected);
+
+        // how long to wait before reconnect attempt `attempt` (starting at 1), `random` in [0, 1) picks the jitter
+        static std::chrono::milliseconds get_reconnect_delay(const reconnect_policy& policy, size_t attempt, double random);
 
     private:
         hub_connection_impl(const std::string& url, std::unique_ptr<hub_protocol>&& hub_protocol, trace_level trace_level,
@@ -67,17 +90,110 @@ namespace signalr
 
         std::atomic<int64_t> m_nextActivationServerTimeout;
         std::atomic<int64_t> m_nextActivationSendPing;
+        // bumped by every `start_keepalive` so the timer of an earlier connection, still running while it was reconnecting,
+        // stops once the new one started its own
+        std::atomic<uint64_t> m_keepalive_generation;
+
+        // streams started by `stream` that haven't completed yet, keyed by invocation id so stream items can find their reader
+        std::unordered_map<std::string, std::shared_ptr<stream_reader_impl>> m_streams;
+        std::mutex m_streams_lock;
+
+        // strands handlers are dispatched on when they don't run on the receive thread, keyed by target (or "" when there is
+        // a single strand for the connection), recreated on every start to pick up the configured scheduler
+        std::unordered_map<std::string, std::shared_ptr<strand>, case_insensitive_hash, case_insensitive_equals> m_handler_strands;
+        std::mutex m_handler_strands_lock;
+
+        // arguments of an invocation posted to a handler strand, `size` is what it adds to the inbound backlog
+        struct pending_invocation
+        {
+            std::vector<signalr::value> arguments;
+            size_t size;
+        };
+
+        struct conflation_state
+        {
+            explicit conflation_state(const conflation_policy& policy) : policy(policy) {}
+
+            conflation_policy policy;
+            std::mutex lock;
+            // invocations posted but not dispatched yet by encoded key argument ("" for latest-only), a newer invocation replaces
+            // the arguments of the entry instead of posting another one
+            std::unordered_map<std::string, std::shared_ptr<pending_invocation>> pending;
+        };
+
+        // targets registered with a conflating policy, only written while disconnected
+        std::unordered_map<std::string, std::shared_ptr<conflation_state>, case_insensitive_hash, case_insensitive_equals> m_conflation;
+
+        // invocations posted to a handler strand whose handler hasn't finished yet and their approximate decoded size, the
+        // transport is paused while they are above the configured inbound backlog watermarks
+        std::atomic<size_t> m_inbound_backlog_bytes;
+        std::atomic<size_t> m_inbound_backlog_messages;
+        // server-to-client streams whose reader buffer is full, the transport stays paused while there are any
+        std::atomic<size_t> m_full_streams;
+        // guarded by `m_inbound_backlog_lock` so a pause and a resume racing each other can't leave the transport paused with
+        // nothing left to resume it
+        bool m_receive_paused;
+        std::mutex m_inbound_backlog_lock;
+
+        // ids of client-to-server streams, the server tracks them separately from invocation ids
+        std::atomic<uint64_t> m_next_upload_stream_id;
 
         std::mutex m_stop_callback_lock;
         std::vector<std::function<void(std::exception_ptr)>> m_stop_callbacks;
 
+        // a message sent while reconnecting, sent once the connection is back
+        struct queued_message
+        {
+            std::string payload;
+            std::function<void(std::exception_ptr)> callback;
+            send_priority priority;
+            std::string conflation_key;
+        };
+
+        std::function<void(std::exception_ptr)> m_reconnecting_callback;
+        std::function<void()> m_reconnected_callback;
+        // set from losing the connection until it is back, the reconnect gives up or it is stopped
+        std::atomic<bool> m_reconnecting;
+        // guards everything below
+        std::mutex m_reconnect_lock;
+        // a reconnect attempt is starting the connection, it handles the connection closing itself
+        bool m_reconnect_attempt;
+        // bumped when a reconnect ends so attempts scheduled before can tell they are stale
+        uint64_t m_reconnect_generation;
+        size_t m_reconnect_attempts;
+        // stopped while reconnecting, reports the disconnect once the stop completed unless closing the connection did
+        bool m_reconnect_stopped;
+        std::deque<queued_message> m_reconnect_queue;
+        std::mt19937 m_reconnect_random;
+
         void initialize();
+        void start_internal(std::function<void(std::exception_ptr)> callback, bool skip_negotiation) noexcept;
+
+        void begin_reconnect(std::exception_ptr exception);
+        void schedule_reconnect(uint64_t generation);
+        void attempt_reconnect(uint64_t generation);
+        void complete_reconnect(uint64_t generation, std::exception_ptr exception);
+        void fail_reconnect_queue(const std::string& reason);
 
-        void process_message(std::string&& message);
+        // sends through the connection, or queues while reconnecting
+        void send_message(const std::string& message, std::function<void(std::exception_ptr)> callback,
+            send_priority priority = send_priority::data, const std::string& conflation_key = std::string());
 
-        void invoke_hub_method(const std::string& method_name, const std::vector<signalr::value>& arguments, const std::string& callback_id,
-            std::function<void()> set_completion, std::function<void(const std::exception_ptr)> set_exception) noexcept;
+        void process_message(std::string&& message, bool reset_timeout = true);
+        void process_messages(std::vector<std::string>&& messages);
+        void dispatch_invocation(invocation_message&& invocation);
+        void update_receive_paused();
+
+        void invoke_hub_method(const invocation_message& invocation, std::function<void()> set_completion,
+            std::function<void(const std::exception_ptr)> set_exception, const std::string& conflation_key = std::string()) noexcept;
         bool invoke_callback(completion_message* completion);
+        std::shared_ptr<stream_reader_impl> remove_stream(const std::string& invocation_id);
+        void cancel_stream(const std::string& invocation_id);
+
+        struct upload_state;
+        void pump_upload(const std::shared_ptr<upload_state>& upload);
+        void upload_chunk_sent(const std::shared_ptr<upload_state>& upload, std::exception_ptr exception);
+        void complete_upload(const std::shared_ptr<upload_state>& upload);
 
         void reset_send_ping();
         void reset_server_timeout();
@@ -26,6 +26,10 @@ namespace signalr
             : hub_message(message_type), invocation_id(invocation_id)
         { }
 
+        hub_invocation_message(std::string&& invocation_id, signalr::message_type message_type)
+            : hub_message(message_type), invocation_id(std::move(invocation_id))
+        { }
+
         std::string invocation_id;
     };
 
@@ -38,7 +42,7 @@ namespace signalr
 
         invocation_message(std::string&& invocation_id, std::string&& target,
             std::vector<signalr::value>&& args, std::vector<std::string>&& stream_ids = std::vector<std::string>())
-            : hub_invocation_message(invocation_id, signalr::message_type::invocation), target(target), arguments(args), stream_ids(stream_ids)
+            : hub_invocation_message(std::move(invocation_id), signalr::message_type::invocation), target(std::move(target)), arguments(std::move(args)), stream_ids(std::move(stream_ids))
         { }
 
         std::string target;
@@ -46,6 +50,36 @@ namespace signalr
         std::vector<std::string> stream_ids;
     };
 
+    struct stream_invocation_message : invocation_message
+    {
+        stream_invocation_message(const std::string& invocation_id, const std::string& target,
+            const std::vector<signalr::value>& args, const std::vector<std::string>& stream_ids = std::vector<std::string>())
+            : invocation_message(invocation_id, target, args, stream_ids)
+        {
+            message_type = signalr::message_type::stream_invocation;
+        }
+    };
+
+    struct stream_item_message : hub_invocation_message
+    {
+        stream_item_message(const std::string& invocation_id, const signalr::value& item)
+            : hub_invocation_message(invocation_id, signalr::message_type::stream_item), item(item)
+        { }
+
+        stream_item_message(std::string&& invocation_id, signalr::value&& item)
+            : hub_invocation_message(std::move(invocation_id), signalr::message_type::stream_item), item(std::move(item))
+        { }
+
+        signalr::value item;
+    };
+
+    struct cancel_invocation_message : hub_invocation_message
+    {
+        cancel_invocation_message(const std::string& invocation_id)
+            : hub_invocation_message(invocation_id, signalr::message_type::cancel_invocation)
+        { }
+    };
+
     struct completion_message : hub_invocation_message
     {
         completion_message(const std::string& invocation_id, const std::string& error, const signalr::value& result, bool has_result)
@@ -53,7 +87,7 @@ namespace signalr
         { }
 
         completion_message(std::string&& invocation_id, std::string&& error, signalr::value&& result, bool has_result)
-            : hub_invocation_message(invocation_id, signalr::message_type::completion), error(error), result(result), has_result(has_result)
+            : hub_invocation_message(std::move(invocation_id), signalr::message_type::completion), error(std::move(error)), result(std::move(result)), has_result(has_result)
         { }
 
         std::string error;
@@ -79,7 +79,7 @@ namespace signalr
         std::string base64result;
 
         size_t i = 0;
-        while (i <= data.size() - 3)
+        while (i + 3 <= data.size())
         {
             uint32_t b = ((uint32_t)data[i] << 16) | ((uint32_t)data[i + 1] << 8) | (uint32_t)data[i + 2];
             base64result.push_back(getBase64Value((b >> 18) & 0x3F));
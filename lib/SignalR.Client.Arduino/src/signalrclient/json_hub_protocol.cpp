@@ -19,6 +19,7 @@ namespace signalr
         switch (hub_message->message_type)
         {
         case message_type::invocation:
+        case message_type::stream_invocation:
         {
             auto invocation = static_cast<invocation_message const*>(hub_message);
             object["type"] = static_cast<int>(invocation->message_type);
@@ -28,7 +29,15 @@ namespace signalr
             }
             object["target"] = invocation->target;
             object["arguments"] = createJson(invocation->arguments);
-            // TODO: streamIds
+            if (!invocation->stream_ids.empty())
+            {
+                Json::Value stream_ids(Json::ValueType::arrayValue);
+                for (auto& stream_id : invocation->stream_ids)
+                {
+                    stream_ids.append(stream_id);
+                }
+                object["streamIds"] = std::move(stream_ids);
+            }
 
             break;
         }
@@ -47,6 +56,21 @@ namespace signalr
             }
             break;
         }
+        case message_type::stream_item:
+        {
+            auto stream_item = static_cast<stream_item_message const*>(hub_message);
+            object["type"] = static_cast<int>(stream_item->message_type);
+            object["invocationId"] = stream_item->invocation_id;
+            object["item"] = createJson(stream_item->item);
+            break;
+        }
+        case message_type::cancel_invocation:
+        {
+            auto cancel_invocation = static_cast<cancel_invocation_message const*>(hub_message);
+            object["type"] = static_cast<int>(cancel_invocation->message_type);
+            object["invocationId"] = cancel_invocation->invocation_id;
+            break;
+        }
         case message_type::ping:
         {
             auto ping = static_cast<ping_message const*>(hub_message);
@@ -94,15 +118,18 @@ namespace signalr
             throw signalr_exception(errors);
         }
 
-        // TODO: manually go through the json object to avoid short-lived allocations
-        auto value = createValue(root);
-
-        if (!value.is_map())
+        if (!root.isObject())
         {
             throw signalr_exception("Message was not a 'map' type");
         }
 
-        const auto& obj = value.as_map();
+        // TODO: manually go through the json object to avoid short-lived allocations
+        // top level fields are converted one by one into a map we own so large values (e.g. 'result') can be moved into the message
+        std::map<std::string, signalr::value> obj;
+        for (const auto& name : root.getMemberNames())
+        {
+            obj.insert({ name, createValue(root[name]) });
+        }
 
         auto found = obj.find("type");
         if (found == obj.end())
@@ -154,8 +181,52 @@ namespace signalr
                 invocation_id = found->second.as_string();
             }
 
+            std::vector<std::string> stream_ids;
+            found = obj.find("streamIds");
+            if (found != obj.end())
+            {
+                if (!found->second.is_array())
+                {
+                    throw signalr_exception("Expected 'streamIds' to be of type 'array'");
+                }
+
+                for (auto& stream_id : found->second.as_array())
+                {
+                    if (!stream_id.is_string())
+                    {
+                        throw signalr_exception("Expected 'streamIds' to contain values of type 'string'");
+                    }
+                    stream_ids.push_back(stream_id.as_string());
+                }
+            }
+
             hub_message = std::unique_ptr<signalr::hub_message>(new invocation_message(invocation_id,
-                obj.find("target")->second.as_string(), obj.find("arguments")->second.as_array()));
+                obj.find("target")->second.as_string(), obj.find("arguments")->second.as_array(), stream_ids));
+
+            break;
+        }
+        case message_type::stream_item:
+        {
+            found = obj.find("invocationId");
+            if (found == obj.end())
+            {
+                throw signalr_exception("Field 'invocationId' not found for 'stream_item' message");
+            }
+            if (!found->second.is_string())
+            {
+                throw signalr_exception("Expected 'invocationId' to be of type 'string'");
+            }
+
+            std::string invocation_id(found->second.as_string());
+
+            signalr::value item;
+            found = obj.find("item");
+            if (found != obj.end())
+            {
+                item = std::move(found->second);
+            }
+
+            hub_message = std::unique_ptr<signalr::hub_message>(new stream_item_message(std::move(invocation_id), std::move(item)));
 
             break;
         }
@@ -167,7 +238,7 @@ namespace signalr
             if (found != obj.end())
             {
                 has_result = true;
-                result = found->second;
+                result = std::move(found->second);
             }
 
             std::string error;
@@ -206,8 +277,8 @@ namespace signalr
                 throw signalr_exception("The 'error' and 'result' properties are mutually exclusive.");
             }
 
-            hub_message = std::unique_ptr<signalr::hub_message>(new completion_message(obj.find("invocationId")->second.as_string(),
-                error, result, has_result));
+            hub_message = std::unique_ptr<signalr::hub_message>(new completion_message(std::string(obj.find("invocationId")->second.as_string()),
+                std::move(error), std::move(result), has_result));
 
             break;
         }
@@ -0,0 +1,439 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+#include "long_polling_transport.h"
+#include "signalrclient/signalr_exception.h"
+#include <atomic>
+#include <iterator>
+
+namespace signalr
+{
+    namespace
+    {
+        // no poll is issued while this many returned polls wait to be handed over, e.g. while receiving is paused
+        const size_t max_received_polls = 2;
+    }
+
+    std::shared_ptr<transport> long_polling_transport::create(const std::function<std::shared_ptr<http_client>(const signalr_client_config&)>& http_client_factory,
+        const signalr_client_config& signalr_client_config, const logger& logger)
+    {
+        return std::shared_ptr<transport>(new long_polling_transport(http_client_factory, signalr_client_config, logger));
+    }
+
+    long_polling_transport::long_polling_transport(const std::function<std::shared_ptr<http_client>(const signalr_client_config&)>& http_client_factory,
+        const signalr_client_config& signalr_client_config, const logger& logger)
+        : transport(logger), m_http_client_factory(http_client_factory), m_signalr_client_config(signalr_client_config),
+        m_process_response_callback([](std::string&&, std::exception_ptr) {}), m_close_callback([](std::exception_ptr) {}),
+        m_send_queue(std::make_shared<http_send_queue>(signalr_client_config)), m_disconnected(true), m_polling(false), m_paused(false),
+        m_delivering(false), m_ended(false)
+    { }
+
+    long_polling_transport::~long_polling_transport()
+    {
+        // the poll's callback can't reach the transport anymore, so there is nothing to wait for
+        std::shared_ptr<cancellation_token_source> cts;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            cts = m_cts;
+        }
+
+        if (cts)
+        {
+            cts->cancel();
+        }
+
+        m_send_queue->close("transport was destroyed before the message was sent");
+    }
+
+    transport_type long_polling_transport::get_transport_type() const noexcept
+    {
+        return transport_type::long_polling;
+    }
+
+    void long_polling_transport::start(const std::string& url, std::function<void(std::exception_ptr)> callback) noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (!m_disconnected || m_polling || m_stop_callback)
+            {
+                callback(std::make_exception_ptr(signalr_exception("transport already connected")));
+                return;
+            }
+
+            try
+            {
+                m_http_client = m_http_client_factory(m_signalr_client_config);
+            }
+            catch (...)
+            {
+                callback(std::current_exception());
+                return;
+            }
+
+            m_url = url;
+            m_cts = std::make_shared<cancellation_token_source>();
+            m_disconnected = false;
+            m_polling = true;
+            m_paused = false;
+            m_received.clear();
+            m_ended = false;
+            m_end_exception = nullptr;
+            m_start_callback = callback;
+            m_send_queue->open(m_http_client, url, m_cts);
+        }
+
+        m_logger.log(trace_level::info,
+            std::string("[long polling transport] connecting to: ")
+            .append(url));
+
+        // the server answers the first poll right away, which completes the start
+        poll();
+    }
+
+    // Must only be called by the thread that set `m_polling`.
+    void long_polling_transport::poll()
+    {
+        while (true)
+        {
+            std::shared_ptr<http_client> http_client;
+            std::string url;
+            std::shared_ptr<cancellation_token_source> cts;
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                http_client = m_http_client;
+                url = m_url;
+                cts = m_cts;
+            }
+
+            // the server holds a poll for up to 90 seconds, the default timeout of the request is longer than that
+            http_request request;
+            request.method = http_method::GET;
+            request.headers = m_signalr_client_config.get_http_headers();
+
+            // 0 - request in flight, 1 - the next poll is due, 2 - `send` returned; whoever comes second issues the next poll so
+            // an http client completing requests synchronously doesn't make this recurse
+            auto poll_state = std::make_shared<std::atomic<int>>(0);
+            auto weak_transport = std::weak_ptr<long_polling_transport>(shared_from_this());
+            http_client->send(url, request, [weak_transport, poll_state](const http_response& response, std::exception_ptr exception)
+                {
+                    auto transport = weak_transport.lock();
+                    if (!transport)
+                    {
+                        return;
+                    }
+
+                    // the next poll is on its way before the payload is handed over
+                    if (transport->complete_poll(response, exception) && poll_state->exchange(1) == 2)
+                    {
+                        transport->poll();
+                    }
+
+                    transport->deliver();
+                }, get_cancellation_token(cts));
+
+            if (poll_state->exchange(2) == 0)
+            {
+                return;
+            }
+        }
+    }
+
+    // Queues the payload of a returned poll, returns true if the next poll is due.
+    bool long_polling_transport::complete_poll(const http_response& response, std::exception_ptr exception)
+    {
+        std::function<void(std::exception_ptr)> start_callback;
+        bool stopping;
+        bool ended = false;
+        bool poll_again = false;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_polling = false;
+            start_callback = std::move(m_start_callback);
+            m_start_callback = nullptr;
+            stopping = m_disconnected;
+
+            if (!stopping && exception == nullptr && response.status_code / 100 == 2 && response.status_code != 204)
+            {
+                // an empty response means the poll timed out on the server
+                if (!response.content.empty())
+                {
+                    m_received.push_back(response.content);
+                }
+
+                poll_again = m_received.size() < max_received_polls;
+                m_polling = poll_again;
+            }
+            else if (!stopping)
+            {
+                // 204 - the server ended the connection
+                if (exception == nullptr && response.status_code != 204)
+                {
+                    exception = std::make_exception_ptr(signalr_exception("the poll request failed with status code "
+                        + std::to_string(response.status_code)));
+                }
+                else if (exception == nullptr && start_callback)
+                {
+                    exception = std::make_exception_ptr(signalr_exception("the server ended the connection while connecting"));
+                }
+
+                ended = true;
+                m_disconnected = true;
+                if (!start_callback)
+                {
+                    m_ended = true;
+                    m_end_exception = exception;
+                }
+            }
+        }
+
+        if (stopping)
+        {
+            if (start_callback)
+            {
+                start_callback(std::make_exception_ptr(canceled_exception()));
+            }
+
+            send_delete();
+            return false;
+        }
+
+        if (ended)
+        {
+            m_send_queue->close("transport stopped before the message was sent");
+
+            if (exception != nullptr)
+            {
+                try
+                {
+                    std::rethrow_exception(exception);
+                }
+                catch (const std::exception& e)
+                {
+                    m_logger.log(
+                        trace_level::error,
+                        std::string("[long polling transport] ")
+                        .append(start_callback ? "exception when connecting to the server: " : "error polling the server: ")
+                        .append(e.what()));
+                }
+            }
+            else
+            {
+                m_logger.log(trace_level::info, "[long polling transport] the server ended the connection");
+            }
+
+            if (start_callback)
+            {
+                start_callback(exception);
+            }
+            return false;
+        }
+
+        if (start_callback)
+        {
+            m_logger.log(trace_level::info, "[long polling transport] connected");
+            start_callback(nullptr);
+        }
+
+        return poll_again;
+    }
+
+    // Hands the received payloads over in the order they were polled unless another thread already does, then the end of the
+    // connection if the server ended it. Resumes polling once a payload was taken off a full queue.
+    void long_polling_transport::deliver()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_delivering)
+            {
+                return;
+            }
+            m_delivering = true;
+        }
+
+        while (true)
+        {
+            std::vector<std::string> payloads;
+            bool poll_again = false;
+            bool ended = false;
+            std::exception_ptr end_exception;
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                if (m_disconnected && !m_ended)
+                {
+                    // stopped, there is no one to hand the payloads to anymore
+                    m_received.clear();
+                }
+
+                if (!m_received.empty() && !m_paused)
+                {
+                    if (m_received.size() > 1 && m_process_response_batch_callback)
+                    {
+                        payloads.assign(std::make_move_iterator(m_received.begin()), std::make_move_iterator(m_received.end()));
+                        m_received.clear();
+                    }
+                    else
+                    {
+                        payloads.push_back(std::move(m_received.front()));
+                        m_received.pop_front();
+                    }
+
+                    if (!m_polling && !m_disconnected)
+                    {
+                        m_polling = true;
+                        poll_again = true;
+                    }
+                }
+                else if (m_received.empty() && m_ended)
+                {
+                    m_ended = false;
+                    ended = true;
+                    end_exception = m_end_exception;
+                    m_end_exception = nullptr;
+                }
+                else
+                {
+                    m_delivering = false;
+                    return;
+                }
+            }
+
+            if (poll_again)
+            {
+                poll();
+            }
+
+            if (ended)
+            {
+                m_close_callback(end_exception);
+            }
+            else if (payloads.size() > 1)
+            {
+                m_process_response_batch_callback(std::move(payloads));
+            }
+            else
+            {
+                m_process_response_callback(std::move(payloads.front()), nullptr);
+            }
+        }
+    }
+
+    // The server would otherwise keep the connection until it timed out waiting for the next poll.
+    void long_polling_transport::send_delete()
+    {
+        std::shared_ptr<http_client> http_client;
+        std::string url;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            http_client = m_http_client;
+            url = m_url;
+        }
+
+        http_request request;
+        request.method = http_method::DEL;
+        request.headers = m_signalr_client_config.get_http_headers();
+
+        // the stop completes even if the transport isn't referenced anymore
+        auto transport = shared_from_this();
+        auto cts = std::make_shared<cancellation_token_source>();
+        http_client->send(url, request, [transport, cts](const http_response& response, std::exception_ptr exception)
+            {
+                if (exception != nullptr || response.status_code / 100 != 2)
+                {
+                    transport->m_logger.log(trace_level::warning, "[long polling transport] the server failed to delete the connection");
+                }
+
+                std::function<void(std::exception_ptr)> stop_callback;
+                {
+                    std::lock_guard<std::mutex> lock(transport->m_lock);
+                    stop_callback = std::move(transport->m_stop_callback);
+                    transport->m_stop_callback = nullptr;
+                }
+
+                transport->m_logger.log(trace_level::debug, "long polling transport stopped");
+                transport->m_close_callback(nullptr);
+                if (stop_callback)
+                {
+                    stop_callback(nullptr);
+                }
+            }, get_cancellation_token(cts));
+    }
+
+    void long_polling_transport::stop(std::function<void(std::exception_ptr)> callback) noexcept
+    {
+        bool polling;
+        std::shared_ptr<cancellation_token_source> cts;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_stop_callback)
+            {
+                auto previous_stop_callback = std::move(m_stop_callback);
+                m_stop_callback = [previous_stop_callback, callback](std::exception_ptr exception)
+                    {
+                        previous_stop_callback(exception);
+                        callback(exception);
+                    };
+                return;
+            }
+
+            if (m_disconnected)
+            {
+                callback(nullptr);
+                return;
+            }
+
+            // completes once the poll returned and the server deleted the connection
+            m_disconnected = true;
+            m_stop_callback = callback;
+            polling = m_polling;
+            cts = m_cts;
+        }
+
+        m_logger.log(trace_level::debug, "stopping long polling transport");
+        m_send_queue->close("transport stopped before the message was sent");
+        cts->cancel();
+
+        if (!polling)
+        {
+            send_delete();
+        }
+    }
+
+    void long_polling_transport::on_close(std::function<void(std::exception_ptr)> callback)
+    {
+        m_close_callback = callback;
+    }
+
+    void long_polling_transport::on_receive(std::function<void(std::string&&, std::exception_ptr)> callback)
+    {
+        m_process_response_callback = callback;
+    }
+
+    void long_polling_transport::on_receive_batch(std::function<void(std::vector<std::string>&&)> callback)
+    {
+        m_process_response_batch_callback = callback;
+    }
+
+    void long_polling_transport::pause_receive() noexcept
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_paused = true;
+    }
+
+    void long_polling_transport::resume_receive() noexcept
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_paused = false;
+        }
+
+        deliver();
+    }
+
+    void long_polling_transport::send(const std::string& payload, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback,
+        send_priority priority, const std::string& conflation_key) noexcept
+    {
+        m_send_queue->send(payload, transfer_format, callback, priority, conflation_key);
+    }
+}
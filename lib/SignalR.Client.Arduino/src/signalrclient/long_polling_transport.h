@@ -0,0 +1,88 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#include "transport.h"
+#include "logger.h"
+#include "signalrclient/http_client.h"
+#include "signalrclient/signalr_client_config.h"
+#include "cancellation_token_source.h"
+#include "http_send_queue.h"
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace signalr
+{
+    // Receives by polling the server with GET requests it holds until it has messages, and sends with POST requests through an
+    // `http_send_queue`. The next poll is issued as soon as one returns, before its messages are handed over, so the server
+    // doesn't wait for the client to process them to answer the next one. Stopping tells the server with a DELETE request.
+    class long_polling_transport : public transport, public std::enable_shared_from_this<long_polling_transport>
+    {
+    public:
+        static std::shared_ptr<transport> create(const std::function<std::shared_ptr<http_client>(const signalr_client_config&)>& http_client_factory,
+            const signalr_client_config& signalr_client_config, const logger& logger);
+
+        ~long_polling_transport();
+
+        long_polling_transport(const long_polling_transport&) = delete;
+
+        long_polling_transport& operator=(const long_polling_transport&) = delete;
+
+        transport_type get_transport_type() const noexcept override;
+
+        void start(const std::string& url, std::function<void(std::exception_ptr)> callback) noexcept override;
+        void stop(std::function<void(std::exception_ptr)> callback) noexcept override;
+        void on_close(std::function<void(std::exception_ptr)> callback) override;
+
+        void send(const std::string& payload, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback,
+            send_priority priority = send_priority::data, const std::string& conflation_key = std::string()) noexcept override;
+
+        void on_receive(std::function<void(std::string&&, std::exception_ptr)>) override;
+        void on_receive_batch(std::function<void(std::vector<std::string>&&)> callback) override;
+
+        void pause_receive() noexcept override;
+        void resume_receive() noexcept override;
+
+    private:
+        long_polling_transport(const std::function<std::shared_ptr<http_client>(const signalr_client_config&)>& http_client_factory,
+            const signalr_client_config& signalr_client_config, const logger& logger);
+
+        std::function<std::shared_ptr<http_client>(const signalr_client_config&)> m_http_client_factory;
+        signalr_client_config m_signalr_client_config;
+        std::function<void(std::string&&, std::exception_ptr)> m_process_response_callback;
+        std::function<void(std::vector<std::string>&&)> m_process_response_batch_callback;
+        std::function<void(std::exception_ptr)> m_close_callback;
+        std::shared_ptr<http_send_queue> m_send_queue;
+
+        // guards everything below
+        std::mutex m_lock;
+        std::shared_ptr<http_client> m_http_client;
+        std::string m_url;
+        // cancels the poll and the sends in flight
+        std::shared_ptr<cancellation_token_source> m_cts;
+        // set until start and once the transport was stopped or the server ended the connection
+        bool m_disconnected;
+        // a poll is in flight
+        bool m_polling;
+        // set until the first poll returned
+        std::function<void(std::exception_ptr)> m_start_callback;
+        // set while stop waits for the poll and the DELETE request to complete
+        std::function<void(std::exception_ptr)> m_stop_callback;
+        bool m_paused;
+        // payloads of returned polls waiting to be handed over, in the order they were polled
+        std::deque<std::string> m_received;
+        // a thread is handing over the received payloads
+        bool m_delivering;
+        // the server ended the connection, the close callback runs once the payloads received before were handed over
+        bool m_ended;
+        std::exception_ptr m_end_exception;
+
+        void poll();
+        bool complete_poll(const http_response& response, std::exception_ptr exception);
+        void deliver();
+        void send_delete();
+    };
+}
@@ -188,12 +188,13 @@ namespace signalr
         switch (hub_message->message_type)
         {
         case message_type::invocation:
+        case message_type::stream_invocation:
         {
             auto invocation = static_cast<invocation_message const*>(hub_message);
 
             packer.pack_array(6);
 
-            packer.pack_int(static_cast<int>(message_type::invocation));
+            packer.pack_int(static_cast<int>(invocation->message_type));
             // Headers
             packer.pack_map(0);
 
@@ -217,7 +218,12 @@ namespace signalr
             }
 
             // StreamIds
-            packer.pack_array(0);
+            packer.pack_array(static_cast<uint32_t>(invocation->stream_ids.size()));
+            for (auto& stream_id : invocation->stream_ids)
+            {
+                packer.pack_str(static_cast<uint32_t>(stream_id.length()));
+                packer.pack_str_body(stream_id.data(), static_cast<uint32_t>(stream_id.length()));
+            }
 
             break;
         }
@@ -252,6 +258,38 @@ namespace signalr
 
             break;
         }
+        case message_type::stream_item:
+        {
+            auto stream_item = static_cast<stream_item_message const*>(hub_message);
+
+            packer.pack_array(4);
+            packer.pack_int(static_cast<int>(message_type::stream_item));
+
+            // Headers
+            packer.pack_map(0);
+
+            packer.pack_str(static_cast<uint32_t>(stream_item->invocation_id.length()));
+            packer.pack_str_body(stream_item->invocation_id.data(), static_cast<uint32_t>(stream_item->invocation_id.length()));
+
+            pack_messagepack(stream_item->item, packer);
+
+            break;
+        }
+        case message_type::cancel_invocation:
+        {
+            auto cancel_invocation = static_cast<cancel_invocation_message const*>(hub_message);
+
+            packer.pack_array(3);
+            packer.pack_int(static_cast<int>(message_type::cancel_invocation));
+
+            // Headers
+            packer.pack_map(0);
+
+            packer.pack_str(static_cast<uint32_t>(cancel_invocation->invocation_id.length()));
+            packer.pack_str_body(cancel_invocation->invocation_id.data(), static_cast<uint32_t>(cancel_invocation->invocation_id.length()));
+
+            break;
+        }
         case message_type::ping:
         {
             // If we need the ping this is how you get it
@@ -366,15 +404,52 @@ namespace signalr
                     ++arg_array_index;
                 }
 
-                vec.emplace_back(std::unique_ptr<hub_message>(
-                    new invocation_message(std::move(invocation_id), std::move(target), std::move(args))));
-
+                std::vector<std::string> stream_ids;
                 if (num_elements_of_message > 5)
                 {
-                    // This is for the StreamIds when they are supported
                     ++msgpack_obj_index;
+
+                    if (msgpack_obj_index->type != msgpack::type::ARRAY)
+                    {
+                        throw signalr_exception("reading 'streamIds' as array failed");
+                    }
+
+                    auto stream_id_index = msgpack_obj_index->via.array.ptr;
+                    for (uint32_t i = 0; i < msgpack_obj_index->via.array.size; ++i)
+                    {
+                        if (stream_id_index->type != msgpack::type::STR)
+                        {
+                            throw signalr_exception("reading 'streamIds' as array of strings failed");
+                        }
+                        stream_ids.emplace_back(stream_id_index->via.str.ptr, stream_id_index->via.str.size);
+                        ++stream_id_index;
+                    }
+                }
+
+                vec.emplace_back(std::unique_ptr<hub_message>(
+                    new invocation_message(std::move(invocation_id), std::move(target), std::move(args), std::move(stream_ids))));
+
+                break;
+            }
+            case message_type::stream_item:
+            {
+                if (num_elements_of_message < 4)
+                {
+                    throw signalr_exception("stream_item message has too few properties");
+                }
+
+                // HEADERS
+                ++msgpack_obj_index;
+
+                if (msgpack_obj_index->type != msgpack::type::STR)
+                {
+                    throw signalr_exception("reading 'invocationId' as string failed");
                 }
+                std::string invocation_id(msgpack_obj_index->via.str.ptr, msgpack_obj_index->via.str.size);
+                ++msgpack_obj_index;
 
+                vec.emplace_back(std::unique_ptr<hub_message>(
+                    new stream_item_message(std::move(invocation_id), createValue(*msgpack_obj_index))));
                 break;
             }
             case message_type::completion:
@@ -0,0 +1,473 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+#include "native_http_client.h"
+
+#ifdef USE_NATIVE_SOCKETS
+
+#include "cpprest/base_uri.h"
+#include "cancellation_token_source.h"
+#include "case_insensitive_comparison_utils.h"
+#include "signalrclient/signalr_exception.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace signalr
+{
+    namespace
+    {
+        const size_t max_response_head_size = 64 * 1024;
+        const std::chrono::seconds worker_idle_timeout(10);
+
+        // eventfd the request's thread waits on next to the socket, signaled when the request's token is canceled
+        struct cancel_event
+        {
+            std::mutex lock;
+            int fd;
+        };
+
+        class response_reader
+        {
+        public:
+            response_reader(int socket, int cancel_fd, std::chrono::steady_clock::time_point deadline,
+                const std::function<void(const char*, size_t)>& on_content)
+                : m_socket(socket), m_cancel_fd(cancel_fd), m_deadline(deadline), m_received(0), m_on_content(on_content), m_streaming(false)
+            { }
+
+            // bytes of the response received so far
+            size_t received() const
+            {
+                return m_received;
+            }
+
+            void write(const std::string& data)
+            {
+                size_t written = 0;
+                while (written < data.size())
+                {
+                    auto sent = ::send(m_socket, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+                    if (sent >= 0)
+                    {
+                        written += static_cast<size_t>(sent);
+                    }
+                    else if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    {
+                        native_sockets::wait(m_socket, POLLOUT, m_cancel_fd, m_deadline);
+                    }
+                    else if (errno != EINTR)
+                    {
+                        std::rethrow_exception(native_sockets::socket_error("sending the http request", errno));
+                    }
+                }
+            }
+
+            // Reads the response to the request that was written. `keep_alive` is set if the connection can be used for
+            // another request.
+            http_response read(bool& keep_alive)
+            {
+                size_t head_end;
+                while ((head_end = m_buffer.find("\r\n\r\n")) == std::string::npos)
+                {
+                    if (m_buffer.size() > max_response_head_size)
+                    {
+                        throw signalr_exception("the http response headers are too large");
+                    }
+
+                    read_more();
+                }
+
+                auto head = m_buffer.substr(0, head_end + 4);
+                m_buffer.erase(0, head_end + 4);
+
+                // e.g. "HTTP/1.1 200 OK"
+                auto status = head.find(' ');
+                if (head.compare(0, 5, "HTTP/") != 0 || status == std::string::npos)
+                {
+                    throw signalr_exception("the server sent an invalid http response");
+                }
+
+                http_response response;
+                response.status_code = atoi(head.c_str() + status + 1);
+                keep_alive = head.compare(0, 9, "HTTP/1.1 ") == 0
+                    && !case_insensitive_equals()(native_sockets::find_header(head, "Connection"), "close");
+
+                m_streaming = m_on_content && response.status_code / 100 == 2;
+                if (m_streaming)
+                {
+                    m_on_content(nullptr, 0);
+                }
+
+                auto content_length = native_sockets::find_header(head, "Content-Length");
+                if (case_insensitive_equals()(native_sockets::find_header(head, "Transfer-Encoding"), "chunked"))
+                {
+                    read_chunked(response.content);
+                }
+                else if (!content_length.empty())
+                {
+                    read_content(static_cast<size_t>(std::stoull(content_length)), response.content);
+                }
+                else if (response.status_code != 204 && response.status_code != 304 && response.status_code / 100 != 1)
+                {
+                    // the body ends with the connection
+                    do
+                    {
+                        deliver(m_buffer.data(), m_buffer.size(), response.content);
+                        m_buffer.clear();
+                    } while (read_some());
+
+                    keep_alive = false;
+                }
+
+                if (!m_buffer.empty())
+                {
+                    // the server sent more than the response, the connection can't be trusted for another request
+                    keep_alive = false;
+                }
+
+                return response;
+            }
+
+        private:
+            int m_socket;
+            int m_cancel_fd;
+            std::chrono::steady_clock::time_point m_deadline;
+            size_t m_received;
+            std::string m_buffer;
+            const std::function<void(const char*, size_t)>& m_on_content;
+            // set while reading the body of a response that is handed to `m_on_content`
+            bool m_streaming;
+
+            void deliver(const char* data, size_t size, std::string& content)
+            {
+                if (size == 0)
+                {
+                    return;
+                }
+
+                if (m_streaming)
+                {
+                    m_on_content(data, size);
+                }
+                else
+                {
+                    content.append(data, size);
+                }
+            }
+
+            // passes on `size` bytes of the body as they arrive
+            void read_content(size_t size, std::string& content)
+            {
+                while (true)
+                {
+                    auto count = std::min(size, m_buffer.size());
+                    deliver(m_buffer.data(), count, content);
+                    m_buffer.erase(0, count);
+                    size -= count;
+
+                    if (size == 0)
+                    {
+                        return;
+                    }
+
+                    read_more();
+                }
+            }
+
+            // returns false once the server closed the connection
+            bool read_some()
+            {
+                char chunk[16 * 1024];
+                while (true)
+                {
+                    auto received = recv(m_socket, chunk, sizeof(chunk), 0);
+                    if (received > 0)
+                    {
+                        m_buffer.append(chunk, static_cast<size_t>(received));
+                        m_received += static_cast<size_t>(received);
+                        return true;
+                    }
+
+                    if (received == 0)
+                    {
+                        return false;
+                    }
+
+                    if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    {
+                        native_sockets::wait(m_socket, POLLIN, m_cancel_fd, m_deadline);
+                    }
+                    else if (errno != EINTR)
+                    {
+                        std::rethrow_exception(native_sockets::socket_error("receiving the http response", errno));
+                    }
+                }
+            }
+
+            void read_more()
+            {
+                if (!read_some())
+                {
+                    throw signalr_exception("the server closed the connection before the http response was complete");
+                }
+            }
+
+            void read_chunked(std::string& content)
+            {
+                while (true)
+                {
+                    size_t line_end;
+                    while ((line_end = m_buffer.find("\r\n")) == std::string::npos)
+                    {
+                        read_more();
+                    }
+
+                    // chunk extensions after the size are ignored
+                    auto size = static_cast<size_t>(std::stoull(m_buffer.substr(0, line_end), nullptr, 16));
+                    m_buffer.erase(0, line_end + 2);
+
+                    if (size == 0)
+                    {
+                        // skip the trailers up to the empty line ending the body
+                        while ((line_end = m_buffer.find("\r\n")) != 0)
+                        {
+                            if (line_end == std::string::npos)
+                            {
+                                read_more();
+                            }
+                            else
+                            {
+                                m_buffer.erase(0, line_end + 2);
+                            }
+                        }
+
+                        m_buffer.erase(0, 2);
+                        return;
+                    }
+
+                    read_content(size, content);
+
+                    while (m_buffer.size() < 2)
+                    {
+                        read_more();
+                    }
+                    m_buffer.erase(0, 2);
+                }
+            }
+        };
+
+        // `idempotent` requests are sent again when a reused connection fails before any of the response arrived, others only
+        // when writing the request failed since the server may have acted on one it received
+        http_response perform_request(native_sockets::connection_pool& connection_pool, const std::string& host, const std::string& port,
+            const std::string& request, bool idempotent, int cancel_fd, std::chrono::steady_clock::time_point deadline,
+            const std::function<void(const char*, size_t)>& on_content)
+        {
+            while (true)
+            {
+                auto socket = connection_pool.take(host, port);
+                auto reused = socket >= 0;
+                if (!reused)
+                {
+                    socket = native_sockets::connect(host, port, [cancel_fd, deadline](int socket)
+                        {
+                            native_sockets::wait(socket, POLLOUT, cancel_fd, deadline);
+                        });
+                }
+
+                response_reader reader(socket, cancel_fd, deadline, on_content);
+                bool written = false;
+                try
+                {
+                    reader.write(request);
+                    written = true;
+
+                    bool keep_alive;
+                    auto response = reader.read(keep_alive);
+                    if (keep_alive)
+                    {
+                        connection_pool.put(host, port, socket);
+                    }
+                    else
+                    {
+                        native_sockets::close(socket);
+                    }
+
+                    return response;
+                }
+                catch (const canceled_exception&)
+                {
+                    native_sockets::close(socket);
+                    throw;
+                }
+                catch (...)
+                {
+                    native_sockets::close(socket);
+
+                    // the server may have closed the connection while it was idle, the request is sent again on a new one
+                    if (!reused || reader.received() > 0 || (written && !idempotent))
+                    {
+                        throw;
+                    }
+                }
+            }
+        }
+    }
+
+    struct native_http_client::request_workers
+    {
+        std::mutex lock;
+        std::condition_variable request_queued;
+        std::deque<std::function<void()>> requests;
+        // workers waiting for a request, the ones already woken up for one included until they took it
+        size_t idle = 0;
+    };
+
+    native_http_client::native_http_client(const signalr_client_config& config, std::shared_ptr<native_sockets::connection_pool> connection_pool)
+        : m_config(config), m_connection_pool(std::move(connection_pool)), m_workers(std::make_shared<request_workers>())
+    { }
+
+    void native_http_client::run(std::function<void()> request)
+    {
+        auto workers = m_workers;
+        {
+            std::lock_guard<std::mutex> lock(workers->lock);
+            workers->requests.push_back(std::move(request));
+            if (workers->idle >= workers->requests.size())
+            {
+                workers->request_queued.notify_one();
+                return;
+            }
+        }
+
+        // the workers only share the queue with the client, so one finishing a request after the client is gone is fine
+        std::thread([workers]()
+            {
+                std::unique_lock<std::mutex> lock(workers->lock);
+                while (true)
+                {
+                    if (workers->requests.empty())
+                    {
+                        ++workers->idle;
+                        auto queued = workers->request_queued.wait_for(lock, worker_idle_timeout,
+                            [&workers]() { return !workers->requests.empty(); });
+                        --workers->idle;
+                        if (!queued)
+                        {
+                            return;
+                        }
+                    }
+
+                    auto next = std::move(workers->requests.front());
+                    workers->requests.pop_front();
+                    lock.unlock();
+
+                    next();
+                    // whatever the request captured is released before the worker can be handed the next one
+                    next = nullptr;
+
+                    lock.lock();
+                }
+            }).detach();
+    }
+
+    void native_http_client::send(const std::string& url, http_request& request,
+        std::function<void(const http_response&, std::exception_ptr)> callback, cancellation_token token)
+    {
+        std::string host;
+        std::string port;
+        std::string request_text;
+        try
+        {
+            web::uri uri(url);
+            if (uri.scheme() != "http")
+            {
+                throw signalr_exception("native_http_client only supports http:// urls, got: " + url);
+            }
+
+            host = uri.host();
+            port = std::to_string(uri.port() > 0 ? uri.port() : 80);
+            auto resource = uri.resource().to_string();
+
+            request_text.append(request.method == http_method::POST ? "POST " : request.method == http_method::DEL ? "DELETE " : "GET ")
+                .append(resource.empty() ? "/" : resource).append(" HTTP/1.1\r\n")
+                .append("Host: ").append(host).append(uri.port() > 0 ? ":" + port : "").append("\r\n");
+
+            if (request.method == http_method::POST || !request.content.empty())
+            {
+                request_text.append("Content-Length: ").append(std::to_string(request.content.size())).append("\r\n");
+            }
+
+            for (const auto& header : request.headers)
+            {
+                request_text.append(header.first).append(": ").append(header.second).append("\r\n");
+            }
+
+            request_text.append("\r\n").append(request.content);
+        }
+        catch (...)
+        {
+            callback(http_response(), std::current_exception());
+            return;
+        }
+
+        auto cancel = std::make_shared<cancel_event>();
+        cancel->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (cancel->fd < 0)
+        {
+            callback(http_response(), native_sockets::socket_error("eventfd", errno));
+            return;
+        }
+
+        token.register_callback([cancel]()
+            {
+                std::lock_guard<std::mutex> lock(cancel->lock);
+                if (cancel->fd >= 0)
+                {
+                    uint64_t value = 1;
+                    if (write(cancel->fd, &value, sizeof(value)) < 0)
+                    {
+                        // already signaled
+                    }
+                }
+            });
+
+        auto deadline = request.timeout.count() > 0
+            ? std::chrono::steady_clock::now() + request.timeout
+            : std::chrono::steady_clock::time_point::max();
+
+        auto connection_pool = m_connection_pool;
+        auto on_content = request.on_content;
+        auto idempotent = request.method == http_method::GET || request.method == http_method::DEL;
+        run([connection_pool, host, port, request_text, idempotent, deadline, cancel, on_content, callback]()
+            {
+                http_response response;
+                std::exception_ptr exception;
+                try
+                {
+                    response = perform_request(*connection_pool, host, port, request_text, idempotent, cancel->fd, deadline, on_content);
+                }
+                catch (...)
+                {
+                    exception = std::current_exception();
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(cancel->lock);
+                    native_sockets::close(cancel->fd);
+                }
+
+                callback(response, exception);
+            });
+    }
+}
+
+#endif
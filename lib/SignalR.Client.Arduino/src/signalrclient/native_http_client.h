@@ -0,0 +1,42 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#include "native_sockets.h"
+
+#ifdef USE_NATIVE_SOCKETS
+
+#include "signalrclient/http_client.h"
+#include "signalrclient/signalr_client_config.h"
+#include <functional>
+#include <memory>
+
+namespace signalr
+{
+    // HTTP/1.1 client on plain TCP sockets, a request blocks one of the client's worker threads until its response was read.
+    // Workers are reused by later requests, one is added when a request finds none idle and they exit after being idle for a
+    // while. Connections the server keeps alive are put back into `connection_pool` and reused by the next request to the same
+    // host. Bodies are streamed to `http_request::on_content` when it's set. Only http:// urls are supported, there is no TLS.
+    class native_http_client : public http_client
+    {
+    public:
+        explicit native_http_client(const signalr_client_config& config = {},
+            std::shared_ptr<native_sockets::connection_pool> connection_pool = std::make_shared<native_sockets::connection_pool>());
+
+        void send(const std::string& url, http_request& request,
+            std::function<void(const http_response&, std::exception_ptr)> callback, cancellation_token token) override;
+
+    private:
+        struct request_workers;
+
+        signalr_client_config m_config;
+        std::shared_ptr<native_sockets::connection_pool> m_connection_pool;
+        std::shared_ptr<request_workers> m_workers;
+
+        void run(std::function<void()> request);
+    };
+}
+
+#endif
@@ -0,0 +1,299 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+#include "native_sockets.h"
+
+#ifdef USE_NATIVE_SOCKETS
+
+#include "signalrclient/signalr_exception.h"
+#include "cancellation_token_source.h"
+#include "case_insensitive_comparison_utils.h"
+#include <algorithm>
+#include <errno.h>
+#include <memory>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+
+namespace signalr
+{
+    namespace native_sockets
+    {
+        namespace
+        {
+            // bounds how long `take` waits for a connection started ahead
+            const std::chrono::seconds connect_ahead_timeout(10);
+        }
+
+        std::exception_ptr socket_error(const std::string& operation, int error)
+        {
+            return std::make_exception_ptr(signalr_exception(operation + " failed: " + std::generic_category().message(error)));
+        }
+
+        int connect(const std::string& host, const std::string& port, const std::function<void(int)>& wait_writable)
+        {
+            addrinfo hints = {};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+
+            // literal IPv6 addresses are enclosed in brackets in urls
+            auto name = host.size() > 2 && host.front() == '[' && host.back() == ']' ? host.substr(1, host.size() - 2) : host;
+
+            addrinfo* addresses = nullptr;
+            auto result = getaddrinfo(name.c_str(), port.c_str(), &hints, &addresses);
+            if (result != 0)
+            {
+                throw signalr_exception("could not resolve '" + host + "': " + gai_strerror(result));
+            }
+
+            std::unique_ptr<addrinfo, void(*)(addrinfo*)> addresses_holder(addresses, freeaddrinfo);
+
+            int error = 0;
+            for (auto address = addresses; address != nullptr; address = address->ai_next)
+            {
+                int socket = ::socket(address->ai_family, address->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, address->ai_protocol);
+                if (socket < 0)
+                {
+                    error = errno;
+                    continue;
+                }
+
+                int no_delay = 1;
+                setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+                if (::connect(socket, address->ai_addr, address->ai_addrlen) == 0)
+                {
+                    return socket;
+                }
+
+                error = errno;
+                if (error == EINPROGRESS)
+                {
+                    try
+                    {
+                        wait_writable(socket);
+                    }
+                    catch (...)
+                    {
+                        close(socket);
+                        throw;
+                    }
+
+                    socklen_t length = sizeof(error);
+                    if (getsockopt(socket, SOL_SOCKET, SO_ERROR, &error, &length) < 0)
+                    {
+                        error = errno;
+                    }
+
+                    if (error == 0)
+                    {
+                        return socket;
+                    }
+                }
+
+                close(socket);
+            }
+
+            std::rethrow_exception(socket_error("connecting to '" + host + ":" + port + "'", error));
+        }
+
+        void close(int& socket) noexcept
+        {
+            if (socket >= 0)
+            {
+                ::close(socket);
+                socket = -1;
+            }
+        }
+
+        void wait(int socket, short events, int cancel_event, std::chrono::steady_clock::time_point deadline)
+        {
+            while (true)
+            {
+                pollfd fds[2] = {};
+                fds[0].fd = socket;
+                fds[0].events = events;
+                fds[1].fd = cancel_event;
+                fds[1].events = POLLIN;
+
+                auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+                if (remaining <= 0)
+                {
+                    throw signalr_exception("the request timed out");
+                }
+
+                auto count = poll(fds, cancel_event >= 0 ? 2 : 1, static_cast<int>(std::min<long long>(remaining, 60 * 1000)));
+                if (count < 0 && errno != EINTR)
+                {
+                    std::rethrow_exception(socket_error("poll", errno));
+                }
+
+                if (fds[1].revents != 0)
+                {
+                    throw canceled_exception();
+                }
+
+                if (fds[0].revents != 0)
+                {
+                    return;
+                }
+            }
+        }
+
+        std::string find_header(const std::string& response, const std::string& name)
+        {
+            // the status line comes first, every line ends with \r\n and an empty line ends the headers
+            auto line_start = response.find("\r\n");
+            while (line_start != std::string::npos)
+            {
+                line_start += 2;
+                auto line_end = response.find("\r\n", line_start);
+                if (line_end == std::string::npos || line_end == line_start)
+                {
+                    break;
+                }
+
+                auto colon = response.find(':', line_start);
+                if (colon < line_end && case_insensitive_equals()(response.substr(line_start, colon - line_start), name))
+                {
+                    auto value_start = response.find_first_not_of(" \t", colon + 1);
+                    auto value_end = response.find_last_not_of(" \t", line_end - 1);
+                    if (value_start >= line_end)
+                    {
+                        return std::string();
+                    }
+
+                    return response.substr(value_start, value_end - value_start + 1);
+                }
+
+                line_start = line_end;
+            }
+
+            return std::string();
+        }
+
+        connection_pool::~connection_pool()
+        {
+            for (auto& idle : m_idle)
+            {
+                close(idle.second);
+            }
+        }
+
+        int connection_pool::take(const std::string& host, const std::string& port)
+        {
+            auto key = host + ":" + port;
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_connect_completed.wait(lock, [this, &key]() { return m_connecting.count(key) == 0; });
+
+            auto idle = m_idle.find(key);
+            if (idle == m_idle.end())
+            {
+                return -1;
+            }
+
+            auto socket = idle->second;
+            m_idle.erase(idle);
+
+            // nothing is expected on an idle connection, so it being readable means the server closed it (or broke the protocol),
+            // catching that here keeps a request that can't be retried from being sent on it
+            pollfd poll_fd = { socket, POLLIN, 0 };
+            if (::poll(&poll_fd, 1, 0) != 0)
+            {
+                close(socket);
+                return -1;
+            }
+
+            return socket;
+        }
+
+        void connection_pool::put(const std::string& host, const std::string& port, int socket)
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            auto idle = m_idle.find(host + ":" + port);
+            if (idle == m_idle.end())
+            {
+                m_idle.emplace(host + ":" + port, socket);
+                return;
+            }
+
+            close(idle->second);
+            idle->second = socket;
+        }
+
+        void connection_pool::connect_ahead(const std::string& host, const std::string& port)
+        {
+            auto key = host + ":" + port;
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                if (m_idle.count(key) != 0)
+                {
+                    return;
+                }
+
+                auto connecting = m_connecting.find(key);
+                if (connecting != m_connecting.end())
+                {
+                    connecting->second = true;
+                    return;
+                }
+
+                m_connecting.emplace(key, true);
+            }
+
+            auto pool = shared_from_this();
+            std::thread([pool, host, port, key]()
+                {
+                    auto socket = -1;
+                    try
+                    {
+                        auto deadline = std::chrono::steady_clock::now() + connect_ahead_timeout;
+                        socket = connect(host, port, [deadline](int socket)
+                            {
+                                wait(socket, POLLOUT, -1, deadline);
+                            });
+                    }
+                    catch (...)
+                    {
+                        // whoever needs the connection connects on its own and reports the error
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(pool->m_lock);
+                        auto connecting = pool->m_connecting.find(key);
+                        auto keep = connecting->second;
+                        pool->m_connecting.erase(connecting);
+                        if (socket >= 0 && (!keep || !pool->m_idle.emplace(key, socket).second))
+                        {
+                            close(socket);
+                        }
+                    }
+                    pool->m_connect_completed.notify_all();
+                }).detach();
+        }
+
+        void connection_pool::close_idle()
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            for (auto& idle : m_idle)
+            {
+                close(idle.second);
+            }
+            m_idle.clear();
+
+            for (auto& connecting : m_connecting)
+            {
+                connecting.second = false;
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,76 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+// the dependency-free socket based clients are built for Linux hosts, e.g. PlatformIO's native environment
+#if defined(__linux__) && !defined(ARDUINO)
+#define USE_NATIVE_SOCKETS
+#endif
+
+#ifdef USE_NATIVE_SOCKETS
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace signalr
+{
+    namespace native_sockets
+    {
+        // signalr_exception describing the errno `error` of `operation`
+        std::exception_ptr socket_error(const std::string& operation, int error);
+
+        // Resolves `host` and connects a non-blocking TCP socket with Nagle's algorithm disabled to the first address that
+        // accepts the connection. `wait_writable` is called with the socket while its connect is in progress and returns once
+        // the socket is writable (or throws to give up). Throws if no address could be connected to.
+        int connect(const std::string& host, const std::string& port, const std::function<void(int)>& wait_writable);
+
+        void close(int& socket) noexcept;
+
+        // Waits until `socket` reports the poll `events`. Throws canceled_exception once `cancel_event` (an eventfd, or -1)
+        // becomes readable and signalr_exception when `deadline` passes.
+        void wait(int socket, short events, int cancel_event, std::chrono::steady_clock::time_point deadline);
+
+        // value of the header `name` in an http response head, empty if it is missing
+        std::string find_header(const std::string& response, const std::string& name);
+
+        // Idle keep-alive connections, at most one per host and port. Shared by the clients created for one connection so
+        // that negotiate, its redirects and the websocket upgrade don't each pay for a new TCP handshake.
+        class connection_pool : public std::enable_shared_from_this<connection_pool>
+        {
+        public:
+            connection_pool() = default;
+            ~connection_pool();
+
+            connection_pool(const connection_pool&) = delete;
+            connection_pool& operator=(const connection_pool&) = delete;
+
+            // Removes and returns the idle connection to host:port, -1 if there is none or the server closed it meanwhile. Waits
+            // for a connection to host:port started by `connect_ahead` to complete.
+            int take(const std::string& host, const std::string& port);
+            // keeps `socket` for the next request to host:port, replacing the connection that was kept before
+            void put(const std::string& host, const std::string& port, int socket);
+            // Connects to host:port in the background unless there is an idle connection to it already, the connection is
+            // kept as an idle one. Lets the websocket connect overlap negotiate when negotiate uses another client.
+            void connect_ahead(const std::string& host, const std::string& port);
+            // closes the idle connections, a connection `connect_ahead` is still setting up is closed once it completes
+            void close_idle();
+
+        private:
+            std::mutex m_lock;
+            std::condition_variable m_connect_completed;
+            std::map<std::string, int> m_idle;
+            // host:port being connected by `connect_ahead`, mapped to whether the connection is kept once it completes
+            std::map<std::string, bool> m_connecting;
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,1237 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+#include "native_websocket_client.h"
+
+#ifdef USE_NATIVE_SOCKETS
+
+#include "cpprest/base_uri.h"
+#include "cancellation_token_source.h"
+#include "json_helpers.h"
+#include "signalrclient/signalr_exception.h"
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace signalr
+{
+    namespace
+    {
+        const uint8_t opcode_continuation = 0x0;
+        const uint8_t opcode_text = 0x1;
+        const uint8_t opcode_binary = 0x2;
+        const uint8_t opcode_close = 0x8;
+        const uint8_t opcode_ping = 0x9;
+        const uint8_t opcode_pong = 0xa;
+
+        // also bounds the size of the upgrade response
+        const size_t read_buffer_size = 64 * 1024;
+        // how long a stopping client waits for the server to answer its close frame
+        const std::chrono::milliseconds close_timeout(2000);
+        // queued frames written with a single sendmsg
+        const size_t max_write_frames = 16;
+
+        uint32_t rotate_left(uint32_t value, int bits)
+        {
+            return (value << bits) | (value >> (32 - bits));
+        }
+
+        std::vector<uint8_t> sha1(const std::string& input)
+        {
+            uint32_t hash[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+            auto data = input;
+            data.push_back(static_cast<char>(0x80));
+            while (data.size() % 64 != 56)
+            {
+                data.push_back(0);
+            }
+
+            uint64_t bit_length = static_cast<uint64_t>(input.size()) * 8;
+            for (int i = 7; i >= 0; --i)
+            {
+                data.push_back(static_cast<char>(bit_length >> (i * 8)));
+            }
+
+            for (size_t chunk = 0; chunk < data.size(); chunk += 64)
+            {
+                uint32_t w[80];
+                for (size_t i = 0; i < 16; ++i)
+                {
+                    auto bytes = reinterpret_cast<const uint8_t*>(data.data() + chunk + i * 4);
+                    w[i] = static_cast<uint32_t>(bytes[0]) << 24 | static_cast<uint32_t>(bytes[1]) << 16 | static_cast<uint32_t>(bytes[2]) << 8 | bytes[3];
+                }
+
+                for (size_t i = 16; i < 80; ++i)
+                {
+                    w[i] = rotate_left(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+                }
+
+                uint32_t a = hash[0], b = hash[1], c = hash[2], d = hash[3], e = hash[4];
+                for (size_t i = 0; i < 80; ++i)
+                {
+                    uint32_t f, k;
+                    if (i < 20)
+                    {
+                        f = (b & c) | (~b & d);
+                        k = 0x5A827999;
+                    }
+                    else if (i < 40)
+                    {
+                        f = b ^ c ^ d;
+                        k = 0x6ED9EBA1;
+                    }
+                    else if (i < 60)
+                    {
+                        f = (b & c) | (b & d) | (c & d);
+                        k = 0x8F1BBCDC;
+                    }
+                    else
+                    {
+                        f = b ^ c ^ d;
+                        k = 0xCA62C1D6;
+                    }
+
+                    auto temp = rotate_left(a, 5) + f + e + k + w[i];
+                    e = d;
+                    d = c;
+                    c = rotate_left(b, 30);
+                    b = a;
+                    a = temp;
+                }
+
+                hash[0] += a;
+                hash[1] += b;
+                hash[2] += c;
+                hash[3] += d;
+                hash[4] += e;
+            }
+
+            std::vector<uint8_t> digest;
+            for (auto word : hash)
+            {
+                for (int i = 3; i >= 0; --i)
+                {
+                    digest.push_back(static_cast<uint8_t>(word >> (i * 8)));
+                }
+            }
+
+            return digest;
+        }
+
+    }
+
+    native_websocket_client::native_websocket_client(const signalr_client_config& signalr_client_config,
+        std::shared_ptr<native_sockets::connection_pool> connection_pool)
+        : m_signalr_client_config(signalr_client_config), m_connection_pool(std::move(connection_pool)), m_state(state::stopped), m_random(std::random_device()()), m_paused(false),
+        m_stopped_on_io_thread(false), m_socket(-1), m_epoll(-1), m_wakeup(-1), m_read_buffer(read_buffer_size), m_read_start(0), m_read_end(0),
+        m_parse_pending(false), m_socket_events(0), m_in_frame(false), m_frame_fin(false), m_frame_opcode(0), m_frame_remaining(0),
+        m_message_opcode(0), m_close_sent(false), m_close_received(false)
+    { }
+
+    native_websocket_client::~native_websocket_client()
+    {
+        native_sockets::close(m_socket);
+        native_sockets::close(m_epoll);
+        native_sockets::close(m_wakeup);
+    }
+
+    void native_websocket_client::start(const std::string& url, std::function<void(std::exception_ptr)> callback)
+    {
+        std::string host;
+        std::string port;
+        std::string request;
+        try
+        {
+            web::uri uri(url);
+            if (uri.scheme() != "ws")
+            {
+                throw signalr_exception("native_websocket_client only supports ws:// urls, got: " + url);
+            }
+
+            host = uri.host();
+            port = std::to_string(uri.port() > 0 ? uri.port() : 80);
+            auto resource = uri.resource().to_string();
+
+            request.append("GET ").append(resource.empty() ? "/" : resource).append(" HTTP/1.1\r\n")
+                .append("Host: ").append(host).append(uri.port() > 0 ? ":" + port : "").append("\r\n")
+                .append("Upgrade: websocket\r\n")
+                .append("Connection: Upgrade\r\n")
+                .append("Sec-WebSocket-Version: 13\r\n");
+
+            for (const auto& header : m_signalr_client_config.get_http_headers())
+            {
+                request.append(header.first).append(": ").append(header.second).append("\r\n");
+            }
+
+#ifdef USE_ZLIB
+            if (m_signalr_client_config.get_websocket_compression().enabled)
+            {
+                request.append("Sec-WebSocket-Extensions: ")
+                    .append(permessage_deflate(m_signalr_client_config.get_websocket_compression()).create_offer()).append("\r\n");
+            }
+#endif
+        }
+        catch (...)
+        {
+            callback(std::current_exception());
+            return;
+        }
+
+        std::string accept_key;
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            if (m_state != state::stopped)
+            {
+                lock.unlock();
+                callback(std::make_exception_ptr(signalr_exception("the websocket client was already started")));
+                return;
+            }
+
+            std::vector<uint8_t> key;
+            for (size_t i = 0; i < 16; ++i)
+            {
+                key.push_back(static_cast<uint8_t>(m_random()));
+            }
+            auto encoded_key = base64Encode(key);
+            request.append("Sec-WebSocket-Key: ").append(encoded_key).append("\r\n\r\n");
+            accept_key = create_accept_key(encoded_key);
+
+            m_epoll = epoll_create1(EPOLL_CLOEXEC);
+            m_wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.fd = m_wakeup;
+            if (m_epoll < 0 || m_wakeup < 0 || epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeup, &event) < 0)
+            {
+                auto exception = native_sockets::socket_error("creating the websocket event loop", errno);
+                native_sockets::close(m_epoll);
+                native_sockets::close(m_wakeup);
+                lock.unlock();
+                callback(exception);
+                return;
+            }
+
+            m_state = state::connecting;
+            m_paused = false;
+            m_stopped_on_io_thread = false;
+            m_read_start = 0;
+            m_read_end = 0;
+            m_parse_pending = false;
+            m_socket_events = 0;
+            m_in_frame = false;
+            m_message_opcode = 0;
+            m_message.clear();
+#ifdef USE_ZLIB
+            m_message_compressed = false;
+#endif
+            m_close_sent = false;
+            m_close_received = false;
+        }
+
+        auto self = shared_from_this();
+        std::thread([self, host, port, request, accept_key, callback]()
+            {
+                self->run(host, port, request, accept_key, callback);
+            }).detach();
+    }
+
+    void native_websocket_client::run(const std::string& host, const std::string& port, const std::string& request,
+        const std::string& accept_key, std::function<void(std::exception_ptr)> callback)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_io_thread_id = std::this_thread::get_id();
+        }
+
+        std::exception_ptr exception;
+        try
+        {
+            // upgrading the connection negotiate left idle saves a TCP handshake
+            m_socket = m_connection_pool != nullptr ? m_connection_pool->take(host, port) : -1;
+            if (m_socket >= 0)
+            {
+                try
+                {
+                    handshake(request, accept_key);
+                }
+                catch (const canceled_exception&)
+                {
+                    throw;
+                }
+                catch (...)
+                {
+                    // the server may have closed the connection while it was idle, the upgrade is sent again on a new one
+                    if (m_read_end > 0)
+                    {
+                        throw;
+                    }
+                    native_sockets::close(m_socket);
+                }
+            }
+
+            if (m_socket < 0)
+            {
+                m_socket = native_sockets::connect(host, port, [this](int socket)
+                    {
+                        wait_for_socket(socket, EPOLLOUT);
+                    });
+                handshake(request, accept_key);
+            }
+
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_state == state::closing)
+            {
+                throw canceled_exception();
+            }
+            m_state = state::open;
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+
+        // completions run on the scheduler, callers may block in them until a message was received (e.g. the hub handshake), a
+        // failed start is reported the same way so the callback never runs on the I/O thread
+        if (exception != nullptr)
+        {
+            shutdown(nullptr);
+            m_signalr_client_config.get_scheduler()->schedule([callback, exception]()
+                {
+                    callback(exception);
+                });
+            return;
+        }
+
+        m_signalr_client_config.get_scheduler()->schedule([callback]()
+            {
+                callback(nullptr);
+            });
+
+        auto close_deadline = std::chrono::steady_clock::time_point::max();
+        try
+        {
+            while (step(close_deadline))
+            {
+            }
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+
+        shutdown(exception);
+    }
+
+    void native_websocket_client::handshake(const std::string& request, const std::string& accept_key)
+    {
+        size_t written = 0;
+        while (written < request.size())
+        {
+            auto sent = ::send(m_socket, request.data() + written, request.size() - written, MSG_NOSIGNAL);
+            if (sent >= 0)
+            {
+                written += static_cast<size_t>(sent);
+            }
+            else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                wait_for_socket(m_socket, EPOLLOUT);
+            }
+            else if (errno != EINTR)
+            {
+                std::rethrow_exception(native_sockets::socket_error("sending the websocket upgrade request", errno));
+            }
+        }
+
+        // frames the server sends right after the response stay in the read buffer
+        const char terminator[] = "\r\n\r\n";
+        char* header_end;
+        while (true)
+        {
+            auto end = m_read_buffer.data() + m_read_end;
+            auto found = std::search(m_read_buffer.data(), end, terminator, terminator + 4);
+            if (found != end)
+            {
+                header_end = found + 4;
+                break;
+            }
+
+            if (m_read_end == m_read_buffer.size())
+            {
+                throw signalr_exception("the websocket upgrade response is too large");
+            }
+
+            auto received = recv(m_socket, end, m_read_buffer.size() - m_read_end, 0);
+            if (received > 0)
+            {
+                m_read_end += static_cast<size_t>(received);
+            }
+            else if (received == 0)
+            {
+                throw signalr_exception("the server closed the connection during the websocket upgrade");
+            }
+            else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                wait_for_socket(m_socket, EPOLLIN);
+            }
+            else if (errno != EINTR)
+            {
+                std::rethrow_exception(native_sockets::socket_error("receiving the websocket upgrade response", errno));
+            }
+        }
+
+        std::string response(m_read_buffer.data(), header_end);
+        m_read_start = static_cast<size_t>(header_end - m_read_buffer.data());
+        m_parse_pending = m_read_start < m_read_end;
+
+        // e.g. "HTTP/1.1 101 Switching Protocols"
+        auto status = response.find(' ');
+        if (status == std::string::npos || response.compare(status + 1, 3, "101") != 0)
+        {
+            throw signalr_exception("the server did not accept the websocket upgrade: " + response.substr(0, response.find("\r\n")));
+        }
+
+        if (native_sockets::find_header(response, "Sec-WebSocket-Accept") != accept_key)
+        {
+            throw signalr_exception("the server answered the websocket upgrade with an invalid Sec-WebSocket-Accept header");
+        }
+
+#ifdef USE_ZLIB
+        // a fresh instance per attempt, the handshake is retried when a pooled connection turns out to be closed
+        std::lock_guard<std::mutex> deflate_lock(m_deflate_lock);
+        m_deflate.reset();
+        const auto& compression = m_signalr_client_config.get_websocket_compression();
+        if (compression.enabled)
+        {
+            std::unique_ptr<permessage_deflate> deflate(new permessage_deflate(compression));
+            if (deflate->accept(native_sockets::find_header(response, "Sec-WebSocket-Extensions")))
+            {
+                m_deflate = std::move(deflate);
+            }
+        }
+#endif
+    }
+
+    // Only used while connecting, waits until `socket` reports `events` or `stop` was called.
+    void native_websocket_client::wait_for_socket(int socket, uint32_t events)
+    {
+        epoll_event event = {};
+        event.events = events;
+        event.data.fd = socket;
+        if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, socket, &event) < 0)
+        {
+            std::rethrow_exception(native_sockets::socket_error("epoll_ctl", errno));
+        }
+
+        try
+        {
+            bool ready = false;
+            while (!ready)
+            {
+                epoll_event ready_events[2];
+                auto count = epoll_wait(m_epoll, ready_events, 2, -1);
+                if (count < 0 && errno != EINTR)
+                {
+                    std::rethrow_exception(native_sockets::socket_error("epoll_wait", errno));
+                }
+
+                for (int i = 0; i < count; ++i)
+                {
+                    if (ready_events[i].data.fd != m_wakeup)
+                    {
+                        ready = true;
+                        continue;
+                    }
+
+                    uint64_t value;
+                    if (read(m_wakeup, &value, sizeof(value)) < 0)
+                    {
+                        // nothing to drain
+                    }
+
+                    std::lock_guard<std::mutex> lock(m_lock);
+                    if (m_state == state::closing)
+                    {
+                        throw canceled_exception();
+                    }
+                }
+            }
+        }
+        catch (...)
+        {
+            epoll_ctl(m_epoll, EPOLL_CTL_DEL, socket, nullptr);
+            throw;
+        }
+
+        epoll_ctl(m_epoll, EPOLL_CTL_DEL, socket, nullptr);
+    }
+
+    // One iteration of the I/O thread's loop: starts the close handshake if `stop` was called, writes what was queued,
+    // parses buffered input and waits for the socket or a wakeup. Returns false once the connection is done.
+    bool native_websocket_client::step(std::chrono::steady_clock::time_point& close_deadline)
+    {
+        if (m_stopped_on_io_thread)
+        {
+            return false;
+        }
+
+        bool closing;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            closing = m_state == state::closing;
+        }
+
+        if (closing && !m_close_sent)
+        {
+            // 1000 - normal closure
+            queue_control_frame(opcode_close, std::string("\x03\xe8", 2));
+            close_deadline = std::chrono::steady_clock::now() + close_timeout;
+        }
+
+        write_pending();
+
+        bool outbound_empty;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            outbound_empty = m_outbound.empty();
+        }
+
+        if (m_close_received && m_close_sent && outbound_empty)
+        {
+            if (!closing)
+            {
+                throw signalr_exception("the server closed the websocket connection");
+            }
+
+            return false;
+        }
+
+        bool reading = !m_close_received && (closing || !m_paused);
+        if (reading && m_parse_pending)
+        {
+            process_input(closing);
+            return true;
+        }
+
+        uint32_t socket_events = 0;
+        if (reading)
+        {
+            socket_events |= EPOLLIN;
+        }
+        if (!outbound_empty)
+        {
+            socket_events |= EPOLLOUT;
+        }
+        update_socket_events(socket_events);
+
+        int timeout = -1;
+        if (m_close_sent)
+        {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(close_deadline - std::chrono::steady_clock::now()).count();
+            if (remaining <= 0)
+            {
+                return false;
+            }
+            timeout = static_cast<int>(remaining);
+        }
+
+        epoll_event events[2];
+        auto count = epoll_wait(m_epoll, events, 2, timeout);
+        if (count < 0 && errno != EINTR)
+        {
+            std::rethrow_exception(native_sockets::socket_error("epoll_wait", errno));
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            if (events[i].data.fd == m_wakeup)
+            {
+                uint64_t value;
+                if (read(m_wakeup, &value, sizeof(value)) < 0)
+                {
+                    // nothing to drain
+                }
+            }
+            else if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0 && !read_input())
+            {
+                if (closing)
+                {
+                    // the server closed the connection without answering the close frame
+                    return false;
+                }
+
+                throw signalr_exception("the websocket connection was closed by the server");
+            }
+        }
+
+        return true;
+    }
+
+    // Closes the connection after the loop ended, fails the sends that were not written and completes `stop`. `exception` is
+    // delivered to the message handler unless the client was being stopped.
+    void native_websocket_client::shutdown(std::exception_ptr exception)
+    {
+        native_sockets::close(m_socket);
+
+        std::deque<outbound_frame> outbound;
+        std::vector<std::function<void(std::exception_ptr)>> stop_callbacks;
+        bool stop_requested;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            native_sockets::close(m_epoll);
+            native_sockets::close(m_wakeup);
+            outbound.swap(m_outbound);
+            stop_callbacks.swap(m_stop_callbacks);
+            stop_requested = m_state == state::closing;
+            m_state = state::stopped;
+            m_io_thread_id = std::thread::id();
+        }
+
+        auto send_exception = exception != nullptr ? exception
+            : std::make_exception_ptr(signalr_exception("the websocket client was stopped before the message was sent"));
+        for (auto& frame : outbound)
+        {
+            if (frame.callback)
+            {
+                frame.callback(send_exception);
+            }
+        }
+
+        if (exception != nullptr && !stop_requested && m_message_handler)
+        {
+            m_message_handler(std::string(), exception);
+        }
+
+        for (auto& callback : stop_callbacks)
+        {
+            callback(nullptr);
+        }
+    }
+
+    // Returns false if the server closed the connection.
+    bool native_websocket_client::read_input()
+    {
+        if (m_read_start > 0)
+        {
+            memmove(m_read_buffer.data(), m_read_buffer.data() + m_read_start, m_read_end - m_read_start);
+            m_read_end -= m_read_start;
+            m_read_start = 0;
+        }
+
+        while (m_read_end < m_read_buffer.size())
+        {
+            auto received = recv(m_socket, m_read_buffer.data() + m_read_end, m_read_buffer.size() - m_read_end, 0);
+            if (received > 0)
+            {
+                m_read_end += static_cast<size_t>(received);
+                m_parse_pending = true;
+                break;
+            }
+
+            if (received == 0)
+            {
+                return false;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                break;
+            }
+
+            if (errno != EINTR)
+            {
+                std::rethrow_exception(native_sockets::socket_error("receiving from the websocket", errno));
+            }
+        }
+
+        return true;
+    }
+
+    // Parses the buffered frames and delivers the messages they complete, messages completed by the same read are delivered
+    // as one batch if a batch handler was registered. Stops early if receiving was paused.
+    void native_websocket_client::process_input(bool closing)
+    {
+        std::vector<std::string> batch;
+        m_parse_pending = false;
+        while (true)
+        {
+            if (m_paused && !closing)
+            {
+                m_parse_pending = true;
+                break;
+            }
+
+            std::string message;
+            auto result = parse_frame(message);
+            if (result == parse_result::need_more || result == parse_result::closed)
+            {
+                break;
+            }
+
+            // messages are dropped once the client is being stopped
+            if (result != parse_result::message || closing)
+            {
+                continue;
+            }
+
+            if (m_batch_handler)
+            {
+                batch.push_back(std::move(message));
+                continue;
+            }
+
+            m_message_handler(std::move(message), nullptr);
+            if (m_stopped_on_io_thread)
+            {
+                return;
+            }
+        }
+
+        if (batch.size() == 1)
+        {
+            m_message_handler(std::move(batch.front()), nullptr);
+        }
+        else if (!batch.empty())
+        {
+            m_batch_handler(std::move(batch));
+        }
+    }
+
+    native_websocket_client::parse_result native_websocket_client::parse_frame(std::string& message)
+    {
+        while (true)
+        {
+            auto available = m_read_end - m_read_start;
+            if (!m_in_frame)
+            {
+                if (available < 2)
+                {
+                    return parse_result::need_more;
+                }
+
+                auto header = reinterpret_cast<const uint8_t*>(m_read_buffer.data() + m_read_start);
+                size_t header_size = 2;
+                uint64_t length = header[1] & 0x7f;
+                if (length == 126)
+                {
+                    header_size += 2;
+                }
+                else if (length == 127)
+                {
+                    header_size += 8;
+                }
+
+                if ((header[1] & 0x80) != 0)
+                {
+                    throw signalr_exception("the server sent a masked websocket frame");
+                }
+
+                if (available < header_size)
+                {
+                    return parse_result::need_more;
+                }
+
+                if (header_size > 2)
+                {
+                    length = 0;
+                    for (size_t i = 2; i < header_size; ++i)
+                    {
+                        length = (length << 8) | header[i];
+                    }
+                }
+
+                auto opcode = static_cast<uint8_t>(header[0] & 0x0f);
+                auto fin = (header[0] & 0x80) != 0;
+                auto reserved = header[0] & 0x70;
+#ifdef USE_ZLIB
+                // RSV1 marks the first frame of a compressed message
+                auto compressed = reserved == 0x40 && m_deflate != nullptr && (opcode == opcode_text || opcode == opcode_binary);
+                if (compressed)
+                {
+                    reserved = 0;
+                }
+#endif
+                if (reserved != 0)
+                {
+                    throw signalr_exception("the server sent a websocket frame with reserved bits set");
+                }
+
+                if ((opcode & 0x08) != 0)
+                {
+                    if (opcode != opcode_close && opcode != opcode_ping && opcode != opcode_pong)
+                    {
+                        throw signalr_exception("the server sent a websocket frame with an unknown opcode");
+                    }
+
+                    if (!fin || length > 125)
+                    {
+                        throw signalr_exception("the server sent an invalid websocket control frame");
+                    }
+
+                    m_control_payload.clear();
+                }
+                else
+                {
+                    if (opcode == opcode_continuation ? m_message_opcode == 0 : m_message_opcode != 0)
+                    {
+                        throw signalr_exception("the server sent an unexpected websocket continuation frame");
+                    }
+
+                    if (opcode != opcode_continuation && opcode != opcode_text && opcode != opcode_binary)
+                    {
+                        throw signalr_exception("the server sent a websocket frame with an unknown opcode");
+                    }
+
+                    if (opcode != opcode_continuation)
+                    {
+                        m_message_opcode = opcode;
+#ifdef USE_ZLIB
+                        m_message_compressed = compressed;
+#endif
+                    }
+
+                    if (length > m_signalr_client_config.get_max_receive_message_size() - m_message.size())
+                    {
+                        throw signalr_exception("the server sent a websocket message larger than the maximum message size");
+                    }
+
+                    // the payload is copied straight from the read buffer into the message
+                    if (length <= read_buffer_size * 256)
+                    {
+                        m_message.reserve(m_message.size() + static_cast<size_t>(length));
+                    }
+                }
+
+                m_read_start += header_size;
+                m_in_frame = true;
+                m_frame_fin = fin;
+                m_frame_opcode = opcode;
+                m_frame_remaining = length;
+                continue;
+            }
+
+            auto is_control = (m_frame_opcode & 0x08) != 0;
+            auto count = static_cast<size_t>(std::min<uint64_t>(available, m_frame_remaining));
+            (is_control ? m_control_payload : m_message).append(m_read_buffer.data() + m_read_start, count);
+            m_read_start += count;
+            m_frame_remaining -= count;
+            if (m_frame_remaining > 0)
+            {
+                return parse_result::need_more;
+            }
+
+            m_in_frame = false;
+            if (is_control)
+            {
+                if (m_frame_opcode == opcode_ping)
+                {
+                    queue_control_frame(opcode_pong, m_control_payload);
+                }
+                else if (m_frame_opcode == opcode_close)
+                {
+                    m_close_received = true;
+                    if (!m_close_sent)
+                    {
+                        // echo the status code
+                        queue_control_frame(opcode_close, m_control_payload.substr(0, 2));
+                    }
+                    return parse_result::closed;
+                }
+
+                return parse_result::control;
+            }
+
+            if (m_frame_fin)
+            {
+#ifdef USE_ZLIB
+                if (m_message_compressed)
+                {
+                    std::string decompressed;
+                    m_deflate->decompress(m_message, decompressed, m_signalr_client_config.get_max_receive_message_size());
+                    m_message = std::move(decompressed);
+                }
+#endif
+                message = std::move(m_message);
+                m_message = std::string();
+                m_message_opcode = 0;
+                return parse_result::message;
+            }
+        }
+    }
+
+    // Writes queued frames until the socket would block.
+    void native_websocket_client::write_pending()
+    {
+        while (true)
+        {
+            iovec buffers[max_write_frames];
+            size_t count = 0;
+            {
+                // only the I/O thread removes frames and other threads only append, so the payloads stay put while writing
+                std::lock_guard<std::mutex> lock(m_lock);
+                for (auto& frame : m_outbound)
+                {
+                    if (count == max_write_frames)
+                    {
+                        break;
+                    }
+
+                    buffers[count].iov_base = &frame.data[frame.written];
+                    buffers[count].iov_len = frame.data.size() - frame.written;
+                    ++count;
+                }
+            }
+
+            if (count == 0)
+            {
+                return;
+            }
+
+            msghdr message = {};
+            message.msg_iov = buffers;
+            message.msg_iovlen = count;
+            auto sent = sendmsg(m_socket, &message, MSG_NOSIGNAL);
+            if (sent < 0)
+            {
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    return;
+                }
+
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                std::rethrow_exception(native_sockets::socket_error("sending to the websocket", errno));
+            }
+
+            std::vector<std::function<void(std::exception_ptr)>> completed;
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                auto remaining = static_cast<size_t>(sent);
+                while (remaining > 0)
+                {
+                    auto& frame = m_outbound.front();
+                    auto left = frame.data.size() - frame.written;
+                    if (remaining < left)
+                    {
+                        frame.written += remaining;
+                        break;
+                    }
+
+                    remaining -= left;
+                    if (frame.callback)
+                    {
+                        completed.push_back(std::move(frame.callback));
+                    }
+                    m_outbound.pop_front();
+                }
+            }
+
+            if (!completed.empty())
+            {
+                auto callbacks = std::make_shared<std::vector<std::function<void(std::exception_ptr)>>>(std::move(completed));
+                m_signalr_client_config.get_scheduler()->schedule([callbacks]()
+                    {
+                        for (auto& callback : *callbacks)
+                        {
+                            callback(nullptr);
+                        }
+                    });
+            }
+        }
+    }
+
+    void native_websocket_client::update_socket_events(uint32_t events)
+    {
+        if (events == m_socket_events)
+        {
+            return;
+        }
+
+        epoll_event event = {};
+        event.events = events;
+        event.data.fd = m_socket;
+        int result;
+        if (m_socket_events == 0)
+        {
+            result = epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_socket, &event);
+        }
+        else if (events == 0)
+        {
+            // while paused with nothing to write the socket is not watched at all, a hang up is noticed once receiving resumes
+            result = epoll_ctl(m_epoll, EPOLL_CTL_DEL, m_socket, nullptr);
+        }
+        else
+        {
+            result = epoll_ctl(m_epoll, EPOLL_CTL_MOD, m_socket, &event);
+        }
+
+        if (result < 0)
+        {
+            std::rethrow_exception(native_sockets::socket_error("epoll_ctl", errno));
+        }
+
+        m_socket_events = events;
+    }
+
+    std::string native_websocket_client::create_frame(uint8_t opcode, const std::vector<const_buffer>& buffers, bool compressed)
+    {
+        size_t size = 0;
+        for (const auto& buffer : buffers)
+        {
+            size += buffer.size;
+        }
+
+        char mask[4];
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            auto random = static_cast<uint32_t>(m_random());
+            memcpy(mask, &random, sizeof(mask));
+        }
+
+        std::string frame;
+        frame.reserve(14 + size);
+        frame.push_back(static_cast<char>(0x80 | (compressed ? 0x40 : 0) | opcode));
+        if (size < 126)
+        {
+            frame.push_back(static_cast<char>(0x80 | size));
+        }
+        else if (size <= 0xffff)
+        {
+            frame.push_back(static_cast<char>(0x80 | 126));
+            frame.push_back(static_cast<char>(size >> 8));
+            frame.push_back(static_cast<char>(size));
+        }
+        else
+        {
+            frame.push_back(static_cast<char>(0x80 | 127));
+            for (int i = 7; i >= 0; --i)
+            {
+                frame.push_back(static_cast<char>(static_cast<uint64_t>(size) >> (i * 8)));
+            }
+        }
+        frame.append(mask, sizeof(mask));
+
+        size_t offset = 0;
+        for (const auto& buffer : buffers)
+        {
+            frame.append(buffer.data, buffer.size);
+            apply_mask(&frame[frame.size() - buffer.size], buffer.size, mask, offset);
+            offset += buffer.size;
+        }
+
+        return frame;
+    }
+
+    // Called by the I/O thread. Pings and pongs are written right after the frame being written, close frames after
+    // everything that was queued.
+    void native_websocket_client::queue_control_frame(uint8_t opcode, const std::string& payload)
+    {
+        auto frame = create_frame(opcode, std::vector<const_buffer>{ const_buffer{ payload.data(), payload.size() } });
+
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (opcode == opcode_close)
+        {
+            m_outbound.push_back(outbound_frame{ std::move(frame), 0, nullptr });
+            m_close_sent = true;
+            return;
+        }
+
+        auto position = m_outbound.begin();
+        if (position != m_outbound.end() && position->written > 0)
+        {
+            ++position;
+        }
+        m_outbound.insert(position, outbound_frame{ std::move(frame), 0, nullptr });
+    }
+
+    void native_websocket_client::wake() noexcept
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_wakeup >= 0)
+        {
+            uint64_t value = 1;
+            if (write(m_wakeup, &value, sizeof(value)) < 0)
+            {
+                // the counter is already non-zero
+            }
+        }
+    }
+
+    void native_websocket_client::stop(std::function<void(std::exception_ptr)> callback)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            if (m_state != state::stopped)
+            {
+                m_state = state::closing;
+                if (std::this_thread::get_id() != m_io_thread_id)
+                {
+                    m_stop_callbacks.push_back(callback);
+                    lock.unlock();
+                    wake();
+                    return;
+                }
+
+                // called from a handler or a completion, the I/O thread closes the connection once it returns but nothing
+                // is delivered anymore
+                m_stopped_on_io_thread = true;
+            }
+        }
+
+        callback(nullptr);
+    }
+
+    void native_websocket_client::send(const std::string& payload, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback)
+    {
+        send(std::vector<const_buffer>{ const_buffer{ payload.data(), payload.size() } }, transfer_format, callback);
+    }
+
+    void native_websocket_client::send(const std::vector<const_buffer>& buffers, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback)
+    {
+        auto opcode = transfer_format == transfer_format::binary ? opcode_binary : opcode_text;
+        std::string frame;
+#ifdef USE_ZLIB
+        std::unique_lock<std::mutex> deflate_lock(m_deflate_lock);
+        size_t size = 0;
+        for (const auto& buffer : buffers)
+        {
+            size += buffer.size;
+        }
+
+        if (m_deflate != nullptr && m_deflate->should_compress(size))
+        {
+            try
+            {
+                std::string compressed;
+                m_deflate->compress(buffers, compressed);
+                frame = create_frame(opcode, std::vector<const_buffer>{ const_buffer{ compressed.data(), compressed.size() } }, true);
+            }
+            catch (...)
+            {
+                deflate_lock.unlock();
+                callback(std::current_exception());
+                return;
+            }
+        }
+        else
+        {
+            deflate_lock.unlock();
+        }
+#endif
+
+        if (frame.empty())
+        {
+            // the buffers are copied into the frame anyway since they have to be masked
+            frame = create_frame(opcode, buffers);
+        }
+
+        auto queued = queue_frame(std::move(frame), callback);
+#ifdef USE_ZLIB
+        if (deflate_lock.owns_lock())
+        {
+            deflate_lock.unlock();
+        }
+#endif
+
+        if (!queued)
+        {
+            callback(std::make_exception_ptr(signalr_exception("the websocket client is not connected")));
+        }
+    }
+
+    // Returns false without queueing the frame if the client isn't open, `callback` is left for the caller to invoke.
+    bool native_websocket_client::queue_frame(std::string&& frame, std::function<void(std::exception_ptr)> callback)
+    {
+        bool wake_io_thread;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_state != state::open)
+            {
+                return false;
+            }
+
+            m_outbound.push_back(outbound_frame{ std::move(frame), 0, callback });
+            wake_io_thread = m_outbound.size() == 1;
+        }
+
+        if (wake_io_thread)
+        {
+            wake();
+        }
+
+        return true;
+    }
+
+    void native_websocket_client::on_message(std::function<void(const std::string&, std::exception_ptr)> handler)
+    {
+        on_owned_message([handler](std::string&& message, std::exception_ptr exception)
+            {
+                handler(message, exception);
+            });
+    }
+
+    void native_websocket_client::on_owned_message(std::function<void(std::string&&, std::exception_ptr)> handler)
+    {
+        m_message_handler = handler;
+    }
+
+    void native_websocket_client::on_message_batch(std::function<void(std::vector<std::string>&&)> handler)
+    {
+        m_batch_handler = handler;
+    }
+
+    void native_websocket_client::pause_receive()
+    {
+        m_paused = true;
+    }
+
+    void native_websocket_client::resume_receive()
+    {
+        m_paused = false;
+        wake();
+    }
+
+    void native_websocket_client::apply_mask(char* data, size_t size, const char mask[4], size_t offset) noexcept
+    {
+        // the key rotated to start at `offset` and repeated to 8 bytes, XORing a word at a time lets compilers vectorize the loop
+        char key[8];
+        for (size_t i = 0; i < sizeof(key); ++i)
+        {
+            key[i] = mask[(offset + i) % 4];
+        }
+
+        uint64_t key_word;
+        memcpy(&key_word, key, sizeof(key_word));
+
+        size_t i = 0;
+        for (; i + sizeof(key_word) <= size; i += sizeof(key_word))
+        {
+            uint64_t word;
+            memcpy(&word, data + i, sizeof(word));
+            word ^= key_word;
+            memcpy(data + i, &word, sizeof(word));
+        }
+
+        for (; i < size; ++i)
+        {
+            data[i] ^= key[i % sizeof(key)];
+        }
+    }
+
+    std::string native_websocket_client::create_accept_key(const std::string& key)
+    {
+        return base64Encode(sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"));
+    }
+}
+
+#endif
@@ -0,0 +1,148 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#include "native_sockets.h"
+#include "permessage_deflate.h"
+
+#ifdef USE_NATIVE_SOCKETS
+
+#include "signalrclient/signalr_client_config.h"
+#include "signalrclient/websocket_client.h"
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdint.h>
+#include <thread>
+
+namespace signalr
+{
+    // RFC 6455 client on a non-blocking TCP socket. A started client owns an I/O thread that waits on epoll for the socket and
+    // for the sends, stops and resumes posted by other threads. Received messages are delivered on that thread, start and
+    // send completions on the config's scheduler. Only ws:// urls are supported, there is no TLS.
+    class native_websocket_client : public persistent_websocket_client, public std::enable_shared_from_this<native_websocket_client>
+    {
+    public:
+        // `connection_pool` is checked for an idle connection to the server (e.g. the one negotiate used) before connecting
+        explicit native_websocket_client(const signalr_client_config& signalr_client_config = {},
+            std::shared_ptr<native_sockets::connection_pool> connection_pool = nullptr);
+        ~native_websocket_client();
+
+        native_websocket_client(const native_websocket_client&) = delete;
+        native_websocket_client& operator=(const native_websocket_client&) = delete;
+
+        void start(const std::string& url, std::function<void(std::exception_ptr)> callback) override;
+        void stop(std::function<void(std::exception_ptr)> callback) override;
+        void send(const std::string& payload, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback) override;
+        void send(const std::vector<const_buffer>& buffers, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback) override;
+
+        void on_message(std::function<void(const std::string&, std::exception_ptr)> handler) override;
+        void on_owned_message(std::function<void(std::string&&, std::exception_ptr)> handler) override;
+        void on_message_batch(std::function<void(std::vector<std::string>&&)> handler) override;
+        void pause_receive() override;
+        void resume_receive() override;
+
+        // XORs `data` with the 4 byte masking key, `offset` is the position of `data` in the masked payload
+        static void apply_mask(char* data, size_t size, const char mask[4], size_t offset = 0) noexcept;
+        // the Sec-WebSocket-Accept value a server answers the Sec-WebSocket-Key `key` with
+        static std::string create_accept_key(const std::string& key);
+
+    private:
+        enum class state
+        {
+            stopped,
+            connecting,
+            open,
+            // `stop` was called, the close handshake is in progress
+            closing
+        };
+
+        enum class parse_result
+        {
+            need_more,
+            message,
+            control,
+            closed
+        };
+
+        struct outbound_frame
+        {
+            std::string data;
+            size_t written;
+            std::function<void(std::exception_ptr)> callback;
+        };
+
+        signalr_client_config m_signalr_client_config;
+        std::shared_ptr<native_sockets::connection_pool> m_connection_pool;
+        std::function<void(std::string&&, std::exception_ptr)> m_message_handler;
+        std::function<void(std::vector<std::string>&&)> m_batch_handler;
+
+        // guards the members shared with the I/O thread
+        std::mutex m_lock;
+        state m_state;
+        std::thread::id m_io_thread_id;
+        std::deque<outbound_frame> m_outbound;
+        std::vector<std::function<void(std::exception_ptr)>> m_stop_callbacks;
+        std::mt19937 m_random;
+
+        std::atomic<bool> m_paused;
+        // set when the I/O thread itself called `stop` (e.g. from a message handler) which completes right away
+        std::atomic<bool> m_stopped_on_io_thread;
+
+        int m_socket;
+        int m_epoll;
+        // eventfd other threads write to so the I/O thread looks at the shared state again
+        int m_wakeup;
+
+        // only touched by the I/O thread, received bytes between `m_read_start` and `m_read_end` weren't parsed yet
+        std::vector<char> m_read_buffer;
+        size_t m_read_start;
+        size_t m_read_end;
+        // the buffer may hold complete frames that weren't parsed, e.g. because receiving was paused
+        bool m_parse_pending;
+        uint32_t m_socket_events;
+        bool m_in_frame;
+        bool m_frame_fin;
+        uint8_t m_frame_opcode;
+        uint64_t m_frame_remaining;
+        std::string m_control_payload;
+        // opcode of the fragmented message being received, 0 if there is none
+        uint8_t m_message_opcode;
+        std::string m_message;
+#ifdef USE_ZLIB
+        // set once the server accepted permessage-deflate, replaced only while connecting. Senders compress under
+        // `m_deflate_lock` and queue the frame before releasing it, the server inflates messages in the order they were
+        // compressed in
+        std::unique_ptr<permessage_deflate> m_deflate;
+        std::mutex m_deflate_lock;
+        bool m_message_compressed;
+#endif
+        bool m_close_sent;
+        bool m_close_received;
+
+        void run(const std::string& host, const std::string& port, const std::string& request, const std::string& accept_key,
+            std::function<void(std::exception_ptr)> callback);
+        void handshake(const std::string& request, const std::string& accept_key);
+        void wait_for_socket(int socket, uint32_t events);
+        bool step(std::chrono::steady_clock::time_point& close_deadline);
+        void shutdown(std::exception_ptr exception);
+
+        bool read_input();
+        void process_input(bool closing);
+        parse_result parse_frame(std::string& message);
+        void write_pending();
+        void update_socket_events(uint32_t events);
+
+        std::string create_frame(uint8_t opcode, const std::vector<const_buffer>& buffers, bool compressed = false);
+        bool queue_frame(std::string&& frame, std::function<void(std::exception_ptr)> callback);
+        void queue_control_frame(uint8_t opcode, const std::string& payload);
+        void wake() noexcept;
+    };
+}
+
+#endif
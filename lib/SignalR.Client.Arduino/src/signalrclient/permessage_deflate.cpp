@@ -0,0 +1,256 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+
+#ifdef USE_ZLIB
+
+#include "permessage_deflate.h"
+#include "signalrclient/signalr_exception.h"
+#include <algorithm>
+#include <string.h>
+
+namespace signalr
+{
+    namespace
+    {
+        // a sync flush ends with an empty stored block, it is left out on the wire
+        const char flush_marker[] = { 0x00, 0x00, static_cast<char>(0xff), static_cast<char>(0xff) };
+
+        std::string trim(const std::string& value)
+        {
+            auto start = value.find_first_not_of(" \t");
+            if (start == std::string::npos)
+            {
+                return std::string();
+            }
+
+            return value.substr(start, value.find_last_not_of(" \t") - start + 1);
+        }
+
+        int parse_window_bits(const std::string& value, int min)
+        {
+            auto bits = value.empty() ? 0 : atoi(trim(value).c_str());
+            if (bits < min || bits > 15)
+            {
+                throw signalr_exception("the server answered the permessage-deflate offer with unsupported window bits: " + value);
+            }
+
+            return bits;
+        }
+    }
+
+    permessage_deflate::permessage_deflate(const websocket_compression& options)
+        : m_options(options), m_client_no_context_takeover(options.client_no_context_takeover),
+        m_server_no_context_takeover(options.server_no_context_takeover), m_initialized(false)
+    {
+        memset(&m_deflate, 0, sizeof(m_deflate));
+        memset(&m_inflate, 0, sizeof(m_inflate));
+    }
+
+    permessage_deflate::~permessage_deflate()
+    {
+        if (m_initialized)
+        {
+            deflateEnd(&m_deflate);
+            inflateEnd(&m_inflate);
+        }
+    }
+
+    std::string permessage_deflate::create_offer() const
+    {
+        std::string offer("permessage-deflate; client_max_window_bits");
+        if (m_options.client_max_window_bits < 15)
+        {
+            offer.append("=").append(std::to_string(m_options.client_max_window_bits));
+        }
+
+        if (m_options.server_max_window_bits < 15)
+        {
+            offer.append("; server_max_window_bits=").append(std::to_string(m_options.server_max_window_bits));
+        }
+
+        if (m_options.client_no_context_takeover)
+        {
+            offer.append("; client_no_context_takeover");
+        }
+
+        if (m_options.server_no_context_takeover)
+        {
+            offer.append("; server_no_context_takeover");
+        }
+
+        return offer;
+    }
+
+    bool permessage_deflate::accept(const std::string& extensions)
+    {
+        // only one extension was offered, the server answers with at most that one
+        std::vector<std::string> parameters;
+        size_t start = 0;
+        while (start <= extensions.size())
+        {
+            auto end = std::min(extensions.find(';', start), extensions.size());
+            parameters.push_back(trim(extensions.substr(start, end - start)));
+            start = end + 1;
+        }
+
+        if (parameters.front() != "permessage-deflate")
+        {
+            if (!parameters.front().empty())
+            {
+                throw signalr_exception("the server accepted a websocket extension that wasn't offered: " + extensions);
+            }
+
+            return false;
+        }
+
+        auto client_window_bits = m_options.client_max_window_bits;
+        for (size_t i = 1; i < parameters.size(); ++i)
+        {
+            auto separator = parameters[i].find('=');
+            auto name = trim(parameters[i].substr(0, separator));
+            auto value = separator == std::string::npos ? std::string() : parameters[i].substr(separator + 1);
+            value.erase(std::remove(value.begin(), value.end(), '"'), value.end());
+
+            if (name == "client_no_context_takeover")
+            {
+                m_client_no_context_takeover = true;
+            }
+            else if (name == "server_no_context_takeover")
+            {
+                m_server_no_context_takeover = true;
+            }
+            else if (name == "client_max_window_bits")
+            {
+                // zlib can't deflate with a 256 byte window
+                client_window_bits = std::min(client_window_bits, parse_window_bits(value, 9));
+            }
+            else if (name == "server_max_window_bits")
+            {
+                // inflating with the largest window handles any window the server uses
+                parse_window_bits(value, 8);
+            }
+            else
+            {
+                throw signalr_exception("the server answered the permessage-deflate offer with an unknown parameter: " + name);
+            }
+        }
+
+        if (deflateInit2(&m_deflate, m_options.level, Z_DEFLATED, -client_window_bits, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            throw signalr_exception("initializing the websocket compression failed");
+        }
+
+        if (inflateInit2(&m_inflate, -15) != Z_OK)
+        {
+            deflateEnd(&m_deflate);
+            throw signalr_exception("initializing the websocket decompression failed");
+        }
+
+        m_initialized = true;
+        return true;
+    }
+
+    bool permessage_deflate::should_compress(size_t size) const noexcept
+    {
+        return size >= m_options.min_message_size;
+    }
+
+    void permessage_deflate::compress(const std::vector<const_buffer>& buffers, std::string& output)
+    {
+        auto start = output.size();
+        for (const auto& buffer : buffers)
+        {
+            m_deflate.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(buffer.data));
+            m_deflate.avail_in = static_cast<uInt>(buffer.size);
+            deflate(Z_NO_FLUSH, output);
+        }
+
+        deflate(Z_SYNC_FLUSH, output);
+
+        if (output.size() - start >= sizeof(flush_marker) && output.compare(output.size() - sizeof(flush_marker), sizeof(flush_marker), flush_marker, sizeof(flush_marker)) == 0)
+        {
+            output.resize(output.size() - sizeof(flush_marker));
+        }
+
+        if (m_client_no_context_takeover)
+        {
+            deflateReset(&m_deflate);
+        }
+    }
+
+    void permessage_deflate::decompress(const std::string& message, std::string& output, size_t max_size)
+    {
+        m_inflate.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(message.data()));
+        m_inflate.avail_in = static_cast<uInt>(message.size());
+        inflate(output, max_size);
+
+        m_inflate.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(flush_marker));
+        m_inflate.avail_in = sizeof(flush_marker);
+        inflate(output, max_size);
+
+        if (m_server_no_context_takeover)
+        {
+            inflateReset(&m_inflate);
+        }
+    }
+
+    void permessage_deflate::deflate(int flush, std::string& output)
+    {
+        do
+        {
+            auto used = output.size();
+            output.resize(used + std::max<size_t>(m_deflate.avail_in / 2, 1024));
+            m_deflate.next_out = reinterpret_cast<Bytef*>(&output[used]);
+            m_deflate.avail_out = static_cast<uInt>(output.size() - used);
+
+            auto result = ::deflate(&m_deflate, flush);
+            output.resize(output.size() - m_deflate.avail_out);
+            if (result == Z_STREAM_ERROR)
+            {
+                throw signalr_exception("compressing the websocket message failed");
+            }
+        } while (m_deflate.avail_in > 0 || m_deflate.avail_out == 0);
+    }
+
+    void permessage_deflate::inflate(std::string& output, size_t max_size)
+    {
+        do
+        {
+            // never room for more than one byte beyond `max_size`, so a small message inflating to a huge one is caught
+            // before it was allocated
+            auto used = output.size();
+            auto room = std::max<size_t>(static_cast<size_t>(m_inflate.avail_in) * 4, 4096);
+            if (room > max_size - used)
+            {
+                room = max_size - used + 1;
+            }
+            output.resize(used + room);
+            m_inflate.next_out = reinterpret_cast<Bytef*>(&output[used]);
+            m_inflate.avail_out = static_cast<uInt>(output.size() - used);
+
+            auto result = ::inflate(&m_inflate, Z_SYNC_FLUSH);
+            output.resize(output.size() - m_inflate.avail_out);
+            if (output.size() > max_size)
+            {
+                // the stream is left mid-message, the connection is failed anyway
+                throw signalr_exception("the server sent a websocket message larger than the maximum message size");
+            }
+            if (result == Z_STREAM_END)
+            {
+                // the server may end a message with a final block, the next one starts a new stream
+                inflateReset(&m_inflate);
+                continue;
+            }
+
+            if (result != Z_OK && result != Z_BUF_ERROR)
+            {
+                throw signalr_exception("the server sent an invalid compressed websocket message");
+            }
+        } while (m_inflate.avail_in > 0 || m_inflate.avail_out == 0);
+    }
+}
+
+#endif
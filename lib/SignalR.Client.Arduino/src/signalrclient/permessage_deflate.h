@@ -0,0 +1,53 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#ifdef USE_ZLIB
+
+#include "signalrclient/websocket_client.h"
+#include "signalrclient/websocket_compression.h"
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+namespace signalr
+{
+    // permessage-deflate (RFC 7692) state of one websocket connection. Compressing and decompressing use separate streams
+    // and may run on different threads, but neither may run concurrently with itself.
+    class permessage_deflate
+    {
+    public:
+        explicit permessage_deflate(const websocket_compression& options);
+        ~permessage_deflate();
+
+        permessage_deflate(const permessage_deflate&) = delete;
+        permessage_deflate& operator=(const permessage_deflate&) = delete;
+
+        // value of the Sec-WebSocket-Extensions request header offering the extension
+        std::string create_offer() const;
+        // Applies the Sec-WebSocket-Extensions response header, returns false if the server didn't accept the extension.
+        // Throws if the server answered with parameters that weren't offered or can't be honored.
+        bool accept(const std::string& extensions);
+
+        bool should_compress(size_t size) const noexcept;
+        // appends the compressed message to `output`
+        void compress(const std::vector<const_buffer>& buffers, std::string& output);
+        // appends the decompressed message to `output`, throws as soon as it grew beyond `max_size` bytes
+        void decompress(const std::string& message, std::string& output, size_t max_size);
+
+    private:
+        websocket_compression m_options;
+        bool m_client_no_context_takeover;
+        bool m_server_no_context_takeover;
+        bool m_initialized;
+        z_stream m_deflate;
+        z_stream m_inflate;
+
+        void deflate(int flush, std::string& output);
+        void inflate(std::string& output, size_t max_size);
+    };
+}
+
+#endif
@@ -0,0 +1,215 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+#include "receive_loop_adapter.h"
+#include "signalrclient/signalr_exception.h"
+#include <atomic>
+
+namespace signalr
+{
+    receive_loop_adapter::receive_loop_adapter(std::shared_ptr<websocket_client> websocket_client, std::shared_ptr<scheduler> scheduler,
+        const logger& logger)
+        : m_websocket_client(std::move(websocket_client)), m_scheduler(std::move(scheduler)), m_logger(logger),
+        m_message_handler([](const std::string&, std::exception_ptr) {}), m_stopped(true), m_paused(false), m_parked(false),
+        m_receive_loop_task(std::make_shared<cancellation_token_source>())
+    {
+        // we use this cts to check if the receive loop is running so it should be
+        // initially canceled to indicate that the receive loop is not running
+        m_receive_loop_task->cancel();
+    }
+
+    void receive_loop_adapter::start(const std::string& url, std::function<void(std::exception_ptr)> callback)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_stopped = false;
+            m_paused = false;
+            m_parked = false;
+        }
+
+        // weak_ptr prevents a circular dependency leading to memory leak and other problems
+        std::weak_ptr<receive_loop_adapter> weak_adapter = shared_from_this();
+        m_websocket_client->start(url, [weak_adapter, callback](std::exception_ptr exception)
+            {
+                auto adapter = weak_adapter.lock();
+                if (!adapter || exception != nullptr)
+                {
+                    callback(exception != nullptr ? exception : std::make_exception_ptr(signalr_exception("websocket client no longer exists")));
+                    return;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(adapter->m_lock);
+                    if (adapter->m_stopped)
+                    {
+                        callback(std::make_exception_ptr(canceled_exception()));
+                        return;
+                    }
+                    adapter->m_receive_loop_task->reset();
+                }
+
+                adapter->receive_loop();
+                callback(nullptr);
+            });
+    }
+
+    void receive_loop_adapter::stop(std::function<void(std::exception_ptr)> callback)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_stopped = true;
+
+            if (m_parked)
+            {
+                // there is no receive outstanding that would notice the stop, end the loop here
+                m_parked = false;
+                m_receive_loop_task->cancel();
+            }
+        }
+
+        auto receive_loop_task = m_receive_loop_task;
+        m_websocket_client->stop([receive_loop_task, callback](std::exception_ptr exception)
+            {
+                receive_loop_task->register_callback([callback, exception]()
+                    {
+                        callback(exception);
+                    });
+            });
+    }
+
+    void receive_loop_adapter::send(const std::string& payload, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback)
+    {
+        m_websocket_client->send(payload, transfer_format, callback);
+    }
+
+    void receive_loop_adapter::send(const std::vector<const_buffer>& buffers, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback)
+    {
+        m_websocket_client->send(buffers, transfer_format, callback);
+    }
+
+    void receive_loop_adapter::on_message(std::function<void(const std::string&, std::exception_ptr)> handler)
+    {
+        m_message_handler = handler;
+    }
+
+    void receive_loop_adapter::pause_receive()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_paused = true;
+    }
+
+    void receive_loop_adapter::resume_receive()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_paused = false;
+            // if the loop didn't park yet it sees the flag cleared and keeps going by itself, `stop` ends a parked loop itself
+            if (!m_parked || m_stopped)
+            {
+                return;
+            }
+            m_parked = false;
+        }
+
+        m_logger.log(trace_level::debug, "[websocket transport] receiving resumed");
+
+        // re-arm from the scheduler, the caller may be holding locks that a synchronously completing receive would need. The
+        // loop is no longer parked so `stop` waits for this to run, which is why it captures a shared_ptr
+        auto adapter = shared_from_this();
+        m_scheduler->schedule([adapter]()
+            {
+                bool stopped;
+                {
+                    std::lock_guard<std::mutex> lock(adapter->m_lock);
+                    stopped = adapter->m_stopped;
+                }
+
+                if (stopped)
+                {
+                    adapter->m_receive_loop_task->cancel();
+                }
+                else
+                {
+                    adapter->receive_loop();
+                }
+            });
+    }
+
+    // Calls `receive` until the client is stopped, fails or receiving gets paused. Clients completing `receive` synchronously are
+    // handled by looping here instead of calling `receive_loop` from the callback so the stack doesn't grow with every message.
+    void receive_loop_adapter::receive_loop()
+    {
+        // Passing the `std::weak_ptr<receive_loop_adapter>` prevents from a memory leak where we would capture the shared_ptr to
+        // the adapter in the continuation lambda and as a result as long as the loop runs the ref count would never get to
+        // zero. `stop` waits for the receive loop to complete so the adapter is alive whenever a receive completes.
+        std::weak_ptr<receive_loop_adapter> weak_adapter = shared_from_this();
+        auto receive_loop_task = m_receive_loop_task;
+
+        while (true)
+        {
+            // 0 - receive in progress, 1 - loop should continue, 2 - `receive` returned; whoever comes second continues the
+            // loop, anything else means the loop is done
+            auto receive_state = std::make_shared<std::atomic<int>>(0);
+
+            m_websocket_client->receive([weak_adapter, receive_loop_task, receive_state](const std::string& message, std::exception_ptr exception)
+                {
+                    auto adapter = weak_adapter.lock();
+                    if (!adapter)
+                    {
+                        receive_loop_task->cancel();
+                        return;
+                    }
+
+                    bool stopped;
+                    {
+                        std::lock_guard<std::mutex> lock(adapter->m_lock);
+                        stopped = adapter->m_stopped;
+                    }
+                    if (stopped)
+                    {
+                        // stop has been called, tell it the receive loop is done and return
+                        receive_loop_task->cancel();
+                        return;
+                    }
+
+                    if (exception != nullptr)
+                    {
+                        // receiving ends with the error, the loop is done before the handler runs since it usually stops the client
+                        receive_loop_task->cancel();
+                        adapter->m_message_handler(message, exception);
+                        return;
+                    }
+
+                    adapter->m_message_handler(message, nullptr);
+
+                    {
+                        std::lock_guard<std::mutex> lock(adapter->m_lock);
+                        if (adapter->m_stopped)
+                        {
+                            receive_loop_task->cancel();
+                            return;
+                        }
+
+                        if (adapter->m_paused)
+                        {
+                            adapter->m_parked = true;
+                            adapter->m_logger.log(trace_level::debug, "[websocket transport] receiving paused");
+                            return;
+                        }
+                    }
+
+                    if (receive_state->exchange(1) == 2)
+                    {
+                        adapter->receive_loop();
+                    }
+                });
+
+            if (receive_state->exchange(2) != 1)
+            {
+                return;
+            }
+        }
+    }
+}
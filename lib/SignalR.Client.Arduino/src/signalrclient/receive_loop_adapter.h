@@ -0,0 +1,53 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#include "signalrclient/websocket_client.h"
+#include "signalrclient/scheduler.h"
+#include "cancellation_token_source.h"
+#include "logger.h"
+#include <memory>
+#include <mutex>
+
+namespace signalr
+{
+    // Implements the persistent receive interface for websocket clients that only implement the one-shot `receive` by calling
+    // `receive` again after each message was handled.
+    class receive_loop_adapter : public persistent_websocket_client, public std::enable_shared_from_this<receive_loop_adapter>
+    {
+    public:
+        receive_loop_adapter(std::shared_ptr<websocket_client> websocket_client, std::shared_ptr<scheduler> scheduler, const logger& logger);
+
+        receive_loop_adapter(const receive_loop_adapter&) = delete;
+
+        receive_loop_adapter& operator=(const receive_loop_adapter&) = delete;
+
+        void start(const std::string& url, std::function<void(std::exception_ptr)> callback) override;
+        void stop(std::function<void(std::exception_ptr)> callback) override;
+        void send(const std::string& payload, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback) override;
+        void send(const std::vector<const_buffer>& buffers, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback) override;
+
+        void on_message(std::function<void(const std::string&, std::exception_ptr)> handler) override;
+        void pause_receive() override;
+        void resume_receive() override;
+
+    private:
+        std::shared_ptr<websocket_client> m_websocket_client;
+        std::shared_ptr<scheduler> m_scheduler;
+        logger m_logger;
+        std::function<void(const std::string&, std::exception_ptr)> m_message_handler;
+
+        // guards the flags below, the loop parks instead of calling `receive` again while paused and `resume_receive` (or
+        // `stop`) picks it up from there
+        std::mutex m_lock;
+        bool m_stopped;
+        bool m_paused;
+        bool m_parked;
+        // canceled while the loop isn't running, `stop` waits for it so the handler is never called after stop completed
+        std::shared_ptr<cancellation_token_source> m_receive_loop_task;
+
+        void receive_loop();
+    };
+}
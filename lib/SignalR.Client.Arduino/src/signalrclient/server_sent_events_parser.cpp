@@ -0,0 +1,96 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+#include "server_sent_events_parser.h"
+#include <string.h>
+
+namespace signalr
+{
+    server_sent_events_parser::server_sent_events_parser()
+        : m_skip_line_feed(false)
+    { }
+
+    void server_sent_events_parser::parse(const char* data, size_t size, std::vector<std::string>& events)
+    {
+        size_t start = 0;
+        if (m_skip_line_feed && size > 0)
+        {
+            m_skip_line_feed = false;
+            if (data[0] == '\n')
+            {
+                start = 1;
+            }
+        }
+
+        // lines end with "\r\n", "\n" or "\r"
+        for (auto i = start; i < size; ++i)
+        {
+            if (data[i] != '\n' && data[i] != '\r')
+            {
+                continue;
+            }
+
+            if (m_line.empty())
+            {
+                process_line(data + start, i - start, events);
+            }
+            else
+            {
+                m_line.append(data + start, i - start);
+                process_line(m_line.data(), m_line.size(), events);
+                m_line.clear();
+            }
+
+            if (data[i] == '\r')
+            {
+                if (i + 1 == size)
+                {
+                    m_skip_line_feed = true;
+                }
+                else if (data[i + 1] == '\n')
+                {
+                    ++i;
+                }
+            }
+
+            start = i + 1;
+        }
+
+        m_line.append(data + start, size - start);
+    }
+
+    void server_sent_events_parser::process_line(const char* line, size_t size, std::vector<std::string>& events)
+    {
+        // an empty line completes the event
+        if (size == 0)
+        {
+            if (!m_data.empty())
+            {
+                m_data.pop_back();
+                events.push_back(std::move(m_data));
+                m_data = std::string();
+            }
+            return;
+        }
+
+        // comments start with a colon, other fields than data (event, id, retry) aren't used by SignalR
+        auto colon = static_cast<const char*>(memchr(line, ':', size));
+        auto name_size = colon == nullptr ? size : static_cast<size_t>(colon - line);
+        if (name_size != 4 || memcmp(line, "data", 4) != 0)
+        {
+            return;
+        }
+
+        auto value = colon == nullptr ? line + size : colon + 1;
+        auto value_size = static_cast<size_t>(line + size - value);
+        if (value_size > 0 && *value == ' ')
+        {
+            ++value;
+            --value_size;
+        }
+
+        m_data.append(value, value_size).push_back('\n');
+    }
+}
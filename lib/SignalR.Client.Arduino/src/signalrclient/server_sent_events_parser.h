@@ -0,0 +1,34 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace signalr
+{
+    // Incremental parser of a text/event-stream body that may arrive in pieces of any size. Only `data` fields are used, the
+    // data lines of an event are joined with '\n' like EventSource does. Lines are processed straight from the input, only a
+    // line split across two pieces is copied.
+    class server_sent_events_parser
+    {
+    public:
+        server_sent_events_parser();
+
+        // appends the data of every event completed by `data` to `events`
+        void parse(const char* data, size_t size, std::vector<std::string>& events);
+
+    private:
+        // start of a line that continues in the next piece
+        std::string m_line;
+        // data lines of the current event, each followed by '\n'
+        std::string m_data;
+        // the last piece ended with '\r', a '\n' starting the next one belongs to the same line break
+        bool m_skip_line_feed;
+
+        void process_line(const char* line, size_t size, std::vector<std::string>& events);
+    };
+}
@@ -0,0 +1,308 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+#include "server_sent_events_transport.h"
+#include "signalrclient/signalr_exception.h"
+
+namespace signalr
+{
+    std::shared_ptr<transport> server_sent_events_transport::create(const std::function<std::shared_ptr<http_client>(const signalr_client_config&)>& http_client_factory,
+        const signalr_client_config& signalr_client_config, const logger& logger)
+    {
+        return std::shared_ptr<transport>(new server_sent_events_transport(http_client_factory, signalr_client_config, logger));
+    }
+
+    server_sent_events_transport::server_sent_events_transport(const std::function<std::shared_ptr<http_client>(const signalr_client_config&)>& http_client_factory,
+        const signalr_client_config& signalr_client_config, const logger& logger)
+        : transport(logger), m_http_client_factory(http_client_factory), m_signalr_client_config(signalr_client_config),
+        m_process_response_callback([](std::string&&, std::exception_ptr) {}), m_close_callback([](std::exception_ptr) {}),
+        m_send_queue(std::make_shared<http_send_queue>(signalr_client_config)), m_disconnected(true), m_receiving(false), m_paused(false)
+    { }
+
+    server_sent_events_transport::~server_sent_events_transport()
+    {
+        // the stream's callbacks can't reach the transport anymore, so there is nothing to wait for
+        std::shared_ptr<cancellation_token_source> cts;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            cts = m_cts;
+        }
+
+        if (cts)
+        {
+            cts->cancel();
+        }
+
+        m_send_queue->close("transport was destroyed before the message was sent");
+    }
+
+    transport_type server_sent_events_transport::get_transport_type() const noexcept
+    {
+        return transport_type::server_sent_events;
+    }
+
+    void server_sent_events_transport::start(const std::string& url, std::function<void(std::exception_ptr)> callback) noexcept
+    {
+        std::shared_ptr<http_client> http_client;
+        std::shared_ptr<cancellation_token_source> cts;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (!m_disconnected || m_receiving)
+            {
+                callback(std::make_exception_ptr(signalr_exception("transport already connected")));
+                return;
+            }
+
+            try
+            {
+                m_http_client = m_http_client_factory(m_signalr_client_config);
+            }
+            catch (...)
+            {
+                callback(std::current_exception());
+                return;
+            }
+
+            m_url = url;
+            m_cts = std::make_shared<cancellation_token_source>();
+            m_disconnected = false;
+            m_receiving = true;
+            m_paused = false;
+            m_start_callback = callback;
+            m_parser = server_sent_events_parser();
+            m_send_queue->open(m_http_client, url, m_cts);
+
+            http_client = m_http_client;
+            cts = m_cts;
+        }
+
+        m_logger.log(trace_level::info,
+            std::string("[server-sent events transport] connecting to: ")
+            .append(url));
+
+        http_request request;
+        request.method = http_method::GET;
+        request.headers = m_signalr_client_config.get_http_headers();
+        request.headers["Accept"] = "text/event-stream";
+        request.headers["Cache-Control"] = "no-cache";
+        request.timeout = std::chrono::seconds::zero();
+
+        auto weak_transport = std::weak_ptr<server_sent_events_transport>(shared_from_this());
+        request.on_content = [weak_transport](const char* data, size_t size)
+            {
+                auto transport = weak_transport.lock();
+                if (transport)
+                {
+                    transport->handle_content(data, size);
+                }
+            };
+
+        http_client->send(url, request, [weak_transport](const http_response& response, std::exception_ptr exception)
+            {
+                auto transport = weak_transport.lock();
+                if (transport)
+                {
+                    transport->handle_stream_end(response, exception);
+                }
+            }, get_cancellation_token(cts));
+    }
+
+    // Called on the stream's thread with every piece of the body, first with no data once the stream opened.
+    void server_sent_events_transport::handle_content(const char* data, size_t size)
+    {
+        std::function<void(std::exception_ptr)> start_callback;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            start_callback = std::move(m_start_callback);
+            m_start_callback = nullptr;
+        }
+
+        if (start_callback)
+        {
+            m_logger.log(trace_level::info, "[server-sent events transport] event stream opened");
+
+            // the stream's thread keeps reading while the connection handles the start
+            m_signalr_client_config.get_scheduler()->schedule([start_callback]()
+                {
+                    start_callback(nullptr);
+                });
+        }
+
+        m_events.clear();
+        m_parser.parse(data, size, m_events);
+        if (m_events.empty())
+        {
+            return;
+        }
+
+        {
+            // not reading from the stream while paused leaves the data in the socket buffers and eventually holds off the server
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_resumed.wait(lock, [this]() { return !m_paused || m_disconnected; });
+            if (m_disconnected)
+            {
+                return;
+            }
+        }
+
+        if (m_events.size() > 1 && m_process_response_batch_callback)
+        {
+            m_process_response_batch_callback(std::move(m_events));
+            m_events = std::vector<std::string>();
+            return;
+        }
+
+        for (auto& event : m_events)
+        {
+            m_process_response_callback(std::move(event), nullptr);
+        }
+    }
+
+    void server_sent_events_transport::handle_stream_end(const http_response& response, std::exception_ptr exception)
+    {
+        std::function<void(std::exception_ptr)> start_callback;
+        std::function<void(std::exception_ptr)> stop_callback;
+        bool stopped;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            start_callback = std::move(m_start_callback);
+            m_start_callback = nullptr;
+            stop_callback = std::move(m_stop_callback);
+            m_stop_callback = nullptr;
+            stopped = m_disconnected;
+            m_disconnected = true;
+            m_receiving = false;
+            m_resumed.notify_all();
+        }
+
+        m_send_queue->close("transport stopped before the message was sent");
+
+        if (stopped)
+        {
+            if (start_callback)
+            {
+                start_callback(std::make_exception_ptr(canceled_exception()));
+            }
+
+            if (stop_callback)
+            {
+                m_logger.log(trace_level::debug, "server-sent events transport stopped");
+                m_close_callback(nullptr);
+                stop_callback(nullptr);
+            }
+            return;
+        }
+
+        if (exception == nullptr)
+        {
+            if (response.status_code / 100 != 2)
+            {
+                exception = std::make_exception_ptr(signalr_exception("the event stream request failed with status code "
+                    + std::to_string(response.status_code)));
+            }
+            else if (start_callback)
+            {
+                exception = std::make_exception_ptr(signalr_exception("the http client did not stream the event stream response, "
+                    "it has to support http_request::on_content"));
+            }
+            else
+            {
+                exception = std::make_exception_ptr(signalr_exception("the server closed the event stream"));
+            }
+        }
+
+        try
+        {
+            std::rethrow_exception(exception);
+        }
+        catch (const std::exception& e)
+        {
+            m_logger.log(
+                trace_level::error,
+                std::string("[server-sent events transport] ")
+                .append(start_callback ? "exception when connecting to the server: " : "error receiving from the event stream: ")
+                .append(e.what()));
+        }
+
+        if (start_callback)
+        {
+            start_callback(exception);
+        }
+        else
+        {
+            m_close_callback(exception);
+        }
+    }
+
+    void server_sent_events_transport::stop(std::function<void(std::exception_ptr)> callback) noexcept
+    {
+        std::shared_ptr<cancellation_token_source> cts;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (!m_receiving)
+            {
+                callback(nullptr);
+                return;
+            }
+
+            m_disconnected = true;
+            m_resumed.notify_all();
+
+            // completes once the stream's callbacks are done
+            auto previous_stop_callback = std::move(m_stop_callback);
+            m_stop_callback = !previous_stop_callback ? callback : [previous_stop_callback, callback](std::exception_ptr exception)
+                {
+                    previous_stop_callback(exception);
+                    callback(exception);
+                };
+
+            cts = m_cts;
+        }
+
+        m_logger.log(trace_level::debug, "stopping server-sent events transport");
+        m_send_queue->close("transport stopped before the message was sent");
+        cts->cancel();
+    }
+
+    void server_sent_events_transport::on_close(std::function<void(std::exception_ptr)> callback)
+    {
+        m_close_callback = callback;
+    }
+
+    void server_sent_events_transport::on_receive(std::function<void(std::string&&, std::exception_ptr)> callback)
+    {
+        m_process_response_callback = callback;
+    }
+
+    void server_sent_events_transport::on_receive_batch(std::function<void(std::vector<std::string>&&)> callback)
+    {
+        m_process_response_batch_callback = callback;
+    }
+
+    void server_sent_events_transport::pause_receive() noexcept
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_paused = true;
+    }
+
+    void server_sent_events_transport::resume_receive() noexcept
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_paused = false;
+        m_resumed.notify_all();
+    }
+
+    void server_sent_events_transport::send(const std::string& payload, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback,
+        send_priority priority, const std::string& conflation_key) noexcept
+    {
+        if (transfer_format != transfer_format::text)
+        {
+            callback(std::make_exception_ptr(signalr_exception("the server-sent events transport only supports text messages")));
+            return;
+        }
+
+        m_send_queue->send(payload, transfer_format, callback, priority, conflation_key);
+    }
+}
@@ -0,0 +1,84 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#include "transport.h"
+#include "logger.h"
+#include "signalrclient/http_client.h"
+#include "signalrclient/signalr_client_config.h"
+#include "cancellation_token_source.h"
+#include "server_sent_events_parser.h"
+#include "http_send_queue.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+namespace signalr
+{
+    // Receives over a text/event-stream GET request that stays open for the lifetime of the transport and sends with POST
+    // requests through an `http_send_queue`. Only text messages are supported. The stream is parsed as it arrives, which needs
+    // an http client that supports `http_request::on_content`.
+    class server_sent_events_transport : public transport, public std::enable_shared_from_this<server_sent_events_transport>
+    {
+    public:
+        static std::shared_ptr<transport> create(const std::function<std::shared_ptr<http_client>(const signalr_client_config&)>& http_client_factory,
+            const signalr_client_config& signalr_client_config, const logger& logger);
+
+        ~server_sent_events_transport();
+
+        server_sent_events_transport(const server_sent_events_transport&) = delete;
+
+        server_sent_events_transport& operator=(const server_sent_events_transport&) = delete;
+
+        transport_type get_transport_type() const noexcept override;
+
+        void start(const std::string& url, std::function<void(std::exception_ptr)> callback) noexcept override;
+        void stop(std::function<void(std::exception_ptr)> callback) noexcept override;
+        void on_close(std::function<void(std::exception_ptr)> callback) override;
+
+        void send(const std::string& payload, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback,
+            send_priority priority = send_priority::data, const std::string& conflation_key = std::string()) noexcept override;
+
+        void on_receive(std::function<void(std::string&&, std::exception_ptr)>) override;
+        void on_receive_batch(std::function<void(std::vector<std::string>&&)> callback) override;
+
+        void pause_receive() noexcept override;
+        void resume_receive() noexcept override;
+
+    private:
+        server_sent_events_transport(const std::function<std::shared_ptr<http_client>(const signalr_client_config&)>& http_client_factory,
+            const signalr_client_config& signalr_client_config, const logger& logger);
+
+        std::function<std::shared_ptr<http_client>(const signalr_client_config&)> m_http_client_factory;
+        signalr_client_config m_signalr_client_config;
+        std::function<void(std::string&&, std::exception_ptr)> m_process_response_callback;
+        std::function<void(std::vector<std::string>&&)> m_process_response_batch_callback;
+        std::function<void(std::exception_ptr)> m_close_callback;
+        std::shared_ptr<http_send_queue> m_send_queue;
+
+        // guards everything below except the parser state, which only the stream's callbacks touch
+        std::mutex m_lock;
+        std::shared_ptr<http_client> m_http_client;
+        std::string m_url;
+        // cancels the stream and the sends in flight
+        std::shared_ptr<cancellation_token_source> m_cts;
+        // set until start and once the transport was stopped or the stream ended
+        bool m_disconnected;
+        // the stream request hasn't completed yet
+        bool m_receiving;
+        // set until the stream opened
+        std::function<void(std::exception_ptr)> m_start_callback;
+        // set while stop waits for the stream request to complete
+        std::function<void(std::exception_ptr)> m_stop_callback;
+        bool m_paused;
+        std::condition_variable m_resumed;
+
+        server_sent_events_parser m_parser;
+        std::vector<std::string> m_events;
+
+        void handle_content(const char* data, size_t size);
+        void handle_stream_end(const http_response& response, std::exception_ptr exception);
+    };
+}
@@ -46,6 +46,19 @@ namespace signalr
         : m_handshake_timeout(std::chrono::seconds(15))
         , m_server_timeout(std::chrono::seconds(30))
         , m_keepalive_interval(std::chrono::seconds(15))
+        , m_max_send_batch_size(16 * 1024)
+        , m_max_send_delay(std::chrono::microseconds::zero())
+        , m_flush_on_idle(true)
+        , m_outbound_high_watermark_bytes(64 * 1024)
+        , m_outbound_low_watermark_bytes(16 * 1024)
+        , m_outbound_high_watermark_messages(256)
+        , m_outbound_low_watermark_messages(64)
+        , m_handler_dispatch_mode(handler_dispatch_mode::receive_thread)
+        , m_inbound_high_watermark_bytes(1024 * 1024)
+        , m_inbound_low_watermark_bytes(256 * 1024)
+        , m_inbound_high_watermark_messages(1024)
+        , m_inbound_low_watermark_messages(256)
+        , m_max_receive_message_size(4 * 1024 * 1024)
     {
         m_scheduler = std::make_shared<signalr_default_scheduler>();
     }
@@ -124,4 +137,194 @@ namespace signalr
     {
         return m_keepalive_interval;
     }
+
+    void signalr_client_config::set_max_send_batch_size(size_t max_bytes)
+    {
+        if (max_bytes == 0)
+        {
+            throw std::runtime_error("max bytes must be greater than 0.");
+        }
+
+        m_max_send_batch_size = max_bytes;
+    }
+
+    size_t signalr_client_config::get_max_send_batch_size() const noexcept
+    {
+        return m_max_send_batch_size;
+    }
+
+    void signalr_client_config::set_max_send_delay(std::chrono::microseconds delay)
+    {
+        if (delay < std::chrono::microseconds::zero())
+        {
+            throw std::runtime_error("delay must not be negative.");
+        }
+
+        m_max_send_delay = delay;
+    }
+
+    std::chrono::microseconds signalr_client_config::get_max_send_delay() const noexcept
+    {
+        return m_max_send_delay;
+    }
+
+    void signalr_client_config::set_flush_on_idle(bool flush_on_idle)
+    {
+        m_flush_on_idle = flush_on_idle;
+    }
+
+    bool signalr_client_config::get_flush_on_idle() const noexcept
+    {
+        return m_flush_on_idle;
+    }
+
+    void signalr_client_config::set_outbound_buffer_bytes(size_t high_watermark, size_t low_watermark)
+    {
+        if (high_watermark == 0 || low_watermark > high_watermark)
+        {
+            throw std::runtime_error("high watermark must be greater than 0 and not less than the low watermark.");
+        }
+
+        m_outbound_high_watermark_bytes = high_watermark;
+        m_outbound_low_watermark_bytes = low_watermark;
+    }
+
+    size_t signalr_client_config::get_outbound_buffer_high_watermark_bytes() const noexcept
+    {
+        return m_outbound_high_watermark_bytes;
+    }
+
+    size_t signalr_client_config::get_outbound_buffer_low_watermark_bytes() const noexcept
+    {
+        return m_outbound_low_watermark_bytes;
+    }
+
+    void signalr_client_config::set_outbound_buffer_messages(size_t high_watermark, size_t low_watermark)
+    {
+        if (high_watermark == 0 || low_watermark > high_watermark)
+        {
+            throw std::runtime_error("high watermark must be greater than 0 and not less than the low watermark.");
+        }
+
+        m_outbound_high_watermark_messages = high_watermark;
+        m_outbound_low_watermark_messages = low_watermark;
+    }
+
+    size_t signalr_client_config::get_outbound_buffer_high_watermark_messages() const noexcept
+    {
+        return m_outbound_high_watermark_messages;
+    }
+
+    size_t signalr_client_config::get_outbound_buffer_low_watermark_messages() const noexcept
+    {
+        return m_outbound_low_watermark_messages;
+    }
+
+    void signalr_client_config::set_handler_dispatch_mode(handler_dispatch_mode mode) noexcept
+    {
+        m_handler_dispatch_mode = mode;
+    }
+
+    handler_dispatch_mode signalr_client_config::get_handler_dispatch_mode() const noexcept
+    {
+        return m_handler_dispatch_mode;
+    }
+
+    void signalr_client_config::set_inbound_backlog_bytes(size_t high_watermark, size_t low_watermark)
+    {
+        if (high_watermark == 0 || low_watermark > high_watermark)
+        {
+            throw std::runtime_error("high watermark must be greater than 0 and not less than the low watermark.");
+        }
+
+        m_inbound_high_watermark_bytes = high_watermark;
+        m_inbound_low_watermark_bytes = low_watermark;
+    }
+
+    size_t signalr_client_config::get_inbound_backlog_high_watermark_bytes() const noexcept
+    {
+        return m_inbound_high_watermark_bytes;
+    }
+
+    size_t signalr_client_config::get_inbound_backlog_low_watermark_bytes() const noexcept
+    {
+        return m_inbound_low_watermark_bytes;
+    }
+
+    void signalr_client_config::set_inbound_backlog_messages(size_t high_watermark, size_t low_watermark)
+    {
+        if (high_watermark == 0 || low_watermark > high_watermark)
+        {
+            throw std::runtime_error("high watermark must be greater than 0 and not less than the low watermark.");
+        }
+
+        m_inbound_high_watermark_messages = high_watermark;
+        m_inbound_low_watermark_messages = low_watermark;
+    }
+
+    size_t signalr_client_config::get_inbound_backlog_high_watermark_messages() const noexcept
+    {
+        return m_inbound_high_watermark_messages;
+    }
+
+    size_t signalr_client_config::get_inbound_backlog_low_watermark_messages() const noexcept
+    {
+        return m_inbound_low_watermark_messages;
+    }
+
+    void signalr_client_config::set_websocket_compression(const websocket_compression& compression)
+    {
+        if (compression.level < -1 || compression.level > 9)
+        {
+            throw std::runtime_error("level must be between -1 and 9.");
+        }
+
+        if (compression.client_max_window_bits < 9 || compression.client_max_window_bits > 15
+            || compression.server_max_window_bits < 8 || compression.server_max_window_bits > 15)
+        {
+            throw std::runtime_error("window bits must be between 9 and 15 for the client and between 8 and 15 for the server.");
+        }
+
+        m_websocket_compression = compression;
+    }
+
+    const websocket_compression& signalr_client_config::get_websocket_compression() const noexcept
+    {
+        return m_websocket_compression;
+    }
+
+    void signalr_client_config::set_max_receive_message_size(size_t max_bytes)
+    {
+        if (max_bytes == 0)
+        {
+            throw std::runtime_error("max bytes must be greater than 0.");
+        }
+
+        m_max_receive_message_size = max_bytes;
+    }
+
+    size_t signalr_client_config::get_max_receive_message_size() const noexcept
+    {
+        return m_max_receive_message_size;
+    }
+
+    void signalr_client_config::set_reconnect_policy(const reconnect_policy& policy)
+    {
+        if (policy.initial_delay < std::chrono::milliseconds::zero() || policy.max_delay < policy.initial_delay)
+        {
+            throw std::runtime_error("initial delay must not be negative and not greater than the max delay.");
+        }
+
+        if (policy.jitter < 0 || policy.jitter > 1)
+        {
+            throw std::runtime_error("jitter must be between 0 and 1.");
+        }
+
+        m_reconnect_policy = policy;
+    }
+
+    const reconnect_policy& signalr_client_config::get_reconnect_policy() const noexcept
+    {
+        return m_reconnect_policy;
+    }
 }
@@ -0,0 +1,59 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+#include "strand.h"
+
+namespace signalr
+{
+    strand::strand(std::shared_ptr<scheduler> scheduler)
+        : m_scheduler(std::move(scheduler)), m_running(false)
+    { }
+
+    void strand::post(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_tasks.push_back(std::move(task));
+
+            if (m_running)
+            {
+                return;
+            }
+            m_running = true;
+        }
+
+        auto self = shared_from_this();
+        m_scheduler->schedule([self]() { self->run(); });
+    }
+
+    void strand::run()
+    {
+        for (size_t i = 0; i < max_tasks_per_run; ++i)
+        {
+            std::function<void()> task;
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                if (m_tasks.empty())
+                {
+                    m_running = false;
+                    return;
+                }
+
+                task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+            }
+
+            try
+            {
+                task();
+            }
+            // tasks are expected to handle their own errors, an escaping exception must not stop the strand
+            catch (...) {}
+        }
+
+        auto self = shared_from_this();
+        m_scheduler->schedule([self]() { self->run(); });
+    }
+}
@@ -0,0 +1,38 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include "signalrclient/scheduler.h"
+
+namespace signalr
+{
+    // Runs posted tasks on the scheduler one at a time and in the order they were posted, tasks posted to different strands
+    // run in parallel. Must be owned by a `std::shared_ptr`.
+    class strand : public std::enable_shared_from_this<strand>
+    {
+    public:
+        explicit strand(std::shared_ptr<scheduler> scheduler);
+
+        strand(const strand&) = delete;
+        strand& operator=(const strand&) = delete;
+
+        void post(std::function<void()> task);
+
+    private:
+        // a busy strand gives up its scheduler thread after this many tasks so it can't starve the other strands
+        static const size_t max_tasks_per_run = 16;
+
+        std::shared_ptr<scheduler> m_scheduler;
+        std::mutex m_lock;
+        std::deque<std::function<void()>> m_tasks;
+        bool m_running;
+
+        void run();
+    };
+}
@@ -0,0 +1,61 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+#include "signalrclient/stream_reader.h"
+#include "stream_reader_impl.h"
+#include "signalrclient/signalr_exception.h"
+
+namespace signalr
+{
+    stream_reader::stream_reader(std::shared_ptr<stream_reader_impl> impl)
+        : m_pImpl(std::move(impl))
+    {}
+
+    stream_reader::stream_reader(stream_reader&& rhs) noexcept
+        : m_pImpl(std::move(rhs.m_pImpl))
+    {}
+
+    stream_reader& stream_reader::operator=(stream_reader&& rhs) noexcept
+    {
+        if (m_pImpl && m_pImpl != rhs.m_pImpl)
+        {
+            m_pImpl->cancel();
+        }
+
+        m_pImpl = std::move(rhs.m_pImpl);
+
+        return *this;
+    }
+
+    // Do NOT remove this destructor. Letting the compiler generate and inline the default dtor may lead to
+    // undefined behavior since we are using an incomplete type. More details here:  http://herbsutter.com/gotw/_100/
+    stream_reader::~stream_reader()
+    {
+        if (m_pImpl)
+        {
+            // no-op if the stream already completed
+            m_pImpl->cancel();
+        }
+    }
+
+    void stream_reader::next(std::function<void(signalr::value&&, bool, std::exception_ptr)> callback) noexcept
+    {
+        if (!m_pImpl)
+        {
+            callback(signalr::value(), true, std::make_exception_ptr(signalr_exception("next() cannot be called on a moved from stream_reader instance")));
+            return;
+        }
+
+        m_pImpl->next(callback);
+    }
+
+    void stream_reader::cancel() noexcept
+    {
+        if (m_pImpl)
+        {
+            m_pImpl->cancel();
+        }
+    }
+}
@@ -0,0 +1,174 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+#include "stream_reader_impl.h"
+#include "signalrclient/signalr_exception.h"
+
+namespace signalr
+{
+    stream_reader_impl::stream_reader_impl(size_t buffer_size)
+        : m_buffer_size(buffer_size == 0 ? 1 : buffer_size), m_completed(false), m_full(false)
+    { }
+
+    void stream_reader_impl::set_cancel_callback(const std::function<void()>& on_cancel)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_on_cancel = on_cancel;
+    }
+
+    void stream_reader_impl::set_full_callback(const std::function<void(bool)>& on_full)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_on_full = on_full;
+    }
+
+    void stream_reader_impl::set_full(bool full)
+    {
+        if (m_full == full)
+        {
+            return;
+        }
+
+        m_full = full;
+        if (m_on_full)
+        {
+            m_on_full(full);
+        }
+    }
+
+    void stream_reader_impl::next(const next_callback& callback)
+    {
+        signalr::value item;
+
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+
+            if (m_items.empty())
+            {
+                if (m_completed)
+                {
+                    auto exception = m_exception;
+                    lock.unlock();
+                    callback(signalr::value(), true, exception);
+                    return;
+                }
+
+                if (m_pending_next)
+                {
+                    lock.unlock();
+                    callback(signalr::value(), false, std::make_exception_ptr(signalr_exception("next() cannot be called while a previous call is pending")));
+                    return;
+                }
+
+                m_pending_next = callback;
+                return;
+            }
+
+            item = std::move(m_items.front());
+            m_items.pop_front();
+
+            if (m_items.size() < m_buffer_size)
+            {
+                set_full(false);
+            }
+        }
+
+        callback(std::move(item), false, nullptr);
+    }
+
+    void stream_reader_impl::cancel()
+    {
+        next_callback pending_next;
+        std::function<void()> on_cancel;
+
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            if (m_completed)
+            {
+                return;
+            }
+
+            m_completed = true;
+            m_items.clear();
+            pending_next = std::move(m_pending_next);
+            m_pending_next = nullptr;
+            on_cancel = std::move(m_on_cancel);
+            m_on_cancel = nullptr;
+            set_full(false);
+            m_on_full = nullptr;
+        }
+
+        if (on_cancel)
+        {
+            on_cancel();
+        }
+
+        if (pending_next)
+        {
+            pending_next(signalr::value(), true, nullptr);
+        }
+    }
+
+    void stream_reader_impl::push_item(signalr::value&& item)
+    {
+        next_callback pending_next;
+
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            if (m_completed)
+            {
+                return;
+            }
+
+            // a reader waiting in `next` means the buffer is empty so the item can go straight to it
+            if (!m_pending_next)
+            {
+                m_items.push_back(std::move(item));
+                if (m_items.size() >= m_buffer_size)
+                {
+                    set_full(true);
+                }
+                return;
+            }
+
+            pending_next = std::move(m_pending_next);
+            m_pending_next = nullptr;
+        }
+
+        pending_next(std::move(item), false, nullptr);
+    }
+
+    void stream_reader_impl::complete(std::exception_ptr exception)
+    {
+        next_callback pending_next;
+
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+
+            if (m_completed)
+            {
+                return;
+            }
+
+            m_completed = true;
+            m_exception = exception;
+            m_on_cancel = nullptr;
+            // no more items will arrive so the buffered ones must not keep the connection paused
+            set_full(false);
+            m_on_full = nullptr;
+
+            // buffered items are still handed out before the completion, a pending `next` means the buffer is empty
+            pending_next = std::move(m_pending_next);
+            m_pending_next = nullptr;
+        }
+
+        if (pending_next)
+        {
+            pending_next(signalr::value(), true, exception);
+        }
+    }
+}
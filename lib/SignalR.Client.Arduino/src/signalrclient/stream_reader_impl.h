@@ -0,0 +1,53 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include "signalrclient/signalr_value.h"
+
+namespace signalr
+{
+    // state shared between a `stream_reader` and the hub connection feeding it, items are produced by the receive loop
+    // and consumed by `next`, once `buffer_size` items are held the connection is told to stop receiving until a slot frees
+    class stream_reader_impl
+    {
+    public:
+        typedef std::function<void(signalr::value&&, bool, std::exception_ptr)> next_callback;
+
+        explicit stream_reader_impl(size_t buffer_size);
+
+        stream_reader_impl(const stream_reader_impl&) = delete;
+        stream_reader_impl& operator=(const stream_reader_impl&) = delete;
+
+        void next(const next_callback& callback);
+        void cancel();
+        // runs once if the reader cancels before the stream completed
+        void set_cancel_callback(const std::function<void()>& on_cancel);
+        // runs with true when the buffer reached `buffer_size` items and with false once a slot freed or the stream ended,
+        // calls alternate and are made under the reader's lock so they arrive in order
+        void set_full_callback(const std::function<void(bool)>& on_full);
+
+        // never blocks, items that arrive while the buffer is full (e.g. the rest of a message already being received when
+        // the connection paused) are still buffered
+        void push_item(signalr::value&& item);
+        void complete(std::exception_ptr exception);
+
+    private:
+        std::mutex m_lock;
+        std::deque<signalr::value> m_items;
+        const size_t m_buffer_size;
+        next_callback m_pending_next;
+        bool m_completed;
+        bool m_full;
+        std::exception_ptr m_exception;
+        std::function<void()> m_on_cancel;
+        std::function<void(bool)> m_on_full;
+
+        // must be called with `m_lock` held
+        void set_full(bool full);
+    };
+}
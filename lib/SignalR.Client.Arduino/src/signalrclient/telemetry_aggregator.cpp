@@ -0,0 +1,211 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+#include "signalrclient/telemetry_aggregator.h"
+#include "signalrclient/hub_connection.h"
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace signalr
+{
+    struct telemetry_aggregator::state
+    {
+        struct buffer
+        {
+            bool numeric = false;
+            std::vector<uint8_t> packed;
+            std::vector<signalr::value> values;
+            // bumped on every flush so a window timer started for an earlier batch doesn't flush this one early
+            uint64_t generation = 0;
+        };
+
+        struct batch
+        {
+            std::string target;
+            signalr::value argument;
+        };
+
+        std::mutex lock;
+        // guards `connection`, which the aggregator's destructor resets so timers still scheduled after that don't send. Recursive
+        // because a send completing synchronously can call back into `add`
+        std::recursive_mutex send_lock;
+        hub_connection* connection;
+        std::shared_ptr<signalr::scheduler> scheduler;
+        std::chrono::milliseconds window;
+        size_t max_samples;
+        std::function<void(std::exception_ptr)> sent_callback;
+        std::unordered_map<std::string, buffer> buffers;
+
+        // must be called while holding `lock`, leaves the buffer empty
+        static void take(const std::string& target, buffer& buffer, std::vector<batch>& batches)
+        {
+            if (buffer.numeric && !buffer.packed.empty())
+            {
+                batches.push_back(batch{ target, signalr::value(std::move(buffer.packed)) });
+            }
+            else if (!buffer.numeric && !buffer.values.empty())
+            {
+                batches.push_back(batch{ target, signalr::value(std::move(buffer.values)) });
+            }
+
+            buffer.packed.clear();
+            buffer.values.clear();
+            ++buffer.generation;
+        }
+
+        // must not be called while holding `lock`, the send can complete synchronously and the callback may add samples
+        void send(std::vector<batch>& batches)
+        {
+            std::lock_guard<std::recursive_mutex> lock(send_lock);
+            if (connection == nullptr)
+            {
+                return;
+            }
+
+            for (auto& batch : batches)
+            {
+                connection->send(batch.target, std::vector<signalr::value>{ std::move(batch.argument) }, sent_callback);
+            }
+        }
+
+        // must be called while holding `lock`, starts the window of the buffer's first sample
+        void start_window(const std::shared_ptr<state>& self, const std::string& target, uint64_t generation)
+        {
+            std::weak_ptr<state> weak_state = self;
+            scheduler->schedule([weak_state, target, generation]()
+                {
+                    auto state = weak_state.lock();
+                    if (!state)
+                    {
+                        return;
+                    }
+
+                    std::vector<batch> batches;
+                    {
+                        std::lock_guard<std::mutex> lock(state->lock);
+                        auto found = state->buffers.find(target);
+                        if (found == state->buffers.end() || found->second.generation != generation)
+                        {
+                            return;
+                        }
+                        take(target, found->second, batches);
+                    }
+                    state->send(batches);
+                }, window);
+        }
+    };
+
+    telemetry_aggregator::telemetry_aggregator(hub_connection& connection, std::shared_ptr<scheduler> scheduler, std::chrono::milliseconds window,
+        size_t max_samples, std::function<void(std::exception_ptr)> sent_callback)
+        : m_state(std::make_shared<state>())
+    {
+        if (!scheduler)
+        {
+            throw std::invalid_argument("scheduler cannot be null");
+        }
+
+        if (max_samples == 0)
+        {
+            throw std::invalid_argument("max_samples must be greater than 0");
+        }
+
+        m_state->connection = &connection;
+        m_state->scheduler = std::move(scheduler);
+        m_state->window = window;
+        m_state->max_samples = max_samples;
+        m_state->sent_callback = std::move(sent_callback);
+    }
+
+    telemetry_aggregator::~telemetry_aggregator()
+    {
+        try
+        {
+            flush();
+        }
+        catch (...) // must not throw from the destructor
+        {}
+
+        std::lock_guard<std::recursive_mutex> lock(m_state->send_lock);
+        m_state->connection = nullptr;
+    }
+
+    void telemetry_aggregator::add(const std::string& target, double sample)
+    {
+        std::vector<state::batch> batches;
+        {
+            std::lock_guard<std::mutex> lock(m_state->lock);
+            auto& buffer = m_state->buffers[target];
+            if (!buffer.numeric)
+            {
+                state::take(target, buffer, batches);
+                buffer.numeric = true;
+            }
+
+            if (buffer.packed.empty())
+            {
+                m_state->start_window(m_state, target, buffer.generation);
+            }
+
+            // the byte order is fixed so the server can decode the samples regardless of the device's endianness
+            uint64_t bits;
+            std::memcpy(&bits, &sample, sizeof(bits));
+            for (size_t i = 0; i < sizeof(bits); ++i)
+            {
+                buffer.packed.push_back(static_cast<uint8_t>(bits >> (i * 8)));
+            }
+
+            if (buffer.packed.size() / sizeof(double) >= m_state->max_samples)
+            {
+                state::take(target, buffer, batches);
+            }
+        }
+
+        m_state->send(batches);
+    }
+
+    void telemetry_aggregator::add(const std::string& target, const signalr::value& sample)
+    {
+        std::vector<state::batch> batches;
+        {
+            std::lock_guard<std::mutex> lock(m_state->lock);
+            auto& buffer = m_state->buffers[target];
+            if (buffer.numeric)
+            {
+                state::take(target, buffer, batches);
+                buffer.numeric = false;
+            }
+
+            if (buffer.values.empty())
+            {
+                m_state->start_window(m_state, target, buffer.generation);
+            }
+
+            buffer.values.push_back(sample);
+
+            if (buffer.values.size() >= m_state->max_samples)
+            {
+                state::take(target, buffer, batches);
+            }
+        }
+
+        m_state->send(batches);
+    }
+
+    void telemetry_aggregator::flush()
+    {
+        std::vector<state::batch> batches;
+        {
+            std::lock_guard<std::mutex> lock(m_state->lock);
+            for (auto& buffer : m_state->buffers)
+            {
+                state::take(buffer.first, buffer.second, batches);
+            }
+        }
+
+        m_state->send(batches);
+    }
+}
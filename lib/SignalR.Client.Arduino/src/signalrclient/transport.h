@@ -7,9 +7,21 @@
 #include "signalrclient/transport_type.h"
 #include "signalrclient/transfer_format.h"
 #include "logger.h"
+#include <functional>
+#include <string>
+#include <vector>
 
 namespace signalr
 {
+    // transports write queued control messages (handshake, pings) ahead of queued data so they are not stuck behind bulk sends.
+    // Messages referring to an earlier message, e.g. stream completions or cancellations, must stay in the data lane so they
+    // can't overtake it.
+    enum class send_priority
+    {
+        control = 0,
+        data = 1
+    };
+
     class transport
     {
     public:
@@ -21,9 +33,19 @@ namespace signalr
         virtual void stop(std::function<void(std::exception_ptr)> callback) noexcept = 0;
         virtual void on_close(std::function<void(std::exception_ptr)> callback) = 0;
 
-        virtual void send(const std::string& payload, signalr::transfer_format transfer_format, std::function<void(std::exception_ptr)> callback) noexcept = 0;
+        // a queued payload with the same non-empty `conflation_key` that hasn't been written yet is replaced by this one instead of
+        // queueing another message, the callbacks of replaced payloads run once the payload replacing them was written
+        virtual void send(const std::string& payload, signalr::transfer_format transfer_format, std::function<void(std::exception_ptr)> callback,
+            send_priority priority = send_priority::data, const std::string& conflation_key = std::string()) noexcept = 0;
 
         virtual void on_receive(std::function<void(std::string&&, std::exception_ptr)> callback) = 0;
+        // messages the transport received together, handed to the `on_receive` callback one by one if this isn't set
+        virtual void on_receive_batch(std::function<void(std::vector<std::string>&&)> callback) = 0;
+
+        // stops handing received messages to the receive callback until `resume_receive` is called, a message that is already
+        // being processed still completes
+        virtual void pause_receive() noexcept = 0;
+        virtual void resume_receive() noexcept = 0;
 
     protected:
         transport(const logger& logger);
@@ -5,6 +5,8 @@
 #include "stdafx.h"
 #include "transport_factory.h"
 #include "websocket_transport.h"
+#include "server_sent_events_transport.h"
+#include "long_polling_transport.h"
 #include "signalrclient/websocket_client.h"
 
 namespace signalr
@@ -23,6 +25,16 @@ namespace signalr
                 logger);
         }
 
+        if (transport_type == signalr::transport_type::server_sent_events)
+        {
+            return server_sent_events_transport::create(m_http_client_factory, signalr_client_config, logger);
+        }
+
+        if (transport_type == signalr::transport_type::long_polling)
+        {
+            return long_polling_transport::create(m_http_client_factory, signalr_client_config, logger);
+        }
+
         throw std::runtime_error("not implemented");
     }
 
@@ -6,6 +6,8 @@
 #include "websocket_transport.h"
 #include "logger.h"
 #include "signalrclient/signalr_exception.h"
+#include "receive_loop_adapter.h"
+#include <algorithm>
 
 #pragma warning (push)
 #pragma warning (disable : 5204 4355)
@@ -23,13 +25,14 @@ namespace signalr
 
     websocket_transport::websocket_transport(const std::function<std::shared_ptr<websocket_client>(const signalr_client_config&)>& websocket_client_factory,
         const signalr_client_config& signalr_client_config, const logger& logger)
-        : transport(logger), m_websocket_client_factory(websocket_client_factory), m_process_response_callback([](std::string, std::exception_ptr) {}),
+        : transport(logger), m_websocket_client_factory(websocket_client_factory), m_process_response_callback([](std::string&&, std::exception_ptr) {}),
         m_close_callback([](std::exception_ptr) {}), m_signalr_client_config(signalr_client_config),
-        m_disconnected(true), m_receive_loop_task(std::make_shared<cancellation_token_source>())
+        m_disconnected(true), m_writing(false), m_lingering(false)
     {
-        // we use this cts to check if the receive loop is running so it should be
-        // initially canceled to indicate that the receive loop is not running
-        m_receive_loop_task->cancel();
+        for (auto& head : m_outbound_heads)
+        {
+            head.store(nullptr);
+        }
     }
 
     websocket_transport::~websocket_transport()
@@ -42,6 +45,16 @@ namespace signalr
         }
         catch (...) // must not throw from the destructor
         {}
+
+        // nobody can be writing anymore since the writer holds a reference to the transport
+        take_outbound_frames();
+        for (auto& write_queue : m_write_queues)
+        {
+            for (auto& frame : write_queue)
+            {
+                frame->callback(std::make_exception_ptr(signalr_exception("transport was destroyed before the message was sent")));
+            }
+        }
     }
 
     transport_type websocket_transport::get_transport_type() const noexcept
@@ -50,141 +63,104 @@ namespace signalr
     }
 
     // Note that the connection assumes that the error callback won't be fired when the result is being processed. This
-    // may no longer be true when we replace the `receive_loop` with "on_message_received" and "on_close" events if they
-    // can be fired on different threads in which case we will have to lock before setting groups token and message id.
-    void websocket_transport::receive_loop()
+    // may no longer be true when "on_message" and "on_close" events can be fired on different threads in which case we
+    // will have to lock before setting groups token and message id.
+    void websocket_transport::handle_message(std::string&& message, std::exception_ptr exception)
     {
-        auto this_transport = shared_from_this();
-        auto logger = this_transport->m_logger;
-
-        // Passing the `std::weak_ptr<websocket_transport>` prevents from a memory leak where we would capture the shared_ptr to
-        // the transport in the continuation lambda and as a result as long as the loop runs the ref count would never get to
-        // zero. Now we capture the weak pointer and get the shared pointer only when the continuation runs so the ref count is
-        // incremented when the shared pointer is acquired and then decremented when it goes out of scope of the continuation.
-        auto weak_transport = std::weak_ptr<websocket_transport>(this_transport);
-
-        auto websocket_client = this_transport->safe_get_websocket_client();
-        auto weak_websocket_client = std::weak_ptr<signalr::websocket_client>(websocket_client);
-        auto receive_loop_task = m_receive_loop_task;
-
-        // There are two cases when we exit the loop. The first case is implicit - we pass the cancellation_token_source
-        // to `then` (note this is after the lambda body) and if the token is cancelled the continuation will not
-        // run at all. The second - explicit - case happens if the token gets cancelled after the continuation has
-        // been started in which case we just stop the loop by not scheduling another receive task.
-        websocket_client->receive([weak_transport, logger, receive_loop_task, weak_websocket_client](std::string message, std::exception_ptr exception)
+        bool disconnected;
+        {
+            std::lock_guard<std::mutex> lock(m_start_stop_lock);
+            disconnected = m_disconnected;
+            if (exception != nullptr)
             {
-                auto transport = weak_transport.lock();
-
-                // transport can be null if a websocket transport specific test doesn't call and wait for stop and relies on the destructor, if that happens update the test to call and wait for stop.
-                // stop waits for the receive loop to complete so the transport should never be null
-                assert(transport != nullptr);
-
-                bool disconnected;
-                {
-                    std::lock_guard<std::mutex> lock(transport->m_start_stop_lock);
-                    disconnected = transport->m_disconnected;
-                }
-                if (disconnected)
-                {
-                    // stop has been called, tell it the receive loop is done and return
-                    receive_loop_task->cancel();
-                    return;
-                }
-
-                if (exception != nullptr)
-                {
-                    try
-                    {
-                        std::rethrow_exception(exception);
-                    }
-                    catch (const std::exception & e)
-                    {
-                        logger.log(
-                            trace_level::error,
-                            std::string("[websocket transport] error receiving response from websocket: ")
-                            .append(e.what()));
-                    }
-                    catch (...)
-                    {
-                        logger.log(
-                            trace_level::error,
-                            "[websocket transport] unknown error occurred when receiving response from websocket");
+                // prevent transport.stop() from doing anything, we'll handle the close logic here (we can't guarantee the close callback will only be called once otherwise)
+                // this could happen if there was a transport error at the same time someone called stop on the connection
+                m_disconnected = true;
+            }
+        }
+        if (disconnected)
+        {
+            // stop has been called and will finish once the client stopped delivering messages
+            return;
+        }
 
-                        exception = std::make_exception_ptr(signalr_exception("unknown error"));
-                    }
+        if (exception == nullptr)
+        {
+            m_process_response_callback(std::move(message), nullptr);
+            return;
+        }
 
-                    {
-                        std::lock_guard<std::mutex> lock(transport->m_start_stop_lock);
-                        disconnected = transport->m_disconnected;
-                        // prevent transport.stop() from doing anything, we'll handle the close logic here (we can't guarantee the close callback will only be called once otherwise)
-                        // this could happen if there was a transport error at the same time someone called stop on the connection
-                        transport->m_disconnected = true;
-                    }
-                    if (disconnected)
-                    {
-                        // stop has been called, tell it the receive loop is done and return
-                        receive_loop_task->cancel();
-                        return;
-                    }
-                    receive_loop_task->cancel();
+        try
+        {
+            std::rethrow_exception(exception);
+        }
+        catch (const std::exception & e)
+        {
+            m_logger.log(
+                trace_level::error,
+                std::string("[websocket transport] error receiving response from websocket: ")
+                .append(e.what()));
+        }
+        catch (...)
+        {
+            m_logger.log(
+                trace_level::error,
+                "[websocket transport] unknown error occurred when receiving response from websocket");
 
-                    std::promise<void> promise;
-                    auto client = weak_websocket_client.lock();
-                    if (!client)
-                    {
-                        // this should not be hit
-                        // we wait for the receive loop to complete before completing stop (which will then destruct the transport and client)
-                        logger.log(trace_level::critical,
-                            "[websocket transport] websocket client has been destructed before the receive loop completes, this is a bug");
-                        assert(client != nullptr);
-                    }
+            exception = std::make_exception_ptr(signalr_exception("unknown error"));
+        }
 
-                    // because transport.stop won't be called we need to stop the underlying client and invoke the transports close callback
-                    client->stop([&promise](std::exception_ptr exception)
-                    {
-                        if (exception != nullptr)
-                        {
-                            promise.set_exception(exception);
-                        }
-                        else
-                        {
-                            promise.set_value();
-                        }
-                    });
+        // the client doesn't deliver messages anymore after an error, so stopping it here can't wait for this call to return
+        std::promise<void> promise;
+        auto client = safe_get_websocket_client();
 
-                    try
-                    {
-                        promise.get_future().get();
-                    }
-                    // We prefer the outer exception bubbling up to the user
-                    // REVIEW: log here?
-                    catch (...) {}
+        // because transport.stop won't be called we need to stop the underlying client and invoke the transports close callback
+        client->stop([&promise](std::exception_ptr exception)
+        {
+            if (exception != nullptr)
+            {
+                promise.set_exception(exception);
+            }
+            else
+            {
+                promise.set_value();
+            }
+        });
 
-                    transport->m_close_callback(exception);
+        try
+        {
+            promise.get_future().get();
+        }
+        // We prefer the outer exception bubbling up to the user
+        // REVIEW: log here?
+        catch (...) {}
 
-                    return;
-                }
+        m_close_callback(exception);
+    }
 
-                transport->m_process_response_callback(message, nullptr);
+    void websocket_transport::handle_message_batch(std::vector<std::string>&& messages)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_start_stop_lock);
+            if (m_disconnected)
+            {
+                return;
+            }
+        }
 
-                {
-                    std::lock_guard<std::mutex> lock(transport->m_start_stop_lock);
-                    disconnected = transport->m_disconnected;
-                }
+        if (m_process_response_batch_callback)
+        {
+            m_process_response_batch_callback(std::move(messages));
+            return;
+        }
 
-                if (!disconnected)
-                {
-                    assert(!receive_loop_task->is_canceled());
-                    transport->receive_loop();
-                }
-                else
-                {
-                    receive_loop_task->cancel();
-                }
-            });
+        for (auto& message : messages)
+        {
+            m_process_response_callback(std::move(message), nullptr);
+        }
     }
 
-    std::shared_ptr<websocket_client> websocket_transport::safe_get_websocket_client()
+    std::shared_ptr<persistent_websocket_client> websocket_transport::safe_get_websocket_client()
     {
         {
             const std::lock_guard<std::mutex> lock(m_websocket_client_lock);
@@ -212,7 +188,39 @@ namespace signalr
                 std::string("[websocket transport] connecting to: ")
                 .append(url));
 
-            auto websocket_client = m_websocket_client_factory(m_signalr_client_config);
+            auto created_client = m_websocket_client_factory(m_signalr_client_config);
+            std::shared_ptr<persistent_websocket_client> websocket_client;
+            auto persistent_client = created_client->as_persistent();
+            if (persistent_client != nullptr)
+            {
+                // shares ownership with the client the factory returned
+                websocket_client = std::shared_ptr<persistent_websocket_client>(created_client, persistent_client);
+            }
+            else
+            {
+                websocket_client = std::make_shared<receive_loop_adapter>(created_client, m_signalr_client_config.get_scheduler(), m_logger);
+            }
+
+            auto weak_transport = std::weak_ptr<websocket_transport>(shared_from_this());
+
+            // registered once per client, receiving doesn't allocate anything per message. The handler is never called after
+            // the client was stopped and `stop` waits for that, so the transport is alive while it runs
+            websocket_client->on_owned_message([weak_transport](std::string&& message, std::exception_ptr exception)
+                {
+                    auto transport = weak_transport.lock();
+                    if (transport)
+                    {
+                        transport->handle_message(std::move(message), exception);
+                    }
+                });
+            websocket_client->on_message_batch([weak_transport](std::vector<std::string>&& messages)
+                {
+                    auto transport = weak_transport.lock();
+                    if (transport)
+                    {
+                        transport->handle_message_batch(std::move(messages));
+                    }
+                });
 
             {
                 std::lock_guard<std::mutex> client_lock(m_websocket_client_lock);
@@ -220,9 +228,6 @@ namespace signalr
             }
 
             m_disconnected = false;
-            m_receive_loop_task->reset();
-
-            auto weak_transport = std::weak_ptr<websocket_transport>(shared_from_this());
 
             websocket_client->start(url, [weak_transport, callback](std::exception_ptr exception)
                 {
@@ -245,7 +250,6 @@ namespace signalr
                             throw signalr::canceled_exception();
                         }
 
-                        transport->receive_loop();
                         callback(nullptr);
                     }
                     catch (const std::exception & e)
@@ -264,7 +268,7 @@ namespace signalr
 
     void websocket_transport::stop(std::function<void(std::exception_ptr)> callback) noexcept
     {
-        std::shared_ptr<websocket_client> websocket_client = nullptr;
+        std::shared_ptr<persistent_websocket_client> websocket_client = nullptr;
 
         {
             std::lock_guard<std::mutex> lock(m_start_stop_lock);
@@ -282,37 +286,34 @@ namespace signalr
 
         auto logger = m_logger;
         auto close_callback = m_close_callback;
-        auto receive_loop_task = m_receive_loop_task;
 
         m_logger.log(trace_level::debug, "stopping websocket transport");
 
-        websocket_client->stop([logger, callback, close_callback, receive_loop_task](std::exception_ptr exception)
+        // the client completes stop once it no longer delivers messages
+        websocket_client->stop([logger, callback, close_callback](std::exception_ptr exception)
             {
-                receive_loop_task->register_callback([logger, callback, close_callback, exception]()
+                try
+                {
+                    if (exception != nullptr)
                     {
-                        try
-                        {
-                            if (exception != nullptr)
-                            {
-                                std::rethrow_exception(exception);
-                            }
-                            logger.log(trace_level::debug, "websocket transport stopped");
-                        }
-                        catch (const std::exception& e)
-                        {
-                            if (logger.is_enabled(trace_level::error))
-                            {
-                                logger.log(
-                                    trace_level::error,
-                                    std::string("websocket transport stopped with error: ")
-                                    .append(e.what()));
-                            }
-                        }
+                        std::rethrow_exception(exception);
+                    }
+                    logger.log(trace_level::debug, "websocket transport stopped");
+                }
+                catch (const std::exception& e)
+                {
+                    if (logger.is_enabled(trace_level::error))
+                    {
+                        logger.log(
+                            trace_level::error,
+                            std::string("websocket transport stopped with error: ")
+                            .append(e.what()));
+                    }
+                }
 
-                        close_callback(exception);
+                close_callback(exception);
 
-                        callback(exception);
-                    });
+                callback(exception);
             });
     }
 
@@ -326,18 +327,252 @@ namespace signalr
         m_process_response_callback = callback;
     }
 
-    void websocket_transport::send(const std::string& payload, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback) noexcept
+    void websocket_transport::on_receive_batch(std::function<void(std::vector<std::string>&&)> callback)
+    {
+        m_process_response_batch_callback = callback;
+    }
+
+    void websocket_transport::pause_receive() noexcept
+    {
+        auto websocket_client = safe_get_websocket_client();
+        if (websocket_client)
+        {
+            websocket_client->pause_receive();
+        }
+    }
+
+    void websocket_transport::resume_receive() noexcept
     {
-        safe_get_websocket_client()->send(payload, transfer_format, [callback](std::exception_ptr exception)
+        auto websocket_client = safe_get_websocket_client();
+        if (websocket_client)
+        {
+            websocket_client->resume_receive();
+        }
+    }
+
+    void websocket_transport::send(const std::string& payload, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback,
+        send_priority priority, const std::string& conflation_key) noexcept
+    {
+        auto& head = m_outbound_heads[static_cast<size_t>(priority)];
+        auto frame = new outbound_frame{ payload, transfer_format, callback, head.load(), conflation_key };
+
+        if (!conflation_key.empty())
+        {
+            std::lock_guard<std::mutex> lock(m_conflated_frames_lock);
+            auto& queued = m_conflated_frames[conflation_key];
+            if (queued != nullptr)
             {
-                if (exception != nullptr)
+                queued->payload = std::move(frame->payload);
+                auto replaced_callback = std::move(queued->callback);
+                queued->callback = [replaced_callback, callback](std::exception_ptr exception)
                 {
+                    replaced_callback(exception);
                     callback(exception);
+                };
+                delete frame;
+                return;
+            }
+            queued = frame;
+        }
+
+        while (!head.compare_exchange_weak(frame->next, frame))
+        {
+        }
+
+        if (!m_writing.exchange(true))
+        {
+            write_pending(false);
+        }
+        else if (priority == send_priority::control && m_lingering.exchange(false))
+        {
+            // the writer was only waiting for the data batch to fill up, the batch is flushed along with the control frame
+            write_pending(true);
+        }
+    }
+
+    void websocket_transport::take_outbound_frames()
+    {
+        for (size_t lane = 0; lane < lane_count; ++lane)
+        {
+            // the stack holds the newest frame first, reverse it so frames are written in the order they were sent
+            outbound_frame* head = m_outbound_heads[lane].exchange(nullptr);
+            outbound_frame* reversed = nullptr;
+            while (head != nullptr)
+            {
+                auto next = head->next;
+                head->next = reversed;
+                reversed = head;
+                head = next;
+            }
+
+            while (reversed != nullptr)
+            {
+                auto next = reversed->next;
+                m_write_queues[lane].push_back(std::unique_ptr<outbound_frame>(reversed));
+                reversed = next;
+            }
+        }
+    }
+
+    // Stops replacing the payload of a frame with a conflation key, called by the writer before it looks at the payload.
+    void websocket_transport::seal_frame(outbound_frame& frame)
+    {
+        if (frame.conflation_key.empty())
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_conflated_frames_lock);
+        auto found = m_conflated_frames.find(frame.conflation_key);
+        if (found != m_conflated_frames.end() && found->second == &frame)
+        {
+            m_conflated_frames.erase(found);
+        }
+        frame.conflation_key.clear();
+    }
+
+    // Must only be called by the thread that set `m_writing`. Writes everything queued, control frames first, concatenating
+    // consecutive frames of the same lane and transfer format (both hub protocols delimit their messages so the server can split
+    // them again) into one websocket send, and releases the writer role once the queues are empty. The lanes are re-checked
+    // before every send so a control frame waits for at most the send in progress.
+    void websocket_transport::write_pending(bool lingered)
+    {
+        const auto max_batch_size = m_signalr_client_config.get_max_send_batch_size();
+        const auto max_delay = m_signalr_client_config.get_max_send_delay();
+
+        while (true)
+        {
+            take_outbound_frames();
+
+            auto write_queue = std::find_if(std::begin(m_write_queues), std::end(m_write_queues),
+                [](const std::deque<std::unique_ptr<outbound_frame>>& queue) { return !queue.empty(); });
+
+            if (write_queue == std::end(m_write_queues))
+            {
+                m_writing.store(false);
+
+                // a frame pushed after the stacks were taken but before the writer role was released would otherwise wait
+                // for the next send
+                if (std::all_of(std::begin(m_outbound_heads), std::end(m_outbound_heads),
+                    [](const std::atomic<outbound_frame*>& head) { return head.load() == nullptr; }) || m_writing.exchange(true))
+                {
+                    return;
                 }
-                else
+
+                continue;
+            }
+
+            // control frames never wait for a batch to fill up
+            if (!lingered && write_queue == &m_write_queues[static_cast<size_t>(send_priority::data)]
+                && !m_signalr_client_config.get_flush_on_idle() && max_delay > std::chrono::microseconds::zero())
+            {
+                size_t queued_bytes = 0;
                 {
-                    callback(nullptr);
+                    std::lock_guard<std::mutex> lock(m_conflated_frames_lock);
+                    for (auto& frame : *write_queue)
+                    {
+                        queued_bytes += frame->payload.size();
+                    }
                 }
-            });
+
+                if (queued_bytes < max_batch_size)
+                {
+                    // keep the writer role and let other senders fill up the batch, the flush is a delayed scheduler callback
+                    // so neither the thread calling send nor a scheduler thread waits for it, the scheduler counts in
+                    // milliseconds so the delay is rounded up rather than dropped
+                    auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(max_delay);
+                    if (delay < max_delay)
+                    {
+                        delay += std::chrono::milliseconds(1);
+                    }
+
+                    m_lingering.store(true);
+                    // a control frame pushed after the stacks were taken may have missed `m_lingering`, it must not wait either
+                    if (m_outbound_heads[static_cast<size_t>(send_priority::control)].load() != nullptr && m_lingering.exchange(false))
+                    {
+                        lingered = true;
+                        continue;
+                    }
+
+                    auto weak_transport = std::weak_ptr<websocket_transport>(shared_from_this());
+                    m_signalr_client_config.get_scheduler()->schedule([weak_transport]()
+                        {
+                            auto transport = weak_transport.lock();
+                            // a control frame may have taken over and flushed the batch already
+                            if (transport && transport->m_lingering.exchange(false))
+                            {
+                                transport->write_pending(true);
+                            }
+                        }, delay);
+                    return;
+                }
+            }
+
+            // a control frame written while the data batch lingered doesn't start the wait over
+            if (write_queue == &m_write_queues[static_cast<size_t>(send_priority::data)])
+            {
+                lingered = false;
+            }
+
+            auto transfer_format = write_queue->front()->transfer_format;
+            // the frames are kept until the send completes, a batch is handed to the client as buffers pointing into their
+            // payloads instead of being concatenated
+            auto frames = std::make_shared<std::vector<std::unique_ptr<outbound_frame>>>();
+            size_t batch_size = 0;
+            while (!write_queue->empty() && write_queue->front()->transfer_format == transfer_format)
+            {
+                auto& frame = write_queue->front();
+                seal_frame(*frame);
+                if (!frames->empty() && batch_size + frame->payload.size() > max_batch_size)
+                {
+                    break;
+                }
+
+                batch_size += frame->payload.size();
+                frames->push_back(std::move(frame));
+                write_queue->pop_front();
+            }
+
+            // 0 - send in progress, 1 - send completed, 2 - `send` returned; whoever comes second continues writing so a
+            // websocket client completing sends synchronously doesn't make this recurse
+            auto send_state = std::make_shared<std::atomic<int>>(0);
+            auto weak_transport = std::weak_ptr<websocket_transport>(shared_from_this());
+            auto send_callback = [weak_transport, frames, send_state, lingered](std::exception_ptr exception)
+                {
+                    for (auto& frame : *frames)
+                    {
+                        frame->callback(exception);
+                    }
+
+                    if (send_state->exchange(1) == 2)
+                    {
+                        auto transport = weak_transport.lock();
+                        if (transport)
+                        {
+                            transport->write_pending(lingered);
+                        }
+                    }
+                };
+
+            if (frames->size() == 1)
+            {
+                safe_get_websocket_client()->send(frames->front()->payload, transfer_format, send_callback);
+            }
+            else
+            {
+                std::vector<const_buffer> buffers;
+                buffers.reserve(frames->size());
+                for (const auto& frame : *frames)
+                {
+                    buffers.push_back(const_buffer{ frame->payload.data(), frame->payload.size() });
+                }
+                safe_get_websocket_client()->send(buffers, transfer_format, send_callback);
+            }
+
+            if (send_state->exchange(2) == 0)
+            {
+                return;
+            }
+        }
     }
 }
@@ -8,6 +8,9 @@
 #include "logger.h"
 #include "signalrclient/websocket_client.h"
 #include "connection_impl.h"
+#include <atomic>
+#include <deque>
+#include <unordered_map>
 
 namespace signalr
 {
@@ -29,27 +32,62 @@ namespace signalr
         void stop(std::function<void(std::exception_ptr)> callback) noexcept override;
         void on_close(std::function<void(std::exception_ptr)> callback) override;
 
-        void send(const std::string& payload, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback) noexcept override;
+        void send(const std::string& payload, transfer_format transfer_format, std::function<void(std::exception_ptr)> callback,
+            send_priority priority = send_priority::data, const std::string& conflation_key = std::string()) noexcept override;
 
         void on_receive(std::function<void(std::string&&, std::exception_ptr)>) override;
+        void on_receive_batch(std::function<void(std::vector<std::string>&&)> callback) override;
+
+        void pause_receive() noexcept override;
+        void resume_receive() noexcept override;
 
     private:
         websocket_transport(const std::function<std::shared_ptr<websocket_client>(const signalr_client_config&)>& websocket_client_factory,
             const signalr_client_config& signalr_client_config, const logger& logger);
 
         std::function<std::shared_ptr<websocket_client>(const signalr_client_config&)> m_websocket_client_factory;
-        std::shared_ptr<websocket_client> m_websocket_client;
+        std::shared_ptr<persistent_websocket_client> m_websocket_client;
         std::mutex m_websocket_client_lock;
         std::mutex m_start_stop_lock;
-        std::function<void(std::string, std::exception_ptr)> m_process_response_callback;
+        std::function<void(std::string&&, std::exception_ptr)> m_process_response_callback;
+        std::function<void(std::vector<std::string>&&)> m_process_response_batch_callback;
         std::function<void(std::exception_ptr)> m_close_callback;
         signalr_client_config m_signalr_client_config;
 
         bool m_disconnected;
-        std::shared_ptr<cancellation_token_source> m_receive_loop_task;
 
-        void receive_loop();
+        struct outbound_frame
+        {
+            std::string payload;
+            signalr::transfer_format transfer_format;
+            std::function<void(std::exception_ptr)> callback;
+            outbound_frame* next;
+            std::string conflation_key;
+        };
+
+        // one lane per `send_priority`, lower lanes are written first
+        static const size_t lane_count = 2;
+
+        // senders push frames onto these lock-free stacks, whoever wins `m_writing` becomes the single writer and takes the
+        // whole stacks at once so concurrent senders never call into the websocket client at the same time
+        std::atomic<outbound_frame*> m_outbound_heads[lane_count];
+        std::atomic<bool> m_writing;
+        // set while the writer holds `m_writing` only to let a data batch fill up, whoever clears it takes over writing: the delayed
+        // flush, or a control frame that must not wait for the batch
+        std::atomic<bool> m_lingering;
+        // frames taken off the stacks in send order, only touched by the current writer
+        std::deque<std::unique_ptr<outbound_frame>> m_write_queues[lane_count];
+        // queued frames with a conflation key that can still be replaced, the payload and callback of these frames are only
+        // touched while holding `m_conflated_frames_lock` until the writer removes them from here
+        std::unordered_map<std::string, outbound_frame*> m_conflated_frames;
+        std::mutex m_conflated_frames_lock;
+
+        void handle_message(std::string&& message, std::exception_ptr exception);
+        void handle_message_batch(std::vector<std::string>&& messages);
+        void take_outbound_frames();
+        void seal_frame(outbound_frame& frame);
+        void write_pending(bool lingered);
 
-        std::shared_ptr<websocket_client> safe_get_websocket_client();
+        std::shared_ptr<persistent_websocket_client> safe_get_websocket_client();
     };
 }
@@ -22,7 +22,16 @@ std::vector<std::pair<std::vector<uint8_t>, std::string>> test_data
     "/8nBN1rH" },
 
     { { 251, 201, 193, 255 },
-    "+8nB/w==" }
+    "+8nB/w==" },
+
+    { { 8, 9 },
+    "CAk=" },
+
+    { { 8 },
+    "CA==" },
+
+    { {},
+    "" }
 };
 
 TEST(base_encode, encodes_binary_data)
@@ -4,14 +4,32 @@
 
 #include "stdafx.h"
 #include "signalrclient/callback_manager.h"
+#include "signalrclient/signalr_exception.h"
 
 using namespace signalr;
 
+namespace
+{
+    std::string get_what(std::exception_ptr exception)
+    {
+        try
+        {
+            std::rethrow_exception(exception);
+        }
+        catch (const std::exception& e)
+        {
+            return e.what();
+        }
+
+        return std::string();
+    }
+}
+
 TEST(callback_manager_register_callback, register_returns_unique_callback_ids)
 {
     callback_manager callback_mgr{ "" };
-    auto callback_id1 = callback_mgr.register_callback([](const char*, const signalr::value&){});
-    auto callback_id2 = callback_mgr.register_callback([](const char*, const signalr::value&){});
+    auto callback_id1 = callback_mgr.register_callback([](std::exception_ptr, const signalr::value&){});
+    auto callback_id2 = callback_mgr.register_callback([](std::exception_ptr, const signalr::value&){});
 
     ASSERT_NE(callback_id1, callback_id2);
 }
@@ -23,9 +41,9 @@ TEST(callback_manager_invoke_callback, invoke_callback_invokes_and_removes_callb
     int callback_argument;
 
     auto callback_id = callback_mgr.register_callback(
-        [&callback_argument](const char* error, const signalr::value& argument)
+        [&callback_argument](std::exception_ptr exception, const signalr::value& argument)
         {
-            ASSERT_EQ(nullptr, error);
+            ASSERT_EQ(nullptr, exception);
             callback_argument = (int)argument.as_double();
         });
 
@@ -43,9 +61,9 @@ TEST(callback_manager_invoke_callback, invoke_callback_invokes_and_does_not_remo
     int callback_argument;
 
     auto callback_id = callback_mgr.register_callback(
-        [&callback_argument](const char* error, const signalr::value& argument)
+        [&callback_argument](std::exception_ptr exception, const signalr::value& argument)
         {
-            ASSERT_EQ(nullptr, error);
+            ASSERT_EQ(nullptr, exception);
             callback_argument = (int)argument.as_double();
         });
 
@@ -72,7 +90,7 @@ TEST(callback_manager_remove, remove_removes_callback_and_returns_true_for_valid
         callback_manager callback_mgr{ "" };
 
         auto callback_id = callback_mgr.register_callback(
-            [&callback_called](const char*, const signalr::value&)
+            [&callback_called](std::exception_ptr, const signalr::value&)
         {
             callback_called = true;
         });
@@ -97,15 +115,15 @@ TEST(callback_manager_clear, clear_invokes_all_callbacks)
     for (auto i = 0; i < 10; i++)
     {
         callback_mgr.register_callback(
-            [&invocation_count](const char* error, const signalr::value& argument)
+            [&invocation_count](std::exception_ptr exception, const signalr::value& argument)
             {
                 invocation_count++;
-                ASSERT_STREQ("clearing callback", error);
+                ASSERT_EQ("clearing callback", get_what(exception));
                 ASSERT_TRUE(argument.is_null());
             });
     }
 
-    callback_mgr.clear("clearing callback");
+    callback_mgr.clear(std::make_exception_ptr(std::runtime_error("clearing callback")));
 
     ASSERT_EQ(10, invocation_count);
 }
@@ -119,10 +137,11 @@ TEST(callback_manager_dtor, clear_invokes_all_callbacks)
         for (auto i = 0; i < 10; i++)
         {
             callback_mgr.register_callback(
-                [&invocation_count](const char* error, const signalr::value& argument)
+                [&invocation_count](std::exception_ptr exception, const signalr::value& argument)
             {
                 invocation_count++;
-                ASSERT_STREQ("error", error);
+                ASSERT_THROW(std::rethrow_exception(exception), signalr_exception);
+                ASSERT_EQ("error", get_what(exception));
                 ASSERT_TRUE(argument.is_null());
             });
         }
@@ -130,3 +149,198 @@ TEST(callback_manager_dtor, clear_invokes_all_callbacks)
 
     ASSERT_EQ(10, invocation_count);
 }
+
+TEST(callback_manager_register_callback, callback_ids_are_decimal_and_sequential)
+{
+    callback_manager callback_mgr{ "" };
+
+    ASSERT_EQ("0", callback_mgr.register_callback([](std::exception_ptr, const signalr::value&) {}));
+    ASSERT_EQ("1", callback_mgr.register_callback([](std::exception_ptr, const signalr::value&) {}));
+    ASSERT_EQ("2", callback_mgr.register_callback([](std::exception_ptr, const signalr::value&) {}));
+}
+
+TEST(callback_manager_format_callback_id, round_trips_through_parse)
+{
+    uint64_t ids[] = { 0, 7, 10, 99, 100, 12345, 4294967296, UINT64_MAX };
+
+    for (auto id : ids)
+    {
+        auto formatted = callback_manager::format_callback_id(id);
+        ASSERT_EQ(std::to_string(id), formatted);
+
+        uint64_t parsed;
+        ASSERT_TRUE(callback_manager::try_parse_callback_id(formatted, parsed));
+        ASSERT_EQ(id, parsed);
+    }
+}
+
+TEST(callback_manager_try_parse_callback_id, rejects_ids_not_created_by_the_manager)
+{
+    std::string invalid_ids[] = { "", "01", "-1", "1a", "abc", " 1", "18446744073709551616", "123456789012345678901" };
+
+    for (const auto& id : invalid_ids)
+    {
+        uint64_t parsed;
+        ASSERT_FALSE(callback_manager::try_parse_callback_id(id, parsed)) << id;
+    }
+}
+
+TEST(callback_manager_invoke_callback, invoke_callback_returns_false_for_non_numeric_callback_id)
+{
+    callback_manager callback_mgr{ "" };
+    callback_mgr.register_callback([](std::exception_ptr, const signalr::value&) {});
+
+    ASSERT_FALSE(callback_mgr.invoke_callback("00", nullptr, signalr::value(), true));
+    ASSERT_FALSE(callback_mgr.invoke_callback("not-an-id", nullptr, signalr::value(), true));
+    ASSERT_TRUE(callback_mgr.invoke_callback("0", nullptr, signalr::value(), true));
+}
+
+TEST(callback_manager_invoke_callback, callbacks_found_after_table_grows_and_entries_are_removed)
+{
+    callback_manager callback_mgr{ "" };
+    std::vector<std::string> callback_ids;
+    std::vector<int> invoked(1000, 0);
+
+    for (auto i = 0; i < 1000; i++)
+    {
+        callback_ids.push_back(callback_mgr.register_callback(
+            [&invoked, i](std::exception_ptr, const signalr::value&)
+            {
+                invoked[i]++;
+            }));
+    }
+
+    // remove every third callback so the remaining entries have to be shifted back into the holes
+    for (auto i = 0; i < 1000; i += 3)
+    {
+        ASSERT_TRUE(callback_mgr.remove_callback(callback_ids[i]));
+    }
+
+    for (auto i = 0; i < 1000; i++)
+    {
+        ASSERT_EQ(i % 3 != 0, callback_mgr.invoke_callback(callback_ids[i], nullptr, signalr::value(), true));
+        ASSERT_EQ(i % 3 != 0 ? 1 : 0, invoked[i]);
+    }
+
+    callback_mgr.clear(std::make_exception_ptr(std::runtime_error("")));
+
+    for (auto i = 0; i < 1000; i++)
+    {
+        ASSERT_EQ(i % 3 != 0 ? 1 : 0, invoked[i]);
+    }
+}
+
+TEST(callback_manager_invoke_callback, concurrent_register_and_invoke)
+{
+    callback_manager callback_mgr{ "" };
+    std::atomic<int> invocation_count{ 0 };
+
+    std::vector<std::thread> threads;
+    for (auto t = 0; t < 4; t++)
+    {
+        threads.emplace_back([&callback_mgr, &invocation_count]()
+            {
+                for (auto i = 0; i < 500; i++)
+                {
+                    auto callback_id = callback_mgr.register_callback(
+                        [&invocation_count](std::exception_ptr, const signalr::value&)
+                        {
+                            invocation_count++;
+                        });
+                    callback_mgr.invoke_callback(callback_id, nullptr, signalr::value(), true);
+                }
+            });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    ASSERT_EQ(2000, invocation_count.load());
+}
+
+TEST(callback_manager_invoke_callback, invoke_callback_transfers_ownership_of_arguments)
+{
+    callback_manager callback_mgr{ "" };
+
+    signalr::value owned;
+    auto callback_id = callback_mgr.register_callback(
+        [&owned](std::exception_ptr, signalr::value&& argument)
+        {
+            owned = std::move(argument);
+        });
+
+    signalr::value argument(std::vector<uint8_t>(1024 * 1024, 0x2a));
+    const auto* data = argument.as_binary().data();
+
+    ASSERT_TRUE(callback_mgr.invoke_callback(callback_id, nullptr, std::move(argument), true));
+
+    // same buffer means the binary payload was moved all the way through rather than copied
+    ASSERT_EQ(data, owned.as_binary().data());
+}
+
+TEST(callback_manager_expire_callbacks, expire_callbacks_completes_only_callbacks_past_their_deadline)
+{
+    callback_manager callback_mgr{ "" };
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto timeout = std::make_exception_ptr(std::runtime_error("timeout"));
+    std::vector<std::string> errors;
+
+    callback_mgr.register_callback([&errors](std::exception_ptr exception, const signalr::value&) { errors.push_back(std::string("late:").append(get_what(exception))); },
+        now + std::chrono::seconds(10));
+    callback_mgr.register_callback([&errors](std::exception_ptr exception, const signalr::value&) { errors.push_back(std::string("early:").append(get_what(exception))); },
+        now + std::chrono::seconds(1));
+    callback_mgr.register_callback([&errors](std::exception_ptr, const signalr::value&) { errors.push_back("no deadline"); });
+
+    ASSERT_EQ(0, callback_mgr.expire_callbacks(now, timeout));
+    ASSERT_TRUE(errors.empty());
+
+    ASSERT_EQ(1, callback_mgr.expire_callbacks(now + std::chrono::seconds(5), timeout));
+    ASSERT_EQ(std::vector<std::string> { "early:timeout" }, errors);
+
+    ASSERT_EQ(1, callback_mgr.expire_callbacks(now + std::chrono::seconds(10), timeout));
+    ASSERT_EQ((std::vector<std::string> { "early:timeout", "late:timeout" }), errors);
+
+    ASSERT_TRUE(callback_mgr.invoke_callback("2", nullptr, signalr::value(), true));
+    ASSERT_EQ(3, errors.size());
+}
+
+TEST(callback_manager_expire_callbacks, expire_callbacks_skips_callbacks_that_already_completed)
+{
+    callback_manager callback_mgr{ "" };
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto timeout = std::make_exception_ptr(std::runtime_error("timeout"));
+    auto invocation_count = 0;
+
+    auto callback_id = callback_mgr.register_callback([&invocation_count](std::exception_ptr, const signalr::value&) { invocation_count++; },
+        now + std::chrono::seconds(1));
+
+    ASSERT_TRUE(callback_mgr.invoke_callback(callback_id, nullptr, signalr::value(), true));
+    ASSERT_EQ(0, callback_mgr.expire_callbacks(now + std::chrono::seconds(1), timeout));
+    ASSERT_EQ(1, invocation_count);
+}
+
+TEST(callback_manager_expire_callbacks, deadlines_of_completed_callbacks_do_not_accumulate)
+{
+    callback_manager callback_mgr{ "" };
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto timeout = std::make_exception_ptr(std::runtime_error("timeout"));
+    auto expired = 0;
+
+    // one call outstanding for the whole run, every other one completes long before its deadline
+    callback_mgr.register_callback([&expired](std::exception_ptr, const signalr::value&) { expired++; }, now + std::chrono::hours(1));
+    for (int i = 0; i < 10000; ++i)
+    {
+        auto callback_id = callback_mgr.register_callback([](std::exception_ptr, const signalr::value&) {}, now + std::chrono::hours(1));
+        ASSERT_TRUE(callback_mgr.invoke_callback(callback_id, nullptr, signalr::value(), true));
+    }
+
+    ASSERT_LE(callback_mgr.pending_deadlines(), 64U);
+
+    ASSERT_EQ(1, callback_mgr.expire_callbacks(now + std::chrono::hours(1), timeout));
+    ASSERT_EQ(1, expired);
+}
@@ -283,4 +283,31 @@ TEST(cancellation_token, callback_called_when_cts_already_destructed)
             called = true;
         });
     ASSERT_TRUE(called);
-}
\ No newline at end of file
+}
+
+TEST(cancellation_token, unregistered_callback_is_not_called)
+{
+    auto cts = std::make_shared<cancellation_token_source>();
+    auto token = get_cancellation_token(cts);
+
+    int first = 0;
+    int second = 0;
+    auto registration = token.register_callback([&first]()
+        {
+            first++;
+        });
+    token.register_callback([&second]()
+        {
+            second++;
+        });
+    ASSERT_NE(0U, registration);
+
+    token.unregister_callback(registration);
+    // unknown registrations and the 0 of an already run callback are ignored
+    token.unregister_callback(registration);
+    token.unregister_callback(0);
+
+    cts->cancel();
+    ASSERT_EQ(0, first);
+    ASSERT_EQ(1, second);
+}
@@ -469,7 +469,7 @@ TEST(connection_impl_start, start_fails_if_negotiate_response_has_error)
     connect_mre.set();
 }
 
-TEST(connection_impl_start, start_fails_if_negotiate_response_does_not_have_websockets)
+TEST(connection_impl_start, start_fails_if_no_transport_supports_the_transfer_format)
 {
     std::shared_ptr<log_writer> writer(std::make_shared<memory_log_writer>());
 
@@ -477,7 +477,8 @@ TEST(connection_impl_start, start_fails_if_negotiate_response_does_not_have_webs
         {
             auto response_body =
                 url.find("/negotiate") != std::string::npos
-                ? "{ \"availableTransports\": [ { \"transport\": \"ServerSentEvents\", \"transferFormats\": [ \"Text\" ] } ] }"
+                ? "{ \"availableTransports\": [ { \"transport\": \"ServerSentEvents\", \"transferFormats\": [ \"Text\" ] }, "
+                    "{ \"transport\": \"WebSockets\", \"transferFormats\": [ \"Text\" ] } ] }"
                 : "";
 
             return http_response{ 200, response_body };
@@ -491,6 +492,8 @@ TEST(connection_impl_start, start_fails_if_negotiate_response_does_not_have_webs
                 http_client->set_scheduler(config.get_scheduler());
                 return http_client;
             }, [websocket_client](const signalr_client_config&) { return websocket_client; });
+    // server-sent events only support text
+    connection->set_transfer_format(transfer_format::binary);
 
     auto mre = manual_reset_event<void>();
     connection->start([&mre](std::exception_ptr exception)
@@ -505,7 +508,7 @@ TEST(connection_impl_start, start_fails_if_negotiate_response_does_not_have_webs
     }
     catch (const signalr_exception & e)
     {
-        ASSERT_STREQ("The server does not support WebSockets which is currently the only transport supported by this client.", e.what());
+        ASSERT_STREQ("The server does not support any of the transports supported by this client.", e.what());
     }
 }
 
@@ -545,7 +548,7 @@ TEST(connection_impl_start, start_fails_if_negotiate_response_does_not_have_tran
     }
     catch (const signalr_exception & e)
     {
-        ASSERT_STREQ("The server does not support WebSockets which is currently the only transport supported by this client.", e.what());
+        ASSERT_STREQ("The server does not support any of the transports supported by this client.", e.what());
     }
 }
 
@@ -1211,6 +1214,114 @@ TEST(connection_impl_set_message_received, callback_invoked_when_message_receive
     ASSERT_EQ("Test", *message);
 }
 
+// delivers messages through `on_owned_message` if `owned` is set and through `on_message` otherwise
+class frame_owning_websocket_client : public persistent_websocket_client
+{
+public:
+    explicit frame_owning_websocket_client(bool owned)
+        : m_owned(owned)
+    { }
+
+    void start(const std::string&, std::function<void(std::exception_ptr)> callback) override
+    {
+        std::thread([callback]() { callback(nullptr); }).detach();
+    }
+
+    void stop(std::function<void(std::exception_ptr)> callback) override
+    {
+        callback(nullptr);
+    }
+
+    void send(const std::string&, signalr::transfer_format, std::function<void(std::exception_ptr)> callback) override
+    {
+        callback(nullptr);
+    }
+
+    void on_message(std::function<void(const std::string&, std::exception_ptr)> handler) override
+    {
+        m_handler = handler;
+    }
+
+    void on_owned_message(std::function<void(std::string&&, std::exception_ptr)> handler) override
+    {
+        if (m_owned)
+        {
+            m_owned_handler = handler;
+        }
+        else
+        {
+            persistent_websocket_client::on_owned_message(handler);
+        }
+    }
+
+    void pause_receive() override
+    { }
+
+    void resume_receive() override
+    { }
+
+    void deliver(std::string&& message)
+    {
+        if (m_owned)
+        {
+            m_owned_handler(std::move(message), nullptr);
+        }
+        else
+        {
+            m_handler(message, nullptr);
+        }
+    }
+
+private:
+    bool m_owned;
+    std::function<void(const std::string&, std::exception_ptr)> m_handler;
+    std::function<void(std::string&&, std::exception_ptr)> m_owned_handler;
+};
+
+// whether the message received callback got the very buffer of a 1 MB frame delivered by the websocket client, i.e. the frame
+// was moved all the way instead of being copied somewhere along the way
+static bool message_buffer_was_moved(bool owned)
+{
+    auto websocket_client = std::make_shared<frame_owning_websocket_client>(owned);
+    auto connection = connection_impl::create(create_uri(), trace_level::none, std::make_shared<memory_log_writer>(), create_test_http_client(),
+        [websocket_client](const signalr_client_config&)
+        {
+            return websocket_client;
+        });
+
+    std::string frame(1024 * 1024, 'x');
+    auto frame_data = frame.data();
+    std::string received;
+    connection->set_message_received([&received](std::string&& message)
+        {
+            received = std::move(message);
+        });
+
+    auto mre = manual_reset_event<void>();
+    connection->start([&mre](std::exception_ptr exception)
+        {
+            mre.set(exception);
+        });
+    mre.get();
+
+    websocket_client->deliver(std::move(frame));
+
+    connection->stop([&mre](std::exception_ptr exception)
+        {
+            mre.set(exception);
+        }, nullptr);
+    mre.get();
+
+    return received.data() == frame_data;
+}
+
+TEST(connection_impl_set_message_received, owned_messages_reach_the_callback_without_being_copied)
+{
+    ASSERT_TRUE(message_buffer_was_moved(true));
+    // clients only implementing `on_message` hand out a reference to their buffer, so the message has to be copied
+    ASSERT_FALSE(message_buffer_was_moved(false));
+}
+
 TEST(connection_impl_set_message_received, exception_from_callback_caught_and_logged)
 {
     auto websocket_client = create_test_websocket_client();
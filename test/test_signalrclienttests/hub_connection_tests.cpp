@@ -6,6 +6,7 @@
 #include "test_utils.h"
 #include "test_http_client.h"
 #include "signalrclient/hub_connection_builder.h"
+#include "signalrclient/telemetry_aggregator.h"
 #include "memory_log_writer.h"
 #include "signalrclient/hub_exception.h"
 #include "signalrclient/signalr_exception.h"
@@ -1201,6 +1202,47 @@ TEST(send, creates_correct_payload)
     ASSERT_EQ("{\"arguments\":[],\"target\":\"method\",\"type\":1}\x1e", payload);
 }
 
+TEST(send_latest, creates_correct_payload)
+{
+    std::string payload;
+    bool handshakeReceived = false;
+
+    auto websocket_client = create_test_websocket_client(
+        /* send function */[&payload, &handshakeReceived](const std::string& m, std::function<void(std::exception_ptr)> callback)
+        {
+            if (handshakeReceived)
+            {
+                payload = m;
+                callback(nullptr);
+                return;
+            }
+            handshakeReceived = true;
+            callback(nullptr);
+        });
+
+    auto hub_connection = create_hub_connection(websocket_client);
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    hub_connection.send_latest("temperature", "sensor1", std::vector<signalr::value>{ 21.5 }, [&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    mre.get();
+
+    ASSERT_EQ("{\"arguments\":[21.5],\"target\":\"temperature\",\"type\":1}\x1e", payload);
+}
+
 TEST(send, does_not_wait_for_server_response)
 {
     auto websocket_client = create_test_websocket_client();
@@ -1369,6 +1411,169 @@ TEST(invoke, invoke_returns_value_returned_from_the_server)
     ASSERT_EQ("abc", result.as_string());
 }
 
+TEST(invoke, invoke_callback_can_take_ownership_of_the_result)
+{
+    auto websocket_client = create_test_websocket_client();
+
+    auto hub_connection = create_hub_connection(websocket_client);
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    signalr::value owned_result;
+    auto invoke_mre = manual_reset_event<void>();
+    hub_connection.invoke("method", std::vector<signalr::value>(), [&invoke_mre, &owned_result](signalr::value&& message, std::exception_ptr exception)
+    {
+        owned_result = std::move(message);
+        invoke_mre.set(exception);
+    });
+
+    websocket_client->receive_message("{ \"type\": 3, \"invocationId\": \"0\", \"result\": [1, \"abc\"] }\x1e");
+
+    invoke_mre.get();
+
+    ASSERT_TRUE(owned_result.is_array());
+    ASSERT_EQ(2, owned_result.as_array().size());
+    ASSERT_EQ("abc", owned_result.as_array()[1].as_string());
+}
+
+TEST(invoke, invoke_with_timeout_completes_with_error_when_no_result_arrives)
+{
+    auto websocket_client = create_test_websocket_client();
+
+    auto hub_connection = create_hub_connection(websocket_client);
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    hub_connection.invoke("method", std::vector<signalr::value>(), [&mre](const signalr::value&, std::exception_ptr exception)
+    {
+        mre.set(exception);
+    }, std::chrono::milliseconds(10));
+
+    try
+    {
+        mre.get();
+        ASSERT_TRUE(false); // exception expected but not thrown
+    }
+    catch (const hub_exception&)
+    {
+        ASSERT_TRUE(false) << "a local timeout must not look like an error returned by the server";
+    }
+    catch (const signalr_exception& e)
+    {
+        ASSERT_STREQ("invocation timed out before a result was received", e.what());
+    }
+
+    // a late completion is ignored
+    websocket_client->receive_message("{ \"type\": 3, \"invocationId\": \"0\", \"result\": 42 }\x1e");
+    ASSERT_EQ(connection_state::connected, hub_connection.get_connection_state());
+}
+
+TEST(invoke, invoke_completes_with_error_when_canceled)
+{
+    auto websocket_client = create_test_websocket_client();
+
+    auto hub_connection = create_hub_connection(websocket_client);
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    auto cts = std::make_shared<cancellation_token_source>();
+    std::atomic<int> invocation_count(0);
+    hub_connection.invoke("method", std::vector<signalr::value>(), [&mre, &invocation_count](const signalr::value&, std::exception_ptr exception)
+    {
+        invocation_count++;
+        mre.set(exception);
+    }, get_cancellation_token(cts));
+
+    cts->cancel();
+
+    ASSERT_THROW(mre.get(), canceled_exception);
+
+    // the entry was removed so the completion doesn't reach the callback again
+    auto invoke_mre = manual_reset_event<void>();
+    hub_connection.invoke("method", std::vector<signalr::value>(), [&invoke_mre](const signalr::value&, std::exception_ptr exception)
+    {
+        invoke_mre.set(exception);
+    });
+
+    websocket_client->receive_message("{ \"type\": 3, \"invocationId\": \"0\", \"result\": 42 }\x1e");
+    websocket_client->receive_message("{ \"type\": 3, \"invocationId\": \"1\", \"result\": 42 }\x1e");
+
+    invoke_mre.get();
+    ASSERT_EQ(1, invocation_count.load());
+}
+
+TEST(invoke, token_shared_by_invocations_only_cancels_the_pending_ones)
+{
+    auto websocket_client = create_test_websocket_client();
+
+    auto hub_connection = create_hub_connection(websocket_client);
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    auto cts = std::make_shared<cancellation_token_source>();
+    std::atomic<int> completed_count(0);
+    auto completed_mre = manual_reset_event<void>();
+    hub_connection.invoke("method", std::vector<signalr::value>(), [&completed_mre, &completed_count](const signalr::value&, std::exception_ptr exception)
+    {
+        completed_count++;
+        completed_mre.set(exception);
+    }, get_cancellation_token(cts));
+
+    websocket_client->receive_message("{ \"type\": 3, \"invocationId\": \"0\", \"result\": 42 }\x1e");
+    completed_mre.get();
+
+    auto pending_mre = manual_reset_event<void>();
+    hub_connection.invoke("method", std::vector<signalr::value>(), [&pending_mre](const signalr::value&, std::exception_ptr exception)
+    {
+        pending_mre.set(exception);
+    }, get_cancellation_token(cts));
+
+    cts->cancel();
+
+    ASSERT_THROW(pending_mre.get(), canceled_exception);
+    ASSERT_EQ(1, completed_count.load());
+}
+
 TEST(invoke, invoke_propagates_errors_from_server_as_hub_exceptions)
 {
     auto websocket_client = create_test_websocket_client();
@@ -1434,12 +1639,87 @@ TEST(invoke, unblocks_task_when_server_completes_call)
     mre.get();
 }
 
-TEST(receive, logs_if_callback_for_given_id_not_found)
+namespace
 {
-    auto websocket_client = create_test_websocket_client();
+    struct stream_read_result
+    {
+        signalr::value item;
+        bool completed;
+        std::exception_ptr exception;
+    };
 
-    std::shared_ptr<log_writer> writer(std::make_shared<memory_log_writer>());
-    auto hub_connection = create_hub_connection(websocket_client, writer, trace_level::info);
+    stream_read_result read_next(stream_reader& reader)
+    {
+        auto result = std::make_shared<std::promise<stream_read_result>>();
+        reader.next([result](signalr::value&& item, bool completed, std::exception_ptr exception)
+        {
+            result->set_value(stream_read_result{ std::move(item), completed, exception });
+        });
+
+        auto future = result->get_future();
+        if (future.wait_for(std::chrono::seconds(5)) != std::future_status::ready)
+        {
+            throw std::runtime_error("timed out waiting for the next stream item");
+        }
+        return future.get();
+    }
+
+    std::shared_ptr<test_websocket_client> create_recording_websocket_client(std::shared_ptr<std::vector<std::string>> payloads,
+        std::shared_ptr<std::mutex> payloads_lock)
+    {
+        return create_test_websocket_client(
+            /* send function */[payloads, payloads_lock](const std::string& m, std::function<void(std::exception_ptr)> callback)
+            {
+                {
+                    std::lock_guard<std::mutex> lock(*payloads_lock);
+                    payloads->push_back(m);
+                }
+                callback(nullptr);
+            });
+    }
+
+    // sends complete asynchronously so the server's response can arrive before the request was recorded
+    void wait_for_payloads(const std::shared_ptr<std::vector<std::string>>& payloads, const std::shared_ptr<std::mutex>& payloads_lock, size_t count)
+    {
+        for (auto i = 0; i < 500; i++)
+        {
+            {
+                std::lock_guard<std::mutex> lock(*payloads_lock);
+                if (payloads->size() >= count)
+                {
+                    return;
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    // the transport coalesces messages queued behind an in-progress send, so split the recorded sends back into messages
+    std::vector<std::string> split_records(const std::vector<std::string>& payloads)
+    {
+        std::vector<std::string> records;
+        for (auto& payload : payloads)
+        {
+            size_t start = 0;
+            while (start < payload.size())
+            {
+                auto end = payload.find('\x1e', start);
+                end = end == std::string::npos ? payload.size() : end + 1;
+                records.push_back(payload.substr(start, end - start));
+                start = end;
+            }
+        }
+        return records;
+    }
+}
+
+TEST(stream, stream_sends_stream_invocation_and_reads_items_until_completion)
+{
+    auto payloads = std::make_shared<std::vector<std::string>>();
+    auto payloads_lock = std::make_shared<std::mutex>();
+    auto websocket_client = create_recording_websocket_client(payloads, payloads_lock);
+
+    auto hub_connection = create_hub_connection(websocket_client);
 
     auto mre = manual_reset_event<void>();
     hub_connection.start([&mre](std::exception_ptr exception)
@@ -1453,34 +1733,43 @@ TEST(receive, logs_if_callback_for_given_id_not_found)
 
     mre.get();
 
-    websocket_client->receive_message("{ \"type\": 3, \"invocationId\": \"0\" }\x1e");
+    auto reader = hub_connection.stream("method", std::vector<signalr::value>{ signalr::value(10.0) });
 
-    // hack? blocks until previous message has been processed
-    websocket_client->receive_message("{ \"type\": 6 }\x1e");
+    websocket_client->receive_message("{ \"type\": 2, \"invocationId\": \"0\", \"item\": 1 }\x1e{ \"type\": 2, \"invocationId\": \"0\", \"item\": \"two\" }\x1e"
+        "{ \"type\": 3, \"invocationId\": \"0\" }\x1e");
 
-    auto log_entries = std::dynamic_pointer_cast<memory_log_writer>(writer)->get_log_entries();
+    auto result = read_next(reader);
+    ASSERT_FALSE(result.completed);
+    ASSERT_EQ(1.0, result.item.as_double());
 
-    ASSERT_TRUE(has_log_entry("[info     ] no callback found for id: 0\n", log_entries)) << dump_vector(log_entries);
+    result = read_next(reader);
+    ASSERT_FALSE(result.completed);
+    ASSERT_EQ("two", result.item.as_string());
+
+    result = read_next(reader);
+    ASSERT_TRUE(result.completed);
+    ASSERT_EQ(nullptr, result.exception);
+
+    // reading past the end keeps reporting completion
+    ASSERT_TRUE(read_next(reader).completed);
+
+    wait_for_payloads(payloads, payloads_lock, 2);
+    std::lock_guard<std::mutex> lock(*payloads_lock);
+    ASSERT_EQ(2, payloads->size());
+    ASSERT_EQ("{\"arguments\":[10],\"invocationId\":\"0\",\"target\":\"method\",\"type\":4}\x1e", (*payloads)[1]);
 }
 
-TEST(receive, closes_if_error_from_parsing)
+TEST(stream, stream_reports_error_from_server_after_buffered_items)
 {
     auto websocket_client = create_test_websocket_client();
 
-    std::shared_ptr<log_writer> writer(std::make_shared<memory_log_writer>());
-    auto hub_connection = create_hub_connection(websocket_client, writer, trace_level::info);
-
-    auto disconnect_mre = manual_reset_event<void>();
-    hub_connection.set_disconnected([&disconnect_mre](std::exception_ptr ex)
-        {
-            disconnect_mre.set(ex);
-        });
+    auto hub_connection = create_hub_connection(websocket_client);
 
     auto mre = manual_reset_event<void>();
     hub_connection.start([&mre](std::exception_ptr exception)
-        {
-            mre.set(exception);
-        });
+    {
+        mre.set(exception);
+    });
 
     ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
     ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
@@ -1488,36 +1777,797 @@ TEST(receive, closes_if_error_from_parsing)
 
     mre.get();
 
-    websocket_client->receive_message("{ \"type\": 3, \"invocationId\": \"0\": \"bad\" }\x1e");
+    auto reader = hub_connection.stream("method");
+
+    websocket_client->receive_message("{ \"type\": 2, \"invocationId\": \"0\", \"item\": 1 }\x1e{ \"type\": 3, \"invocationId\": \"0\", \"error\": \"Ooops\" }\x1e");
 
+    auto result = read_next(reader);
+    ASSERT_FALSE(result.completed);
+    ASSERT_EQ(1.0, result.item.as_double());
+
+    result = read_next(reader);
+    ASSERT_TRUE(result.completed);
     try
     {
-        disconnect_mre.get();
-        ASSERT_TRUE(false);
+        std::rethrow_exception(result.exception);
     }
-    catch (const std::exception& ex)
+    catch (const hub_exception& e)
     {
-        ASSERT_STREQ("* Line 1, Column 33\n  Missing ',' or '}' in object declaration\n", ex.what());
+        ASSERT_STREQ("Ooops", e.what());
     }
-
-    ASSERT_EQ(connection_state::disconnected, hub_connection.get_connection_state());
 }
 
-TEST(invoke_void, invoke_creates_runtime_error)
+TEST(stream, destroying_reader_cancels_the_stream_on_the_server)
 {
-   auto websocket_client = create_test_websocket_client();
+    auto payloads = std::make_shared<std::vector<std::string>>();
+    auto payloads_lock = std::make_shared<std::mutex>();
+    auto cancel_sent = std::make_shared<manual_reset_event<void>>();
+    auto websocket_client = create_test_websocket_client(
+        /* send function */[payloads, payloads_lock, cancel_sent](const std::string& m, std::function<void(std::exception_ptr)> callback)
+        {
+            {
+                std::lock_guard<std::mutex> lock(*payloads_lock);
+                payloads->push_back(m);
+            }
+            if (m.find("\"type\":5") != std::string::npos)
+            {
+                cancel_sent->set();
+            }
+            callback(nullptr);
+        });
 
-   auto hub_connection = create_hub_connection(websocket_client);
+    auto hub_connection = create_hub_connection(websocket_client);
 
-   auto mre = manual_reset_event<void>();
-   hub_connection.start([&mre](std::exception_ptr exception)
-   {
-       mre.set(exception);
-   });
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
 
-   ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
-   ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
-   websocket_client->receive_message("{ }\x1e");
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    {
+        auto reader = hub_connection.stream("method");
+        websocket_client->receive_message("{ \"type\": 2, \"invocationId\": \"0\", \"item\": 1 }\x1e");
+        ASSERT_EQ(1.0, read_next(reader).item.as_double());
+    }
+
+    cancel_sent->get();
+
+    {
+        std::lock_guard<std::mutex> lock(*payloads_lock);
+        ASSERT_EQ("{\"invocationId\":\"0\",\"type\":5}\x1e", split_records(*payloads).back());
+    }
+
+    // items still in flight for the canceled stream are dropped
+    websocket_client->receive_message("{ \"type\": 2, \"invocationId\": \"0\", \"item\": 2 }\x1e");
+    ASSERT_EQ(connection_state::connected, hub_connection.get_connection_state());
+}
+
+TEST(stream, full_buffer_stops_reading_from_the_connection)
+{
+    auto websocket_client = create_test_websocket_client();
+
+    auto hub_connection = create_hub_connection(websocket_client);
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    auto reader = hub_connection.stream("method", std::vector<signalr::value>(), 1);
+
+    websocket_client->receive_message("{ \"type\": 2, \"invocationId\": \"0\", \"item\": 1 }\x1e{ \"type\": 2, \"invocationId\": \"0\", \"item\": 2 }\x1e"
+        "{ \"type\": 2, \"invocationId\": \"0\", \"item\": 3 }\x1e");
+
+    // the next message can only be delivered once the receive loop asks for it, the full buffer paused the transport so it won't
+    // until the reader freed a slot
+    std::atomic<bool> completion_delivered(false);
+    std::thread completion_thread([&websocket_client, &completion_delivered]()
+    {
+        websocket_client->receive_message("{ \"type\": 3, \"invocationId\": \"0\" }\x1e");
+        completion_delivered = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    ASSERT_FALSE(completion_delivered.load());
+
+    ASSERT_EQ(1.0, read_next(reader).item.as_double());
+    ASSERT_EQ(2.0, read_next(reader).item.as_double());
+    ASSERT_EQ(3.0, read_next(reader).item.as_double());
+
+    completion_thread.join();
+    ASSERT_TRUE(completion_delivered.load());
+
+    ASSERT_TRUE(read_next(reader).completed);
+}
+
+TEST(stream, full_buffer_does_not_block_the_rest_of_the_message)
+{
+    auto websocket_client = create_test_websocket_client();
+
+    auto hub_connection = create_hub_connection(websocket_client);
+
+    auto handler_called = std::make_shared<manual_reset_event<void>>();
+    hub_connection.on("method", [handler_called](const std::vector<signalr::value>&)
+    {
+        handler_called->set();
+    });
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    auto reader = hub_connection.stream("method", std::vector<signalr::value>(), 1);
+
+    // the invocation after the items is dispatched even though nothing was read from the full buffer yet
+    websocket_client->receive_message("{ \"type\": 2, \"invocationId\": \"0\", \"item\": 1 }\x1e{ \"type\": 2, \"invocationId\": \"0\", \"item\": 2 }\x1e"
+        "{ \"type\": 1, \"target\": \"method\", \"arguments\": [] }\x1e");
+
+    handler_called->get();
+
+    ASSERT_EQ(1.0, read_next(reader).item.as_double());
+    ASSERT_EQ(2.0, read_next(reader).item.as_double());
+}
+
+TEST(stream, stream_fails_when_connection_stops)
+{
+    auto websocket_client = create_test_websocket_client();
+
+    auto hub_connection = create_hub_connection(websocket_client);
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    auto reader = hub_connection.stream("method");
+
+    hub_connection.stop([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+    mre.get();
+
+    auto result = read_next(reader);
+    ASSERT_TRUE(result.completed);
+    try
+    {
+        std::rethrow_exception(result.exception);
+    }
+    catch (const hub_exception& e)
+    {
+        ASSERT_STREQ("connection was stopped before invocation result was received", e.what());
+    }
+}
+
+TEST(upload, upload_sends_chunks_and_completes_the_stream)
+{
+    auto payloads = std::make_shared<std::vector<std::string>>();
+    auto payloads_lock = std::make_shared<std::mutex>();
+    auto stream_completed = std::make_shared<manual_reset_event<void>>();
+    auto websocket_client = create_test_websocket_client(
+        /* send function */[payloads, payloads_lock, stream_completed](const std::string& m, std::function<void(std::exception_ptr)> callback)
+        {
+            {
+                std::lock_guard<std::mutex> lock(*payloads_lock);
+                payloads->push_back(m);
+            }
+            if (m.find("\"type\":3") != std::string::npos)
+            {
+                stream_completed->set();
+            }
+            callback(nullptr);
+        });
+
+    auto hub_connection = create_hub_connection(websocket_client);
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    auto position = std::make_shared<uint8_t>(0);
+    auto invoke_mre = manual_reset_event<signalr::value>();
+    hub_connection.upload("method", std::vector<signalr::value>{ signalr::value("capture") },
+        [position](uint8_t* buffer, size_t buffer_size)
+        {
+            size_t written = 0;
+            while (written < buffer_size && *position < 10)
+            {
+                buffer[written++] = (*position)++;
+            }
+            return written;
+        },
+        [&invoke_mre](signalr::value&& result, std::exception_ptr exception)
+        {
+            if (exception)
+            {
+                invoke_mre.set(exception);
+            }
+            else
+            {
+                invoke_mre.set(std::move(result));
+            }
+        }, 4, 1);
+
+    stream_completed->get();
+
+    websocket_client->receive_message("{ \"type\": 3, \"invocationId\": \"0\", \"result\": 10 }\x1e");
+    ASSERT_EQ(10.0, invoke_mre.get().as_double());
+
+    std::lock_guard<std::mutex> lock(*payloads_lock);
+    auto records = split_records(*payloads);
+    ASSERT_EQ(6, records.size());
+    ASSERT_EQ("{\"arguments\":[\"capture\"],\"invocationId\":\"0\",\"streamIds\":[\"0\"],\"target\":\"method\",\"type\":1}\x1e", records[1]);
+    ASSERT_EQ("{\"invocationId\":\"0\",\"item\":\"AAECAw==\",\"type\":2}\x1e", records[2]);
+    ASSERT_EQ("{\"invocationId\":\"0\",\"item\":\"BAUGBw==\",\"type\":2}\x1e", records[3]);
+    ASSERT_EQ("{\"invocationId\":\"0\",\"item\":\"CAk=\",\"type\":2}\x1e", records[4]);
+    ASSERT_EQ("{\"invocationId\":\"0\",\"type\":3}\x1e", records[5]);
+}
+
+TEST(upload, upload_limits_chunks_in_flight)
+{
+    // the stream items in each held send along with the send's callback
+    auto pending_sends = std::make_shared<std::vector<std::pair<int, std::function<void(std::exception_ptr)>>>>();
+    auto pending_sends_lock = std::make_shared<std::mutex>();
+    auto websocket_client = create_test_websocket_client(
+        /* send function */[pending_sends, pending_sends_lock](const std::string& m, std::function<void(std::exception_ptr)> callback)
+        {
+            auto stream_items = 0;
+            for (auto position = m.find("\"type\":2"); position != std::string::npos; position = m.find("\"type\":2", position + 1))
+            {
+                stream_items++;
+            }
+
+            if (stream_items > 0)
+            {
+                // hold on to stream items to simulate a slow network
+                std::lock_guard<std::mutex> lock(*pending_sends_lock);
+                pending_sends->push_back(std::make_pair(stream_items, callback));
+                return;
+            }
+            callback(nullptr);
+        });
+
+    auto hub_connection = create_hub_connection(websocket_client);
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    auto produced_chunks = std::make_shared<std::atomic<int>>(0);
+    hub_connection.upload("method", std::vector<signalr::value>(),
+        [produced_chunks](uint8_t* buffer, size_t buffer_size)
+        {
+            (*produced_chunks)++;
+            memset(buffer, 0x2a, buffer_size);
+            return buffer_size;
+        },
+        [](const signalr::value&, std::exception_ptr) {}, 1024, 2);
+
+    auto wait_for_chunks = [&produced_chunks](int expected)
+    {
+        for (auto i = 0; i < 100 && produced_chunks->load() < expected; i++)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    };
+
+    wait_for_chunks(2);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    ASSERT_EQ(2, produced_chunks->load());
+
+    // the transport may have coalesced both chunks into one send, every chunk that completes frees a slot for a new one
+    std::pair<int, std::function<void(std::exception_ptr)>> send;
+    {
+        std::lock_guard<std::mutex> lock(*pending_sends_lock);
+        ASSERT_EQ(1, pending_sends->size());
+        send = pending_sends->front();
+        pending_sends->erase(pending_sends->begin());
+    }
+    send.second(nullptr);
+
+    wait_for_chunks(2 + send.first);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    ASSERT_EQ(2 + send.first, produced_chunks->load());
+
+    hub_connection.stop([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+    mre.get();
+
+    std::lock_guard<std::mutex> lock(*pending_sends_lock);
+    for (auto& pending_send : *pending_sends)
+    {
+        pending_send.second(std::make_exception_ptr(std::runtime_error("stopped")));
+    }
+}
+
+TEST(upload, producer_exception_completes_the_stream_with_an_error)
+{
+    auto payloads = std::make_shared<std::vector<std::string>>();
+    auto payloads_lock = std::make_shared<std::mutex>();
+    auto stream_completed = std::make_shared<manual_reset_event<void>>();
+    auto websocket_client = create_test_websocket_client(
+        /* send function */[payloads, payloads_lock, stream_completed](const std::string& m, std::function<void(std::exception_ptr)> callback)
+        {
+            {
+                std::lock_guard<std::mutex> lock(*payloads_lock);
+                payloads->push_back(m);
+            }
+            if (m.find("\"type\":3") != std::string::npos)
+            {
+                stream_completed->set();
+            }
+            callback(nullptr);
+        });
+
+    auto hub_connection = create_hub_connection(websocket_client);
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    hub_connection.upload("method", std::vector<signalr::value>(),
+        [](uint8_t*, size_t) -> size_t
+        {
+            throw std::runtime_error("sensor unplugged");
+        });
+
+    stream_completed->get();
+
+    std::lock_guard<std::mutex> lock(*payloads_lock);
+    ASSERT_EQ("{\"error\":\"upload producer failed: sensor unplugged\",\"invocationId\":\"0\",\"type\":3}\x1e", split_records(*payloads).back());
+}
+
+TEST(send_batch, sends_all_calls_in_a_single_payload_and_routes_results)
+{
+    auto payloads = std::make_shared<std::vector<std::string>>();
+    auto payloads_lock = std::make_shared<std::mutex>();
+    auto websocket_client = create_recording_websocket_client(payloads, payloads_lock);
+
+    auto hub_connection = create_hub_connection(websocket_client);
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    auto first_mre = manual_reset_event<signalr::value>();
+    auto second_mre = manual_reset_event<signalr::value>();
+    signalr::hub_batch batch;
+    batch.send("notify", std::vector<signalr::value>{ signalr::value(1.0) })
+        .invoke("first", std::vector<signalr::value>(), [&first_mre](signalr::value&& result, std::exception_ptr exception)
+        {
+            if (exception) { first_mre.set(exception); } else { first_mre.set(std::move(result)); }
+        })
+        .invoke("second", std::vector<signalr::value>(), [&second_mre](signalr::value&& result, std::exception_ptr exception)
+        {
+            if (exception) { second_mre.set(exception); } else { second_mre.set(std::move(result)); }
+        });
+    ASSERT_EQ(3u, batch.size());
+
+    auto batch_mre = manual_reset_event<void>();
+    hub_connection.send_batch(std::move(batch), [&batch_mre](std::exception_ptr exception)
+    {
+        batch_mre.set(exception);
+    });
+    batch_mre.get();
+
+    {
+        std::lock_guard<std::mutex> lock(*payloads_lock);
+        ASSERT_EQ(2u, payloads->size());
+        ASSERT_EQ(
+            "{\"arguments\":[1],\"target\":\"notify\",\"type\":1}\x1e"
+            "{\"arguments\":[],\"invocationId\":\"0\",\"target\":\"first\",\"type\":1}\x1e"
+            "{\"arguments\":[],\"invocationId\":\"1\",\"target\":\"second\",\"type\":1}\x1e", (*payloads)[1]);
+    }
+
+    websocket_client->receive_message("{ \"type\": 3, \"invocationId\": \"1\", \"result\": \"two\" }\x1e"
+        "{ \"type\": 3, \"invocationId\": \"0\", \"result\": 1 }\x1e");
+
+    ASSERT_EQ("two", second_mre.get().as_string());
+    ASSERT_EQ(1.0, first_mre.get().as_double());
+}
+
+TEST(telemetry_aggregator, sends_buffered_samples_in_one_invocation_per_target)
+{
+    auto payloads = std::make_shared<std::vector<std::string>>();
+    auto payloads_lock = std::make_shared<std::mutex>();
+    auto websocket_client = create_recording_websocket_client(payloads, payloads_lock);
+    auto hub_connection = create_hub_connection(websocket_client);
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    {
+        signalr_client_config config;
+        telemetry_aggregator aggregator(hub_connection, config.get_scheduler(), std::chrono::minutes(1), 2);
+
+        aggregator.add("status", signalr::value("idle"));
+        // reaching max samples sends right away
+        aggregator.add("temperature", 1.0);
+        aggregator.add("temperature", 2.0);
+        wait_for_payloads(payloads, payloads_lock, 2);
+
+        aggregator.add("status", signalr::value(true));
+        // the rest is sent when the aggregator goes away
+    }
+
+    wait_for_payloads(payloads, payloads_lock, 3);
+
+    std::lock_guard<std::mutex> lock(*payloads_lock);
+    auto records = split_records(*payloads);
+    ASSERT_EQ(3, records.size());
+    ASSERT_EQ("{\"protocol\":\"json\",\"version\":1}\x1e", records[0]);
+    // two little-endian doubles, base64 encoded by the json protocol
+    ASSERT_EQ("{\"arguments\":[\"AAAAAAAA8D8AAAAAAAAAQA==\"],\"target\":\"temperature\",\"type\":1}\x1e", records[1]);
+    ASSERT_EQ("{\"arguments\":[[\"idle\",true]],\"target\":\"status\",\"type\":1}\x1e", records[2]);
+}
+
+TEST(telemetry_aggregator, sends_samples_once_the_window_elapsed)
+{
+    auto payloads = std::make_shared<std::vector<std::string>>();
+    auto payloads_lock = std::make_shared<std::mutex>();
+    auto websocket_client = create_recording_websocket_client(payloads, payloads_lock);
+    auto hub_connection = create_hub_connection(websocket_client);
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    signalr_client_config config;
+    auto sent = std::make_shared<manual_reset_event<void>>();
+    telemetry_aggregator aggregator(hub_connection, config.get_scheduler(), std::chrono::milliseconds(50), 64,
+        [sent](std::exception_ptr exception) { sent->set(exception); });
+
+    aggregator.add("temperature", 3.0);
+    sent->get();
+
+    std::lock_guard<std::mutex> lock(*payloads_lock);
+    auto records = split_records(*payloads);
+    ASSERT_EQ(2, records.size());
+    ASSERT_EQ("{\"arguments\":[\"AAAAAAAACEA=\"],\"target\":\"temperature\",\"type\":1}\x1e", records[1]);
+}
+
+TEST(send_batch, failed_send_fails_every_invocation_in_the_batch)
+{
+    auto websocket_client = create_test_websocket_client(
+        /* send function */[](const std::string& m, std::function<void(std::exception_ptr)> callback)
+        {
+            if (m.find("\"target\"") != std::string::npos)
+            {
+                callback(std::make_exception_ptr(std::runtime_error("send failed")));
+                return;
+            }
+            callback(nullptr);
+        });
+
+    auto hub_connection = create_hub_connection(websocket_client);
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    auto first_mre = manual_reset_event<signalr::value>();
+    auto second_mre = manual_reset_event<signalr::value>();
+    signalr::hub_batch batch;
+    batch.invoke("first", std::vector<signalr::value>(), [&first_mre](signalr::value&& result, std::exception_ptr exception)
+        {
+            if (exception) { first_mre.set(exception); } else { first_mre.set(std::move(result)); }
+        })
+        .invoke("second", std::vector<signalr::value>(), [&second_mre](signalr::value&& result, std::exception_ptr exception)
+        {
+            if (exception) { second_mre.set(exception); } else { second_mre.set(std::move(result)); }
+        });
+
+    auto batch_mre = manual_reset_event<void>();
+    hub_connection.send_batch(std::move(batch), [&batch_mre](std::exception_ptr exception)
+    {
+        batch_mre.set(exception);
+    });
+
+    for (auto event : { &first_mre, &second_mre })
+    {
+        try
+        {
+            event->get();
+            ASSERT_TRUE(false);
+        }
+        catch (const std::runtime_error& e)
+        {
+            ASSERT_STREQ("send failed", e.what());
+        }
+    }
+
+    try
+    {
+        batch_mre.get();
+        ASSERT_TRUE(false);
+    }
+    catch (const std::runtime_error& e)
+    {
+        ASSERT_STREQ("send failed", e.what());
+    }
+}
+
+TEST(try_send, fails_fast_above_high_watermark_and_signals_writable_below_low_watermark)
+{
+    auto held_sends = std::make_shared<std::vector<std::function<void(std::exception_ptr)>>>();
+    auto held_sends_lock = std::make_shared<std::mutex>();
+    auto websocket_client = create_test_websocket_client(
+        /* send function */[held_sends, held_sends_lock](const std::string& m, std::function<void(std::exception_ptr)> callback)
+        {
+            if (m.find("\"target\":\"method\"") != std::string::npos)
+            {
+                // simulate a slow network
+                std::lock_guard<std::mutex> lock(*held_sends_lock);
+                held_sends->push_back(callback);
+                return;
+            }
+            callback(nullptr);
+        });
+
+    signalr_client_config config;
+    config.set_outbound_buffer_messages(3, 1);
+    auto hub_connection = create_hub_connection(websocket_client);
+    hub_connection.set_client_config(config);
+
+    auto writable = std::make_shared<manual_reset_event<void>>();
+    hub_connection.set_writable([writable]()
+    {
+        writable->set();
+    });
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    // the handshake is written first so once this completed nothing else is outstanding
+    hub_connection.send("warmup", std::vector<signalr::value>(), [&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+    mre.get();
+
+    auto sent = std::make_shared<std::atomic<int>>(0);
+    auto on_sent = [sent](std::exception_ptr exception)
+    {
+        if (!exception)
+        {
+            (*sent)++;
+        }
+    };
+
+    ASSERT_TRUE(hub_connection.try_send("method", std::vector<signalr::value>(), on_sent));
+    ASSERT_TRUE(hub_connection.try_send("method", std::vector<signalr::value>(), on_sent));
+    ASSERT_TRUE(hub_connection.try_send("method", std::vector<signalr::value>(), on_sent));
+    ASSERT_FALSE(hub_connection.try_send("method", std::vector<signalr::value>(), on_sent));
+
+    // complete the held sends until everything drained
+    while (sent->load() < 3)
+    {
+        std::function<void(std::exception_ptr)> callback;
+        {
+            std::lock_guard<std::mutex> lock(*held_sends_lock);
+            if (!held_sends->empty())
+            {
+                callback = held_sends->front();
+                held_sends->erase(held_sends->begin());
+            }
+        }
+
+        if (callback)
+        {
+            callback(nullptr);
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    writable->get();
+    ASSERT_TRUE(hub_connection.try_send("method", std::vector<signalr::value>(), on_sent));
+
+    hub_connection.stop([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+    mre.get();
+
+    std::lock_guard<std::mutex> lock(*held_sends_lock);
+    for (auto& callback : *held_sends)
+    {
+        callback(std::make_exception_ptr(std::runtime_error("stopped")));
+    }
+}
+
+TEST(try_send, returns_false_on_a_moved_from_hub_connection)
+{
+    auto hub_connection = create_hub_connection();
+    auto moved_to = std::move(hub_connection);
+
+    auto called = false;
+    ASSERT_FALSE(hub_connection.try_send("method", std::vector<signalr::value>(), [&called](std::exception_ptr) { called = true; }));
+    ASSERT_FALSE(called);
+}
+
+TEST(receive, logs_if_callback_for_given_id_not_found)
+{
+    auto websocket_client = create_test_websocket_client();
+
+    std::shared_ptr<log_writer> writer(std::make_shared<memory_log_writer>());
+    auto hub_connection = create_hub_connection(websocket_client, writer, trace_level::info);
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    websocket_client->receive_message("{ \"type\": 3, \"invocationId\": \"0\" }\x1e");
+
+    // hack? blocks until previous message has been processed
+    websocket_client->receive_message("{ \"type\": 6 }\x1e");
+
+    auto log_entries = std::dynamic_pointer_cast<memory_log_writer>(writer)->get_log_entries();
+
+    ASSERT_TRUE(has_log_entry("[info     ] no callback found for id: 0\n", log_entries)) << dump_vector(log_entries);
+}
+
+TEST(receive, closes_if_error_from_parsing)
+{
+    auto websocket_client = create_test_websocket_client();
+
+    std::shared_ptr<log_writer> writer(std::make_shared<memory_log_writer>());
+    auto hub_connection = create_hub_connection(websocket_client, writer, trace_level::info);
+
+    auto disconnect_mre = manual_reset_event<void>();
+    hub_connection.set_disconnected([&disconnect_mre](std::exception_ptr ex)
+        {
+            disconnect_mre.set(ex);
+        });
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+        {
+            mre.set(exception);
+        });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    websocket_client->receive_message("{ \"type\": 3, \"invocationId\": \"0\": \"bad\" }\x1e");
+
+    try
+    {
+        disconnect_mre.get();
+        ASSERT_TRUE(false);
+    }
+    catch (const std::exception& ex)
+    {
+        ASSERT_STREQ("* Line 1, Column 33\n  Missing ',' or '}' in object declaration\n", ex.what());
+    }
+
+    ASSERT_EQ(connection_state::disconnected, hub_connection.get_connection_state());
+}
+
+TEST(invoke_void, invoke_creates_runtime_error)
+{
+   auto websocket_client = create_test_websocket_client();
+
+   auto hub_connection = create_hub_connection(websocket_client);
+
+   auto mre = manual_reset_event<void>();
+   hub_connection.start([&mre](std::exception_ptr exception)
+   {
+       mre.set(exception);
+   });
+
+   ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+   ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+   websocket_client->receive_message("{ }\x1e");
 
    mre.get();
 
@@ -1532,20 +2582,283 @@ TEST(invoke_void, invoke_creates_runtime_error)
    {
        mre.get();
 
-       ASSERT_TRUE(false); // exception expected but not thrown
-   }
-   catch (const hub_exception & e)
-   {
-       ASSERT_STREQ("Ooops", e.what());
-   }
-}
+       ASSERT_TRUE(false); // exception expected but not thrown
+   }
+   catch (const hub_exception & e)
+   {
+       ASSERT_STREQ("Ooops", e.what());
+   }
+}
+
+TEST(connection_id, can_get_connection_id)
+{
+    auto websocket_client = create_test_websocket_client();
+    auto hub_connection = create_hub_connection(websocket_client);
+
+    ASSERT_EQ("", hub_connection.get_connection_id());
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+    auto connection_id = hub_connection.get_connection_id();
+
+    hub_connection.stop([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    mre.get();
+
+    ASSERT_EQ("f7707523-307d-4cba-9abf-3eef701241e8", connection_id);
+    ASSERT_EQ("f7707523-307d-4cba-9abf-3eef701241e8", hub_connection.get_connection_id());
+}
+
+TEST(on, target_strand_dispatch_keeps_receiving_while_a_handler_is_busy)
+{
+    auto websocket_client = create_test_websocket_client();
+    auto hub_connection = create_hub_connection(websocket_client);
+
+    signalr_client_config config;
+    config.set_handler_dispatch_mode(handler_dispatch_mode::target_strand);
+    hub_connection.set_client_config(config);
+
+    auto release_slow = std::make_shared<manual_reset_event<void>>();
+    hub_connection.on("slow", [release_slow](const std::vector<signalr::value>&)
+    {
+        release_slow->get();
+    });
+
+    auto received = std::make_shared<std::vector<double>>();
+    auto received_lock = std::make_shared<std::mutex>();
+    auto fast_done = std::make_shared<manual_reset_event<void>>();
+    hub_connection.on("fast", [received, received_lock, fast_done](const std::vector<signalr::value>& arguments)
+    {
+        std::lock_guard<std::mutex> lock(*received_lock);
+        received->push_back(arguments[0].as_double());
+        if (received->size() == 3)
+        {
+            fast_done->set();
+        }
+    });
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    websocket_client->receive_message("{ \"type\": 1, \"target\": \"slow\", \"arguments\": [] }\x1e");
+    // with handlers running on the receive thread these would wait for the slow handler
+    websocket_client->receive_message("{ \"type\": 1, \"target\": \"fast\", \"arguments\": [ 1 ] }\x1e");
+    websocket_client->receive_message("{ \"type\": 1, \"target\": \"fast\", \"arguments\": [ 2 ] }\x1e{ \"type\": 1, \"target\": \"fast\", \"arguments\": [ 3 ] }\x1e");
+
+    fast_done->get();
+    release_slow->set();
+
+    std::lock_guard<std::mutex> lock(*received_lock);
+    ASSERT_EQ(std::vector<double>({ 1, 2, 3 }), *received);
+}
+
+TEST(on, receiving_pauses_while_the_handler_backlog_is_above_the_high_watermark)
+{
+    auto websocket_client = create_test_websocket_client();
+    auto hub_connection = create_hub_connection(websocket_client);
+
+    signalr_client_config config;
+    config.set_handler_dispatch_mode(handler_dispatch_mode::connection_strand);
+    config.set_inbound_backlog_messages(2, 1);
+    hub_connection.set_client_config(config);
+
+    auto handler_entered = std::make_shared<manual_reset_event<void>>();
+    auto release = std::make_shared<manual_reset_event<void>>();
+    auto received = std::make_shared<std::atomic<int>>(0);
+    auto all_received = std::make_shared<manual_reset_event<void>>();
+    hub_connection.on("method", [handler_entered, release, received, all_received](const std::vector<signalr::value>&)
+    {
+        if (++*received == 1)
+        {
+            handler_entered->set();
+            release->get();
+        }
+        else if (*received == 4)
+        {
+            all_received->set();
+        }
+    });
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    websocket_client->receive_message(
+        "{ \"type\": 1, \"target\": \"method\", \"arguments\": [] }\x1e"
+        "{ \"type\": 1, \"target\": \"method\", \"arguments\": [] }\x1e"
+        "{ \"type\": 1, \"target\": \"method\", \"arguments\": [] }\x1e");
+
+    handler_entered->get();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    // the handshake and the invocations were received, the backlog reached the high watermark so nothing else was asked for
+    ASSERT_EQ(2, websocket_client->receive_count);
+
+    release->set();
+
+    // only returns once the transport asks for the next message again
+    websocket_client->receive_message("{ \"type\": 1, \"target\": \"method\", \"arguments\": [] }\x1e");
+    all_received->get();
+}
+
+TEST(on, conflation_replaces_invocations_that_were_not_dispatched_yet)
+{
+    auto websocket_client = create_test_websocket_client();
+    auto hub_connection = create_hub_connection(websocket_client);
+
+    signalr_client_config config;
+    config.set_handler_dispatch_mode(handler_dispatch_mode::connection_strand);
+    hub_connection.set_client_config(config);
+
+    auto handler_entered = std::make_shared<manual_reset_event<void>>();
+    auto release = std::make_shared<manual_reset_event<void>>();
+    hub_connection.on("block", [handler_entered, release](const std::vector<signalr::value>&)
+    {
+        handler_entered->set();
+        release->get();
+    });
+
+    auto received = std::make_shared<std::vector<std::string>>();
+    auto received_lock = std::make_shared<std::mutex>();
+    auto done = std::make_shared<manual_reset_event<void>>();
+    hub_connection.on("position", [received, received_lock, done](const std::vector<signalr::value>& arguments)
+    {
+        std::lock_guard<std::mutex> lock(*received_lock);
+        received->push_back(arguments[0].as_string() + std::to_string(static_cast<int>(arguments[1].as_double())));
+        if (received->size() == 3)
+        {
+            done->set();
+        }
+    }, conflation_policy::by_argument(0));
+    hub_connection.on("status", [received, received_lock](const std::vector<signalr::value>& arguments)
+    {
+        std::lock_guard<std::mutex> lock(*received_lock);
+        received->push_back(arguments[0].as_string());
+    }, conflation_policy::latest());
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    mre.get();
+
+    websocket_client->receive_message("{ \"type\": 1, \"target\": \"block\", \"arguments\": [] }\x1e");
+    handler_entered->get();
+
+    websocket_client->receive_message(
+        "{ \"type\": 1, \"target\": \"position\", \"arguments\": [ \"a\", 1 ] }\x1e"
+        "{ \"type\": 1, \"target\": \"status\", \"arguments\": [ \"starting\" ] }\x1e"
+        "{ \"type\": 1, \"target\": \"position\", \"arguments\": [ \"b\", 1 ] }\x1e"
+        "{ \"type\": 1, \"target\": \"position\", \"arguments\": [ \"a\", 2 ] }\x1e"
+        "{ \"type\": 1, \"target\": \"status\", \"arguments\": [ \"running\" ] }\x1e"
+        "{ \"type\": 1, \"target\": \"position\", \"arguments\": [ \"a\", 3 ] }\x1e");
+    // the next receive is only armed once the previous message was processed
+    websocket_client->receive_message("{ \"type\": 6 }\x1e");
+
+    release->set();
+    done->get();
+
+    std::lock_guard<std::mutex> lock(*received_lock);
+    // dispatched in the order the keys were first queued, with the newest arguments
+    ASSERT_EQ(std::vector<std::string>({ "a3", "running", "b1" }), *received);
+}
+
+// delivers everything passed to `deliver_batch` with a single call to the transport's batch handler
+class batching_websocket_client : public persistent_websocket_client
+{
+public:
+    void start(const std::string&, std::function<void(std::exception_ptr)> callback) override
+    {
+        std::thread([callback]() { callback(nullptr); }).detach();
+    }
+
+    void stop(std::function<void(std::exception_ptr)> callback) override
+    {
+        callback(nullptr);
+    }
+
+    void send(const std::string&, signalr::transfer_format, std::function<void(std::exception_ptr)> callback) override
+    {
+        handshake_sent.cancel();
+        callback(nullptr);
+    }
+
+    void on_message(std::function<void(const std::string&, std::exception_ptr)>) override
+    { }
+
+    void on_message_batch(std::function<void(std::vector<std::string>&&)> handler) override
+    {
+        m_batch_handler = handler;
+    }
+
+    void pause_receive() override
+    { }
+
+    void resume_receive() override
+    { }
+
+    void deliver_batch(std::vector<std::string> messages)
+    {
+        m_batch_handler(std::move(messages));
+    }
+
+    cancellation_token_source handshake_sent;
 
-TEST(connection_id, can_get_connection_id)
+private:
+    std::function<void(std::vector<std::string>&&)> m_batch_handler;
+};
+
+TEST(on, messages_received_in_one_batch_are_all_processed_in_order)
 {
-    auto websocket_client = create_test_websocket_client();
-    auto hub_connection = create_hub_connection(websocket_client);
+    auto websocket_client = std::make_shared<batching_websocket_client>();
+    auto hub_connection = hub_connection_builder::create(create_uri())
+        .with_logging(std::make_shared<memory_log_writer>(), trace_level::verbose)
+        .with_http_client_factory(create_test_http_client())
+        .with_websocket_factory([websocket_client](const signalr_client_config&)
+            {
+                return websocket_client;
+            })
+        .build();
 
-    ASSERT_EQ("", hub_connection.get_connection_id());
+    std::vector<int> received;
+    hub_connection.on("method", [&received](const std::vector<signalr::value>& arguments)
+    {
+        received.push_back(static_cast<int>(arguments[0].as_double()));
+    });
 
     auto mre = manual_reset_event<void>();
     hub_connection.start([&mre](std::exception_ptr exception)
@@ -1553,22 +2866,23 @@ TEST(connection_id, can_get_connection_id)
         mre.set(exception);
     });
 
-    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
     ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
-    websocket_client->receive_message("{ }\x1e");
+    // the handshake response and the invocations arrive together
+    websocket_client->deliver_batch({
+        "{ }\x1e",
+        "{ \"type\": 1, \"target\": \"method\", \"arguments\": [ 1 ] }\x1e",
+        "{ \"type\": 1, \"target\": \"method\", \"arguments\": [ 2 ] }\x1e"
+            "{ \"type\": 1, \"target\": \"method\", \"arguments\": [ 3 ] }\x1e" });
 
     mre.get();
-    auto connection_id = hub_connection.get_connection_id();
+
+    ASSERT_EQ(std::vector<int>({ 1, 2, 3 }), received);
 
     hub_connection.stop([&mre](std::exception_ptr exception)
     {
         mre.set(exception);
     });
-
     mre.get();
-
-    ASSERT_EQ("f7707523-307d-4cba-9abf-3eef701241e8", connection_id);
-    ASSERT_EQ("f7707523-307d-4cba-9abf-3eef701241e8", hub_connection.get_connection_id());
 }
 
 TEST(on, event_name_must_not_be_empty_string)
@@ -2182,4 +3496,436 @@ TEST(receive, unknown_message_type_closes_connection)
     {
         ASSERT_STREQ("unknown message type '100' received", ex.what());
     }
-}
\ No newline at end of file
+}
+
+namespace
+{
+    hub_connection create_reconnecting_hub_connection(const std::shared_ptr<test_websocket_client>& websocket_client, const reconnect_policy& policy)
+    {
+        auto hub_connection = create_hub_connection(websocket_client, std::make_shared<memory_log_writer>(), trace_level::none);
+
+        signalr_client_config config;
+        config.set_reconnect_policy(policy);
+        hub_connection.set_client_config(config);
+        return hub_connection;
+    }
+
+    void start_hub_connection(hub_connection& hub_connection, const std::shared_ptr<test_websocket_client>& websocket_client)
+    {
+        auto mre = manual_reset_event<void>();
+        hub_connection.start([&mre](std::exception_ptr exception)
+            {
+                mre.set(exception);
+            });
+
+        ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+        ASSERT_FALSE(websocket_client->handshake_sent.wait(5000));
+        websocket_client->receive_message("{ }\x1e");
+
+        mre.get();
+    }
+
+    // the first connect succeeds, the ones reconnecting fail
+    std::shared_ptr<test_websocket_client> create_unreachable_after_start_websocket_client(const std::shared_ptr<std::atomic<int>>& connects)
+    {
+        return create_test_websocket_client(
+            [](const std::string&, std::function<void(std::exception_ptr)> callback) { callback(nullptr); },
+            [connects](const std::string&, std::function<void(std::exception_ptr)> callback)
+            {
+                if (++(*connects) == 1)
+                {
+                    callback(nullptr);
+                }
+                else
+                {
+                    callback(std::make_exception_ptr(std::runtime_error("connect failed")));
+                }
+            });
+    }
+}
+
+TEST(reconnect, restores_the_connection_keeping_handlers_and_sending_queued_messages)
+{
+    auto sent_lock = std::make_shared<std::mutex>();
+    auto sent = std::make_shared<std::vector<std::string>>();
+    auto handshakes = std::make_shared<int>(0);
+    auto second_handshake = std::make_shared<manual_reset_event<void>>();
+    auto websocket_client = create_test_websocket_client(
+        [sent_lock, sent, handshakes, second_handshake](const std::string& message, std::function<void(std::exception_ptr)> callback)
+        {
+            {
+                std::lock_guard<std::mutex> lock(*sent_lock);
+                sent->push_back(message);
+                if (message.find("\"protocol\"") != std::string::npos && ++(*handshakes) == 2)
+                {
+                    second_handshake->set();
+                }
+            }
+            callback(nullptr);
+        });
+
+    reconnect_policy policy;
+    policy.enabled = true;
+    // the test websocket client is shared by the transports, so the lost one has to be done with it first
+    policy.initial_delay = std::chrono::milliseconds(100);
+    policy.max_delay = std::chrono::milliseconds(100);
+    policy.jitter = 0;
+    auto hub_connection = create_reconnecting_hub_connection(websocket_client, policy);
+
+    auto broadcast = std::make_shared<manual_reset_event<void>>();
+    hub_connection.on("broadcast", [broadcast](const std::vector<signalr::value>&)
+        {
+            broadcast->set();
+        });
+    auto reconnecting = std::make_shared<manual_reset_event<void>>();
+    hub_connection.set_reconnecting([reconnecting](std::exception_ptr exception)
+        {
+            reconnecting->set(exception);
+        });
+    auto reconnected = std::make_shared<manual_reset_event<void>>();
+    hub_connection.set_reconnected([reconnected]()
+        {
+            reconnected->set();
+        });
+    auto disconnected = std::make_shared<std::atomic<bool>>(false);
+    hub_connection.set_disconnected([disconnected](std::exception_ptr)
+        {
+            *disconnected = true;
+        });
+
+    start_hub_connection(hub_connection, websocket_client);
+
+    websocket_client->receive_message(std::make_exception_ptr(std::runtime_error("connection lost")));
+    ASSERT_ANY_THROW(reconnecting->get());
+
+    // queued until the handshake of the new connection completed
+    auto send_mre = manual_reset_event<void>();
+    hub_connection.send("echo", std::vector<signalr::value>{ "queued" }, [&send_mre](std::exception_ptr exception)
+        {
+            send_mre.set(exception);
+        });
+
+    second_handshake->get();
+    ASSERT_EQ(connection_state::reconnecting, hub_connection.get_connection_state());
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    reconnected->get();
+    send_mre.get();
+    ASSERT_EQ(connection_state::connected, hub_connection.get_connection_state());
+    {
+        std::lock_guard<std::mutex> lock(*sent_lock);
+        ASSERT_NE(std::string::npos, sent->back().find("\"queued\"")) << dump_vector(*sent);
+    }
+
+    websocket_client->receive_message("{ \"type\": 1, \"target\": \"broadcast\", \"arguments\": [] }\x1e");
+    broadcast->get();
+    ASSERT_FALSE(*disconnected);
+
+    auto stop_mre = manual_reset_event<void>();
+    hub_connection.stop([&stop_mre](std::exception_ptr exception)
+        {
+            stop_mre.set(exception);
+        });
+    stop_mre.get();
+    ASSERT_TRUE(*disconnected);
+}
+
+TEST(reconnect, invocations_in_flight_fail_while_the_ones_made_while_reconnecting_complete)
+{
+    auto handshakes = std::make_shared<std::atomic<int>>(0);
+    auto second_handshake = std::make_shared<manual_reset_event<void>>();
+    auto websocket_client = create_test_websocket_client(
+        [handshakes, second_handshake](const std::string& message, std::function<void(std::exception_ptr)> callback)
+        {
+            if (message.find("\"protocol\"") != std::string::npos && ++(*handshakes) == 2)
+            {
+                second_handshake->set();
+            }
+            callback(nullptr);
+        });
+
+    reconnect_policy policy;
+    policy.enabled = true;
+    policy.initial_delay = std::chrono::milliseconds(100);
+    policy.max_delay = std::chrono::milliseconds(100);
+    policy.jitter = 0;
+    auto hub_connection = create_reconnecting_hub_connection(websocket_client, policy);
+
+    auto reconnecting = std::make_shared<manual_reset_event<void>>();
+    hub_connection.set_reconnecting([reconnecting](std::exception_ptr exception)
+        {
+            reconnecting->set(exception);
+        });
+
+    start_hub_connection(hub_connection, websocket_client);
+
+    auto in_flight_mre = manual_reset_event<signalr::value>();
+    hub_connection.invoke("method", std::vector<signalr::value>(), [&in_flight_mre](const signalr::value& result, std::exception_ptr exception)
+        {
+            if (exception)
+            {
+                in_flight_mre.set(exception);
+            }
+            else
+            {
+                in_flight_mre.set(result);
+            }
+        });
+
+    websocket_client->receive_message(std::make_exception_ptr(std::runtime_error("connection lost")));
+    ASSERT_ANY_THROW(reconnecting->get());
+
+    // the server doesn't complete invocations made on the lost connection
+    try
+    {
+        in_flight_mre.get();
+        ASSERT_TRUE(false);
+    }
+    catch (const hub_exception& e)
+    {
+        ASSERT_STREQ("connection was stopped before invocation result was received", e.what());
+    }
+
+    auto queued_mre = manual_reset_event<signalr::value>();
+    hub_connection.invoke("method", std::vector<signalr::value>(), [&queued_mre](const signalr::value& result, std::exception_ptr exception)
+        {
+            if (exception)
+            {
+                queued_mre.set(exception);
+            }
+            else
+            {
+                queued_mre.set(result);
+            }
+        });
+
+    second_handshake->get();
+    ASSERT_FALSE(websocket_client->receive_loop_started.wait(5000));
+    websocket_client->receive_message("{ }\x1e");
+
+    websocket_client->receive_message("{ \"type\": 3, \"invocationId\": \"1\", \"result\": 42 }\x1e");
+    ASSERT_EQ(42.0, queued_mre.get().as_double());
+}
+
+TEST(reconnect, gives_up_after_max_attempts)
+{
+    auto connects = std::make_shared<std::atomic<int>>(0);
+    auto websocket_client = create_unreachable_after_start_websocket_client(connects);
+
+    reconnect_policy policy;
+    policy.enabled = true;
+    policy.max_attempts = 2;
+    policy.initial_delay = std::chrono::milliseconds(100);
+    policy.max_delay = std::chrono::milliseconds(100);
+    policy.jitter = 0;
+    policy.max_queued_messages = 1;
+    auto hub_connection = create_reconnecting_hub_connection(websocket_client, policy);
+
+    auto reconnecting = std::make_shared<manual_reset_event<void>>();
+    hub_connection.set_reconnecting([reconnecting](std::exception_ptr)
+        {
+            reconnecting->set();
+        });
+    auto disconnected = std::make_shared<manual_reset_event<void>>();
+    hub_connection.set_disconnected([disconnected](std::exception_ptr exception)
+        {
+            disconnected->set(exception);
+        });
+
+    start_hub_connection(hub_connection, websocket_client);
+
+    websocket_client->receive_message(std::make_exception_ptr(std::runtime_error("connection lost")));
+    reconnecting->get();
+
+    auto queued_mre = manual_reset_event<void>();
+    hub_connection.send("echo", std::vector<signalr::value>{ 1.0 }, [&queued_mre](std::exception_ptr exception)
+        {
+            queued_mre.set(exception);
+        });
+    auto overflow_mre = manual_reset_event<void>();
+    hub_connection.send("echo", std::vector<signalr::value>{ 2.0 }, [&overflow_mre](std::exception_ptr exception)
+        {
+            overflow_mre.set(exception);
+        });
+
+    try
+    {
+        overflow_mre.get();
+        ASSERT_TRUE(false);
+    }
+    catch (const std::exception& ex)
+    {
+        ASSERT_STREQ("the connection is reconnecting and too many messages are queued", ex.what());
+    }
+
+    try
+    {
+        disconnected->get();
+        ASSERT_TRUE(false);
+    }
+    catch (const std::exception& ex)
+    {
+        ASSERT_STREQ("connect failed", ex.what());
+    }
+
+    try
+    {
+        queued_mre.get();
+        ASSERT_TRUE(false);
+    }
+    catch (const std::exception& ex)
+    {
+        ASSERT_STREQ("connection could not be reestablished before the message was sent", ex.what());
+    }
+
+    ASSERT_EQ(3, connects->load());
+    ASSERT_EQ(connection_state::disconnected, hub_connection.get_connection_state());
+}
+
+TEST(reconnect, invoke_timeout_fires_while_reconnecting)
+{
+    auto connects = std::make_shared<std::atomic<int>>(0);
+    auto websocket_client = create_unreachable_after_start_websocket_client(connects);
+
+    reconnect_policy policy;
+    policy.enabled = true;
+    // keeps trying for as long as the test runs
+    policy.max_attempts = 0;
+    policy.initial_delay = std::chrono::milliseconds(100);
+    policy.max_delay = std::chrono::milliseconds(100);
+    policy.jitter = 0;
+    auto hub_connection = create_reconnecting_hub_connection(websocket_client, policy);
+
+    auto reconnecting = std::make_shared<manual_reset_event<void>>();
+    hub_connection.set_reconnecting([reconnecting](std::exception_ptr)
+        {
+            reconnecting->set();
+        });
+
+    start_hub_connection(hub_connection, websocket_client);
+
+    websocket_client->receive_message(std::make_exception_ptr(std::runtime_error("connection lost")));
+    reconnecting->get();
+
+    auto invoke_mre = manual_reset_event<void>();
+    hub_connection.invoke("method", std::vector<signalr::value>(), [&invoke_mre](const signalr::value&, std::exception_ptr exception)
+        {
+            invoke_mre.set(exception);
+        }, std::chrono::milliseconds(10));
+
+    try
+    {
+        invoke_mre.get();
+        ASSERT_TRUE(false);
+    }
+    catch (const signalr_exception& e)
+    {
+        ASSERT_STREQ("invocation timed out before a result was received", e.what());
+    }
+    ASSERT_EQ(connection_state::reconnecting, hub_connection.get_connection_state());
+
+    auto stop_mre = manual_reset_event<void>();
+    hub_connection.stop([&stop_mre](std::exception_ptr exception)
+        {
+            stop_mre.set(exception);
+        });
+    stop_mre.get();
+}
+
+TEST(reconnect, stop_while_reconnecting_fails_queued_messages)
+{
+    auto connects = std::make_shared<std::atomic<int>>(0);
+    auto websocket_client = create_unreachable_after_start_websocket_client(connects);
+
+    reconnect_policy policy;
+    policy.enabled = true;
+    policy.max_attempts = 0;
+    policy.initial_delay = std::chrono::milliseconds(50);
+    policy.max_delay = std::chrono::milliseconds(50);
+    auto hub_connection = create_reconnecting_hub_connection(websocket_client, policy);
+
+    auto reconnecting = std::make_shared<manual_reset_event<void>>();
+    hub_connection.set_reconnecting([reconnecting](std::exception_ptr)
+        {
+            reconnecting->set();
+        });
+    auto disconnects = std::make_shared<std::atomic<int>>(0);
+    hub_connection.set_disconnected([disconnects](std::exception_ptr exception)
+        {
+            ASSERT_EQ(nullptr, exception);
+            ++(*disconnects);
+        });
+
+    start_hub_connection(hub_connection, websocket_client);
+
+    websocket_client->receive_message(std::make_exception_ptr(std::runtime_error("connection lost")));
+    reconnecting->get();
+
+    auto send_mre = manual_reset_event<void>();
+    hub_connection.send("echo", std::vector<signalr::value>{ 1.0 }, [&send_mre](std::exception_ptr exception)
+        {
+            send_mre.set(exception);
+        });
+
+    auto stop_mre = manual_reset_event<void>();
+    hub_connection.stop([&stop_mre](std::exception_ptr exception)
+        {
+            stop_mre.set(exception);
+        });
+    stop_mre.get();
+
+    try
+    {
+        send_mre.get();
+        ASSERT_TRUE(false);
+    }
+    catch (const std::exception& ex)
+    {
+        ASSERT_STREQ("connection was stopped before the message was sent", ex.what());
+    }
+
+    // no attempt scheduled before the stop reconnects
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    ASSERT_EQ(1, disconnects->load());
+    ASSERT_EQ(connection_state::disconnected, hub_connection.get_connection_state());
+}
+
+TEST(reconnect, delay_doubles_up_to_the_max_delay_and_jitter_shortens_it)
+{
+    reconnect_policy policy;
+    policy.initial_delay = std::chrono::milliseconds(100);
+    policy.max_delay = std::chrono::milliseconds(1000);
+    policy.jitter = 0;
+
+    ASSERT_EQ(100, hub_connection_impl::get_reconnect_delay(policy, 1, 0.5).count());
+    ASSERT_EQ(200, hub_connection_impl::get_reconnect_delay(policy, 2, 0.5).count());
+    ASSERT_EQ(800, hub_connection_impl::get_reconnect_delay(policy, 4, 0.5).count());
+    ASSERT_EQ(1000, hub_connection_impl::get_reconnect_delay(policy, 5, 0.5).count());
+    ASSERT_EQ(1000, hub_connection_impl::get_reconnect_delay(policy, 100000, 0.5).count());
+
+    policy.jitter = 0.5;
+    ASSERT_EQ(200, hub_connection_impl::get_reconnect_delay(policy, 2, 0).count());
+    ASSERT_EQ(150, hub_connection_impl::get_reconnect_delay(policy, 2, 0.5).count());
+
+    policy.jitter = 1;
+    ASSERT_EQ(0, hub_connection_impl::get_reconnect_delay(policy, 2, 0.9999).count());
+}
+
+TEST(reconnect, policy_is_validated)
+{
+    signalr_client_config config;
+    reconnect_policy policy;
+
+    policy.jitter = 1.5;
+    ASSERT_THROW(config.set_reconnect_policy(policy), std::runtime_error);
+
+    policy.jitter = 0;
+    policy.initial_delay = std::chrono::seconds(2);
+    policy.max_delay = std::chrono::seconds(1);
+    ASSERT_THROW(config.set_reconnect_policy(policy), std::runtime_error);
+
+    policy.max_delay = std::chrono::seconds(2);
+    config.set_reconnect_policy(policy);
+    ASSERT_EQ(std::chrono::seconds(2), config.get_reconnect_policy().max_delay);
+}
@@ -42,6 +42,10 @@ std::vector<std::pair<std::string, std::shared_ptr<hub_message>>> protocol_test_
     { "{\"arguments\":[[1,5]],\"target\":\"Target\",\"type\":1}\x1e",
     std::shared_ptr<hub_message>(new invocation_message("", "Target", std::vector<value>{ value(std::vector<value>{value(1.f), value(5.f)}) })) },
 
+    // invocation message with stream ids
+    { "{\"arguments\":[],\"invocationId\":\"1\",\"streamIds\":[\"0\",\"1\"],\"target\":\"Target\",\"type\":1}\x1e",
+    std::shared_ptr<hub_message>(new invocation_message("1", "Target", std::vector<value>{}, std::vector<std::string>{ "0", "1" })) },
+
     // ping message
     { "{\"type\":6}\x1e",
     std::shared_ptr<hub_message>(new ping_message()) },
@@ -61,6 +65,14 @@ std::vector<std::pair<std::string, std::shared_ptr<hub_message>>> protocol_test_
     // completion message with null result
     { "{\"invocationId\":\"1\",\"result\":null,\"type\":3}\x1e",
     std::shared_ptr<hub_message>(new completion_message("1", "", value(), true)) },
+
+    // stream item message
+    { "{\"invocationId\":\"1\",\"item\":42,\"type\":2}\x1e",
+    std::shared_ptr<hub_message>(new stream_item_message("1", value(42.f))) },
+
+    // stream item message with array item
+    { "{\"invocationId\":\"1\",\"item\":[1,\"Foo\"],\"type\":2}\x1e",
+    std::shared_ptr<hub_message>(new stream_item_message("1", value(std::vector<value>{ value(1.f), value("Foo") }))) },
 };
 
 TEST(json_hub_protocol, write_message)
@@ -82,6 +94,16 @@ TEST(json_hub_protocol, parse_message)
     }
 }
 
+TEST(json_hub_protocol, write_stream_invocation_and_cancel_invocation)
+{
+    stream_invocation_message stream_invocation("1", "Target", std::vector<value>{ value(1.f) });
+    ASSERT_STREQ("{\"arguments\":[1],\"invocationId\":\"1\",\"target\":\"Target\",\"type\":4}\x1e",
+        json_hub_protocol().write_message(&stream_invocation).data());
+
+    cancel_invocation_message cancel_invocation("1");
+    ASSERT_STREQ("{\"invocationId\":\"1\",\"type\":5}\x1e", json_hub_protocol().write_message(&cancel_invocation).data());
+}
+
 TEST(json_hub_protocol, parsing_field_order_does_not_matter)
 {
     invocation_message message = invocation_message("123", "Target", std::vector<value>{value(true)});
@@ -151,11 +173,16 @@ std::vector<std::pair<std::string, std::string>> invalid_messages
     { "{\"type\":1,\"target\":\"send\",\"arguments\":[],\"invocationId\":42}\x1e", "Expected 'invocationId' to be of type 'string'" },
     { "{\"type\":1,\"target\":\"send\",\"arguments\":42,\"invocationId\":\"42\"}\x1e", "Expected 'arguments' to be of type 'array'" },
     { "{\"type\":1,\"target\":true,\"arguments\":[],\"invocationId\":\"42\"}\x1e", "Expected 'target' to be of type 'string'" },
+    { "{\"type\":1,\"target\":\"send\",\"arguments\":[],\"streamIds\":\"1\"}\x1e", "Expected 'streamIds' to be of type 'array'" },
+    { "{\"type\":1,\"target\":\"send\",\"arguments\":[],\"streamIds\":[1]}\x1e", "Expected 'streamIds' to contain values of type 'string'" },
 
     { "{\"type\":3}\x1e", "Field 'invocationId' not found for 'completion' message" },
     { "{\"type\":3,\"invocationId\":42}\x1e", "Expected 'invocationId' to be of type 'string'" },
     { "{\"type\":3,\"invocationId\":\"42\",\"error\":[]}\x1e", "Expected 'error' to be of type 'string'" },
     { "{\"type\":3,\"invocationId\":\"42\",\"error\":\"foo\",\"result\":true}\x1e", "The 'error' and 'result' properties are mutually exclusive." },
+
+    { "{\"type\":2,\"item\":42}\x1e", "Field 'invocationId' not found for 'stream_item' message" },
+    { "{\"type\":2,\"invocationId\":42,\"item\":42}\x1e", "Expected 'invocationId' to be of type 'string'" },
 };
 
 TEST(json_hub_protocol, invalid_messages_throw)
@@ -0,0 +1,376 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+#include "test_utils.h"
+#include "signalrclient/long_polling_transport.h"
+#include "signalrclient/signalr_exception.h"
+#include "signalrclient/native_sockets.h"
+#include "memory_log_writer.h"
+#include <condition_variable>
+
+#ifdef USE_NATIVE_SOCKETS
+#include "native_test_server.h"
+#include "signalrclient/hub_connection_builder.h"
+#endif
+
+using namespace signalr;
+
+namespace
+{
+    // http client whose requests are completed by the test
+    class manual_http_client : public http_client, public std::enable_shared_from_this<manual_http_client>
+    {
+    public:
+        struct recorded_request
+        {
+            http_method method;
+            std::string content;
+            std::function<void(const http_response&, std::exception_ptr)> callback;
+        };
+
+        void send(const std::string&, http_request& request,
+            std::function<void(const http_response&, std::exception_ptr)> callback, cancellation_token token) override
+        {
+            size_t index;
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                index = m_requests.size();
+                m_requests.push_back(recorded_request{ request.method, request.content, callback });
+            }
+
+            auto weak_client = std::weak_ptr<manual_http_client>(shared_from_this());
+            token.register_callback([weak_client, index]()
+                {
+                    auto client = weak_client.lock();
+                    if (client)
+                    {
+                        client->complete(index, http_response(), std::make_exception_ptr(canceled_exception()));
+                    }
+                });
+        }
+
+        size_t requests()
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            return m_requests.size();
+        }
+
+        recorded_request request(size_t index)
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            return m_requests.at(index);
+        }
+
+        void complete(size_t index, const http_response& response, std::exception_ptr exception = nullptr)
+        {
+            std::function<void(const http_response&, std::exception_ptr)> callback;
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                callback = std::move(m_requests.at(index).callback);
+                m_requests.at(index).callback = nullptr;
+            }
+
+            if (callback)
+            {
+                callback(response, exception);
+            }
+        }
+
+    private:
+        std::mutex m_lock;
+        std::vector<recorded_request> m_requests;
+    };
+
+    std::shared_ptr<transport> create_transport(const std::shared_ptr<http_client>& client)
+    {
+        return long_polling_transport::create([client](const signalr_client_config&)
+            {
+                return client;
+            }, signalr_client_config(), logger(std::make_shared<memory_log_writer>(), trace_level::none));
+    }
+
+    // starts the transport and answers the first poll
+    void start_transport(const std::shared_ptr<transport>& transport, const std::shared_ptr<manual_http_client>& client)
+    {
+        auto mre = manual_reset_event<void>();
+        transport->start("http://fake/hub?id=token", [&mre](std::exception_ptr exception)
+            {
+                mre.set(exception);
+            });
+
+        ASSERT_EQ(1, client->requests());
+        ASSERT_TRUE(client->request(0).method == http_method::GET);
+        client->complete(0, http_response(200, ""));
+        mre.get();
+    }
+}
+
+TEST(long_polling_transport, next_poll_is_issued_before_the_payload_is_handed_over)
+{
+    auto client = std::make_shared<manual_http_client>();
+    auto transport = create_transport(client);
+    std::vector<std::string> received;
+    std::vector<size_t> requests_when_received;
+    transport->on_receive([&received, &requests_when_received, client](std::string&& message, std::exception_ptr)
+        {
+            received.push_back(std::move(message));
+            requests_when_received.push_back(client->requests());
+        });
+    start_transport(transport, client);
+
+    ASSERT_EQ(2, client->requests());
+    client->complete(1, http_response(200, "{\"type\":6}\x1e{\"type\":6}\x1e"));
+
+    ASSERT_EQ(std::vector<std::string>{ "{\"type\":6}\x1e{\"type\":6}\x1e" }, received);
+    ASSERT_EQ(std::vector<size_t>{ 3 }, requests_when_received);
+    ASSERT_TRUE(client->request(2).method == http_method::GET);
+
+    // the server answers a poll it held for too long without content
+    client->complete(2, http_response(200, ""));
+    ASSERT_EQ(1, received.size());
+    ASSERT_EQ(4, client->requests());
+}
+
+TEST(long_polling_transport, polling_stops_while_receiving_is_paused)
+{
+    auto client = std::make_shared<manual_http_client>();
+    auto transport = create_transport(client);
+    std::vector<std::string> received;
+    transport->on_receive([&received](std::string&& message, std::exception_ptr)
+        {
+            received.push_back(std::move(message));
+        });
+    start_transport(transport, client);
+
+    transport->pause_receive();
+    client->complete(1, http_response(200, "a"));
+    client->complete(2, http_response(200, "b"));
+
+    // two returned polls wait to be handed over, the server holds the rest
+    ASSERT_TRUE(received.empty());
+    ASSERT_EQ(3, client->requests());
+
+    transport->resume_receive();
+    ASSERT_EQ((std::vector<std::string>{ "a", "b" }), received);
+    ASSERT_EQ(4, client->requests());
+}
+
+TEST(long_polling_transport, messages_queued_during_a_post_are_sent_together)
+{
+    auto client = std::make_shared<manual_http_client>();
+    auto transport = create_transport(client);
+    start_transport(transport, client);
+
+    std::vector<std::exception_ptr> results;
+    auto record_result = [&results](std::exception_ptr exception)
+    {
+        results.push_back(exception);
+    };
+
+    transport->send("1\x1e", transfer_format::text, record_result);
+    ASSERT_EQ(3, client->requests());
+    ASSERT_TRUE(client->request(2).method == http_method::POST);
+    ASSERT_EQ("1\x1e", client->request(2).content);
+
+    transport->send("2\x1e", transfer_format::text, record_result);
+    transport->send("3\x1e", transfer_format::text, record_result);
+    transport->send("{\"type\":6}\x1e", transfer_format::text, record_result, send_priority::control);
+    ASSERT_EQ(3, client->requests());
+
+    client->complete(2, http_response(200, ""));
+    ASSERT_EQ(1, results.size());
+    ASSERT_EQ(4, client->requests());
+    ASSERT_TRUE(client->request(3).method == http_method::POST);
+    ASSERT_EQ("{\"type\":6}\x1e" "2\x1e" "3\x1e", client->request(3).content);
+
+    client->complete(3, http_response(500, ""));
+    ASSERT_EQ(4, results.size());
+    ASSERT_EQ(nullptr, results[0]);
+    for (size_t i = 1; i < results.size(); ++i)
+    {
+        ASSERT_THROW(std::rethrow_exception(results[i]), signalr_exception);
+    }
+}
+
+TEST(long_polling_transport, stop_deletes_the_connection_after_the_poll_returned)
+{
+    auto client = std::make_shared<manual_http_client>();
+    auto transport = create_transport(client);
+    auto closed = false;
+    transport->on_close([&closed](std::exception_ptr exception)
+        {
+            ASSERT_EQ(nullptr, exception);
+            closed = true;
+        });
+    start_transport(transport, client);
+
+    auto stopped = false;
+    transport->stop([&stopped](std::exception_ptr exception)
+        {
+            ASSERT_EQ(nullptr, exception);
+            stopped = true;
+        });
+
+    // the poll was canceled
+    ASSERT_EQ(3, client->requests());
+    ASSERT_TRUE(client->request(2).method == http_method::DEL);
+    ASSERT_FALSE(stopped);
+
+    client->complete(2, http_response(202, ""));
+    ASSERT_TRUE(stopped);
+    ASSERT_TRUE(closed);
+
+    auto mre = manual_reset_event<void>();
+    transport->send("{}\x1e", transfer_format::text, [&mre](std::exception_ptr exception)
+        {
+            mre.set(exception);
+        });
+    ASSERT_THROW(mre.get(), signalr_exception);
+}
+
+TEST(long_polling_transport, server_ending_the_connection_closes_the_transport_after_the_received_payloads)
+{
+    auto client = std::make_shared<manual_http_client>();
+    auto transport = create_transport(client);
+    std::vector<std::string> events;
+    transport->on_receive([&events](std::string&& message, std::exception_ptr)
+        {
+            events.push_back(std::move(message));
+        });
+    transport->on_close([&events](std::exception_ptr exception)
+        {
+            events.push_back(exception == nullptr ? "closed" : "failed");
+        });
+    start_transport(transport, client);
+
+    transport->pause_receive();
+    client->complete(1, http_response(200, "a"));
+    client->complete(2, http_response(204, ""));
+    ASSERT_TRUE(events.empty());
+
+    transport->resume_receive();
+    ASSERT_EQ((std::vector<std::string>{ "a", "closed" }), events);
+    ASSERT_EQ(3, client->requests());
+}
+
+#ifdef USE_NATIVE_SOCKETS
+
+namespace
+{
+    class echo_counter
+    {
+    public:
+        echo_counter() : m_count(0) { }
+
+        void increment()
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            ++m_count;
+            m_changed.notify_all();
+        }
+
+        bool wait_for(int count)
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            return m_changed.wait_for(lock, std::chrono::seconds(30), [this, count]() { return m_count >= count; });
+        }
+
+    private:
+        std::mutex m_lock;
+        std::condition_variable m_changed;
+        int m_count;
+    };
+
+    hub_connection start_long_polling_connection(native_test_server& server, echo_counter& echoes)
+    {
+        server.set_transports("{ \"transport\": \"LongPolling\", \"transferFormats\": [ \"Text\", \"Binary\" ] }");
+
+        auto hub_connection = hub_connection_builder::create(server.url("/hub"))
+            .with_logging(std::make_shared<memory_log_writer>(), trace_level::none)
+            .build();
+
+        hub_connection.on("echo", [&echoes](const std::vector<signalr::value>&)
+            {
+                echoes.increment();
+            });
+
+        auto mre = manual_reset_event<void>();
+        hub_connection.start([&mre](std::exception_ptr exception)
+            {
+                mre.set(exception);
+            });
+        mre.get();
+
+        return hub_connection;
+    }
+
+    void stop_connection(hub_connection& hub_connection)
+    {
+        auto mre = manual_reset_event<void>();
+        hub_connection.stop([&mre](std::exception_ptr exception)
+            {
+                mre.set(exception);
+            });
+        mre.get();
+    }
+}
+
+TEST(long_polling_transport, hub_connection_echoes_over_long_polling)
+{
+    native_test_server server;
+    echo_counter echoes;
+    auto hub_connection = start_long_polling_connection(server, echoes);
+
+    hub_connection.send("echo", std::vector<signalr::value>{ "over long polling" });
+    ASSERT_TRUE(echoes.wait_for(1));
+    ASSERT_EQ(0, server.event_streams());
+    ASSERT_EQ(0, server.upgrades());
+
+    stop_connection(hub_connection);
+    ASSERT_EQ(connection_state::disconnected, hub_connection.get_connection_state());
+}
+
+TEST(long_polling_transport, benchmark_hub_echo)
+{
+    native_test_server server;
+    echo_counter echoes;
+    auto hub_connection = start_long_polling_connection(server, echoes);
+
+    // latency: one message in flight at a time, every echo takes a POST and a poll
+    const int round_trips = 100;
+    auto started = std::chrono::steady_clock::now();
+    for (int i = 0; i < round_trips; ++i)
+    {
+        hub_connection.send("echo", std::vector<signalr::value>{ static_cast<double>(i) });
+        ASSERT_TRUE(echoes.wait_for(i + 1));
+    }
+    auto round_trip_elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started);
+
+    // throughput: messages queued while a POST is in flight go out in the next one, polls return everything echoed meanwhile
+    const int messages = 2000;
+    auto posts = server.posts();
+    auto polls = server.polls();
+    started = std::chrono::steady_clock::now();
+    for (int i = 0; i < messages; ++i)
+    {
+        hub_connection.send("echo", std::vector<signalr::value>{ static_cast<double>(i) });
+    }
+    ASSERT_TRUE(echoes.wait_for(round_trips + messages));
+    auto burst_elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started);
+    posts = server.posts() - posts;
+    polls = server.polls() - polls;
+
+    RecordProperty("round_trip_us", static_cast<int>(round_trip_elapsed.count() / round_trips));
+    RecordProperty("burst_messages_per_second", static_cast<int>(messages * 1000000LL / std::max<long long>(burst_elapsed.count(), 1)));
+    RecordProperty("burst_posts", posts);
+    RecordProperty("burst_polls", polls);
+
+    ASSERT_LT(posts, messages / 2);
+    ASSERT_LT(polls, messages / 2);
+
+    stop_connection(hub_connection);
+}
+
+#endif
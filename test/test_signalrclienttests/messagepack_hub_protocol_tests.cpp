@@ -39,6 +39,10 @@ namespace
         { string_from_bytes({0x0D, 0x96, 0x01, 0x80, 0xC0, 0xA6, 0x54, 0x61, 0x72, 0x67, 0x65, 0x74, 0x90, 0x90}),
         std::shared_ptr<hub_message>(new invocation_message("", "Target", std::vector<value>{})) },
 
+        // invocation message with stream ids
+        { string_from_bytes({0x10, 0x96, 0x01, 0x80, 0xA1, 0x31, 0xA6, 0x54, 0x61, 0x72, 0x67, 0x65, 0x74, 0x90, 0x91, 0xA1, 0x30}),
+        std::shared_ptr<hub_message>(new invocation_message("1", "Target", std::vector<value>{}, std::vector<std::string>{ "0" })) },
+
         // invocation message with non-ascii string argument
         /*{ "{\"arguments\":[\"\xD7\x9E\xD7\x97\xD7\xA8\xD7\x95\xD7\x96\xD7\xAA\x20\xD7\x9B\xD7\x9C\xD7\xA9\xD7\x94\xD7\x99\"],\"target\":\"Target\",\"type\":1}\x1e",
         std::shared_ptr<hub_message>(new invocation_message("", "Target", std::vector<value>{ value("\xD7\x9E\xD7\x97\xD7\xA8\xD7\x95\xD7\x96\xD7\xAA\x20\xD7\x9B\xD7\x9C\xD7\xA9\xD7\x94\xD7\x99") })) },*/
@@ -74,6 +78,14 @@ namespace
         // completion message with null result
         { string_from_bytes({0x07, 0x95, 0x03, 0x80, 0xA1, 0x31, 0x03, 0xC0}),
         std::shared_ptr<hub_message>(new completion_message("1", "", value(), true)) },
+
+        // stream item message
+        { string_from_bytes({0x06, 0x94, 0x02, 0x80, 0xA1, 0x31, 0x2A}),
+        std::shared_ptr<hub_message>(new stream_item_message("1", value(42.f))) },
+
+        // stream item message with null item
+        { string_from_bytes({0x06, 0x94, 0x02, 0x80, 0xA1, 0x31, 0xC0}),
+        std::shared_ptr<hub_message>(new stream_item_message("1", value())) },
     };
 }
 
@@ -96,6 +108,16 @@ TEST(messagepack_hub_protocol, parse_message)
     }
 }
 
+TEST(messagepack_hub_protocol, write_stream_invocation_and_cancel_invocation)
+{
+    stream_invocation_message stream_invocation("1", "Target", std::vector<value>{});
+    ASSERT_EQ(string_from_bytes({ 0x0E, 0x96, 0x04, 0x80, 0xA1, 0x31, 0xA6, 0x54, 0x61, 0x72, 0x67, 0x65, 0x74, 0x90, 0x90 }),
+        messagepack_hub_protocol().write_message(&stream_invocation));
+
+    cancel_invocation_message cancel_invocation("1");
+    ASSERT_EQ(string_from_bytes({ 0x05, 0x93, 0x05, 0x80, 0xA1, 0x31 }), messagepack_hub_protocol().write_message(&cancel_invocation));
+}
+
 TEST(messagepack_hub_protocol, can_parse_multiple_messages)
 {
     auto payload = string_from_bytes({ 0x0D, 0x96, 0x01, 0x80, 0xC0, 0xA6, 0x54, 0x61, 0x72, 0x67, 0x65, 0x74, 0x90, 0x90,
@@ -145,6 +167,8 @@ namespace
         { string_from_bytes({0x0E, 0x96, 0x01, 0x80, 0x04, 0xA6, 0x54, 0x61, 0x72, 0x67, 0x65, 0x74, 0x91, 0xC0, 0x90}), "reading 'invocationId' as string failed"},
         { string_from_bytes({0x0E, 0x96, 0x01, 0x80, 0xC0, 0x96, 0x54, 0x61, 0x72, 0x67, 0x65, 0x74, 0x91, 0xC0, 0x90}), "reading 'target' as string failed"},
         { string_from_bytes({0x0E, 0x96, 0x01, 0x80, 0xC0, 0xA6, 0x54, 0x61, 0x72, 0x67, 0x65, 0x74, 0xA1, 0xC0, 0x90}), "reading 'arguments' as array failed"},
+        { string_from_bytes({0x0E, 0x96, 0x01, 0x80, 0xC0, 0xA6, 0x54, 0x61, 0x72, 0x67, 0x65, 0x74, 0x90, 0xA1, 0x30}), "reading 'streamIds' as array failed"},
+        { string_from_bytes({0x0E, 0x96, 0x01, 0x80, 0xC0, 0xA6, 0x54, 0x61, 0x72, 0x67, 0x65, 0x74, 0x90, 0x91, 0x01}), "reading 'streamIds' as array of strings failed"},
 
         // completion message
         { string_from_bytes({0x07, 0x95, 0x03, 0x80, 0x91, 0x31, 0x03, 0x2A}), "reading 'invocationId' as string failed"},
@@ -152,6 +176,10 @@ namespace
         { string_from_bytes({0x05, 0x93, 0x03, 0x80, 0xA1, 0x31}), "completion message has too few properties"},
         { string_from_bytes({0x06, 0x94, 0x03, 0x80, 0xA1, 0x31, 0x03}), "completion message has too few properties"},
         { string_from_bytes({0x08, 0x95, 0x03, 0x80, 0xA1, 0x31, 0x01, 0x91, 0x03}), "reading 'error' as string failed"},
+
+        // stream item message
+        { string_from_bytes({0x05, 0x93, 0x02, 0x80, 0xA1, 0x31}), "stream_item message has too few properties"},
+        { string_from_bytes({0x06, 0x94, 0x02, 0x80, 0x91, 0x31, 0x2A}), "reading 'invocationId' as string failed"},
     };
 }
 
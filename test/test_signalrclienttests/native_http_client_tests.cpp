@@ -0,0 +1,246 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+#include "test_utils.h"
+#include "signalrclient/native_http_client.h"
+
+#ifdef USE_NATIVE_SOCKETS
+
+#include "native_test_server.h"
+#include "memory_log_writer.h"
+#include "signalrclient/cancellation_token_source.h"
+#include "signalrclient/hub_connection_builder.h"
+#include "signalrclient/signalr_exception.h"
+
+using namespace signalr;
+
+namespace
+{
+    http_response send_request(native_http_client& client, const std::string& url, http_method method = http_method::GET,
+        const std::string& content = "", std::shared_ptr<cancellation_token_source> cts = std::make_shared<cancellation_token_source>())
+    {
+        http_request request;
+        request.method = method;
+        request.content = content;
+
+        auto mre = manual_reset_event<http_response>();
+        client.send(url, request, [&mre](const http_response& response, std::exception_ptr exception)
+            {
+                if (exception != nullptr)
+                {
+                    mre.set(exception);
+                }
+                else
+                {
+                    mre.set(response);
+                }
+            }, get_cancellation_token(cts));
+
+        return mre.get();
+    }
+}
+
+TEST(native_http_client, requests_to_the_same_host_reuse_the_connection)
+{
+    native_test_server server;
+    native_http_client client;
+
+    auto response = send_request(client, server.url("/first?x=1"), http_method::POST, "body");
+    ASSERT_EQ(200, response.status_code);
+    ASSERT_EQ("POST /first?x=1 body", response.content);
+
+    response = send_request(client, server.url("/chunked"));
+    ASSERT_EQ("hello world", response.content);
+
+    response = send_request(client, server.url("/second"));
+    ASSERT_EQ("GET /second ", response.content);
+
+    ASSERT_EQ(1, server.connections());
+    ASSERT_EQ(3, server.requests());
+}
+
+TEST(native_http_client, connection_closed_while_idle_is_replaced)
+{
+    native_test_server server;
+    server.close_after_response = true;
+    native_http_client client;
+
+    ASSERT_EQ("GET /first ", send_request(client, server.url("/first")).content);
+    ASSERT_EQ("GET /second ", send_request(client, server.url("/second")).content);
+
+    ASSERT_EQ(2, server.connections());
+}
+
+TEST(native_http_client, post_is_not_sent_on_a_connection_closed_while_idle)
+{
+    native_test_server server;
+    server.close_after_response = true;
+    native_http_client client;
+
+    ASSERT_EQ("POST /first a", send_request(client, server.url("/first"), http_method::POST, "a").content);
+    // gives the server's close time to arrive, a POST isn't sent again once it was written so the pool has to notice it
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    ASSERT_EQ("POST /second b", send_request(client, server.url("/second"), http_method::POST, "b").content);
+
+    ASSERT_EQ(2, server.connections());
+    ASSERT_EQ(2, server.requests());
+}
+
+TEST(native_http_client, requests_reuse_the_worker_thread)
+{
+    native_test_server server;
+    native_http_client client;
+
+    std::thread::id first_worker;
+    std::thread::id second_worker;
+    for (auto worker : { &first_worker, &second_worker })
+    {
+        http_request request;
+        auto mre = manual_reset_event<void>();
+        client.send(server.url("/"), request, [&mre, worker](const http_response&, std::exception_ptr exception)
+            {
+                *worker = std::this_thread::get_id();
+                mre.set(exception);
+            }, get_cancellation_token(std::make_shared<cancellation_token_source>()));
+        mre.get();
+
+        // lets the worker go back to waiting for the next request
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    ASSERT_EQ(first_worker, second_worker);
+    ASSERT_NE(std::this_thread::get_id(), first_worker);
+}
+
+TEST(native_http_client, request_can_be_canceled)
+{
+    native_test_server server;
+    native_http_client client;
+
+    auto cts = std::make_shared<cancellation_token_source>();
+    std::thread cancel([cts]()
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            cts->cancel();
+        });
+
+    ASSERT_THROW(send_request(client, server.url("/hang"), http_method::GET, "", cts), canceled_exception);
+    cancel.join();
+}
+
+TEST(native_http_client, https_urls_are_rejected)
+{
+    native_http_client client;
+    ASSERT_THROW(send_request(client, "https://127.0.0.1/negotiate"), signalr_exception);
+}
+
+TEST(native_http_client, connect_to_handshake_latency_with_negotiate_redirect)
+{
+    // every new connection costs the stand-in server 50ms, roughly a TCP handshake over a cellular link
+    native_test_server server(std::chrono::milliseconds(50));
+    server.redirects = 1;
+
+    auto hub_connection = hub_connection_builder::create(server.url("/hub"))
+        .with_logging(std::make_shared<memory_log_writer>(), trace_level::none)
+        .build();
+
+    auto started = std::chrono::steady_clock::now();
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+        {
+            mre.set(exception);
+        });
+    mre.get();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+    RecordProperty("connect_to_handshake_ms", static_cast<int>(elapsed.count()));
+
+    // both negotiate requests and the websocket upgrade used one connection
+    ASSERT_EQ(1, server.connections());
+    ASSERT_EQ(3, server.requests());
+    ASSERT_EQ(1, server.upgrades());
+    ASSERT_LE(std::chrono::milliseconds(50), elapsed);
+
+    hub_connection.stop([&mre](std::exception_ptr exception)
+        {
+            mre.set(exception);
+        });
+    mre.get();
+}
+
+TEST(native_http_client, websocket_connects_while_negotiate_runs_on_a_custom_http_client)
+{
+    native_test_server server(std::chrono::milliseconds(100));
+
+    auto hub_connection = hub_connection_builder::create(server.url("/hub"))
+        .with_logging(std::make_shared<memory_log_writer>(), trace_level::none)
+        .with_http_client_factory([](const signalr_client_config& config)
+            {
+                // doesn't share the default clients' connections
+                return std::make_shared<native_http_client>(config);
+            })
+        .build();
+
+    auto started = std::chrono::steady_clock::now();
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+        {
+            mre.set(exception);
+        });
+    mre.get();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+    RecordProperty("connect_to_handshake_ms", static_cast<int>(elapsed.count()));
+
+    // the websocket's connection was set up during negotiate, only one connection delay is paid
+    ASSERT_EQ(2, server.connections());
+    ASSERT_EQ(1, server.upgrades());
+    ASSERT_GT(std::chrono::milliseconds(190), elapsed);
+
+    hub_connection.stop([&mre](std::exception_ptr exception)
+        {
+            mre.set(exception);
+        });
+    mre.get();
+}
+
+TEST(native_http_client, negotiate_redirect_does_not_leave_idle_connections_ahead)
+{
+    native_test_server server;
+    server.redirects = 1;
+    server.redirect_to_localhost = true;
+    // only the connections the client keeps open stay open
+    server.close_after_response = true;
+
+    auto hub_connection = hub_connection_builder::create(server.url("/hub"))
+        .with_logging(std::make_shared<memory_log_writer>(), trace_level::none)
+        .with_http_client_factory([](const signalr_client_config& config)
+            {
+                return std::make_shared<native_http_client>(config);
+            })
+        .build();
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+        {
+            mre.set(exception);
+        });
+    mre.get();
+
+    // the connection set up ahead to 127.0.0.1 before the redirect to localhost is closed, only the websocket's is left
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (server.open_connections() > 1 && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(1, server.open_connections());
+    ASSERT_EQ(1, server.upgrades());
+
+    hub_connection.stop([&mre](std::exception_ptr exception)
+        {
+            mre.set(exception);
+        });
+    mre.get();
+}
+
+#endif
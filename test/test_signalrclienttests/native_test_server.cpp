@@ -0,0 +1,451 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+#include "native_test_server.h"
+
+#ifdef USE_NATIVE_SOCKETS
+
+#include "signalrclient/native_websocket_client.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace signalr;
+
+namespace
+{
+    bool write_all(int socket, const std::string& data)
+    {
+        size_t written = 0;
+        while (written < data.size())
+        {
+            auto sent = ::send(socket, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+            if (sent <= 0)
+            {
+                return false;
+            }
+            written += static_cast<size_t>(sent);
+        }
+
+        return true;
+    }
+
+    bool read_exact(int socket, std::string& input, size_t size, std::string& data)
+    {
+        char buffer[16 * 1024];
+        while (input.size() < size)
+        {
+            auto received = recv(socket, buffer, sizeof(buffer), 0);
+            if (received <= 0)
+            {
+                return false;
+            }
+            input.append(buffer, static_cast<size_t>(received));
+        }
+
+        data = input.substr(0, size);
+        input.erase(0, size);
+        return true;
+    }
+
+    bool read_until(int socket, std::string& input, const std::string& terminator, std::string& data)
+    {
+        char buffer[16 * 1024];
+        size_t end;
+        while ((end = input.find(terminator)) == std::string::npos)
+        {
+            auto received = recv(socket, buffer, sizeof(buffer), 0);
+            if (received <= 0)
+            {
+                return false;
+            }
+            input.append(buffer, static_cast<size_t>(received));
+        }
+
+        data = input.substr(0, end + terminator.size());
+        input.erase(0, end + terminator.size());
+        return true;
+    }
+
+    std::string frame(uint8_t first_byte, const std::string& payload)
+    {
+        // only used for short frames
+        std::string frame(1, static_cast<char>(first_byte));
+        frame.push_back(static_cast<char>(payload.size()));
+        return frame.append(payload);
+    }
+
+    // the hub's answer to posted messages: the handshake, which comes first, is answered with "{}\x1e", the rest is echoed
+    std::string hub_answer(const std::string& body)
+    {
+        if (body.find("\"protocol\"") == std::string::npos)
+        {
+            return body;
+        }
+
+        return "{}\x1e" + body.substr(body.find('\x1e') + 1);
+    }
+
+    std::string payload_event(const std::string& body)
+    {
+        return "data: " + hub_answer(body) + "\r\n\r\n";
+    }
+
+    std::string response(const std::string& content)
+    {
+        return "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(content.size()) + "\r\n\r\n" + content;
+    }
+}
+
+native_test_server::native_test_server(std::chrono::milliseconds connection_delay)
+    : redirects(0), reject_upgrades(false), close_after_response(false), redirect_to_localhost(false),
+    m_connection_delay(connection_delay), m_connections(0), m_open_connections(0), m_requests(0), m_upgrades(0), m_event_streams(0), m_polls(0), m_posts(0),
+    m_transports("{ \"transport\": \"WebSockets\", \"transferFormats\": [ \"Text\", \"Binary\" ] }"), m_event_stream(-1),
+    m_long_polling(0), m_stopping(false)
+{
+    m_listener = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(m_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    listen(m_listener, 16);
+
+    socklen_t length = sizeof(address);
+    getsockname(m_listener, reinterpret_cast<sockaddr*>(&address), &length);
+    m_port = ntohs(address.sin_port);
+
+    m_accept_thread = std::thread([this]() { accept_connections(); });
+}
+
+native_test_server::~native_test_server()
+{
+    ::shutdown(m_listener, SHUT_RDWR);
+    m_accept_thread.join();
+    ::close(m_listener);
+
+    // no more connections are accepted, the serving threads take the lock so it isn't held while joining them
+    std::vector<int> sockets;
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        sockets = m_sockets;
+        threads = std::move(m_threads);
+        m_stopping = true;
+        m_poll_ready.notify_all();
+    }
+
+    for (auto socket : sockets)
+    {
+        ::shutdown(socket, SHUT_RDWR);
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    for (auto socket : sockets)
+    {
+        ::close(socket);
+    }
+}
+
+std::string native_test_server::url(const std::string& resource) const
+{
+    return "http://127.0.0.1:" + std::to_string(m_port) + resource;
+}
+
+int native_test_server::connections() const
+{
+    return m_connections;
+}
+
+int native_test_server::open_connections() const
+{
+    return m_open_connections;
+}
+
+int native_test_server::requests() const
+{
+    return m_requests;
+}
+
+int native_test_server::upgrades() const
+{
+    return m_upgrades;
+}
+
+int native_test_server::event_streams() const
+{
+    return m_event_streams;
+}
+
+int native_test_server::polls() const
+{
+    return m_polls;
+}
+
+int native_test_server::posts() const
+{
+    return m_posts;
+}
+
+void native_test_server::set_transports(const std::string& transports)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_transports = transports;
+}
+
+bool native_test_server::write_event_stream(const std::string& data)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    if (m_event_stream < 0)
+    {
+        return false;
+    }
+
+    char size[16];
+    snprintf(size, sizeof(size), "%zx\r\n", data.size());
+    return write_all(m_event_stream, size + data + "\r\n");
+}
+
+void native_test_server::end_long_polling()
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_long_polling = 2;
+    m_poll_ready.notify_all();
+}
+
+void native_test_server::accept_connections()
+{
+    while (true)
+    {
+        auto socket = accept(m_listener, nullptr, nullptr);
+        if (socket < 0)
+        {
+            return;
+        }
+
+        ++m_connections;
+        ++m_open_connections;
+        auto accepted = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_sockets.push_back(socket);
+        m_threads.push_back(std::thread([this, socket, accepted]()
+            {
+                serve(socket, accepted);
+                --m_open_connections;
+            }));
+    }
+}
+
+void native_test_server::serve(int socket, std::chrono::steady_clock::time_point accepted)
+{
+    std::string input;
+    std::string head;
+    auto first_response = true;
+    while (read_until(socket, input, "\r\n\r\n", head))
+    {
+        ++m_requests;
+
+        auto content_length = native_sockets::find_header(head, "Content-Length");
+        std::string body;
+        if (!content_length.empty() && !read_exact(socket, input, std::stoul(content_length), body))
+        {
+            return;
+        }
+
+        if (first_response)
+        {
+            std::this_thread::sleep_until(accepted + m_connection_delay);
+            first_response = false;
+        }
+
+        auto method = head.substr(0, head.find(' '));
+        auto resource = head.substr(method.size() + 1, head.find(' ', method.size() + 1) - method.size() - 1);
+        auto connection = resource.find("id=") != std::string::npos;
+        if (method == "POST" && connection)
+        {
+            ++m_posts;
+        }
+
+        if (!native_sockets::find_header(head, "Sec-WebSocket-Key").empty())
+        {
+            if (reject_upgrades)
+            {
+                // e.g. a proxy that doesn't pass websockets on
+                write_all(socket, "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+                return;
+            }
+
+            ++m_upgrades;
+            write_all(socket, "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: "
+                + native_websocket_client::create_accept_key(native_sockets::find_header(head, "Sec-WebSocket-Key")) + "\r\n\r\n");
+            serve_websocket(socket, input);
+            return;
+        }
+
+        if (resource.find("/negotiate") != std::string::npos)
+        {
+            if (redirects-- > 0)
+            {
+                auto redirect_url = url("/redirected");
+                if (redirect_to_localhost)
+                {
+                    redirect_url.replace(redirect_url.find("127.0.0.1"), 9, "localhost");
+                }
+                write_all(socket, response("{ \"url\": \"" + redirect_url + "\" }"));
+            }
+            else
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                write_all(socket, response("{ \"connectionId\": \"id\", \"connectionToken\": \"token\", \"negotiateVersion\": 1, "
+                    "\"availableTransports\": [ " + m_transports + " ] }"));
+            }
+        }
+        else if (native_sockets::find_header(head, "Accept") == "text/event-stream")
+        {
+            ++m_event_streams;
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                write_all(socket, "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nTransfer-Encoding: chunked\r\n\r\n");
+                m_event_stream = socket;
+            }
+
+            // the stream is open until the client closes it
+            char buffer[16];
+            while (recv(socket, buffer, sizeof(buffer), 0) > 0)
+            {
+            }
+
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_event_stream = -1;
+            return;
+        }
+        else if (method == "POST" && write_event_stream(payload_event(body)))
+        {
+            write_all(socket, "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n");
+        }
+        else if (method == "POST" && connection)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                m_poll_content.append(hub_answer(body));
+                m_poll_ready.notify_all();
+            }
+            write_all(socket, "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n");
+        }
+        else if (method == "DELETE" && connection)
+        {
+            end_long_polling();
+            write_all(socket, "HTTP/1.1 202 Accepted\r\nContent-Length: 0\r\n\r\n");
+        }
+        else if (method == "GET" && connection)
+        {
+            serve_poll(socket);
+        }
+        else if (resource == "/chunked")
+        {
+            write_all(socket, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n6;ext=1\r\n world\r\n0\r\n\r\n");
+        }
+        else if (resource == "/hang")
+        {
+            // waits for the client to give up
+            char buffer[16];
+            while (recv(socket, buffer, sizeof(buffer), 0) > 0)
+            {
+            }
+            return;
+        }
+        else
+        {
+            write_all(socket, response(method + " " + resource + " " + body));
+        }
+
+        if (close_after_response)
+        {
+            ::shutdown(socket, SHUT_RDWR);
+            return;
+        }
+    }
+}
+
+void native_test_server::serve_poll(int socket)
+{
+    ++m_polls;
+    std::unique_lock<std::mutex> lock(m_lock);
+    if (m_long_polling == 0)
+    {
+        m_long_polling = 1;
+        lock.unlock();
+        write_all(socket, response(""));
+        return;
+    }
+
+    m_poll_ready.wait_for(lock, std::chrono::seconds(5), [this]() { return !m_poll_content.empty() || m_long_polling != 1 || m_stopping; });
+    if (m_stopping)
+    {
+        return;
+    }
+
+    if (m_long_polling != 1)
+    {
+        lock.unlock();
+        write_all(socket, "HTTP/1.1 204 No Content\r\n\r\n");
+        return;
+    }
+
+    std::string content;
+    content.swap(m_poll_content);
+    lock.unlock();
+    write_all(socket, response(content));
+}
+
+void native_test_server::serve_websocket(int socket, std::string& input)
+{
+    std::string header;
+    while (read_exact(socket, input, 2, header))
+    {
+        auto opcode = static_cast<uint8_t>(header[0] & 0x0f);
+        size_t length = header[1] & 0x7f;
+        std::string extended;
+        if (length >= 126)
+        {
+            if (!read_exact(socket, input, length == 126 ? 2 : 8, extended))
+            {
+                return;
+            }
+
+            length = 0;
+            for (auto c : extended)
+            {
+                length = (length << 8) | static_cast<uint8_t>(c);
+            }
+        }
+
+        std::string mask;
+        std::string payload;
+        if (!read_exact(socket, input, 4, mask) || !read_exact(socket, input, length, payload))
+        {
+            return;
+        }
+        native_websocket_client::apply_mask(&payload[0], payload.size(), mask.data());
+
+        if (opcode == 0x8)
+        {
+            write_all(socket, frame(0x88, payload));
+            return;
+        }
+
+        // the hub handshake request
+        if (payload.find("\"protocol\"") != std::string::npos)
+        {
+            write_all(socket, frame(0x81, "{}\x1e"));
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,98 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#pragma once
+
+#include "signalrclient/native_sockets.h"
+
+#ifdef USE_NATIVE_SOCKETS
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Stand-in for a SignalR server on 127.0.0.1, every connection is served by its own thread:
+// - POST .../negotiate answers with a connection token and the transports passed to `set_transports`, or with a redirect to
+//   /redirected while `redirects` is positive (on localhost instead of 127.0.0.1 while `redirect_to_localhost` is set)
+// - a websocket upgrade answers the hub handshake and echoes the close frame, or is refused while `reject_upgrades` is set
+// - a GET accepting text/event-stream opens the event stream (chunked), while it's open every other POST is answered on it
+//   like a hub would: the handshake with "{}\x1e", anything else is echoed as an event
+// - a GET of a connection (?id=) that doesn't open an event stream is a long poll: the first one opens the connection and is
+//   answered right away, the next ones are held until a POST queued the hub's answer (like above), the connection ended or five
+//   seconds passed. DELETE and `end_long_polling` end the connection, which answers the polls with 204
+// - GET /chunked answers "hello world" in two chunks, GET /hang never answers
+// - anything else is answered with "<method> <resource> <body>"
+// The first response on every connection is sent no earlier than `connection_delay` after the connection was accepted,
+// simulating the round trips of connecting over a slow link.
+class native_test_server
+{
+public:
+    explicit native_test_server(std::chrono::milliseconds connection_delay = std::chrono::milliseconds(0));
+    ~native_test_server();
+
+    native_test_server(const native_test_server&) = delete;
+    native_test_server& operator=(const native_test_server&) = delete;
+
+    std::string url(const std::string& resource) const;
+
+    int connections() const;
+    // connections that neither side closed yet
+    int open_connections() const;
+    int requests() const;
+    int upgrades() const;
+    int event_streams() const;
+    int polls() const;
+    // POST requests to a connection
+    int posts() const;
+
+    // the availableTransports negotiate answers with, only WebSockets by default
+    void set_transports(const std::string& transports);
+    // writes `data` to the open event stream as is, returns false if there is none
+    bool write_event_stream(const std::string& data);
+    void end_long_polling();
+
+    std::atomic<int> redirects;
+    std::atomic<bool> reject_upgrades;
+    // connections are closed after the first response, without telling the client
+    std::atomic<bool> close_after_response;
+    std::atomic<bool> redirect_to_localhost;
+
+private:
+    int m_listener;
+    uint16_t m_port;
+    std::chrono::milliseconds m_connection_delay;
+    std::thread m_accept_thread;
+
+    std::atomic<int> m_connections;
+    std::atomic<int> m_open_connections;
+    std::atomic<int> m_requests;
+    std::atomic<int> m_upgrades;
+    std::atomic<int> m_event_streams;
+    std::atomic<int> m_polls;
+    std::atomic<int> m_posts;
+
+    std::mutex m_lock;
+    std::vector<int> m_sockets;
+    std::vector<std::thread> m_threads;
+    std::string m_transports;
+    // socket of the open event stream, -1 if there is none. Writes to it hold `m_lock`
+    int m_event_stream;
+    // 0 - no long polling connection, 1 - open, 2 - ended
+    int m_long_polling;
+    // answers waiting for the next poll
+    std::string m_poll_content;
+    std::condition_variable m_poll_ready;
+    bool m_stopping;
+
+    void accept_connections();
+    void serve(int socket, std::chrono::steady_clock::time_point accepted);
+    void serve_websocket(int socket, std::string& input);
+    void serve_poll(int socket);
+};
+
+#endif
@@ -0,0 +1,559 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+#include "test_utils.h"
+#include "signalrclient/native_websocket_client.h"
+
+#ifdef USE_NATIVE_SOCKETS
+
+#include "signalrclient/signalr_exception.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <condition_variable>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace signalr;
+
+namespace
+{
+    // Websocket server on 127.0.0.1 accepting a single connection, echoes the data frames it receives. `extensions` is
+    // sent as the Sec-WebSocket-Extensions response header, compressed frames are echoed without inflating them.
+    class echo_server
+    {
+    public:
+        explicit echo_server(std::function<void(echo_server&)> on_connected = nullptr, const std::string& extensions = "")
+            : m_connection(-1), m_compressed_frames(0)
+        {
+            m_listener = ::socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in address = {};
+            address.sin_family = AF_INET;
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            bind(m_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+            listen(m_listener, 1);
+
+            socklen_t length = sizeof(address);
+            getsockname(m_listener, reinterpret_cast<sockaddr*>(&address), &length);
+            m_port = ntohs(address.sin_port);
+
+            m_thread = std::thread([this, on_connected, extensions]() { serve(on_connected, extensions); });
+        }
+
+        ~echo_server()
+        {
+            ::shutdown(m_listener, SHUT_RDWR);
+            int connection = m_connection;
+            if (connection >= 0)
+            {
+                ::shutdown(connection, SHUT_RDWR);
+            }
+            m_thread.join();
+            ::close(m_listener);
+        }
+
+        std::string url(const std::string& resource = "/hub") const
+        {
+            return "ws://127.0.0.1:" + std::to_string(m_port) + resource;
+        }
+
+        void send_frame(uint8_t first_byte, const std::string& payload)
+        {
+            std::string frame(1, static_cast<char>(first_byte));
+            if (payload.size() < 126)
+            {
+                frame.push_back(static_cast<char>(payload.size()));
+            }
+            else
+            {
+                frame.push_back(127);
+                for (int i = 7; i >= 0; --i)
+                {
+                    frame.push_back(static_cast<char>(static_cast<uint64_t>(payload.size()) >> (i * 8)));
+                }
+            }
+            frame.append(payload);
+            write_all(frame);
+        }
+
+        std::string request()
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            return m_request;
+        }
+
+        std::vector<std::string> pongs()
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            return m_pongs;
+        }
+
+        int compressed_frames() const
+        {
+            return m_compressed_frames;
+        }
+
+    private:
+        int m_listener;
+        std::atomic<int> m_connection;
+        uint16_t m_port;
+        std::thread m_thread;
+        std::string m_input;
+        std::atomic<int> m_compressed_frames;
+
+        std::mutex m_lock;
+        std::string m_request;
+        std::vector<std::string> m_pongs;
+
+        void write_all(const std::string& data)
+        {
+            size_t written = 0;
+            while (written < data.size())
+            {
+                auto sent = ::send(m_connection, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+                if (sent <= 0)
+                {
+                    return;
+                }
+                written += static_cast<size_t>(sent);
+            }
+        }
+
+        bool read_exact(size_t size, std::string& data)
+        {
+            char buffer[16 * 1024];
+            while (m_input.size() < size)
+            {
+                auto received = recv(m_connection, buffer, sizeof(buffer), 0);
+                if (received <= 0)
+                {
+                    return false;
+                }
+                m_input.append(buffer, static_cast<size_t>(received));
+            }
+
+            data = m_input.substr(0, size);
+            m_input.erase(0, size);
+            return true;
+        }
+
+        void serve(std::function<void(echo_server&)> on_connected, const std::string& extensions)
+        {
+            auto connection = accept(m_listener, nullptr, nullptr);
+            if (connection < 0)
+            {
+                return;
+            }
+            m_connection = connection;
+
+            std::string byte;
+            std::string request;
+            while (request.size() < 4 || request.compare(request.size() - 4, 4, "\r\n\r\n") != 0)
+            {
+                if (!read_exact(1, byte))
+                {
+                    return;
+                }
+                request.append(byte);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                m_request = request;
+            }
+
+            auto key_start = request.find("Sec-WebSocket-Key: ") + 19;
+            auto key = request.substr(key_start, request.find("\r\n", key_start) - key_start);
+            write_all("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: "
+                + native_websocket_client::create_accept_key(key) + "\r\n"
+                + (extensions.empty() ? "" : "Sec-WebSocket-Extensions: " + extensions + "\r\n") + "\r\n");
+
+            if (on_connected)
+            {
+                on_connected(*this);
+            }
+
+            std::string header;
+            while (read_exact(2, header))
+            {
+                auto opcode = static_cast<uint8_t>(header[0] & 0x0f);
+                uint64_t length = header[1] & 0x7f;
+                std::string extended;
+                if (length >= 126)
+                {
+                    if (!read_exact(length == 126 ? 2 : 8, extended))
+                    {
+                        return;
+                    }
+
+                    length = 0;
+                    for (auto c : extended)
+                    {
+                        length = (length << 8) | static_cast<uint8_t>(c);
+                    }
+                }
+
+                std::string mask;
+                std::string payload;
+                if (!read_exact(4, mask) || !read_exact(static_cast<size_t>(length), payload))
+                {
+                    return;
+                }
+                native_websocket_client::apply_mask(&payload[0], payload.size(), mask.data());
+
+                if (opcode == 0x8)
+                {
+                    send_frame(0x88, payload);
+                    return;
+                }
+
+                if (opcode == 0xa)
+                {
+                    std::lock_guard<std::mutex> lock(m_lock);
+                    m_pongs.push_back(payload);
+                    continue;
+                }
+
+                if ((header[0] & 0x40) != 0)
+                {
+                    ++m_compressed_frames;
+                }
+
+                send_frame(header[0], payload);
+            }
+        }
+    };
+
+    class message_collector
+    {
+    public:
+        void add(std::string&& message, std::exception_ptr exception)
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (exception != nullptr)
+            {
+                m_exception = exception;
+            }
+            else
+            {
+                m_messages.push_back(std::move(message));
+            }
+            m_changed.notify_all();
+        }
+
+        std::vector<std::string> wait_for(size_t count)
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_changed.wait_for(lock, std::chrono::seconds(5), [this, count]() { return m_messages.size() >= count; });
+            return m_messages;
+        }
+
+        std::exception_ptr wait_for_exception()
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_changed.wait_for(lock, std::chrono::seconds(5), [this]() { return m_exception != nullptr; });
+            return m_exception;
+        }
+
+    private:
+        std::mutex m_lock;
+        std::condition_variable m_changed;
+        std::vector<std::string> m_messages;
+        std::exception_ptr m_exception;
+    };
+
+    thread_local bool running_scheduled = false;
+
+    // runs every callback on a thread of its own that is marked as a scheduler thread
+    class marking_scheduler : public scheduler
+    {
+    public:
+        void schedule(const signalr_base_cb& cb, std::chrono::milliseconds delay = std::chrono::milliseconds::zero()) override
+        {
+            std::thread([cb, delay]()
+                {
+                    std::this_thread::sleep_for(delay);
+                    running_scheduled = true;
+                    cb();
+                }).detach();
+        }
+    };
+
+    std::shared_ptr<native_websocket_client> start_client(const std::string& url, message_collector& messages,
+        const signalr_client_config& config = signalr_client_config())
+    {
+        auto client = std::make_shared<native_websocket_client>(config);
+        client->on_owned_message([&messages](std::string&& message, std::exception_ptr exception)
+            {
+                messages.add(std::move(message), exception);
+            });
+
+        auto mre = manual_reset_event<void>();
+        client->start(url, [&mre](std::exception_ptr exception)
+            {
+                mre.set(exception);
+            });
+        mre.get();
+
+        return client;
+    }
+
+    void stop_client(const std::shared_ptr<native_websocket_client>& client)
+    {
+        auto mre = manual_reset_event<void>();
+        client->stop([&mre](std::exception_ptr exception)
+            {
+                mre.set(exception);
+            });
+        mre.get();
+    }
+}
+
+TEST(native_websocket_client, messages_are_echoed_back)
+{
+    echo_server server;
+    message_collector messages;
+    signalr_client_config config;
+    config.set_http_headers({ { "Authorization", "Bearer token" } });
+    auto client = start_client(server.url("/hub?id=42"), messages, config);
+
+    auto request = server.request();
+    ASSERT_EQ(0U, request.find("GET /hub?id=42 HTTP/1.1\r\n"));
+    ASSERT_NE(std::string::npos, request.find("\r\nHost: 127.0.0.1:"));
+    ASSERT_NE(std::string::npos, request.find("\r\nUpgrade: websocket\r\n"));
+    ASSERT_NE(std::string::npos, request.find("\r\nAuthorization: Bearer token\r\n"));
+
+    std::string large(1024 * 1024 + 3, '\0');
+    for (size_t i = 0; i < large.size(); ++i)
+    {
+        large[i] = static_cast<char>(i * 7);
+    }
+
+    auto sent = manual_reset_event<void>();
+    client->send("{\"type\":6}\x1e", transfer_format::text, [](std::exception_ptr) {});
+    client->send(std::vector<const_buffer>{ const_buffer{ large.data(), 5 }, const_buffer{ large.data() + 5, large.size() - 5 } },
+        transfer_format::binary, [&sent](std::exception_ptr exception)
+        {
+            sent.set(exception);
+        });
+    sent.get();
+
+    auto received = messages.wait_for(2);
+    ASSERT_EQ(2U, received.size());
+    ASSERT_EQ("{\"type\":6}\x1e", received[0]);
+    ASSERT_TRUE(large == received[1]);
+
+    stop_client(client);
+}
+
+TEST(native_websocket_client, fragmented_messages_are_reassembled_and_pings_answered)
+{
+    echo_server server([](echo_server& server)
+        {
+            server.send_frame(0x01, "ab");
+            server.send_frame(0x89, "ping");
+            server.send_frame(0x80, "cd");
+        });
+    message_collector messages;
+    auto client = start_client(server.url(), messages);
+
+    auto received = messages.wait_for(1);
+    ASSERT_EQ(std::vector<std::string>{ "abcd" }, received);
+
+    // the pong is written before the echo of this message so the server recorded it once the echo arrives
+    client->send("x", transfer_format::text, [](std::exception_ptr) {});
+    messages.wait_for(2);
+    ASSERT_EQ(std::vector<std::string>{ "ping" }, server.pongs());
+
+    stop_client(client);
+}
+
+TEST(native_websocket_client, message_larger_than_the_maximum_size_fails_the_connection)
+{
+    echo_server server([](echo_server& server)
+        {
+            server.send_frame(0x81, "abcd");
+            // the fragments only exceed the limit together
+            server.send_frame(0x01, "abc");
+            server.send_frame(0x80, "de");
+        });
+    message_collector messages;
+    signalr_client_config config;
+    ASSERT_THROW(config.set_max_receive_message_size(0), std::runtime_error);
+    config.set_max_receive_message_size(4);
+    auto client = start_client(server.url(), messages, config);
+
+    ASSERT_EQ(std::vector<std::string>{ "abcd" }, messages.wait_for(1));
+
+    auto exception = messages.wait_for_exception();
+    ASSERT_NE(nullptr, exception);
+    try
+    {
+        std::rethrow_exception(exception);
+    }
+    catch (const signalr_exception& e)
+    {
+        ASSERT_STREQ("the server sent a websocket message larger than the maximum message size", e.what());
+    }
+}
+
+TEST(native_websocket_client, server_close_is_reported_to_the_message_handler)
+{
+    echo_server server([](echo_server& server)
+        {
+            server.send_frame(0x88, std::string("\x03\xe8", 2));
+        });
+    message_collector messages;
+    auto client = start_client(server.url(), messages);
+
+    auto exception = messages.wait_for_exception();
+    ASSERT_NE(nullptr, exception);
+    try
+    {
+        std::rethrow_exception(exception);
+    }
+    catch (const signalr_exception& e)
+    {
+        ASSERT_STREQ("the server closed the websocket connection", e.what());
+    }
+
+    auto send_failed = manual_reset_event<void>();
+    client->send("x", transfer_format::text, [&send_failed](std::exception_ptr exception)
+        {
+            send_failed.set(exception);
+        });
+    ASSERT_THROW(send_failed.get(), signalr_exception);
+}
+
+TEST(native_websocket_client, start_fails_if_nothing_is_listening)
+{
+    int port;
+    {
+        // a port that was free a moment ago
+        echo_server server;
+        port = std::stoi(server.url("").substr(15));
+    }
+
+    signalr_client_config config;
+    config.set_scheduler(std::make_shared<marking_scheduler>());
+    auto client = std::make_shared<native_websocket_client>(config);
+    client->on_owned_message([](std::string&&, std::exception_ptr) {});
+    auto mre = manual_reset_event<void>();
+    auto on_scheduler = false;
+    client->start("ws://127.0.0.1:" + std::to_string(port), [&mre, &on_scheduler](std::exception_ptr exception)
+        {
+            on_scheduler = running_scheduled;
+            mre.set(exception);
+        });
+    ASSERT_THROW(mre.get(), signalr_exception);
+    // like a successful start, the failure isn't reported on the I/O thread
+    ASSERT_TRUE(on_scheduler);
+}
+
+TEST(native_websocket_client, apply_mask_matches_bytewise_masking_at_any_offset)
+{
+    const char mask[4] = { 0x12, 0x34, 0x56, 0x78 };
+    for (size_t offset = 0; offset < 8; ++offset)
+    {
+        for (size_t size = 0; size < 40; ++size)
+        {
+            std::string data(size, '\0');
+            std::string expected(size, '\0');
+            for (size_t i = 0; i < size; ++i)
+            {
+                data[i] = static_cast<char>(i * 31 + offset);
+                expected[i] = static_cast<char>(data[i] ^ mask[(offset + i) % 4]);
+            }
+
+            native_websocket_client::apply_mask(&data[0], size, mask, offset);
+            ASSERT_EQ(expected, data) << "offset " << offset << ", size " << size;
+        }
+    }
+}
+
+#ifdef USE_ZLIB
+TEST(native_websocket_client, messages_are_compressed_if_the_server_accepts_permessage_deflate)
+{
+    // without context takeover the client can inflate the frames it compressed itself
+    echo_server server(nullptr, "permessage-deflate; client_no_context_takeover; server_no_context_takeover");
+    message_collector messages;
+    signalr_client_config config;
+    websocket_compression compression;
+    compression.enabled = true;
+    compression.client_no_context_takeover = true;
+    config.set_websocket_compression(compression);
+    auto client = start_client(server.url(), messages, config);
+
+    ASSERT_NE(std::string::npos, server.request().find("\r\nSec-WebSocket-Extensions: permessage-deflate; client_max_window_bits; "
+        "client_no_context_takeover\r\n"));
+
+    std::string large;
+    for (int i = 0; i < 100; ++i)
+    {
+        large.append("{\"type\":1,\"target\":\"SendReading\",\"arguments\":[" + std::to_string(i) + "]}\x1e");
+    }
+
+    client->send("{\"type\":6}\x1e", transfer_format::text, [](std::exception_ptr) {});
+    client->send(large, transfer_format::text, [](std::exception_ptr) {});
+    client->send(large, transfer_format::binary, [](std::exception_ptr) {});
+
+    auto received = messages.wait_for(3);
+    ASSERT_EQ(3U, received.size());
+    ASSERT_EQ("{\"type\":6}\x1e", received[0]);
+    ASSERT_EQ(large, received[1]);
+    ASSERT_EQ(large, received[2]);
+    ASSERT_EQ(2, server.compressed_frames());
+
+    stop_client(client);
+}
+
+TEST(native_websocket_client, compressed_message_inflating_beyond_the_maximum_size_fails_the_connection)
+{
+    echo_server server(nullptr, "permessage-deflate; client_no_context_takeover; server_no_context_takeover");
+    message_collector messages;
+    signalr_client_config config;
+    websocket_compression compression;
+    compression.enabled = true;
+    compression.client_no_context_takeover = true;
+    config.set_websocket_compression(compression);
+    config.set_max_receive_message_size(1024);
+    auto client = start_client(server.url(), messages, config);
+
+    // the echoed frame is well below the limit, only the inflated message exceeds it
+    client->send(std::string(64 * 1024, 'x'), transfer_format::text, [](std::exception_ptr) {});
+
+    auto exception = messages.wait_for_exception();
+    ASSERT_NE(nullptr, exception);
+    try
+    {
+        std::rethrow_exception(exception);
+    }
+    catch (const signalr_exception& e)
+    {
+        ASSERT_STREQ("the server sent a websocket message larger than the maximum message size", e.what());
+    }
+    ASSERT_EQ(1, server.compressed_frames());
+}
+
+TEST(native_websocket_client, compressed_frames_are_rejected_if_the_extension_was_not_negotiated)
+{
+    echo_server server([](echo_server& server)
+        {
+            server.send_frame(0xc1, "x");
+        });
+    message_collector messages;
+    auto client = start_client(server.url(), messages);
+
+    ASSERT_NE(nullptr, messages.wait_for_exception());
+}
+#endif
+
+TEST(native_websocket_client, create_accept_key_matches_the_rfc_example)
+{
+    ASSERT_EQ("s3pPLMBiTxaQ9kYGzzhZRbK+xOo=", native_websocket_client::create_accept_key("dGhlIHNhbXBsZSBub25jZQ=="));
+}
+
+#endif
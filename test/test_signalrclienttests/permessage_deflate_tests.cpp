@@ -0,0 +1,228 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+
+#ifdef USE_ZLIB
+
+#include "signalrclient/permessage_deflate.h"
+#include "signalrclient/json_hub_protocol.h"
+#include "signalrclient/signalr_exception.h"
+#ifdef USE_MSGPACK
+#include "signalrclient/messagepack_hub_protocol.h"
+#endif
+#include <chrono>
+#include <limits>
+
+using namespace signalr;
+
+namespace
+{
+    const size_t unlimited = std::numeric_limits<size_t>::max();
+
+    websocket_compression compression(bool no_context_takeover = false, int level = -1)
+    {
+        websocket_compression compression;
+        compression.enabled = true;
+        compression.level = level;
+        compression.client_no_context_takeover = no_context_takeover;
+        compression.server_no_context_takeover = no_context_takeover;
+        return compression;
+    }
+
+    std::vector<const_buffer> buffers(const std::string& message)
+    {
+        return std::vector<const_buffer>{ const_buffer{ message.data(), message.size() } };
+    }
+
+    // invocations as a chat-like app would send them, similar but not identical
+    std::vector<std::string> invocations(const hub_protocol& protocol, size_t count)
+    {
+        std::vector<std::string> messages;
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::map<std::string, signalr::value> reading
+            {
+                { "sensor", std::string("temperature-") + std::to_string(i % 4) },
+                { "value", static_cast<double>(20 + i % 7) },
+                { "unit", "celsius" },
+                { "timestamp", std::string("2026-10-19T12:00:") + std::to_string(10 + i % 50) + "Z" }
+            };
+            invocation_message message(std::to_string(i), "SendReading", std::vector<signalr::value>{ "device-0042", reading });
+            messages.push_back(protocol.write_message(&message));
+        }
+
+        return messages;
+    }
+
+    // Sends `messages` from one side to the other, returns the compressed size in bytes.
+    size_t roundtrip(const std::vector<std::string>& messages, const websocket_compression& options, std::chrono::microseconds& elapsed)
+    {
+        permessage_deflate client(options);
+        permessage_deflate server(options);
+        auto answer = std::string("permessage-deflate")
+            + (options.client_no_context_takeover ? "; client_no_context_takeover; server_no_context_takeover" : "");
+        client.accept(answer);
+        // the server inflates what the client deflated, the parameters are symmetric here
+        server.accept(answer);
+
+        size_t compressed_size = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& message : messages)
+        {
+            std::string compressed;
+            client.compress(buffers(message), compressed);
+            compressed_size += compressed.size();
+
+            std::string decompressed;
+            server.decompress(compressed, decompressed, unlimited);
+            EXPECT_EQ(message, decompressed);
+        }
+        elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+        return compressed_size;
+    }
+
+    size_t total_size(const std::vector<std::string>& messages)
+    {
+        size_t size = 0;
+        for (const auto& message : messages)
+        {
+            size += message.size();
+        }
+        return size;
+    }
+}
+
+TEST(permessage_deflate, offer_lists_the_configured_parameters)
+{
+    ASSERT_EQ("permessage-deflate; client_max_window_bits", permessage_deflate(websocket_compression()).create_offer());
+
+    auto options = compression(true);
+    options.client_max_window_bits = 10;
+    options.server_max_window_bits = 9;
+    ASSERT_EQ("permessage-deflate; client_max_window_bits=10; server_max_window_bits=9; client_no_context_takeover; "
+        "server_no_context_takeover", permessage_deflate(options).create_offer());
+}
+
+TEST(permessage_deflate, accept_reports_whether_the_server_agreed)
+{
+    ASSERT_FALSE(permessage_deflate(compression()).accept(""));
+    ASSERT_TRUE(permessage_deflate(compression()).accept("permessage-deflate"));
+    ASSERT_TRUE(permessage_deflate(compression()).accept("permessage-deflate; client_max_window_bits=\"12\"; server_no_context_takeover"));
+
+    ASSERT_THROW(permessage_deflate(compression()).accept("x-webkit-deflate-frame"), signalr_exception);
+    ASSERT_THROW(permessage_deflate(compression()).accept("permessage-deflate; unknown"), signalr_exception);
+    ASSERT_THROW(permessage_deflate(compression()).accept("permessage-deflate; client_max_window_bits=8"), signalr_exception);
+    ASSERT_THROW(permessage_deflate(compression()).accept("permessage-deflate; server_max_window_bits=16"), signalr_exception);
+}
+
+TEST(permessage_deflate, messages_roundtrip_across_buffers)
+{
+    permessage_deflate client(compression());
+    permessage_deflate server(compression());
+    ASSERT_TRUE(client.accept("permessage-deflate"));
+    ASSERT_TRUE(server.accept("permessage-deflate"));
+
+    std::string large(256 * 1024, '\0');
+    for (size_t i = 0; i < large.size(); ++i)
+    {
+        large[i] = static_cast<char>((i * i) >> 5);
+    }
+
+    for (int i = 0; i < 3; ++i)
+    {
+        std::string compressed;
+        client.compress(std::vector<const_buffer>{ const_buffer{ large.data(), 7 }, const_buffer{ large.data() + 7, large.size() - 7 } },
+            compressed);
+        ASSERT_LT(compressed.size(), large.size());
+
+        // a message of exactly the maximum size is fine
+        std::string decompressed;
+        server.decompress(compressed, decompressed, large.size());
+        ASSERT_TRUE(large == decompressed);
+    }
+
+    std::string empty;
+    client.compress(std::vector<const_buffer>(), empty);
+    std::string decompressed;
+    server.decompress(empty, decompressed, unlimited);
+    ASSERT_EQ("", decompressed);
+}
+
+TEST(permessage_deflate, invalid_input_throws)
+{
+    permessage_deflate deflate(compression());
+    ASSERT_TRUE(deflate.accept("permessage-deflate"));
+
+    std::string output;
+    ASSERT_THROW(deflate.decompress(std::string("\xff\xff\xff\xff", 4), output, unlimited), signalr_exception);
+}
+
+TEST(permessage_deflate, message_inflating_beyond_the_maximum_size_throws)
+{
+    permessage_deflate client(compression());
+    permessage_deflate server(compression());
+    ASSERT_TRUE(client.accept("permessage-deflate"));
+    ASSERT_TRUE(server.accept("permessage-deflate"));
+
+    // a few hundred bytes on the wire
+    std::string zeros(1024 * 1024, '\0');
+    std::string compressed;
+    client.compress(buffers(zeros), compressed);
+    ASSERT_LT(compressed.size(), 4096U);
+
+    std::string decompressed;
+    try
+    {
+        server.decompress(compressed, decompressed, 64 * 1024);
+        ASSERT_TRUE(false);
+    }
+    catch (const signalr_exception& e)
+    {
+        ASSERT_STREQ("the server sent a websocket message larger than the maximum message size", e.what());
+    }
+    ASSERT_LE(decompressed.size(), 64U * 1024 + 1);
+}
+
+TEST(permessage_deflate, small_messages_are_not_compressed)
+{
+    permessage_deflate deflate(compression());
+    ASSERT_FALSE(deflate.should_compress(127));
+    ASSERT_TRUE(deflate.should_compress(128));
+}
+
+// Compression ratio and cost of hub invocations, written to the test report (--gtest_output=xml) per protocol, level and
+// context takeover. Context takeover lets every message refer to the ones before it, which is where most of the savings of
+// small, similar messages come from.
+TEST(permessage_deflate, benchmark_hub_invocations)
+{
+    std::vector<std::pair<std::string, std::vector<std::string>>> payloads;
+    payloads.push_back(std::make_pair("json", invocations(json_hub_protocol(), 1000)));
+#ifdef USE_MSGPACK
+    payloads.push_back(std::make_pair("messagepack", invocations(messagepack_hub_protocol(), 1000)));
+#endif
+
+    for (const auto& payload : payloads)
+    {
+        auto uncompressed = total_size(payload.second);
+        for (auto level : { 1, 6, 9 })
+        {
+            std::chrono::microseconds takeover_elapsed, reset_elapsed;
+            auto takeover = roundtrip(payload.second, compression(false, level), takeover_elapsed);
+            auto reset = roundtrip(payload.second, compression(true, level), reset_elapsed);
+
+            auto name = payload.first + "_level" + std::to_string(level);
+            RecordProperty(name + "_takeover_percent", static_cast<int>(takeover * 100 / uncompressed));
+            RecordProperty(name + "_takeover_ns_per_message", static_cast<int>(takeover_elapsed.count() * 1000 / payload.second.size()));
+            RecordProperty(name + "_reset_percent", static_cast<int>(reset * 100 / uncompressed));
+            RecordProperty(name + "_reset_ns_per_message", static_cast<int>(reset_elapsed.count() * 1000 / payload.second.size()));
+
+            ASSERT_LT(takeover, reset) << name;
+            ASSERT_LT(takeover, uncompressed / 2) << name;
+        }
+    }
+}
+
+#endif
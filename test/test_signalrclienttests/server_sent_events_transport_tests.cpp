@@ -0,0 +1,221 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+#include "test_utils.h"
+#include "signalrclient/server_sent_events_parser.h"
+#include "signalrclient/server_sent_events_transport.h"
+#include "signalrclient/native_http_client.h"
+#include "signalrclient/signalr_exception.h"
+#include "memory_log_writer.h"
+
+#ifdef USE_NATIVE_SOCKETS
+#include "native_test_server.h"
+#include "signalrclient/hub_connection_builder.h"
+#include <condition_variable>
+#endif
+
+using namespace signalr;
+
+namespace
+{
+    std::vector<std::string> parse_in_pieces(const std::string& stream, size_t piece_size)
+    {
+        server_sent_events_parser parser;
+        std::vector<std::string> events;
+        for (size_t i = 0; i < stream.size(); i += piece_size)
+        {
+            parser.parse(stream.data() + i, std::min(piece_size, stream.size() - i), events);
+        }
+        return events;
+    }
+}
+
+TEST(server_sent_events_parser, events_are_parsed_regardless_of_how_the_stream_is_split)
+{
+    const std::string stream =
+        ":\r\n"
+        "data: {}\x1e\r\n\r\n"
+        "event: message\nid: 1\nretry: 100\ndata:first\ndata:  second\ndata\n\n"
+        "data: cr\r\rdata: crlf\r\n\r\n"
+        ": comment\r\n"
+        "datum: ignored\r\n\r\n"
+        "data: incomplete";
+
+    const std::vector<std::string> expected{ "{}\x1e", "first\n second\n", "cr", "crlf" };
+    for (size_t piece_size = 1; piece_size <= stream.size(); ++piece_size)
+    {
+        ASSERT_EQ(expected, parse_in_pieces(stream, piece_size)) << "piece size " << piece_size;
+    }
+}
+
+TEST(server_sent_events_parser, event_is_completed_by_a_later_piece)
+{
+    server_sent_events_parser parser;
+    std::vector<std::string> events;
+
+    parser.parse("data: a", 7, events);
+    ASSERT_TRUE(events.empty());
+
+    parser.parse("bc\r", 3, events);
+    ASSERT_TRUE(events.empty());
+
+    parser.parse("\n\r\n", 3, events);
+    ASSERT_EQ(std::vector<std::string>{ "abc" }, events);
+}
+
+#ifdef USE_NATIVE_SOCKETS
+
+namespace
+{
+    class message_collector
+    {
+    public:
+        void add(std::string&& message)
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_messages.push_back(std::move(message));
+            m_changed.notify_all();
+        }
+
+        std::vector<std::string> wait_for(size_t count)
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_changed.wait_for(lock, std::chrono::seconds(5), [this, count]() { return m_messages.size() >= count; });
+            return m_messages;
+        }
+
+    private:
+        std::mutex m_lock;
+        std::condition_variable m_changed;
+        std::vector<std::string> m_messages;
+    };
+
+    std::shared_ptr<transport> create_transport()
+    {
+        return server_sent_events_transport::create([](const signalr_client_config& config)
+            {
+                return std::make_shared<native_http_client>(config);
+            }, signalr_client_config(), logger(std::make_shared<memory_log_writer>(), trace_level::none));
+    }
+
+    void start_transport(const std::shared_ptr<transport>& transport, const std::string& url)
+    {
+        auto mre = manual_reset_event<void>();
+        transport->start(url, [&mre](std::exception_ptr exception)
+            {
+                mre.set(exception);
+            });
+        mre.get();
+    }
+
+    void send_message(const std::shared_ptr<transport>& transport, const std::string& payload,
+        transfer_format transfer_format = transfer_format::text)
+    {
+        auto mre = manual_reset_event<void>();
+        transport->send(payload, transfer_format, [&mre](std::exception_ptr exception)
+            {
+                mre.set(exception);
+            });
+        mre.get();
+    }
+}
+
+TEST(server_sent_events_transport, events_are_received_as_they_are_streamed)
+{
+    native_test_server server;
+    auto transport = create_transport();
+    message_collector messages;
+    transport->on_receive([&messages](std::string&& message, std::exception_ptr)
+        {
+            messages.add(std::move(message));
+        });
+    start_transport(transport, server.url("/hub?id=token"));
+
+    // the stream stays open, every event is handed over as soon as its piece arrived
+    ASSERT_TRUE(server.write_event_stream(":\r\n\r\ndata: {\"type\":6}\x1e\r\n"));
+    ASSERT_TRUE(server.write_event_stream("\r\ndata: part"));
+    ASSERT_EQ(std::vector<std::string>{ "{\"type\":6}\x1e" }, messages.wait_for(1));
+
+    ASSERT_TRUE(server.write_event_stream("ial\r\n\r\n"));
+    ASSERT_EQ((std::vector<std::string>{ "{\"type\":6}\x1e", "partial" }), messages.wait_for(2));
+
+    // the stand-in server echoes posted messages as events
+    send_message(transport, "{\"type\":1,\"target\":\"echo\",\"arguments\":[]}\x1e");
+    ASSERT_EQ("{\"type\":1,\"target\":\"echo\",\"arguments\":[]}\x1e", messages.wait_for(3)[2]);
+    ASSERT_EQ(2, server.requests());
+    ASSERT_EQ(1, server.event_streams());
+
+    ASSERT_THROW(send_message(transport, "binary", transfer_format::binary), signalr_exception);
+
+    auto closed = manual_reset_event<void>();
+    transport->on_close([&closed](std::exception_ptr exception)
+        {
+            closed.set(exception);
+        });
+    auto stopped = manual_reset_event<void>();
+    transport->stop([&stopped](std::exception_ptr exception)
+        {
+            stopped.set(exception);
+        });
+    stopped.get();
+    closed.get();
+
+    ASSERT_THROW(send_message(transport, "{}\x1e"), signalr_exception);
+}
+
+TEST(server_sent_events_transport, server_closing_the_stream_closes_the_transport)
+{
+    auto server = std::unique_ptr<native_test_server>(new native_test_server());
+    auto transport = create_transport();
+    auto closed = manual_reset_event<void>();
+    transport->on_close([&closed](std::exception_ptr exception)
+        {
+            closed.set(exception);
+        });
+    start_transport(transport, server->url("/hub?id=token"));
+
+    server.reset();
+    ASSERT_THROW(closed.get(), signalr_exception);
+}
+
+TEST(server_sent_events_transport, hub_connection_falls_back_to_server_sent_events_if_websockets_fail)
+{
+    native_test_server server;
+    server.set_transports("{ \"transport\": \"WebSockets\", \"transferFormats\": [ \"Text\", \"Binary\" ] }, "
+        "{ \"transport\": \"ServerSentEvents\", \"transferFormats\": [ \"Text\" ] }");
+    server.reject_upgrades = true;
+
+    auto hub_connection = hub_connection_builder::create(server.url("/hub"))
+        .with_logging(std::make_shared<memory_log_writer>(), trace_level::none)
+        .build();
+
+    auto echoed = manual_reset_event<std::string>();
+    hub_connection.on("echo", [&echoed](const std::vector<signalr::value>& arguments)
+        {
+            echoed.set(arguments[0].as_string());
+        });
+
+    auto mre = manual_reset_event<void>();
+    hub_connection.start([&mre](std::exception_ptr exception)
+        {
+            mre.set(exception);
+        });
+    mre.get();
+
+    ASSERT_EQ(0, server.upgrades());
+    ASSERT_EQ(1, server.event_streams());
+
+    // the server echoes the invocation back to the client
+    hub_connection.send("echo", std::vector<signalr::value>{ "over server-sent events" });
+    ASSERT_EQ("over server-sent events", echoed.get());
+
+    hub_connection.stop([&mre](std::exception_ptr exception)
+        {
+            mre.set(exception);
+        });
+    mre.get();
+}
+
+#endif
@@ -0,0 +1,82 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// See the LICENSE file in the project root for more information.
+
+#include "stdafx.h"
+#include "strand.h"
+#include "signalr_default_scheduler.h"
+#include "test_utils.h"
+
+using namespace signalr;
+
+TEST(strand, runs_tasks_one_at_a_time_in_order)
+{
+    auto scheduler = std::make_shared<signalr_default_scheduler>();
+    auto s = std::make_shared<strand>(scheduler);
+
+    std::mutex lock;
+    std::vector<int> order;
+    std::atomic<int> running(0);
+    std::atomic<bool> overlapped(false);
+    auto done = manual_reset_event<void>();
+
+    for (int i = 0; i < 100; ++i)
+    {
+        s->post([i, &lock, &order, &running, &overlapped, &done]()
+            {
+                if (++running > 1)
+                {
+                    overlapped = true;
+                }
+
+                {
+                    std::lock_guard<std::mutex> l(lock);
+                    order.push_back(i);
+                }
+
+                --running;
+                if (i == 99)
+                {
+                    done.set();
+                }
+            });
+    }
+
+    done.get();
+
+    ASSERT_FALSE(overlapped);
+    ASSERT_EQ(100, order.size());
+    for (int i = 0; i < 100; ++i)
+    {
+        ASSERT_EQ(i, order[i]);
+    }
+}
+
+TEST(strand, different_strands_run_in_parallel)
+{
+    auto scheduler = std::make_shared<signalr_default_scheduler>();
+    auto first = std::make_shared<strand>(scheduler);
+    auto second = std::make_shared<strand>(scheduler);
+
+    auto release_first = std::make_shared<manual_reset_event<void>>();
+    auto second_ran = manual_reset_event<void>();
+
+    first->post([release_first]() { release_first->get(); });
+    // the first strand is blocked, the second one must still make progress
+    second->post([&second_ran]() { second_ran.set(); });
+
+    second_ran.get();
+    release_first->set();
+}
+
+TEST(strand, throwing_task_does_not_stop_the_strand)
+{
+    auto scheduler = std::make_shared<signalr_default_scheduler>();
+    auto s = std::make_shared<strand>(scheduler);
+
+    auto done = manual_reset_event<void>();
+    s->post([]() { throw std::runtime_error("oops"); });
+    s->post([&done]() { done.set(); });
+
+    done.get();
+}
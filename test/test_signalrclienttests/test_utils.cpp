@@ -169,7 +169,7 @@ void assert_hub_message_equality(signalr::hub_message* expected, signalr::hub_me
         ASSERT_STREQ(expected_message->invocation_id.data(), actual_message->invocation_id.data());
         ASSERT_STREQ(expected_message->target.data(), actual_message->target.data());
         assert_signalr_value_equality(expected_message->arguments, actual_message->arguments);
-        //stream_ids
+        ASSERT_EQ(expected_message->stream_ids, actual_message->stream_ids);
         break;
     }
     case message_type::completion:
@@ -184,6 +184,16 @@ void assert_hub_message_equality(signalr::hub_message* expected, signalr::hub_me
 
         break;
     }
+    case message_type::stream_item:
+    {
+        auto expected_message = reinterpret_cast<stream_item_message*>(expected);
+        auto actual_message = reinterpret_cast<stream_item_message*>(actual);
+
+        ASSERT_STREQ(expected_message->invocation_id.data(), actual_message->invocation_id.data());
+        assert_signalr_value_equality(expected_message->item, actual_message->item);
+
+        break;
+    }
     case message_type::ping:
     {
         // No fields on ping messages currently
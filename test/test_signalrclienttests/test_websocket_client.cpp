@@ -64,6 +64,8 @@ void test_websocket_client::start(const std::string& url, std::function<void(std
     m_receive_message_event = manual_reset_event<bool>();
     m_receive_waiting = manual_reset_event<void>();
     m_receive_loop_not_running.cancel();
+    // an error the previous connection was closed with must not close the new one
+    m_receive_exception = nullptr;
 
     handshake_sent.reset();
     receive_loop_started.reset();
@@ -112,12 +114,31 @@ void test_websocket_client::send(const std::string& payload, signalr::transfer_f
     auto l_ignore_pings = ignore_pings;
     m_scheduler->schedule([payload, callback, local_copy, l_ignore_pings]()
         {
-            if (l_ignore_pings && payload.find("\"type\":6") != -1)
+            auto message = payload;
+            if (l_ignore_pings)
             {
-                callback(nullptr);
-                return;
+                // the transport can coalesce pings with other messages so only the ping records are removed
+                message.clear();
+                size_t start = 0;
+                while (start < payload.size())
+                {
+                    auto end = payload.find('\x1e', start);
+                    end = end == std::string::npos ? payload.size() : end + 1;
+                    auto record = payload.substr(start, end - start);
+                    if (record.find("\"type\":6") == std::string::npos)
+                    {
+                        message.append(record);
+                    }
+                    start = end;
+                }
+
+                if (message.empty())
+                {
+                    callback(nullptr);
+                    return;
+                }
             }
-            (*local_copy)(payload, callback);
+            (*local_copy)(message, callback);
         });
 }
 
@@ -236,6 +236,338 @@ TEST(websocket_transport_send, send_creates_and_sends_websocket_messages)
     mre.get();
 }
 
+TEST(websocket_transport_send, sends_queued_behind_a_send_in_progress_are_coalesced)
+{
+    auto sent = std::make_shared<std::vector<std::string>>();
+    auto held_send = std::make_shared<manual_reset_event<std::function<void(std::exception_ptr)>>>();
+    auto sent_lock = std::make_shared<std::mutex>();
+
+    auto client = std::make_shared<test_websocket_client>();
+    client->set_send_function([sent, sent_lock, held_send](const std::string& payload, std::function<void(std::exception_ptr)> callback)
+    {
+        std::lock_guard<std::mutex> lock(*sent_lock);
+        sent->push_back(payload);
+        if (sent->size() == 1)
+        {
+            // keep the first send in progress so the following ones queue up behind it
+            held_send->set(callback);
+            return;
+        }
+        callback(nullptr);
+    });
+
+    signalr_client_config config;
+    config.set_max_send_batch_size(4);
+    auto ws_transport = websocket_transport::create([&](const signalr_client_config& config)
+        {
+            client->set_config(config);
+            return client;
+        }, config, logger(std::make_shared<trace_log_writer>(), trace_level::none));
+
+    auto mre = manual_reset_event<void>();
+    ws_transport->start("ws://url", [&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+    mre.get();
+
+    auto completed = std::make_shared<std::atomic<int>>(0);
+    auto all_completed = std::make_shared<manual_reset_event<void>>();
+    auto on_sent = [completed, all_completed](std::exception_ptr)
+    {
+        if (++(*completed) == 6)
+        {
+            all_completed->set();
+        }
+    };
+
+    ws_transport->send("AA", transfer_format::text, on_sent);
+    auto release_send = held_send->get();
+
+    ws_transport->send("BB", transfer_format::text, on_sent);
+    ws_transport->send("CC", transfer_format::text, on_sent);
+    ws_transport->send("DD", transfer_format::text, on_sent);
+    ws_transport->send("EE", transfer_format::binary, on_sent);
+    ws_transport->send("FF", transfer_format::binary, on_sent);
+
+    release_send(nullptr);
+    all_completed->get();
+
+    {
+        std::lock_guard<std::mutex> lock(*sent_lock);
+        ASSERT_EQ(4, sent->size());
+        ASSERT_EQ("AA", (*sent)[0]);
+        // coalescing stops at the max batch size and at a change of the transfer format
+        ASSERT_EQ("BBCC", (*sent)[1]);
+        ASSERT_EQ("DD", (*sent)[2]);
+        ASSERT_EQ("EEFF", (*sent)[3]);
+    }
+
+    ws_transport->stop([&mre](std::exception_ptr exception)
+        {
+            mre.set(exception);
+        });
+    mre.get();
+}
+
+TEST(websocket_transport_send, queued_sends_with_the_same_conflation_key_are_replaced)
+{
+    auto sent = std::make_shared<std::vector<std::string>>();
+    auto held_send = std::make_shared<manual_reset_event<std::function<void(std::exception_ptr)>>>();
+    auto sent_lock = std::make_shared<std::mutex>();
+
+    auto client = std::make_shared<test_websocket_client>();
+    client->set_send_function([sent, sent_lock, held_send](const std::string& payload, std::function<void(std::exception_ptr)> callback)
+    {
+        std::lock_guard<std::mutex> lock(*sent_lock);
+        sent->push_back(payload);
+        if (sent->size() == 1)
+        {
+            held_send->set(callback);
+            return;
+        }
+        callback(nullptr);
+    });
+
+    auto ws_transport = websocket_transport::create([&](const signalr_client_config& config)
+        {
+            client->set_config(config);
+            return client;
+        }, signalr_client_config(), logger(std::make_shared<trace_log_writer>(), trace_level::none));
+
+    auto mre = manual_reset_event<void>();
+    ws_transport->start("ws://url", [&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+    mre.get();
+
+    auto completed = std::make_shared<std::atomic<int>>(0);
+    auto all_completed = std::make_shared<manual_reset_event<void>>();
+    auto on_sent = [completed, all_completed](std::exception_ptr)
+    {
+        if (++(*completed) == 6)
+        {
+            all_completed->set();
+        }
+    };
+
+    ws_transport->send("A1", transfer_format::text, on_sent, send_priority::data, "a");
+    auto release_send = held_send->get();
+
+    ws_transport->send("A2", transfer_format::text, on_sent, send_priority::data, "a");
+    ws_transport->send("B1", transfer_format::text, on_sent, send_priority::data, "b");
+    ws_transport->send("A3", transfer_format::text, on_sent, send_priority::data, "a");
+    ws_transport->send("CC", transfer_format::text, on_sent);
+    ws_transport->send("A4", transfer_format::text, on_sent, send_priority::data, "a");
+
+    release_send(nullptr);
+    all_completed->get();
+
+    {
+        std::lock_guard<std::mutex> lock(*sent_lock);
+        ASSERT_EQ(2, sent->size());
+        // the send in progress can't be replaced anymore, queued ones keep their place in the queue
+        ASSERT_EQ("A1", (*sent)[0]);
+        ASSERT_EQ("A4B1CC", (*sent)[1]);
+    }
+
+    ws_transport->stop([&mre](std::exception_ptr exception)
+        {
+            mre.set(exception);
+        });
+    mre.get();
+}
+
+TEST(websocket_transport_send, sends_wait_for_max_delay_when_not_flushing_on_idle)
+{
+    auto sent = std::make_shared<std::vector<std::string>>();
+    auto sent_lock = std::make_shared<std::mutex>();
+
+    auto client = std::make_shared<test_websocket_client>();
+    client->set_send_function([sent, sent_lock](const std::string& payload, std::function<void(std::exception_ptr)> callback)
+    {
+        {
+            std::lock_guard<std::mutex> lock(*sent_lock);
+            sent->push_back(payload);
+        }
+        callback(nullptr);
+    });
+
+    signalr_client_config config;
+    config.set_flush_on_idle(false);
+    config.set_max_send_delay(std::chrono::milliseconds(100));
+    auto ws_transport = websocket_transport::create([&](const signalr_client_config& config)
+        {
+            client->set_config(config);
+            return client;
+        }, config, logger(std::make_shared<trace_log_writer>(), trace_level::none));
+
+    auto mre = manual_reset_event<void>();
+    ws_transport->start("ws://url", [&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+    mre.get();
+
+    auto first_sent = manual_reset_event<void>();
+    ws_transport->send("A", transfer_format::text, [&first_sent](std::exception_ptr exception) { first_sent.set(exception); });
+    ws_transport->send("B", transfer_format::text, [&mre](std::exception_ptr exception) { mre.set(exception); });
+    first_sent.get();
+    mre.get();
+
+    {
+        std::lock_guard<std::mutex> lock(*sent_lock);
+        ASSERT_EQ(1, sent->size());
+        ASSERT_EQ("AB", (*sent)[0]);
+    }
+
+    ws_transport->stop([&mre](std::exception_ptr exception)
+        {
+            mre.set(exception);
+        });
+    mre.get();
+}
+
+TEST(websocket_transport_send, control_frame_does_not_wait_for_a_lingering_data_batch)
+{
+    auto sent = std::make_shared<std::vector<std::string>>();
+    auto sent_lock = std::make_shared<std::mutex>();
+
+    auto client = std::make_shared<test_websocket_client>();
+    client->set_send_function([sent, sent_lock](const std::string& payload, std::function<void(std::exception_ptr)> callback)
+    {
+        {
+            std::lock_guard<std::mutex> lock(*sent_lock);
+            sent->push_back(payload);
+        }
+        callback(nullptr);
+    });
+
+    signalr_client_config config;
+    config.set_flush_on_idle(false);
+    config.set_max_send_delay(std::chrono::seconds(5));
+    auto ws_transport = websocket_transport::create([&](const signalr_client_config& config)
+        {
+            client->set_config(config);
+            return client;
+        }, config, logger(std::make_shared<trace_log_writer>(), trace_level::none));
+
+    auto mre = manual_reset_event<void>();
+    ws_transport->start("ws://url", [&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+    mre.get();
+
+    const auto start = std::chrono::steady_clock::now();
+    auto data_sent = manual_reset_event<void>();
+    ws_transport->send("A", transfer_format::text, [&data_sent](std::exception_ptr exception) { data_sent.set(exception); });
+    ws_transport->send("C", transfer_format::text, [&mre](std::exception_ptr exception) { mre.set(exception); }, send_priority::control);
+    mre.get();
+    data_sent.get();
+
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+    {
+        std::lock_guard<std::mutex> lock(*sent_lock);
+        ASSERT_EQ((std::vector<std::string>{ "C", "A" }), *sent);
+    }
+
+    ws_transport->stop([&mre](std::exception_ptr exception)
+        {
+            mre.set(exception);
+        });
+    mre.get();
+}
+
+TEST(websocket_transport_send, control_frames_are_written_ahead_of_queued_data)
+{
+    auto sent = std::make_shared<std::vector<std::string>>();
+    auto sent_lock = std::make_shared<std::mutex>();
+    auto held_send = std::make_shared<manual_reset_event<std::function<void(std::exception_ptr)>>>();
+    auto ping_sent = std::make_shared<manual_reset_event<void>>();
+
+    auto client = std::make_shared<test_websocket_client>();
+    client->ignore_pings = false;
+    client->set_send_function([sent, sent_lock, held_send, ping_sent](const std::string& payload, std::function<void(std::exception_ptr)> callback)
+    {
+        {
+            std::lock_guard<std::mutex> lock(*sent_lock);
+            sent->push_back(payload.size() > 64 ? std::string("data") : payload);
+            if (sent->size() == 1)
+            {
+                held_send->set(callback);
+                return;
+            }
+        }
+
+        if (payload.find("\"type\":6") != std::string::npos)
+        {
+            ping_sent->set();
+        }
+        callback(nullptr);
+    });
+
+    const size_t chunk_size = 64 * 1024;
+    signalr_client_config config;
+    config.set_max_send_batch_size(chunk_size);
+    auto ws_transport = websocket_transport::create([&](const signalr_client_config& config)
+        {
+            client->set_config(config);
+            return client;
+        }, config, logger(std::make_shared<trace_log_writer>(), trace_level::none));
+
+    auto mre = manual_reset_event<void>();
+    ws_transport->start("ws://url", [&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+    mre.get();
+
+    // queue a 50 MB argument behind a send that is still in progress
+    const auto chunk = std::string(chunk_size, 'x');
+    const size_t chunks = 50 * 1024 * 1024 / chunk_size;
+    auto completed = std::make_shared<std::atomic<size_t>>(0);
+    auto data_sent = std::make_shared<manual_reset_event<void>>();
+    for (size_t i = 0; i < chunks; ++i)
+    {
+        ws_transport->send(chunk, transfer_format::text, [completed, data_sent, chunks](std::exception_ptr)
+            {
+                if (++(*completed) == chunks)
+                {
+                    data_sent->set();
+                }
+            });
+    }
+    auto release_send = held_send->get();
+
+    auto ping_queued = std::chrono::steady_clock::now();
+    ws_transport->send("{\"type\":6}\x1e", transfer_format::text, [](std::exception_ptr) {}, send_priority::control);
+    release_send(nullptr);
+    ping_sent->get();
+    auto ping_latency = std::chrono::steady_clock::now() - ping_queued;
+
+    {
+        // the ping only waited for the send that was already in progress
+        std::lock_guard<std::mutex> lock(*sent_lock);
+        ASSERT_LE(2u, sent->size());
+        ASSERT_EQ("{\"type\":6}\x1e", (*sent)[1]);
+    }
+    ASSERT_GT(std::chrono::seconds(1), ping_latency);
+
+    data_sent->get();
+    {
+        std::lock_guard<std::mutex> lock(*sent_lock);
+        ASSERT_EQ(chunks + 1, sent->size());
+    }
+
+    ws_transport->stop([&mre](std::exception_ptr exception)
+        {
+            mre.set(exception);
+        });
+    mre.get();
+}
+
 TEST(websocket_transport_disconnect, disconnect_closes_websocket)
 {
     bool close_called = false;
@@ -713,4 +1045,303 @@ TEST(websocket_client_custom_impl, caching_callbacks_does_not_leak)
         mre.set(exception);
     });
     mre.get();
-}
\ No newline at end of file
+}
+class persistent_test_websocket_client : public persistent_websocket_client
+{
+public:
+    void start(const std::string&, std::function<void(std::exception_ptr)> callback) override
+    {
+        callback(nullptr);
+    }
+
+    void stop(std::function<void(std::exception_ptr)> callback) override
+    {
+        callback(nullptr);
+    }
+
+    void send(const std::string&, signalr::transfer_format, std::function<void(std::exception_ptr)> callback) override
+    {
+        callback(nullptr);
+    }
+
+    void on_message(std::function<void(const std::string&, std::exception_ptr)> handler) override
+    {
+        ++on_message_calls;
+        m_handler = handler;
+    }
+
+    void on_message_batch(std::function<void(std::vector<std::string>&&)> handler) override
+    {
+        m_batch_handler = handler;
+    }
+
+    void pause_receive() override
+    {
+        ++pause_calls;
+    }
+
+    void resume_receive() override
+    {
+        ++resume_calls;
+    }
+
+    void deliver(const std::string& message)
+    {
+        m_handler(message, nullptr);
+    }
+
+    void deliver_batch(std::vector<std::string> messages)
+    {
+        m_batch_handler(std::move(messages));
+    }
+
+    int on_message_calls = 0;
+    int pause_calls = 0;
+    int resume_calls = 0;
+
+private:
+    std::function<void(const std::string&, std::exception_ptr)> m_handler;
+    std::function<void(std::vector<std::string>&&)> m_batch_handler;
+};
+
+TEST(websocket_client_custom_impl, persistent_client_delivers_messages_to_the_handler_registered_once)
+{
+    auto client = std::make_shared<persistent_test_websocket_client>();
+    auto ws_transport = websocket_transport::create([client](const signalr_client_config&)
+        {
+            return client;
+        }, signalr_client_config{}, logger(std::make_shared<trace_log_writer>(), trace_level::none));
+
+    std::vector<std::string> received;
+    ws_transport->on_receive([&received](std::string&& message, std::exception_ptr)
+    {
+        received.push_back(message);
+    });
+
+    auto mre = manual_reset_event<void>();
+    ws_transport->start("ws://fakeuri.org", [&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+    mre.get();
+
+    client->deliver("a");
+    client->deliver("b");
+    ws_transport->pause_receive();
+    ws_transport->resume_receive();
+    client->deliver("c");
+
+    ws_transport->stop([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+    mre.get();
+
+    ASSERT_EQ(std::vector<std::string>({ "a", "b", "c" }), received);
+    ASSERT_EQ(1, client->on_message_calls);
+    ASSERT_EQ(1, client->pause_calls);
+    ASSERT_EQ(1, client->resume_calls);
+}
+
+TEST(websocket_client_custom_impl, batches_are_delivered_in_one_callback_or_split_if_there_is_no_batch_callback)
+{
+    auto client = std::make_shared<persistent_test_websocket_client>();
+    auto ws_transport = websocket_transport::create([client](const signalr_client_config&)
+        {
+            return client;
+        }, signalr_client_config{}, logger(std::make_shared<trace_log_writer>(), trace_level::none));
+
+    std::vector<std::string> received;
+    ws_transport->on_receive([&received](std::string&& message, std::exception_ptr)
+    {
+        received.push_back(message);
+    });
+
+    auto mre = manual_reset_event<void>();
+    ws_transport->start("ws://fakeuri.org", [&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+    mre.get();
+
+    client->deliver_batch({ "a", "b" });
+    ASSERT_EQ(std::vector<std::string>({ "a", "b" }), received);
+
+    std::vector<std::vector<std::string>> batches;
+    ws_transport->on_receive_batch([&batches](std::vector<std::string>&& messages)
+    {
+        batches.push_back(std::move(messages));
+    });
+
+    client->deliver_batch({ "c", "d", "e" });
+    client->deliver("f");
+
+    ws_transport->stop([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+    mre.get();
+
+    ASSERT_EQ(std::vector<std::string>({ "a", "b", "f" }), received);
+    ASSERT_EQ(1U, batches.size());
+    ASSERT_EQ(std::vector<std::string>({ "c", "d", "e" }), batches[0]);
+}
+
+// records whether payloads were sent as one string or as buffers, the first send is held until `release_first_send`
+class scatter_gather_websocket_client : public persistent_test_websocket_client
+{
+public:
+    void send(const std::string& payload, signalr::transfer_format, std::function<void(std::exception_ptr)> callback) override
+    {
+        sends.push_back("string:" + payload);
+        if (sends.size() == 1)
+        {
+            m_first_send_callback = callback;
+            return;
+        }
+        callback(nullptr);
+    }
+
+    void send(const std::vector<const_buffer>& buffers, signalr::transfer_format, std::function<void(std::exception_ptr)> callback) override
+    {
+        std::string send = std::to_string(buffers.size()) + " buffers:";
+        for (const auto& buffer : buffers)
+        {
+            send.append(buffer.data, buffer.size);
+        }
+        sends.push_back(send);
+        callback(nullptr);
+    }
+
+    void release_first_send()
+    {
+        m_first_send_callback(nullptr);
+    }
+
+    std::vector<std::string> sends;
+
+private:
+    std::function<void(std::exception_ptr)> m_first_send_callback;
+};
+
+TEST(websocket_client_custom_impl, coalesced_sends_are_passed_to_the_client_as_buffers)
+{
+    auto client = std::make_shared<scatter_gather_websocket_client>();
+    auto ws_transport = websocket_transport::create([client](const signalr_client_config&)
+        {
+            return client;
+        }, signalr_client_config{}, logger(std::make_shared<trace_log_writer>(), trace_level::none));
+
+    auto mre = manual_reset_event<void>();
+    ws_transport->start("ws://fakeuri.org", [&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+    mre.get();
+
+    int completed = 0;
+    auto on_sent = [&completed](std::exception_ptr exception)
+    {
+        ASSERT_EQ(nullptr, exception);
+        ++completed;
+    };
+
+    ws_transport->send("AA", transfer_format::text, on_sent);
+    ws_transport->send("BB", transfer_format::text, on_sent);
+    ws_transport->send("CC", transfer_format::text, on_sent);
+    ws_transport->send("DD", transfer_format::text, on_sent);
+    client->release_first_send();
+
+    ws_transport->stop([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+    mre.get();
+
+    ASSERT_EQ(4, completed);
+    ASSERT_EQ(std::vector<std::string>({ "string:AA", "3 buffers:BBCCDD" }), client->sends);
+}
+
+// completes `receive` on the calling thread until `message_count` messages were received
+class synchronous_websocket_client : public websocket_client
+{
+public:
+    explicit synchronous_websocket_client(int message_count)
+        : m_remaining(message_count)
+    { }
+
+    void start(const std::string&, std::function<void(std::exception_ptr)> callback) override
+    {
+        std::thread([callback]() { callback(nullptr); }).detach();
+    }
+
+    void stop(std::function<void(std::exception_ptr)> callback) override
+    {
+        std::function<void(const std::string&, std::exception_ptr)> pending_receive;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            pending_receive = std::move(m_pending_receive);
+        }
+
+        if (pending_receive)
+        {
+            pending_receive("", nullptr);
+        }
+        callback(nullptr);
+    }
+
+    void send(const std::string&, signalr::transfer_format, std::function<void(std::exception_ptr)> callback) override
+    {
+        callback(nullptr);
+    }
+
+    void receive(std::function<void(const std::string&, std::exception_ptr)> callback) override
+    {
+        if (m_remaining > 0)
+        {
+            --m_remaining;
+            callback("message", nullptr);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_pending_receive = callback;
+    }
+
+private:
+    int m_remaining;
+    std::mutex m_lock;
+    std::function<void(const std::string&, std::exception_ptr)> m_pending_receive;
+};
+
+TEST(websocket_client_custom_impl, synchronously_completing_receive_does_not_grow_the_stack)
+{
+    // deep enough to overflow the stack if every message re-armed `receive` from within the previous callback
+    const int message_count = 200000;
+
+    auto ws_transport = websocket_transport::create([message_count](const signalr_client_config&)
+        {
+            return std::make_shared<synchronous_websocket_client>(message_count);
+        }, signalr_client_config{}, logger(std::make_shared<trace_log_writer>(), trace_level::none));
+
+    auto received = std::make_shared<std::atomic<int>>(0);
+    ws_transport->on_receive([received](std::string&&, std::exception_ptr)
+    {
+        ++*received;
+    });
+
+    auto mre = manual_reset_event<void>();
+    ws_transport->start("ws://fakeuri.org", [&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+    mre.get();
+
+    ASSERT_EQ(message_count, received->load());
+
+    ws_transport->stop([&mre](std::exception_ptr exception)
+    {
+        mre.set(exception);
+    });
+    mre.get();
+}